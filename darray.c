@@ -1,15 +1,85 @@
+#ifndef _POSIX_C_SOURCE
+#   define _POSIX_C_SOURCE 200809L // sysconf
+#endif
 #include "darray.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)            \
+    && (defined(__x86_64__) || defined(__i386__))
+#   define DA_X86_SIMD 1
+#   include <immintrin.h>
+#   define DA_TARGET_AVX2 __attribute__((target("avx2")))
+#   define DA_AVX2_INLINE                                                      \
+        inline __attribute__((always_inline, target("avx2")))
+#else
+#   define DA_X86_SIMD 0
+#endif
 
 ////////////////////////////////// DARRAY CORE /////////////////////////////////
-static inline void _da_memswap(void* p1, void* p2, size_t sz)
+#if defined(__GNUC__) || defined(__clang__) // GNU C compiler attributes
+#   define DA_ALWAYS_INLINE inline __attribute__((always_inline))
+#   define DA_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#   define DA_ALWAYS_INLINE inline
+#   define DA_PREFETCH(addr) ((void)(addr))
+#endif // !GNU C compiler attributes
+
+#define DA_SWAP_BUFFER_SIZE 64
+#define DA_CACHE_LINE_SIZE 64
+
+static DA_ALWAYS_INLINE void _da_memswap(void* p1, void* p2, size_t sz)
+{
+    // Swapping through a fixed size buffer lets the compiler use full word
+    // (or vector) loads and stores rather than exchanging byte by byte.
+    char tmp[DA_SWAP_BUFFER_SIZE], *a = p1, *b = p2;
+    while (sz >= DA_SWAP_BUFFER_SIZE)
+    {
+        memcpy(tmp, a, DA_SWAP_BUFFER_SIZE);
+        memcpy(a, b, DA_SWAP_BUFFER_SIZE);
+        memcpy(b, tmp, DA_SWAP_BUFFER_SIZE);
+        a += DA_SWAP_BUFFER_SIZE;
+        b += DA_SWAP_BUFFER_SIZE;
+        sz -= DA_SWAP_BUFFER_SIZE;
+    }
+    memcpy(tmp, a, sz);
+    memcpy(a, b, sz);
+    memcpy(b, tmp, sz);
+}
+
+static inline struct da_mem_funcs _da_mem_funcs(const void* darr)
 {
-    char tmp, *a = p1, *b = p2;
-    for (size_t i = 0; i < sz; ++i)
+    return ((struct _darray*)DA_P_HEAD_FROM_HANDLE(darr))->_mem_funcs;
+}
+
+// Index of the lowest set bit of `x`, which must not be 0.
+static inline unsigned _da_ctz64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned n = 0;
+    while ((x & 1) == 0)
     {
-        tmp = a[i];
-        a[i] = b[i];
-        b[i] = tmp;
+        x >>= 1;
+        n += 1;
     }
+    return n;
+#endif
+}
+
+static inline unsigned _da_popcount64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & UINT64_C(0x5555555555555555));
+    x = (x & UINT64_C(0x3333333333333333))
+        + ((x >> 2) & UINT64_C(0x3333333333333333));
+    x = (x + (x >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+    return (unsigned)((x * UINT64_C(0x0101010101010101)) >> 56);
+#endif
 }
 
 void* da_alloc(size_t nelem, size_t size)
@@ -157,6 +227,8 @@ void da_remove_arr(void* darr, size_t index, size_t nelem)
 
 void da_swap(void* darr, size_t index_a, size_t index_b)
 {
+    if (index_a == index_b)
+        return;
     size_t size = da_sizeof_elem(darr);
     _da_memswap(
         ((char*)darr) + (index_a*size),
@@ -165,366 +237,6091 @@ void da_swap(void* darr, size_t index_a, size_t index_b)
     );
 }
 
-void* da_concat(void* dest, const void* src, size_t nelem)
-{
-    size_t offset = da_length(dest)*da_sizeof_elem(dest);
-    dest = da_reserve(dest, nelem);
-    if (dest == NULL)
-        return NULL;
-    memcpy((char*)dest+offset, src, nelem*da_sizeof_elem(dest));
-    *DA_P_LENGTH_FROM_HANDLE(dest) += nelem;
-    return dest;
-}
-
-/////////////////////////////////// DSTRING ////////////////////////////////////
-darray(char) dstr_alloc_empty(void)
-{
-    char* dstr = da_alloc(1, sizeof(char));
-    if (dstr == NULL)
-        return NULL;
-    dstr[0] = '\0';
-    return dstr;
-}
-
-darray(char) dstr_alloc_cstr(const char* src)
+static DA_ALWAYS_INLINE void _da_reverse_impl(char* first, size_t nelem,
+    size_t size)
 {
-    size_t src_len_with_nullterm = strlen(src)+1;
-    char* dstr = da_alloc(src_len_with_nullterm, sizeof(char));
-    if (dstr == NULL)
-        return NULL;
-    memcpy(dstr, src, src_len_with_nullterm);
-    return dstr;
+    char* last = first + (nelem-1)*size;
+    for (size_t i = 0; i < nelem/2; ++i)
+        _da_memswap(first + i*size, last - i*size, size);
 }
 
-darray(char) dstr_alloc_dstr(const darray(char) src)
+static void _da_reverse(char* first, size_t nelem, size_t size)
 {
-    size_t src_len_with_nullterm = da_length(src);
-    char* dstr = da_alloc(src_len_with_nullterm, sizeof(char));
-    if (dstr == NULL)
-        return NULL;
-    memcpy(dstr, src, src_len_with_nullterm);
-    return dstr;
+    if (nelem < 2)
+        return;
+    // Dispatch on common element sizes so that each swap compiles down to a
+    // pair of register moves the compiler is able to vectorize.
+    switch (size)
+    {
+    case 1:  _da_reverse_impl(first, nelem, 1);  break;
+    case 2:  _da_reverse_impl(first, nelem, 2);  break;
+    case 4:  _da_reverse_impl(first, nelem, 4);  break;
+    case 8:  _da_reverse_impl(first, nelem, 8);  break;
+    case 16: _da_reverse_impl(first, nelem, 16); break;
+    default: _da_reverse_impl(first, nelem, size); break;
+    }
 }
 
-darray(char) dstr_alloc_format(const char* format, ...)
+static void _da_rotate(char* first, size_t nelem, size_t k, size_t size)
 {
-    va_list args;
-    va_start(args, format);
-
-    va_list copy;
-    va_copy(copy, args);
-    size_t size = vsnprintf(NULL, 0, format, copy) + 1 /* +1 for '\0' */;
-    va_end(copy);
+    if (nelem == 0 || (k %= nelem) == 0)
+        return;
 
-    char* dstr = da_alloc(size, sizeof(char));
-    if (dstr == NULL)
-        return NULL;
-    vsprintf(dstr, format, args);
+    // Short rotations are handled by stashing the smaller side on the stack
+    // and sliding the rest of the range over with a single memmove.
+    char tmp[DA_SWAP_BUFFER_SIZE*4];
+    if (k*size <= sizeof(tmp))
+    {
+        memcpy(tmp, first, k*size);
+        memmove(first, first + k*size, (nelem-k)*size);
+        memcpy(first + (nelem-k)*size, tmp, k*size);
+        return;
+    }
+    if ((nelem-k)*size <= sizeof(tmp))
+    {
+        memcpy(tmp, first + k*size, (nelem-k)*size);
+        memmove(first + (nelem-k)*size, first, k*size);
+        memcpy(first, tmp, (nelem-k)*size);
+        return;
+    }
 
-    va_end(args);
-    return dstr;
+    // Gries-Mills block swap rotation. The blocks [first, first+k) and
+    // [first+k, first+nelem) are repeatedly swapped in place until they are
+    // of equal length.
+    size_t i = k;
+    size_t j = nelem - k;
+    while (i != j)
+    {
+        if (i < j)
+        {
+            _da_memswap(first + (k-i)*size, first + (k+j-i)*size, i*size);
+            j -= i;
+        }
+        else
+        {
+            _da_memswap(first + (k-i)*size, first + k*size, j*size);
+            i -= j;
+        }
+    }
+    _da_memswap(first + (k-i)*size, first + k*size, i*size);
 }
 
-darray(char) dstr_alloc_empty_custom(struct da_mem_funcs mem_funcs)
+void da_reverse(void* darr)
 {
-    char* dstr = da_alloc_custom(mem_funcs, 1, sizeof(char));
-    if (dstr == NULL)
-        return NULL;
-    dstr[0] = '\0';
-    return dstr;
+    _da_reverse(darr, da_length(darr), da_sizeof_elem(darr));
 }
 
-darray(char) dstr_alloc_cstr_custom(struct da_mem_funcs mem_funcs,
-    const char* src)
+void da_reverse_range(void* darr, size_t index, size_t nelem)
 {
-    size_t src_len_with_nullterm = strlen(src)+1;
-    char* dstr = da_alloc_custom(mem_funcs, src_len_with_nullterm, sizeof(char));
-    if (dstr == NULL)
-        return NULL;
-    memcpy(dstr, src, src_len_with_nullterm);
-    return dstr;
+    size_t size = da_sizeof_elem(darr);
+    _da_reverse((char*)darr + index*size, nelem, size);
 }
 
-darray(char) dstr_alloc_dstr_custom(struct da_mem_funcs mem_funcs,
-    const darray(char) src)
+void da_rotate(void* darr, size_t k)
 {
-    size_t src_len_with_nullterm = da_length(src);
-    char* dstr = da_alloc_custom(mem_funcs, src_len_with_nullterm, sizeof(char));
-    if (dstr == NULL)
-        return NULL;
-    memcpy(dstr, src, src_len_with_nullterm);
-    return dstr;
+    _da_rotate(darr, da_length(darr), k, da_sizeof_elem(darr));
 }
 
-darray(char) dstr_alloc_format_custom(struct da_mem_funcs mem_funcs,
-    const char* format, ...)
+void da_rotate_range(void* darr, size_t index, size_t nelem, size_t k)
 {
-    va_list args;
-    va_start(args, format);
-
-    va_list copy;
-    va_copy(copy, args);
-    size_t size = vsnprintf(NULL, 0, format, copy) + 1 /* +1 for '\0' */;
-    va_end(copy);
-
-    char* dstr = da_alloc_custom(mem_funcs, size, sizeof(char));
-    if (dstr == NULL)
-        return NULL;
-    vsprintf(dstr, format, args);
-
-    va_end(args);
-    return dstr;
+    size_t size = da_sizeof_elem(darr);
+    _da_rotate((char*)darr + index*size, nelem, k, size);
 }
 
-void dstr_free(darray(char) dstr)
+static DA_ALWAYS_INLINE void _da_unique(char* base, size_t* length,
+    size_t sz, bool (*eq)(const void*, const void*))
 {
-    da_free(dstr);
+    size_t nelem = *length;
+    if (nelem < 2)
+        return;
+    size_t kept = 1;
+    for (size_t i = 1; i < nelem; ++i)
+    {
+        const char* elem = base + i*sz;
+        char* last = base + (kept-1)*sz;
+        bool dup = eq == NULL ? memcmp(last, elem, sz) == 0 : eq(last, elem);
+        if (dup)
+            continue;
+        if (i != kept)
+            memcpy(base + kept*sz, elem, sz);
+        kept += 1;
+    }
+    *length = kept;
 }
 
-darray(char) dstr_reassign_empty(darray(char) allocated_dstr)
+void da_unique(void* darr, bool (*eq)(const void*, const void*))
 {
-    *DA_P_LENGTH_FROM_HANDLE(allocated_dstr) = 0;
-    allocated_dstr = da_concat(allocated_dstr, "", 1);
-    return allocated_dstr;
+    size_t* length = DA_P_LENGTH_FROM_HANDLE(darr);
+    switch (da_sizeof_elem(darr))
+    {
+    case 1:  _da_unique(darr, length, 1, eq);                    break;
+    case 2:  _da_unique(darr, length, 2, eq);                    break;
+    case 4:  _da_unique(darr, length, 4, eq);                    break;
+    case 8:  _da_unique(darr, length, 8, eq);                    break;
+    default: _da_unique(darr, length, da_sizeof_elem(darr), eq); break;
+    }
 }
 
-darray(char) dstr_reassign_cstr(darray(char) allocated_dstr,
-    const char* src)
+// Multiply-xorshift mixing of a 64-bit word (the finalizer of splitmix64).
+static inline uint64_t _da_hash_mix(uint64_t x)
 {
-    *DA_P_LENGTH_FROM_HANDLE(allocated_dstr) = 0;
-    allocated_dstr = da_concat(allocated_dstr, src, strlen(src)+1);
-    return allocated_dstr;
+    x ^= x >> 30;
+    x *= UINT64_C(0xBF58476D1CE4E5B9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94D049BB133111EB);
+    x ^= x >> 31;
+    return x;
 }
 
-darray(char) dstr_reassign_dstr(darray(char) allocated_dstr,
-    const darray(char) src)
+// Hash `sz` bytes a word at a time.
+static DA_ALWAYS_INLINE size_t _da_hash_bytes(const void* ptr, size_t sz)
 {
-    *DA_P_LENGTH_FROM_HANDLE(allocated_dstr) = 0;
-    allocated_dstr = da_concat(allocated_dstr, src, da_length(src));
-    return allocated_dstr;
+    const char* bytes = ptr;
+    uint64_t h = UINT64_C(0x9E3779B97F4A7C15) ^ sz;
+    while (sz >= sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, bytes, sizeof(word));
+        h = _da_hash_mix(h ^ word);
+        bytes += sizeof(word);
+        sz -= sizeof(word);
+    }
+    if (sz != 0)
+    {
+        uint64_t word = 0;
+        memcpy(&word, bytes, sz);
+        h = _da_hash_mix(h ^ word);
+    }
+    return (size_t)h;
 }
 
-darray(char) dstr_reassign_format(darray(char) allocated_dstr,
-    const char* format, ...)
+// Slot of the temporary hash table used by `da_dedupe`. `index` is one past
+// the position of a kept element so that a zeroed slot is empty.
+struct _da_dedupe_slot
 {
-    va_list args;
-    va_start(args, format);
-    
-    va_list copy;
-    va_copy(copy, args);
-    size_t size = vsnprintf(NULL, 0, format, copy) + 1 /* +1 for '\0' */;
-    va_end(copy);
-
-    *DA_P_LENGTH_FROM_HANDLE(allocated_dstr) = 0;
-    allocated_dstr = da_reserve(allocated_dstr, size);
-    if (allocated_dstr == NULL)
-        return NULL;
-    vsprintf(allocated_dstr, format, args);
-    *DA_P_LENGTH_FROM_HANDLE(allocated_dstr) = size;
-
-    va_end(args);
-    return allocated_dstr;
-}
+    size_t hash;
+    size_t index;
+};
 
-size_t dstr_length(const darray(char) dstr)
+static DA_ALWAYS_INLINE void _da_dedupe(char* base, size_t* length,
+    size_t sz, size_t (*hash)(const void*),
+    bool (*eq)(const void*, const void*), struct _da_dedupe_slot* table,
+    size_t mask)
 {
-    // dstrings always have a null terminator so this should never underflow.
-    return da_length(dstr)-1;
+    size_t nelem = *length;
+    size_t kept = 0;
+    for (size_t i = 0; i < nelem; ++i)
+    {
+        const char* elem = base + i*sz;
+        size_t h = hash == NULL ? _da_hash_bytes(elem, sz) : hash(elem);
+        size_t pos = _da_hash_mix(h) & mask;
+        bool dup = false;
+        // Linear probing. The table is at most half full so an empty slot is
+        // always found.
+        while (table[pos].index != 0)
+        {
+            if (table[pos].hash == h)
+            {
+                const char* other = base + (table[pos].index-1)*sz;
+                dup = eq == NULL ? memcmp(other, elem, sz) == 0 :
+                    eq(other, elem);
+                if (dup)
+                    break;
+            }
+            pos = (pos + 1) & mask;
+        }
+        if (dup)
+            continue;
+        table[pos].hash = h;
+        table[pos].index = kept + 1;
+        if (i != kept)
+            memcpy(base + kept*sz, elem, sz);
+        kept += 1;
+    }
+    *length = kept;
 }
 
-darray(char) dstr_concat_char(darray(char) dest, char c)
+bool da_dedupe(void* darr, size_t (*hash)(const void*),
+    bool (*eq)(const void*, const void*))
 {
-    return dest = da_insert(dest, da_length(dest)-1, c);
+    size_t nelem = da_length(darr);
+    if (nelem < 2)
+        return true;
+    size_t capacity = 2;
+    while (capacity < 2*nelem)
+        capacity *= 2;
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(darr);
+    struct _da_dedupe_slot* table =
+        mem_funcs.alloc_f(capacity*sizeof(struct _da_dedupe_slot));
+    if (table == NULL)
+        return false;
+    memset(table, 0, capacity*sizeof(struct _da_dedupe_slot));
+
+    size_t* length = DA_P_LENGTH_FROM_HANDLE(darr);
+    size_t sz = da_sizeof_elem(darr);
+    size_t mask = capacity - 1;
+    switch (sz)
+    {
+    case 4:  _da_dedupe(darr, length, 4, hash, eq, table, mask);  break;
+    case 8:  _da_dedupe(darr, length, 8, hash, eq, table, mask);  break;
+    default: _da_dedupe(darr, length, sz, hash, eq, table, mask); break;
+    }
+
+    mem_funcs.free_f(table);
+    return true;
 }
 
-darray(char) dstr_concat_cstr(darray(char) dest, const char* src)
+void* da_concat(void* dest, const void* src, size_t nelem)
 {
-    size_t dest_strlen = dstr_length(dest);
-    size_t src_strlen = strlen(src);
-    dest = da_reserve(dest, src_strlen);
+    size_t offset = da_length(dest)*da_sizeof_elem(dest);
+    dest = da_reserve(dest, nelem);
     if (dest == NULL)
         return NULL;
-    memcpy(dest+dest_strlen, src, src_strlen+1);
-    *DA_P_LENGTH_FROM_HANDLE(dest) += src_strlen;
+    memcpy((char*)dest+offset, src, nelem*da_sizeof_elem(dest));
+    *DA_P_LENGTH_FROM_HANDLE(dest) += nelem;
     return dest;
 }
 
-darray(char) dstr_concat_dstr(darray(char) dest, const darray(char) src)
+void* da_map(const void* src, size_t out_elemsz,
+    void (*fn)(void* out, const void* in, void* ctx), void* ctx)
 {
-    size_t dest_strlen = dstr_length(dest);
-    size_t src_strlen = dstr_length(src);
-    dest = da_reserve(dest, src_strlen);
+    size_t nelem = da_length(src);
+    size_t in_sz = da_sizeof_elem(src);
+    char* dest = da_alloc_exact_custom(_da_mem_funcs(src), nelem, out_elemsz);
     if (dest == NULL)
         return NULL;
-    memcpy(dest+dest_strlen, src, src_strlen+1);
-    *DA_P_LENGTH_FROM_HANDLE(dest) += src_strlen;
+    const char* in = src;
+    for (size_t i = 0; i < nelem; ++i)
+        fn(dest + i*out_elemsz, in + i*in_sz, ctx);
     return dest;
 }
 
-darray(char) dstr_concat_format(darray(char) dest, const char* format, ...)
+void da_transform(void* darr, void (*fn)(void* elem, void* ctx), void* ctx)
 {
-    size_t dest_strlen = dstr_length(dest);
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    char* elem = darr;
+    for (size_t i = 0; i < nelem; ++i)
+        fn(elem + i*sz, ctx);
+}
 
-    va_list args;
-    va_start(args, format);
+/////////////////////////////////// PARALLEL ///////////////////////////////////
+static size_t _da_default_nthreads(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+}
 
-    va_list copy;
-    va_copy(copy, args);
-    size_t formatted_strlen = vsnprintf(NULL, 0, format, copy);
-    va_end(copy);
+// Number of threads to use for `nelem` elements when the caller asked for
+// `nthreads` (0 meaning one per online processor) and each thread should get
+// at least `min_chunk` elements.
+static size_t _da_clamp_nthreads(size_t nthreads, size_t nelem,
+    size_t min_chunk)
+{
+    if (nthreads == 0)
+        nthreads = _da_default_nthreads();
+    if (nthreads > DA_PARALLEL_MAX_THREADS)
+        nthreads = DA_PARALLEL_MAX_THREADS;
+    if (nthreads > nelem / min_chunk)
+        nthreads = nelem / min_chunk;
+    return nthreads == 0 ? 1 : nthreads;
+}
 
-    dest = da_reserve(dest, formatted_strlen);
-    if (dest == NULL)
-        return NULL;
-    vsprintf(dest+dest_strlen, format, args);
-    *DA_P_LENGTH_FROM_HANDLE(dest) += formatted_strlen;
+// Worker threads are started the first time a parallel algorithm needs them
+// and then sleep on a condition variable between jobs. Only one job runs on
+// the pool at a time; `run_lock` is held by the thread that submitted it.
+static struct
+{
+    pthread_mutex_t run_lock;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    size_t nworkers;
+    // Incremented for every job. Each worker remembers the last generation it
+    // has seen in its own slot of `seen`.
+    unsigned long generation;
+    unsigned long seen[DA_PARALLEL_MAX_THREADS];
+    void (*fn)(void* ctx, size_t id);
+    void* ctx;
+    size_t njob_workers; // Workers with ids in [1, njob_workers] take part.
+    size_t pending;      // Workers that have not finished the current job.
+} _da_pool = {
+    .run_lock = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER
+};
 
-    va_end(args);
-    return dest;
-}
+// Set on pool workers, and on the submitting thread while its job runs, so
+// that a parallel algorithm called from inside a job runs inline rather than
+// waiting for the pool it is already occupying.
+static _Thread_local bool _da_in_parallel = false;
 
-int dstr_cmp(const darray(char) s1, const char* s2)
+static void* _da_pool_worker(void* arg)
 {
-    while (*s1 == *s2 && *s1 != '\0')
+    size_t id = (size_t)(uintptr_t)arg;
+    _da_in_parallel = true;
+    pthread_mutex_lock(&_da_pool.lock);
+    for (;;)
     {
-        s1++;
-        s2++;
+        while (_da_pool.generation == _da_pool.seen[id])
+            pthread_cond_wait(&_da_pool.work, &_da_pool.lock);
+        _da_pool.seen[id] = _da_pool.generation;
+        if (id > _da_pool.njob_workers)
+            continue;
+        void (*fn)(void* ctx, size_t id) = _da_pool.fn;
+        void* ctx = _da_pool.ctx;
+        pthread_mutex_unlock(&_da_pool.lock);
+        fn(ctx, id);
+        pthread_mutex_lock(&_da_pool.lock);
+        if (--_da_pool.pending == 0)
+            pthread_cond_signal(&_da_pool.done);
     }
-    return *s1 - *s2;
+    return NULL;
 }
 
-int dstr_cmp_case(const darray(char) s1, const char* s2)
+// Start workers until the pool has `nworkers` of them. Must be called with
+// `run_lock` held. Stops early if a thread cannot be started.
+static void _da_pool_grow(size_t nworkers)
 {
-    while (tolower(*s1) == tolower(*s2) && *s1 != '\0')
+    while (_da_pool.nworkers < nworkers)
     {
-        s1++;
-        s2++;
+        size_t id = _da_pool.nworkers + 1;
+        _da_pool.seen[id] = _da_pool.generation;
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, _da_pool_worker,
+            (void*)(uintptr_t)id) != 0)
+            return;
+        pthread_detach(thread);
+        _da_pool.nworkers = id;
     }
-    return *s1 - *s2;
 }
 
-long dstr_find(darray(char) dstr, const char* substr)
+// Run `fn(ctx, id)` for every id in [0, nthreads) on the worker pool. The
+// calling thread takes id 0. Ids that no worker is available for are run by
+// the calling thread after its own, so `fn` must not rely on all ids running
+// at the same time.
+static void _da_parallel_run(size_t nthreads, void (*fn)(void* ctx, size_t id),
+    void* ctx)
 {
-    char* loc = strstr(dstr, substr);
-    if (loc == NULL)
-        return -1;
-    return loc - dstr;
+    if (nthreads <= 1 || _da_in_parallel)
+    {
+        for (size_t id = 0; id < nthreads; ++id)
+            fn(ctx, id);
+        return;
+    }
+
+    pthread_mutex_lock(&_da_pool.run_lock);
+    _da_pool_grow(nthreads - 1);
+    size_t nworkers = _da_pool.nworkers < nthreads - 1 ? _da_pool.nworkers
+        : nthreads - 1;
+    pthread_mutex_lock(&_da_pool.lock);
+    _da_pool.fn = fn;
+    _da_pool.ctx = ctx;
+    _da_pool.njob_workers = nworkers;
+    _da_pool.pending = nworkers;
+    _da_pool.generation += 1;
+    pthread_cond_broadcast(&_da_pool.work);
+    pthread_mutex_unlock(&_da_pool.lock);
+
+    _da_in_parallel = true;
+    fn(ctx, 0);
+    for (size_t id = nworkers + 1; id < nthreads; ++id)
+        fn(ctx, id);
+    _da_in_parallel = false;
+
+    pthread_mutex_lock(&_da_pool.lock);
+    while (_da_pool.pending > 0)
+        pthread_cond_wait(&_da_pool.done, &_da_pool.lock);
+    pthread_mutex_unlock(&_da_pool.lock);
+    pthread_mutex_unlock(&_da_pool.run_lock);
 }
 
-static const char* _da_strcasestr(const char* haystack, const char* needle)
+// With automatic chunk sizing each claim takes this fraction of the remaining
+// elements divided by the number of threads. Chunks shrink as the work runs
+// out, so a thread stuck on an expensive chunk leaves the rest to the others.
+#define DA_PARALLEL_FOR_CHUNKS_PER_THREAD 4
+
+static size_t _da_gcd(size_t a, size_t b)
 {
-    const char* currh = haystack;
-    const char* currn = needle;
-    while (1)
+    while (b != 0)
     {
-        if (*currn == '\0')
-            return haystack;
-        else if (*currh == '\0')
-            return NULL;
-
-        if (tolower(*currh) != tolower(*currn))
-        {
-            haystack = ++currh;
-            currn = needle;
-        }
-        else
-        {
-            currh++;
-            currn++;
-        }
+        size_t t = a % b;
+        a = b;
+        b = t;
     }
+    return a;
 }
 
-long dstr_find_case(darray(char) dstr, const char* substr)
+struct _da_pfor_job
 {
-    const char* loc = _da_strcasestr(dstr, substr);
+    char* base;
+    size_t sz;
+    size_t nelem;
+    size_t nthreads;
+    size_t chunk_size;
+    // Chunk boundaries are `first` plus a multiple of `step`, where `first`
+    // is the first element starting on a cache line and `step` elements span
+    // a whole number of cache lines.
+    size_t first;
+    size_t step;
+    void (*fn)(void* elem, size_t index, void* ctx);
+    void* ctx;
+    // Claimed by every thread, so kept on a cache line of its own.
+    _Alignas(DA_CACHE_LINE_SIZE) atomic_size_t next;
+};
+
+static bool _da_pfor_claim(struct _da_pfor_job* job, size_t* begin,
+    size_t* end)
+{
+    size_t cur = atomic_load_explicit(&job->next, memory_order_relaxed);
+    do
+    {
+        if (cur >= job->nelem)
+            return false;
+        size_t want = job->chunk_size != 0 ? job->chunk_size
+            : (job->nelem - cur)
+                / (job->nthreads * DA_PARALLEL_FOR_CHUNKS_PER_THREAD);
+        size_t stop = cur + (want != 0 ? want : 1);
+        if (stop <= job->first)
+            stop = job->first;
+        else
+            stop = job->first + (stop - job->first + job->step - 1)
+                / job->step * job->step;
+        *begin = cur;
+        *end = stop < cur || stop > job->nelem ? job->nelem : stop;
+    } while (!atomic_compare_exchange_weak_explicit(&job->next, &cur, *end,
+        memory_order_relaxed, memory_order_relaxed));
+    return true;
+}
+
+static void _da_pfor_thread(void* ctx, size_t id)
+{
+    (void)id;
+    struct _da_pfor_job* job = ctx;
+    size_t begin, end;
+    while (_da_pfor_claim(job, &begin, &end))
+    {
+        for (size_t i = begin; i < end; ++i)
+            job->fn(job->base + i*job->sz, i, job->ctx);
+    }
+}
+
+void da_parallel_for(void* darr,
+    void (*fn)(void* elem, size_t index, void* ctx), void* ctx,
+    const struct da_parallel_opts* opts)
+{
+    struct da_parallel_opts o = opts != NULL ? *opts
+        : (struct da_parallel_opts){0};
+    struct _da_pfor_job job = {
+        .base = darr,
+        .sz = da_sizeof_elem(darr),
+        .nelem = da_length(darr),
+        .chunk_size = o.chunk_size,
+        .fn = fn,
+        .ctx = ctx
+    };
+    job.step = DA_CACHE_LINE_SIZE / _da_gcd(job.sz, DA_CACHE_LINE_SIZE);
+    for (size_t i = 0; i < job.step; ++i)
+    {
+        if ((uintptr_t)(job.base + i*job.sz) % DA_CACHE_LINE_SIZE == 0)
+        {
+            job.first = i;
+            break;
+        }
+    }
+    job.nthreads = _da_clamp_nthreads(o.nthreads, job.nelem, job.step);
+    atomic_init(&job.next, 0);
+    _da_parallel_run(job.nthreads, _da_pfor_thread, &job);
+}
+
+/////////////////////////////////// SORTING ////////////////////////////////////
+#define DA_SORT_INSERTION_THRESHOLD 24
+#define DA_SORT_NINTHER_THRESHOLD 128
+#define DA_SORT_PARTIAL_INSERTION_LIMIT 8
+#define DA_SORT_BLOCK_SIZE 64
+#define DA_SORT_TMP_SIZE 64
+#define DA_SORT_STACK_SIZE 64
+
+// The sorting routines below are written once in terms of an element size and
+// a `less` predicate, and are force inlined into each public entry point. When
+// the entry point passes a constant element size and a known predicate the
+// compiler specializes the whole sort for that element type.
+
+static DA_ALWAYS_INLINE void _da_sort2(char* a, char* b, size_t sz,
+    bool (*less)(const void*, const void*, const void*), const void* ctx)
+{
+    if (less(b, a, ctx))
+        _da_memswap(a, b, sz);
+}
+
+static DA_ALWAYS_INLINE void _da_sort3(char* a, char* b, char* c, size_t sz,
+    bool (*less)(const void*, const void*, const void*), const void* ctx)
+{
+    _da_sort2(a, b, sz, less, ctx);
+    _da_sort2(b, c, sz, less, ctx);
+    _da_sort2(a, b, sz, less, ctx);
+}
+
+// Insertion sort of [begin, end). If `guarded` is false the element directly
+// before `begin` must compare less than or equal to every element in the range.
+static DA_ALWAYS_INLINE void _da_insertion_sort(char* begin, char* end,
+    size_t sz, bool (*less)(const void*, const void*, const void*),
+    const void* ctx, bool guarded)
+{
+    if (begin == end)
+        return;
+    for (char* cur = begin + sz; cur != end; cur += sz)
+    {
+        char* sift = cur;
+        if (!less(sift, sift - sz, ctx))
+            continue;
+        if (sz <= DA_SORT_TMP_SIZE)
+        {
+            alignas(max_align_t) char tmp[DA_SORT_TMP_SIZE];
+            memcpy(tmp, sift, sz);
+            do
+            {
+                memcpy(sift, sift - sz, sz);
+                sift -= sz;
+            } while ((!guarded || sift != begin) && less(tmp, sift - sz, ctx));
+            memcpy(sift, tmp, sz);
+        }
+        else
+        {
+            do
+            {
+                _da_memswap(sift, sift - sz, sz);
+                sift -= sz;
+            } while ((!guarded || sift != begin) && less(sift, sift - sz, ctx));
+        }
+    }
+}
+
+// Insertion sort that gives up after a small number of element moves. Returns
+// true if [begin, end) is sorted on completion.
+static DA_ALWAYS_INLINE bool _da_partial_insertion_sort(char* begin, char* end,
+    size_t sz, bool (*less)(const void*, const void*, const void*),
+    const void* ctx)
+{
+    if (begin == end)
+        return true;
+    size_t moves = 0;
+    for (char* cur = begin + sz; cur != end; cur += sz)
+    {
+        char* sift = cur;
+        if (!less(sift, sift - sz, ctx))
+            continue;
+        do
+        {
+            _da_memswap(sift, sift - sz, sz);
+            sift -= sz;
+        } while (sift != begin && less(sift, sift - sz, ctx));
+        moves += (cur - sift) / sz;
+        if (moves > DA_SORT_PARTIAL_INSERTION_LIMIT)
+            return false;
+    }
+    return true;
+}
+
+static DA_ALWAYS_INLINE void _da_sift_down(char* base, size_t index,
+    size_t nelem, size_t sz,
+    bool (*less)(const void*, const void*, const void*), const void* ctx)
+{
+    size_t child;
+    while ((child = 2*index + 1) < nelem)
+    {
+        if (child+1 < nelem && less(base + child*sz, base + (child+1)*sz, ctx))
+            child += 1;
+        if (!less(base + index*sz, base + child*sz, ctx))
+            return;
+        _da_memswap(base + index*sz, base + child*sz, sz);
+        index = child;
+    }
+}
+
+static DA_ALWAYS_INLINE void _da_heapsort(char* base, size_t nelem, size_t sz,
+    bool (*less)(const void*, const void*, const void*), const void* ctx)
+{
+    for (size_t i = nelem/2; i-- > 0;)
+        _da_sift_down(base, i, nelem, sz, less, ctx);
+    for (size_t i = nelem; i-- > 1;)
+    {
+        _da_memswap(base, base + i*sz, sz);
+        _da_sift_down(base, 0, i, sz, less, ctx);
+    }
+}
+
+// Partition [begin, end) around the pivot at `begin`. Elements less than the
+// pivot are moved to its left and all others to its right. Returns the final
+// position of the pivot and sets `already_partitioned` if no elements had to
+// be moved.
+static DA_ALWAYS_INLINE char* _da_partition_right(char* begin, char* end,
+    size_t sz, bool (*less)(const void*, const void*, const void*),
+    const void* ctx, bool* already_partitioned)
+{
+    char* first = begin;
+    char* last = end;
+
+    // The median of 3 pivot selection guarantees an element not less than the
+    // pivot exists to the right, so this first scan needs no bounds check.
+    while (less(first += sz, begin, ctx));
+    if (first - sz == begin)
+        while (first < last && !less(last -= sz, begin, ctx));
+    else
+        while (!less(last -= sz, begin, ctx));
+
+    *already_partitioned = first >= last;
+    while (first < last)
+    {
+        _da_memswap(first, last, sz);
+        while (less(first += sz, begin, ctx));
+        while (!less(last -= sz, begin, ctx));
+    }
+
+    char* pivot_pos = first - sz;
+    if (pivot_pos != begin)
+        _da_memswap(begin, pivot_pos, sz);
+    return pivot_pos;
+}
+
+// Branchless variant of `_da_partition_right` derived from "BlockQuicksort:
+// How Branch Mispredictions don't affect Quicksort" (Edelkamp and Weiss).
+// Comparison results for a block of elements on each side are recorded as
+// offsets without branching, and misplaced elements are then swapped in bulk.
+static DA_ALWAYS_INLINE char* _da_partition_right_branchless(char* begin,
+    char* end, size_t sz, bool (*less)(const void*, const void*, const void*),
+    const void* ctx, bool* already_partitioned)
+{
+    char* first = begin;
+    char* last = end;
+
+    while (less(first += sz, begin, ctx));
+    if (first - sz == begin)
+        while (first < last && !less(last -= sz, begin, ctx));
+    else
+        while (!less(last -= sz, begin, ctx));
+
+    *already_partitioned = first >= last;
+    if (!*already_partitioned)
+    {
+        _da_memswap(first, last, sz);
+        first += sz;
+
+        unsigned char offsets_l[DA_SORT_BLOCK_SIZE];
+        unsigned char offsets_r[DA_SORT_BLOCK_SIZE];
+        char* offsets_l_base = first;
+        char* offsets_r_base = last;
+        size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+        while (first < last)
+        {
+            size_t num_unknown = (last - first) / sz;
+            size_t left_split = num_l == 0 ?
+                (num_r == 0 ? num_unknown/2 : num_unknown) : 0;
+            size_t right_split = num_r == 0 ? (num_unknown - left_split) : 0;
+
+            if (left_split > DA_SORT_BLOCK_SIZE)
+                left_split = DA_SORT_BLOCK_SIZE;
+            for (size_t i = 0; i < left_split; ++i)
+            {
+                offsets_l[num_l] = i;
+                num_l += !less(first, begin, ctx);
+                first += sz;
+            }
+
+            if (right_split > DA_SORT_BLOCK_SIZE)
+                right_split = DA_SORT_BLOCK_SIZE;
+            for (size_t i = 0; i < right_split;)
+            {
+                offsets_r[num_r] = ++i;
+                last -= sz;
+                num_r += less(last, begin, ctx);
+            }
+
+            size_t num = num_l < num_r ? num_l : num_r;
+            if (num_l == num_r || sz > DA_SORT_TMP_SIZE)
+            {
+                // Plain swaps are required for descending input to keep the
+                // partition linear.
+                for (size_t i = 0; i < num; ++i)
+                {
+                    _da_memswap(
+                        offsets_l_base + offsets_l[start_l+i]*sz,
+                        offsets_r_base - offsets_r[start_r+i]*sz,
+                        sz
+                    );
+                }
+            }
+            else if (num > 0)
+            {
+                // Cyclic permutation: two moves per misplaced pair instead of
+                // the three required by a swap.
+                alignas(max_align_t) char tmp[DA_SORT_TMP_SIZE];
+                char* l = offsets_l_base + offsets_l[start_l]*sz;
+                char* r = offsets_r_base - offsets_r[start_r]*sz;
+                memcpy(tmp, l, sz);
+                memcpy(l, r, sz);
+                for (size_t i = 1; i < num; ++i)
+                {
+                    l = offsets_l_base + offsets_l[start_l+i]*sz;
+                    memcpy(r, l, sz);
+                    r = offsets_r_base - offsets_r[start_r+i]*sz;
+                    memcpy(l, r, sz);
+                }
+                memcpy(r, tmp, sz);
+            }
+            num_l -= num;
+            num_r -= num;
+            start_l += num;
+            start_r += num;
+            if (num_l == 0)
+            {
+                start_l = 0;
+                offsets_l_base = first;
+            }
+            if (num_r == 0)
+            {
+                start_r = 0;
+                offsets_r_base = last;
+            }
+        }
+
+        // Some elements on one side remain misplaced. Move them to the far end
+        // of the other side.
+        if (num_l)
+        {
+            while (num_l--)
+            {
+                _da_memswap(offsets_l_base + offsets_l[start_l+num_l]*sz,
+                    last -= sz, sz);
+            }
+            first = last;
+        }
+        if (num_r)
+        {
+            while (num_r--)
+            {
+                _da_memswap(offsets_r_base - offsets_r[start_r+num_r]*sz,
+                    first, sz);
+                first += sz;
+            }
+        }
+    }
+
+    char* pivot_pos = first - sz;
+    if (pivot_pos != begin)
+        _da_memswap(begin, pivot_pos, sz);
+    return pivot_pos;
+}
+
+// Partition [begin, end) around the pivot at `begin`, placing elements equal
+// to the pivot to its left. Used when the pivot is known to equal the element
+// directly before the range, in which case all elements equal to it are
+// already in their final position.
+static DA_ALWAYS_INLINE char* _da_partition_left(char* begin, char* end,
+    size_t sz, bool (*less)(const void*, const void*, const void*),
+    const void* ctx)
+{
+    char* first = begin;
+    char* last = end;
+
+    while (less(begin, last -= sz, ctx));
+    if (last + sz == end)
+        while (first < last && !less(begin, first += sz, ctx));
+    else
+        while (!less(begin, first += sz, ctx));
+
+    while (first < last)
+    {
+        _da_memswap(first, last, sz);
+        while (less(begin, last -= sz, ctx));
+        while (!less(begin, first += sz, ctx));
+    }
+
+    if (last != begin)
+        _da_memswap(begin, last, sz);
+    return last;
+}
+
+struct _da_sort_range
+{
+    char* begin;
+    char* end;
+    int bad_allowed;
+    bool leftmost;
+};
+
+// Pattern-defeating quicksort (Orson Peters) over `nelem` elements of size
+// `sz` starting at `base`. The recursion of the reference implementation is
+// replaced with an explicit stack; the larger partition is always deferred so
+// the stack never holds more than log2(nelem) ranges.
+static DA_ALWAYS_INLINE void _da_pdqsort(char* base, size_t nelem, size_t sz,
+    bool (*less)(const void*, const void*, const void*), const void* ctx,
+    bool branchless)
+{
+    if (nelem < 2)
+        return;
+
+    struct _da_sort_range stack[DA_SORT_STACK_SIZE];
+    size_t top = 0;
+    char* begin = base;
+    char* end = base + nelem*sz;
+    bool leftmost = true;
+    int bad_allowed = 0;
+    for (size_t n = nelem; n >>= 1;)
+        bad_allowed += 1;
+
+    while (true)
+    {
+        size_t size = (end - begin) / sz;
+        if (size < DA_SORT_INSERTION_THRESHOLD)
+        {
+            _da_insertion_sort(begin, end, sz, less, ctx, leftmost);
+            goto next_range;
+        }
+
+        // Choose a pivot as the median of 3 (or the pseudomedian of 9 for
+        // larger ranges) and move it to `begin`.
+        size_t s2 = size / 2;
+        if (size > DA_SORT_NINTHER_THRESHOLD)
+        {
+            _da_sort3(begin, begin + s2*sz, end - sz, sz, less, ctx);
+            _da_sort3(begin + sz, begin + (s2-1)*sz, end - 2*sz, sz, less, ctx);
+            _da_sort3(begin + 2*sz, begin + (s2+1)*sz, end - 3*sz, sz, less,
+                ctx);
+            _da_sort3(begin + (s2-1)*sz, begin + s2*sz, begin + (s2+1)*sz, sz,
+                less, ctx);
+            _da_memswap(begin, begin + s2*sz, sz);
+        }
+        else
+        {
+            _da_sort3(begin + s2*sz, begin, end - sz, sz, less, ctx);
+        }
+
+        // If the pivot equals the element before this range then every
+        // element equal to the pivot is already in place. Partition those
+        // elements out and continue with the remainder.
+        if (!leftmost && !less(begin - sz, begin, ctx))
+        {
+            begin = _da_partition_left(begin, end, sz, less, ctx) + sz;
+            continue;
+        }
+
+        bool already_partitioned;
+        char* pivot_pos = branchless ?
+            _da_partition_right_branchless(begin, end, sz, less, ctx,
+                &already_partitioned) :
+            _da_partition_right(begin, end, sz, less, ctx,
+                &already_partitioned);
+
+        size_t l_size = (pivot_pos - begin) / sz;
+        size_t r_size = (end - (pivot_pos + sz)) / sz;
+        if (l_size < size/8 || r_size < size/8)
+        {
+            // Highly unbalanced partition. Fall back to heapsort if this keeps
+            // happening, otherwise shuffle some elements to break patterns.
+            if (--bad_allowed == 0)
+            {
+                _da_heapsort(begin, size, sz, less, ctx);
+                goto next_range;
+            }
+            if (l_size >= DA_SORT_INSERTION_THRESHOLD)
+            {
+                _da_memswap(begin, begin + (l_size/4)*sz, sz);
+                _da_memswap(pivot_pos - sz, pivot_pos - (l_size/4)*sz, sz);
+                if (l_size > DA_SORT_NINTHER_THRESHOLD)
+                {
+                    _da_memswap(begin + sz, begin + (l_size/4 + 1)*sz, sz);
+                    _da_memswap(begin + 2*sz, begin + (l_size/4 + 2)*sz, sz);
+                    _da_memswap(pivot_pos - 2*sz,
+                        pivot_pos - (l_size/4 + 1)*sz, sz);
+                    _da_memswap(pivot_pos - 3*sz,
+                        pivot_pos - (l_size/4 + 2)*sz, sz);
+                }
+            }
+            if (r_size >= DA_SORT_INSERTION_THRESHOLD)
+            {
+                _da_memswap(pivot_pos + sz, pivot_pos + (1 + r_size/4)*sz, sz);
+                _da_memswap(end - sz, end - (r_size/4)*sz, sz);
+                if (r_size > DA_SORT_NINTHER_THRESHOLD)
+                {
+                    _da_memswap(pivot_pos + 2*sz,
+                        pivot_pos + (2 + r_size/4)*sz, sz);
+                    _da_memswap(pivot_pos + 3*sz,
+                        pivot_pos + (3 + r_size/4)*sz, sz);
+                    _da_memswap(end - 2*sz, end - (1 + r_size/4)*sz, sz);
+                    _da_memswap(end - 3*sz, end - (2 + r_size/4)*sz, sz);
+                }
+            }
+        }
+        else if (already_partitioned
+            && _da_partial_insertion_sort(begin, pivot_pos, sz, less, ctx)
+            && _da_partial_insertion_sort(pivot_pos + sz, end, sz, less, ctx))
+        {
+            // The input was likely already sorted.
+            goto next_range;
+        }
+
+        if (l_size < r_size)
+        {
+            stack[top++] = (struct _da_sort_range){
+                pivot_pos + sz, end, bad_allowed, false};
+            end = pivot_pos;
+        }
+        else
+        {
+            stack[top++] = (struct _da_sort_range){
+                begin, pivot_pos, bad_allowed, leftmost};
+            begin = pivot_pos + sz;
+            leftmost = false;
+        }
+        continue;
+
+    next_range:
+        if (top == 0)
+            return;
+        top -= 1;
+        begin = stack[top].begin;
+        end = stack[top].end;
+        bad_allowed = stack[top].bad_allowed;
+        leftmost = stack[top].leftmost;
+    }
+}
+
+struct _da_sort_ctx
+{
+    int (*cmp)(const void*, const void*);
+    size_t offset;
+};
+
+static DA_ALWAYS_INLINE bool _da_less_cmp(const void* a, const void* b,
+    const void* ctx)
+{
+    return ((const struct _da_sort_ctx*)ctx)->cmp(a, b) < 0;
+}
+
+#define _DA_DEFINE_KEY_LESS(suffix, type)                                      \
+static DA_ALWAYS_INLINE bool _da_less_##suffix(const void* a, const void* b,   \
+    const void* ctx)                                                           \
+{                                                                              \
+    size_t offset = ((const struct _da_sort_ctx*)ctx)->offset;                 \
+    type ka, kb;                                                               \
+    memcpy(&ka, (const char*)a + offset, sizeof(type));                        \
+    memcpy(&kb, (const char*)b + offset, sizeof(type));                        \
+    return ka < kb;                                                            \
+}
+_DA_DEFINE_KEY_LESS(i32, int32_t)
+_DA_DEFINE_KEY_LESS(u32, uint32_t)
+_DA_DEFINE_KEY_LESS(i64, int64_t)
+_DA_DEFINE_KEY_LESS(u64, uint64_t)
+_DA_DEFINE_KEY_LESS(f32, float)
+_DA_DEFINE_KEY_LESS(f64, double)
+
+// Scalar sorts pass the element size as a constant so every element move is
+// specialized at compile time.
+#define _DA_SORT_SCALAR(darr, suffix, type)                                    \
+    _da_pdqsort((char*)(darr), da_length(darr), sizeof(type),                  \
+        _da_less_##suffix, &(struct _da_sort_ctx){.offset=0}, true)
+
+static void _da_sort_cmp(char* base, size_t nelem, size_t sz,
+    const struct _da_sort_ctx* ctx)
+{
+    switch (sz)
+    {
+    case 4:  _da_pdqsort(base, nelem, 4, _da_less_cmp, ctx, false);  break;
+    case 8:  _da_pdqsort(base, nelem, 8, _da_less_cmp, ctx, false);  break;
+    case 16: _da_pdqsort(base, nelem, 16, _da_less_cmp, ctx, false); break;
+    default: _da_pdqsort(base, nelem, sz, _da_less_cmp, ctx, false); break;
+    }
+}
+
+void da_sort(void* darr, int (*cmp)(const void*, const void*))
+{
+    struct _da_sort_ctx ctx = {.cmp=cmp};
+    _da_sort_cmp(darr, da_length(darr), da_sizeof_elem(darr), &ctx);
+}
+
+void da_sort_int(darray(int) darr)
+{
+    if (sizeof(int) == 4)
+        _DA_SORT_SCALAR(darr, i32, int32_t);
+    else
+        _DA_SORT_SCALAR(darr, i64, int64_t);
+}
+
+void da_sort_uint(darray(unsigned) darr)
+{
+    if (sizeof(unsigned) == 4)
+        _DA_SORT_SCALAR(darr, u32, uint32_t);
+    else
+        _DA_SORT_SCALAR(darr, u64, uint64_t);
+}
+
+void da_sort_long(darray(long) darr)
+{
+    if (sizeof(long) == 4)
+        _DA_SORT_SCALAR(darr, i32, int32_t);
+    else
+        _DA_SORT_SCALAR(darr, i64, int64_t);
+}
+
+void da_sort_ulong(darray(unsigned long) darr)
+{
+    if (sizeof(unsigned long) == 4)
+        _DA_SORT_SCALAR(darr, u32, uint32_t);
+    else
+        _DA_SORT_SCALAR(darr, u64, uint64_t);
+}
+
+void da_sort_float(darray(float) darr)
+{
+    _DA_SORT_SCALAR(darr, f32, float);
+}
+
+void da_sort_double(darray(double) darr)
+{
+    _DA_SORT_SCALAR(darr, f64, double);
+}
+
+void da_sort_by_key_offset(void* darr, size_t offset, enum da_key_type type)
+{
+    struct _da_sort_ctx ctx = {.offset=offset};
+    char* base = darr;
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    bool branchless = sz <= 16;
+    switch (type)
+    {
+    case DA_KEY_I32:
+        _da_pdqsort(base, nelem, sz, _da_less_i32, &ctx, branchless);
+        break;
+    case DA_KEY_U32:
+        _da_pdqsort(base, nelem, sz, _da_less_u32, &ctx, branchless);
+        break;
+    case DA_KEY_I64:
+        _da_pdqsort(base, nelem, sz, _da_less_i64, &ctx, branchless);
+        break;
+    case DA_KEY_U64:
+        _da_pdqsort(base, nelem, sz, _da_less_u64, &ctx, branchless);
+        break;
+    case DA_KEY_F32:
+        _da_pdqsort(base, nelem, sz, _da_less_f32, &ctx, branchless);
+        break;
+    case DA_KEY_F64:
+        _da_pdqsort(base, nelem, sz, _da_less_f64, &ctx, branchless);
+        break;
+    }
+}
+
+// Introselect over [begin, end), leaving the element at `nth` in its sorted
+// position. `leftmost` is false if the element directly before `begin` compares
+// less than or equal to every element in the range.
+static DA_ALWAYS_INLINE void _da_select(char* begin, char* end, char* nth,
+    size_t sz, bool (*less)(const void*, const void*, const void*),
+    const void* ctx, bool leftmost)
+{
+    int bad_allowed = 0;
+    for (size_t n = (end - begin) / sz; n >>= 1;)
+        bad_allowed += 1;
+
+    while ((size_t)(end - begin) / sz >= DA_SORT_INSERTION_THRESHOLD)
+    {
+        size_t size = (end - begin) / sz;
+        size_t s2 = size / 2;
+        if (size > DA_SORT_NINTHER_THRESHOLD)
+        {
+            _da_sort3(begin, begin + s2*sz, end - sz, sz, less, ctx);
+            _da_sort3(begin + sz, begin + (s2-1)*sz, end - 2*sz, sz, less, ctx);
+            _da_sort3(begin + 2*sz, begin + (s2+1)*sz, end - 3*sz, sz, less,
+                ctx);
+            _da_sort3(begin + (s2-1)*sz, begin + s2*sz, begin + (s2+1)*sz, sz,
+                less, ctx);
+            _da_memswap(begin, begin + s2*sz, sz);
+        }
+        else
+        {
+            _da_sort3(begin + s2*sz, begin, end - sz, sz, less, ctx);
+        }
+
+        // As in `_da_pdqsort`, a pivot equal to the element before the range
+        // is the smallest value in it. Every element equal to it is final.
+        if (!leftmost && !less(begin - sz, begin, ctx))
+        {
+            char* last_equal = _da_partition_left(begin, end, sz, less, ctx);
+            if (nth <= last_equal)
+                return;
+            begin = last_equal + sz;
+            continue;
+        }
+
+        bool already_partitioned;
+        char* pivot_pos = _da_partition_right(begin, end, sz, less, ctx,
+            &already_partitioned);
+        size_t l_size = (pivot_pos - begin) / sz;
+        size_t r_size = (end - (pivot_pos + sz)) / sz;
+        if ((l_size < size/8 || r_size < size/8) && --bad_allowed == 0)
+        {
+            _da_heapsort(begin, size, sz, less, ctx);
+            return;
+        }
+
+        if (nth == pivot_pos)
+            return;
+        if (nth < pivot_pos)
+        {
+            end = pivot_pos;
+        }
+        else
+        {
+            begin = pivot_pos + sz;
+            leftmost = false;
+        }
+    }
+    _da_insertion_sort(begin, end, sz, less, ctx, leftmost);
+}
+
+static void _da_select_cmp(char* begin, char* end, char* nth, size_t sz,
+    const struct _da_sort_ctx* ctx, bool leftmost)
+{
+    switch (sz)
+    {
+    case 4:
+        _da_select(begin, end, nth, 4, _da_less_cmp, ctx, leftmost);
+        break;
+    case 8:
+        _da_select(begin, end, nth, 8, _da_less_cmp, ctx, leftmost);
+        break;
+    case 16:
+        _da_select(begin, end, nth, 16, _da_less_cmp, ctx, leftmost);
+        break;
+    default:
+        _da_select(begin, end, nth, sz, _da_less_cmp, ctx, leftmost);
+        break;
+    }
+}
+
+void da_nth_element(void* darr, size_t nth,
+    int (*cmp)(const void*, const void*))
+{
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    if (nth >= nelem)
+        return;
+    struct _da_sort_ctx ctx = {.cmp=cmp};
+    char* base = darr;
+    _da_select_cmp(base, base + nelem*sz, base + nth*sz, sz, &ctx, true);
+}
+
+// Sorted index of the nearest-rank quantile `q` of `nelem` elements.
+static size_t _da_quantile_index(double q, size_t nelem)
+{
+    double x = q * (double)nelem;
+    if (!(x > 0.0))
+        return 0;
+    if (x >= (double)nelem)
+        return nelem - 1;
+    size_t rank = (size_t)x;
+    rank += (double)rank < x; // ceil without linking libm
+    return rank - 1;
+}
+
+void da_percentiles(void* darr, const double* qs, size_t nq, void* out,
+    int (*cmp)(const void*, const void*))
+{
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    struct _da_sort_ctx ctx = {.cmp=cmp};
+    char* base = darr;
+    for (size_t i = 0; i < nq; ++i)
+    {
+        // The elements at indices selected for earlier quantiles are in their
+        // sorted positions and partition the darray, so only the range
+        // between the nearest of them on either side needs searching.
+        size_t index = _da_quantile_index(qs[i], nelem);
+        size_t lo = 0;
+        size_t hi = nelem;
+        bool selected = false;
+        for (size_t j = 0; j < i; ++j)
+        {
+            size_t prev = _da_quantile_index(qs[j], nelem);
+            selected = selected || prev == index;
+            if (prev < index && prev + 1 > lo)
+                lo = prev + 1;
+            if (prev > index && prev < hi)
+                hi = prev;
+        }
+        if (!selected)
+        {
+            _da_select_cmp(base + lo*sz, base + hi*sz, base + index*sz, sz,
+                &ctx, lo == 0);
+        }
+        memcpy((char*)out + i*sz, base + index*sz, sz);
+    }
+}
+
+#define DA_RADIX_BITS 8
+#define DA_RADIX_BUCKETS (1 << DA_RADIX_BITS)
+
+// Map a key to an unsigned integer whose natural ordering matches the ordering
+// of the key.
+static DA_ALWAYS_INLINE uint64_t _da_radix_key(const char* elem,
+    enum da_key_type type)
+{
+    uint32_t u32;
+    uint64_t u64;
+    switch (type)
+    {
+    case DA_KEY_I32:
+        memcpy(&u32, elem, sizeof(u32));
+        return u32 ^ UINT32_C(0x80000000);
+    case DA_KEY_U32:
+        memcpy(&u32, elem, sizeof(u32));
+        return u32;
+    case DA_KEY_I64:
+        memcpy(&u64, elem, sizeof(u64));
+        return u64 ^ UINT64_C(0x8000000000000000);
+    case DA_KEY_U64:
+        memcpy(&u64, elem, sizeof(u64));
+        return u64;
+    case DA_KEY_F32:
+        memcpy(&u32, elem, sizeof(u32));
+        return u32 ^ ((u32 >> 31) ? UINT32_C(0xFFFFFFFF) :
+            UINT32_C(0x80000000));
+    case DA_KEY_F64:
+        memcpy(&u64, elem, sizeof(u64));
+        return u64 ^ ((u64 >> 63) ? UINT64_C(0xFFFFFFFFFFFFFFFF) :
+            UINT64_C(0x8000000000000000));
+    }
+    return 0;
+}
+
+static DA_ALWAYS_INLINE bool _da_radix_sort(char* base, size_t nelem,
+    size_t sz, size_t offset, enum da_key_type type,
+    struct da_mem_funcs mem_funcs)
+{
+    if (nelem < 2)
+        return true;
+    bool narrow_key =
+        type == DA_KEY_I32 || type == DA_KEY_U32 || type == DA_KEY_F32;
+    size_t key_bytes = narrow_key ? 4 : 8;
+
+    char* aux = mem_funcs.alloc_f(nelem*sz);
+    if (aux == NULL)
+        return false;
+
+    // Histograms for every digit are gathered in a single pass.
+    size_t hist[8][DA_RADIX_BUCKETS] = {{0}};
+    for (size_t i = 0; i < nelem; ++i)
+    {
+        uint64_t key = _da_radix_key(base + i*sz + offset, type);
+        for (size_t d = 0; d < key_bytes; ++d)
+            hist[d][(key >> (d*DA_RADIX_BITS)) & (DA_RADIX_BUCKETS-1)] += 1;
+    }
+
+    char* src = base;
+    char* dst = aux;
+    uint64_t first_key = _da_radix_key(base + offset, type);
+    for (size_t d = 0; d < key_bytes; ++d)
+    {
+        size_t shift = d*DA_RADIX_BITS;
+        // Every key shares this digit, so the pass would not reorder anything.
+        if (hist[d][(first_key >> shift) & (DA_RADIX_BUCKETS-1)] == nelem)
+            continue;
+
+        size_t sum = 0;
+        for (size_t b = 0; b < DA_RADIX_BUCKETS; ++b)
+        {
+            size_t count = hist[d][b];
+            hist[d][b] = sum;
+            sum += count;
+        }
+        for (size_t i = 0; i < nelem; ++i)
+        {
+            uint64_t key = _da_radix_key(src + i*sz + offset, type);
+            size_t bucket = (key >> shift) & (DA_RADIX_BUCKETS-1);
+            memcpy(dst + (hist[d][bucket]++)*sz, src + i*sz, sz);
+        }
+        char* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != base)
+        memcpy(base, src, nelem*sz);
+    mem_funcs.free_f(aux);
+    return true;
+}
+
+#define _DA_RADIX_SORT_SCALAR(darr, type, key_type)                            \
+    _da_radix_sort((char*)(darr), da_length(darr), sizeof(type), 0, key_type,  \
+        _da_mem_funcs(darr))
+
+bool da_radix_sort_i32(darray(int32_t) darr)
+{
+    return _DA_RADIX_SORT_SCALAR(darr, int32_t, DA_KEY_I32);
+}
+
+bool da_radix_sort_u32(darray(uint32_t) darr)
+{
+    return _DA_RADIX_SORT_SCALAR(darr, uint32_t, DA_KEY_U32);
+}
+
+bool da_radix_sort_i64(darray(int64_t) darr)
+{
+    return _DA_RADIX_SORT_SCALAR(darr, int64_t, DA_KEY_I64);
+}
+
+bool da_radix_sort_u64(darray(uint64_t) darr)
+{
+    return _DA_RADIX_SORT_SCALAR(darr, uint64_t, DA_KEY_U64);
+}
+
+bool da_radix_sort_f32(darray(float) darr)
+{
+    return _DA_RADIX_SORT_SCALAR(darr, float, DA_KEY_F32);
+}
+
+bool da_radix_sort_f64(darray(double) darr)
+{
+    return _DA_RADIX_SORT_SCALAR(darr, double, DA_KEY_F64);
+}
+
+bool da_radix_sort_by_key_offset(void* darr, size_t offset,
+    enum da_key_type type)
+{
+    return _da_radix_sort(darr, da_length(darr), da_sizeof_elem(darr), offset,
+        type, _da_mem_funcs(darr));
+}
+
+// Each thread sorts at least this many elements, otherwise the cost of
+// starting threads outweighs the work they do.
+#define DA_PARALLEL_SORT_MIN_CHUNK 16384
+
+struct _da_psort
+{
+    char* src;
+    char* dst;
+    size_t nelem;
+    size_t sz;
+    size_t nthreads;
+    size_t nruns;
+    size_t bounds[DA_PARALLEL_MAX_THREADS+1];
+    bool copy_first;
+    const struct _da_sort_ctx* ctx;
+};
+
+static void _da_psort_chunk(void* ctx, size_t id)
+{
+    struct _da_psort* ps = ctx;
+    size_t begin = ps->bounds[id];
+    size_t nelem = ps->bounds[id+1] - begin;
+    // When the number of merge rounds is odd the chunks are sorted in the
+    // auxiliary buffer so that the final round writes back into the darray.
+    if (ps->copy_first)
+        memcpy(ps->src + begin*ps->sz, ps->dst + begin*ps->sz, nelem*ps->sz);
+    _da_sort_cmp(ps->src + begin*ps->sz, nelem, ps->sz, ps->ctx);
+}
+
+// Number of elements taken from `a` among the first `k` elements of the
+// stable merge of `a` and `b`.
+static DA_ALWAYS_INLINE size_t _da_corank(size_t k, const char* a, size_t na,
+    const char* b, size_t nb, size_t sz, const struct _da_sort_ctx* ctx)
+{
+    size_t lo = k > nb ? k - nb : 0;
+    size_t hi = k < na ? k : na;
+    while (lo < hi)
+    {
+        size_t i = lo + (hi - lo) / 2;
+        if (!_da_less_cmp(b + (k-i-1)*sz, a + i*sz, ctx))
+            lo = i + 1;
+        else
+            hi = i;
+    }
+    return lo;
+}
+
+static DA_ALWAYS_INLINE void _da_merge(const char* a, size_t na,
+    const char* b, size_t nb, char* out, size_t sz,
+    const struct _da_sort_ctx* ctx)
+{
+    while (na != 0 && nb != 0)
+    {
+        if (_da_less_cmp(b, a, ctx))
+        {
+            memcpy(out, b, sz);
+            b += sz;
+            nb -= 1;
+        }
+        else
+        {
+            memcpy(out, a, sz);
+            a += sz;
+            na -= 1;
+        }
+        out += sz;
+    }
+    memcpy(out, a, na*sz);
+    memcpy(out + na*sz, b, nb*sz);
+}
+
+// Every thread produces an equal slice of the output of the current merge
+// round, locating the matching input ranges by co-ranking. This keeps all
+// threads busy even in the final rounds where only one or two pairs of runs
+// remain.
+static DA_ALWAYS_INLINE void _da_psort_merge_impl(struct _da_psort* ps,
+    size_t id, size_t sz)
+{
+    size_t slice_begin = ps->nelem * id / ps->nthreads;
+    size_t slice_end = ps->nelem * (id+1) / ps->nthreads;
+    for (size_t r = 0; r < ps->nruns; r += 2)
+    {
+        size_t begin = ps->bounds[r];
+        size_t mid = ps->bounds[r+1];
+        size_t end = ps->bounds[r+2 <= ps->nruns ? r+2 : r+1];
+        if (end <= slice_begin || begin >= slice_end)
+            continue;
+
+        const char* a = ps->src + begin*sz;
+        const char* b = ps->src + mid*sz;
+        size_t na = mid - begin;
+        size_t nb = end - mid;
+        size_t k0 = (slice_begin > begin ? slice_begin : begin) - begin;
+        size_t k1 = (slice_end < end ? slice_end : end) - begin;
+        size_t i0 = _da_corank(k0, a, na, b, nb, sz, ps->ctx);
+        size_t i1 = _da_corank(k1, a, na, b, nb, sz, ps->ctx);
+        _da_merge(a + i0*sz, i1 - i0, b + (k0-i0)*sz, (k1-i1) - (k0-i0),
+            ps->dst + (begin+k0)*sz, sz, ps->ctx);
+    }
+}
+
+static void _da_psort_merge(void* ctx, size_t id)
+{
+    struct _da_psort* ps = ctx;
+    switch (ps->sz)
+    {
+    case 4:  _da_psort_merge_impl(ps, id, 4);      break;
+    case 8:  _da_psort_merge_impl(ps, id, 8);      break;
+    case 16: _da_psort_merge_impl(ps, id, 16);     break;
+    default: _da_psort_merge_impl(ps, id, ps->sz); break;
+    }
+}
+
+bool da_parallel_sort(void* darr, int (*cmp)(const void*, const void*),
+    size_t nthreads)
+{
+    struct _da_sort_ctx ctx = {.cmp=cmp};
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+
+    nthreads = _da_clamp_nthreads(nthreads, nelem, DA_PARALLEL_SORT_MIN_CHUNK);
+    if (nthreads == 1)
+    {
+        _da_sort_cmp(darr, nelem, sz, &ctx);
+        return true;
+    }
+
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(darr);
+    char* aux = mem_funcs.alloc_f(nelem*sz);
+    if (aux == NULL)
+        return false;
+
+    struct _da_psort ps = {
+        .nelem=nelem, .sz=sz, .nthreads=nthreads, .nruns=nthreads, .ctx=&ctx
+    };
+    for (size_t t = 0; t <= nthreads; ++t)
+        ps.bounds[t] = nelem * t / nthreads;
+    size_t rounds = 0;
+    for (size_t n = 1; n < nthreads; n *= 2)
+        rounds += 1;
+    ps.copy_first = rounds % 2 == 1;
+    ps.src = ps.copy_first ? aux : darr;
+    ps.dst = ps.copy_first ? darr : aux;
+
+    _da_parallel_run(ps.nthreads, _da_psort_chunk, &ps);
+    while (ps.nruns > 1)
+    {
+        _da_parallel_run(ps.nthreads, _da_psort_merge, &ps);
+        size_t nruns = (ps.nruns + 1) / 2;
+        for (size_t r = 0; r < nruns; ++r)
+            ps.bounds[r] = ps.bounds[2*r];
+        ps.bounds[nruns] = nelem;
+        ps.nruns = nruns;
+        char* tmp = ps.src;
+        ps.src = ps.dst;
+        ps.dst = tmp;
+    }
+
+    mem_funcs.free_f(aux);
+    return true;
+}
+
+////////////////////////////////// SEARCHING ///////////////////////////////////
+static DA_ALWAYS_INLINE long _da_find_scalar(const char* base, size_t nelem,
+    const void* value, size_t sz)
+{
+    for (size_t i = 0; i < nelem; ++i)
+    {
+        if (memcmp(base + i*sz, value, sz) == 0)
+            return (long)i;
+    }
+    return -1;
+}
+
+static DA_ALWAYS_INLINE size_t _da_count_scalar(const char* base, size_t nelem,
+    const void* value, size_t sz)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < nelem; ++i)
+        count += memcmp(base + i*sz, value, sz) == 0;
+    return count;
+}
+
+#if DA_X86_SIMD
+// The SIMD kernels compare `w` byte lanes (w = 1, 2, 4, or 8) and reduce each
+// vector comparison to a byte mask with movemask. Every byte of a matching
+// lane is set, so the index of the first match is the index of the first set
+// bit divided by `w`, and the number of matches is the popcount divided by
+// `w`. Four SSE2 or two AVX2 masks are combined into one 64-bit word per loop
+// iteration so that a single test covers 64 bytes.
+
+static DA_ALWAYS_INLINE __m128i _da_sse2_set1(const void* value, size_t w)
+{
+    int8_t v8;
+    int16_t v16;
+    int32_t v32;
+    int64_t v64;
+    switch (w)
+    {
+    case 1:  memcpy(&v8, value, 1);  return _mm_set1_epi8(v8);
+    case 2:  memcpy(&v16, value, 2); return _mm_set1_epi16(v16);
+    case 4:  memcpy(&v32, value, 4); return _mm_set1_epi32(v32);
+    default: memcpy(&v64, value, 8); return _mm_set1_epi64x(v64);
+    }
+}
+
+static DA_ALWAYS_INLINE uint64_t _da_sse2_eq_mask(const char* p, __m128i v,
+    size_t w)
+{
+    __m128i x = _mm_loadu_si128((const __m128i*)p);
+    __m128i eq;
+    switch (w)
+    {
+    case 1:  eq = _mm_cmpeq_epi8(x, v);  break;
+    case 2:  eq = _mm_cmpeq_epi16(x, v); break;
+    case 4:  eq = _mm_cmpeq_epi32(x, v); break;
+    default:
+        // SSE2 has no 64-bit compare. A 64-bit lane matches if both of its
+        // 32-bit halves match.
+        eq = _mm_cmpeq_epi32(x, v);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        break;
+    }
+    return (uint32_t)_mm_movemask_epi8(eq);
+}
+
+static DA_ALWAYS_INLINE uint64_t _da_sse2_eq_mask64(const char* p, __m128i v,
+    size_t w)
+{
+    return _da_sse2_eq_mask(p, v, w)
+        | _da_sse2_eq_mask(p + 16, v, w) << 16
+        | _da_sse2_eq_mask(p + 32, v, w) << 32
+        | _da_sse2_eq_mask(p + 48, v, w) << 48;
+}
+
+static DA_ALWAYS_INLINE long _da_find_sse2(const char* base, size_t nelem,
+    const void* value, size_t w)
+{
+    __m128i v = _da_sse2_set1(value, w);
+    size_t nbytes = nelem*w;
+    size_t i = 0;
+    for (; i + 64 <= nbytes; i += 64)
+    {
+        uint64_t m = _da_sse2_eq_mask64(base + i, v, w);
+        if (m != 0)
+            return (long)((i + __builtin_ctzll(m)) / w);
+    }
+    for (; i + 16 <= nbytes; i += 16)
+    {
+        uint64_t m = _da_sse2_eq_mask(base + i, v, w);
+        if (m != 0)
+            return (long)((i + __builtin_ctzll(m)) / w);
+    }
+    long tail = _da_find_scalar(base + i, (nbytes - i) / w, value, w);
+    return tail < 0 ? -1 : (long)(i / w) + tail;
+}
+
+static DA_ALWAYS_INLINE size_t _da_count_sse2(const char* base, size_t nelem,
+    const void* value, size_t w)
+{
+    __m128i v = _da_sse2_set1(value, w);
+    size_t nbytes = nelem*w;
+    size_t matched_bytes = 0;
+    size_t i = 0;
+    for (; i + 64 <= nbytes; i += 64)
+    {
+        uint64_t m = _da_sse2_eq_mask64(base + i, v, w);
+        matched_bytes += __builtin_popcountll(m);
+    }
+    for (; i + 16 <= nbytes; i += 16)
+        matched_bytes += __builtin_popcountll(_da_sse2_eq_mask(base + i, v, w));
+    return matched_bytes / w
+        + _da_count_scalar(base + i, (nbytes - i) / w, value, w);
+}
+
+static DA_AVX2_INLINE __m256i _da_avx2_set1(const void* value, size_t w)
+{
+    int8_t v8;
+    int16_t v16;
+    int32_t v32;
+    int64_t v64;
+    switch (w)
+    {
+    case 1:  memcpy(&v8, value, 1);  return _mm256_set1_epi8(v8);
+    case 2:  memcpy(&v16, value, 2); return _mm256_set1_epi16(v16);
+    case 4:  memcpy(&v32, value, 4); return _mm256_set1_epi32(v32);
+    default: memcpy(&v64, value, 8); return _mm256_set1_epi64x(v64);
+    }
+}
+
+static DA_AVX2_INLINE uint64_t _da_avx2_eq_mask(const char* p, __m256i v,
+    size_t w)
+{
+    __m256i x = _mm256_loadu_si256((const __m256i*)p);
+    __m256i eq;
+    switch (w)
+    {
+    case 1:  eq = _mm256_cmpeq_epi8(x, v);  break;
+    case 2:  eq = _mm256_cmpeq_epi16(x, v); break;
+    case 4:  eq = _mm256_cmpeq_epi32(x, v); break;
+    default: eq = _mm256_cmpeq_epi64(x, v); break;
+    }
+    return (uint32_t)_mm256_movemask_epi8(eq);
+}
+
+static DA_AVX2_INLINE long _da_find_avx2_impl(const char* base, size_t nelem,
+    const void* value, size_t w)
+{
+    __m256i v = _da_avx2_set1(value, w);
+    size_t nbytes = nelem*w;
+    size_t i = 0;
+    for (; i + 64 <= nbytes; i += 64)
+    {
+        uint64_t m = _da_avx2_eq_mask(base + i, v, w)
+            | _da_avx2_eq_mask(base + i + 32, v, w) << 32;
+        if (m != 0)
+            return (long)((i + __builtin_ctzll(m)) / w);
+    }
+    for (; i + 32 <= nbytes; i += 32)
+    {
+        uint64_t m = _da_avx2_eq_mask(base + i, v, w);
+        if (m != 0)
+            return (long)((i + __builtin_ctzll(m)) / w);
+    }
+    long tail = _da_find_scalar(base + i, (nbytes - i) / w, value, w);
+    return tail < 0 ? -1 : (long)(i / w) + tail;
+}
+
+static DA_AVX2_INLINE size_t _da_count_avx2_impl(const char* base,
+    size_t nelem, const void* value, size_t w)
+{
+    __m256i v = _da_avx2_set1(value, w);
+    size_t nbytes = nelem*w;
+    size_t matched_bytes = 0;
+    size_t i = 0;
+    for (; i + 64 <= nbytes; i += 64)
+    {
+        uint64_t m = _da_avx2_eq_mask(base + i, v, w)
+            | _da_avx2_eq_mask(base + i + 32, v, w) << 32;
+        matched_bytes += __builtin_popcountll(m);
+    }
+    for (; i + 32 <= nbytes; i += 32)
+        matched_bytes += __builtin_popcountll(_da_avx2_eq_mask(base + i, v, w));
+    return matched_bytes / w
+        + _da_count_scalar(base + i, (nbytes - i) / w, value, w);
+}
+
+static DA_TARGET_AVX2 long _da_find_avx2(const char* base, size_t nelem,
+    const void* value, size_t w)
+{
+    switch (w)
+    {
+    case 1:  return _da_find_avx2_impl(base, nelem, value, 1);
+    case 2:  return _da_find_avx2_impl(base, nelem, value, 2);
+    case 4:  return _da_find_avx2_impl(base, nelem, value, 4);
+    default: return _da_find_avx2_impl(base, nelem, value, 8);
+    }
+}
+
+static DA_TARGET_AVX2 size_t _da_count_avx2(const char* base, size_t nelem,
+    const void* value, size_t w)
+{
+    switch (w)
+    {
+    case 1:  return _da_count_avx2_impl(base, nelem, value, 1);
+    case 2:  return _da_count_avx2_impl(base, nelem, value, 2);
+    case 4:  return _da_count_avx2_impl(base, nelem, value, 4);
+    default: return _da_count_avx2_impl(base, nelem, value, 8);
+    }
+}
+
+static bool _da_has_avx2(void)
+{
+    static int has_avx2 = -1;
+    if (has_avx2 < 0)
+        has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    return has_avx2;
+}
+#endif // DA_X86_SIMD
+
+long da_find(const void* darr, const void* value)
+{
+    const char* base = darr;
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+#if DA_X86_SIMD
+    if (sz == 1 || sz == 2 || sz == 4 || sz == 8)
+    {
+        if (_da_has_avx2())
+            return _da_find_avx2(base, nelem, value, sz);
+        switch (sz)
+        {
+        case 1:  return _da_find_sse2(base, nelem, value, 1);
+        case 2:  return _da_find_sse2(base, nelem, value, 2);
+        case 4:  return _da_find_sse2(base, nelem, value, 4);
+        default: return _da_find_sse2(base, nelem, value, 8);
+        }
+    }
+#endif // DA_X86_SIMD
+    switch (sz)
+    {
+    case 1:  return _da_find_scalar(base, nelem, value, 1);
+    case 2:  return _da_find_scalar(base, nelem, value, 2);
+    case 4:  return _da_find_scalar(base, nelem, value, 4);
+    case 8:  return _da_find_scalar(base, nelem, value, 8);
+    default: return _da_find_scalar(base, nelem, value, sz);
+    }
+}
+
+size_t da_count(const void* darr, const void* value)
+{
+    const char* base = darr;
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+#if DA_X86_SIMD
+    if (sz == 1 || sz == 2 || sz == 4 || sz == 8)
+    {
+        if (_da_has_avx2())
+            return _da_count_avx2(base, nelem, value, sz);
+        switch (sz)
+        {
+        case 1:  return _da_count_sse2(base, nelem, value, 1);
+        case 2:  return _da_count_sse2(base, nelem, value, 2);
+        case 4:  return _da_count_sse2(base, nelem, value, 4);
+        default: return _da_count_sse2(base, nelem, value, 8);
+        }
+    }
+#endif // DA_X86_SIMD
+    switch (sz)
+    {
+    case 1:  return _da_count_scalar(base, nelem, value, 1);
+    case 2:  return _da_count_scalar(base, nelem, value, 2);
+    case 4:  return _da_count_scalar(base, nelem, value, 4);
+    case 8:  return _da_count_scalar(base, nelem, value, 8);
+    default: return _da_count_scalar(base, nelem, value, sz);
+    }
+}
+
+bool da_contains(const void* darr, const void* value)
+{
+    return da_find(darr, value) != -1;
+}
+
+long da_find_if(const void* darr, bool (*pred)(const void*, void*), void* ctx)
+{
+    const char* base = darr;
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    for (size_t i = 0; i < nelem; ++i)
+    {
+        if (pred(base + i*sz, ctx))
+            return (long)i;
+    }
+    return -1;
+}
+
+// Branchless lower/upper bound over `nelem` elements of size `sz` starting at
+// `base`. The range is halved a fixed number of times and the half to keep is
+// selected with a conditional move rather than a branch. While a comparison is
+// in flight both possible midpoints of the next step are prefetched, hiding
+// most of the cache miss latency on large darrays.
+static DA_ALWAYS_INLINE size_t _da_bound(const char* base, size_t nelem,
+    size_t sz, const void* key, int (*cmp)(const void*, const void*),
+    bool upper)
+{
+    if (nelem == 0)
+        return 0;
+    const char* first = base;
+    while (nelem > 1)
+    {
+        size_t half = nelem / 2;
+        DA_PREFETCH(base + ((nelem - half) / 2)*sz);
+        DA_PREFETCH(base + (half + (nelem - half) / 2)*sz);
+        int c = cmp(base + half*sz, key);
+        base = (upper ? c <= 0 : c < 0) ? base + half*sz : base;
+        nelem -= half;
+    }
+    int c = cmp(base, key);
+    return (size_t)(base - first) / sz + (upper ? c <= 0 : c < 0);
+}
+
+size_t da_lower_bound(const void* darr, const void* key,
+    int (*cmp)(const void*, const void*))
+{
+    return _da_bound(darr, da_length(darr), da_sizeof_elem(darr), key, cmp,
+        false);
+}
+
+size_t da_upper_bound(const void* darr, const void* key,
+    int (*cmp)(const void*, const void*))
+{
+    return _da_bound(darr, da_length(darr), da_sizeof_elem(darr), key, cmp,
+        true);
+}
+
+struct da_range da_equal_range(const void* darr, const void* key,
+    int (*cmp)(const void*, const void*))
+{
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    struct da_range range;
+    range.begin = _da_bound(darr, nelem, sz, key, cmp, false);
+    range.end = range.begin + _da_bound((const char*)darr + range.begin*sz,
+        nelem - range.begin, sz, key, cmp, true);
+    return range;
+}
+
+void* da_insert_sorted(void* darr, const void* value,
+    int (*cmp)(const void*, const void*))
+{
+    return da_insert_arr(darr, da_upper_bound(darr, value, cmp), value, 1);
+}
+
+void* da_merge_sorted_batch(void* darr, void* batch, size_t nbatch,
+    int (*cmp)(const void*, const void*))
+{
+    darr = da_reserve(darr, nbatch);
+    if (darr == NULL)
+        return NULL;
+    size_t sz = da_sizeof_elem(darr);
+    struct _da_sort_ctx ctx = {.cmp=cmp};
+    _da_sort_cmp(batch, nbatch, sz, &ctx);
+
+    // Darray elements [0, i) and batch elements [0, j) are still unmerged,
+    // and everything from index i + j of the darray onward is final.
+    char* base = darr;
+    const char* b = batch;
+    size_t i = da_length(darr);
+    for (size_t j = nbatch; j > 0; --j)
+    {
+        const char* key = b + (j-1)*sz;
+        // Gallop back from i over the elements greater than the key, then
+        // binary search the last step for the first of them.
+        size_t step = 1;
+        while (step <= i && cmp(base + (i-step)*sz, key) > 0)
+            step *= 2;
+        size_t lo = step > i ? 0 : i - step;
+        size_t hi = i - step/2;
+        size_t pos = lo + _da_bound(base + lo*sz, hi - lo, sz, key, cmp, true);
+        memmove(base + (pos+j)*sz, base + pos*sz, (i - pos)*sz);
+        memcpy(base + (pos+j-1)*sz, key, sz);
+        i = pos;
+    }
+    *DA_P_LENGTH_FROM_HANDLE(darr) += nbatch;
+    return darr;
+}
+
+// Cursor into one input of a k-way merge. An exhausted input has cur == end
+// and loses against every other input.
+struct _da_kway_source
+{
+    const char* cur;
+    const char* end;
+};
+
+// True if source `a` should be output before source `b`. Ties go to the lower
+// numbered source, which keeps the merge stable.
+static DA_ALWAYS_INLINE bool _da_kway_beats(const struct _da_kway_source* src,
+    size_t a, size_t b, int (*cmp)(const void*, const void*))
+{
+    if (src[b].cur == src[b].end)
+        return true;
+    if (src[a].cur == src[a].end)
+        return false;
+    int c = cmp(src[a].cur, src[b].cur);
+    return (c < 0) | ((c == 0) & (a < b));
+}
+
+// Loser tree over `k` sources. Leaves are the implicit nodes [k, 2k), node n
+// has children 2n and 2n+1, and tree[n] for n in [1, k) holds the source that
+// lost the match played at node n. tree[0] holds the overall winner.
+// `winners` is scratch space for 2k entries.
+static DA_ALWAYS_INLINE char* _da_kway_merge(char* out,
+    struct _da_kway_source* src, size_t* tree, size_t* winners, size_t k,
+    size_t sz, int (*cmp)(const void*, const void*), bool unique)
+{
+    for (size_t i = 0; i < k; ++i)
+        winners[k + i] = i;
+    for (size_t n = k; n-- > 1;)
+    {
+        size_t l = winners[2*n];
+        size_t r = winners[2*n + 1];
+        bool l_wins = _da_kway_beats(src, l, r, cmp);
+        winners[n] = l_wins ? l : r;
+        tree[n] = l_wins ? r : l;
+    }
+    size_t w = k > 1 ? winners[1] : 0;
+
+    char* first = out;
+    while (src[w].cur != src[w].end)
+    {
+        if (!unique || out == first || cmp(out - sz, src[w].cur) != 0)
+        {
+            memcpy(out, src[w].cur, sz);
+            out += sz;
+        }
+        src[w].cur += sz;
+        // Replay the matches on the path from the winner's leaf to the root.
+        // The outcome of each match is unpredictable, so the winner and loser
+        // are selected without branching.
+        for (size_t n = (w + k) / 2; n > 0; n /= 2)
+        {
+            size_t challenger = tree[n];
+            bool challenger_wins = _da_kway_beats(src, challenger, w, cmp);
+            tree[n] = challenger_wins ? w : challenger;
+            w = challenger_wins ? challenger : w;
+        }
+    }
+    return out;
+}
+
+static void* _da_kway_merge_arrays(void* const* arrays, size_t narrays,
+    int (*cmp)(const void*, const void*), bool unique)
+{
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(arrays[0]);
+    size_t sz = da_sizeof_elem(arrays[0]);
+    size_t total = 0;
+    for (size_t i = 0; i < narrays; ++i)
+        total += da_length(arrays[i]);
+
+    // Sources, tree, and scratch space for the initial tournament share one
+    // temporary block.
+    size_t src_bytes = narrays * sizeof(struct _da_kway_source);
+    char* tmp = mem_funcs.alloc_f(src_bytes + 3*narrays*sizeof(size_t));
+    if (tmp == NULL)
+        return NULL;
+    char* out = da_alloc_exact_custom(mem_funcs, total, sz);
+    if (out == NULL)
+    {
+        mem_funcs.free_f(tmp);
+        return NULL;
+    }
+    struct _da_kway_source* src = (struct _da_kway_source*)tmp;
+    size_t* tree = (size_t*)(tmp + src_bytes);
+    size_t* winners = tree + narrays;
+    for (size_t i = 0; i < narrays; ++i)
+    {
+        src[i].cur = arrays[i];
+        src[i].end = (const char*)arrays[i] + da_length(arrays[i])*sz;
+    }
+
+    char* end;
+    switch (sz)
+    {
+    case 4:
+        end = _da_kway_merge(out, src, tree, winners, narrays, 4, cmp, unique);
+        break;
+    case 8:
+        end = _da_kway_merge(out, src, tree, winners, narrays, 8, cmp, unique);
+        break;
+    default:
+        end = _da_kway_merge(out, src, tree, winners, narrays, sz, cmp,
+            unique);
+        break;
+    }
+    *DA_P_LENGTH_FROM_HANDLE(out) = (size_t)(end - out) / sz;
+    mem_funcs.free_f(tmp);
+    return out;
+}
+
+void* da_kway_merge(void* const* arrays, size_t narrays,
+    int (*cmp)(const void*, const void*))
+{
+    return _da_kway_merge_arrays(arrays, narrays, cmp, false);
+}
+
+void* da_kway_merge_unique(void* const* arrays, size_t narrays,
+    int (*cmp)(const void*, const void*))
+{
+    return _da_kway_merge_arrays(arrays, narrays, cmp, true);
+}
+
+// Set operations switch from a linear merge to galloping through the larger
+// input once it is at least this many times longer than the smaller one.
+#define DA_SET_GALLOP_RATIO 32
+
+enum _da_set_op
+{
+    DA_SET_INTERSECT,
+    DA_SET_UNION,
+    DA_SET_DIFFERENCE
+};
+
+// Index of the first element of base[0, nelem) not less than `key`, found by
+// galloping forward from the front.
+static DA_ALWAYS_INLINE size_t _da_gallop(const char* base, size_t nelem,
+    size_t sz, const void* key, int (*cmp)(const void*, const void*))
+{
+    size_t lo = 0;
+    size_t hi = 0;
+    size_t step = 1;
+    while (hi < nelem && cmp(base + hi*sz, key) < 0)
+    {
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    if (hi > nelem)
+        hi = nelem;
+    return lo + _da_bound(base + lo*sz, hi - lo, sz, key, cmp, false);
+}
+
+static DA_ALWAYS_INLINE char* _da_set_copy(char* out, const char* src,
+    size_t nelem, size_t sz)
+{
+    memcpy(out, src, nelem*sz);
+    return out + nelem*sz;
+}
+
+// Linear merge of sorted sets a and b into `out`. Returns the end of the
+// output.
+static DA_ALWAYS_INLINE char* _da_set_merge(char* out, const char* a,
+    size_t na, const char* b, size_t nb, size_t sz,
+    int (*cmp)(const void*, const void*), enum _da_set_op op)
+{
+    size_t i = 0;
+    size_t j = 0;
+    while (i < na && j < nb)
+    {
+        int c = cmp(a + i*sz, b + j*sz);
+        if (c <= 0 && (c == 0 ? op != DA_SET_DIFFERENCE
+            : op != DA_SET_INTERSECT))
+            out = _da_set_copy(out, a + i*sz, 1, sz);
+        else if (c > 0 && op == DA_SET_UNION)
+            out = _da_set_copy(out, b + j*sz, 1, sz);
+        i += c <= 0;
+        j += c >= 0;
+    }
+    if (op != DA_SET_INTERSECT)
+        out = _da_set_copy(out, a + i*sz, na - i, sz);
+    if (op == DA_SET_UNION)
+        out = _da_set_copy(out, b + j*sz, nb - j, sz);
+    return out;
+}
+
+// Merge of sorted sets where one input is much smaller than the other. Each
+// element of the smaller input is located in the larger one by galloping from
+// the previous position, so runs of the larger input are skipped over (or
+// copied with one `memcpy`) instead of being compared element by element.
+static DA_ALWAYS_INLINE char* _da_set_gallop(char* out, const char* a,
+    size_t na, const char* b, size_t nb, size_t sz,
+    int (*cmp)(const void*, const void*), enum _da_set_op op)
+{
+    bool a_small = na <= nb;
+    const char* small = a_small ? a : b;
+    const char* large = a_small ? b : a;
+    size_t nsmall = a_small ? na : nb;
+    size_t nlarge = a_small ? nb : na;
+    // The large input's elements are output by union, and by difference when
+    // they come from a.
+    bool copy_large = op == DA_SET_UNION
+        || (op == DA_SET_DIFFERENCE && !a_small);
+    // The small input's elements missing from the large one are output by
+    // union, and by difference when they come from a.
+    bool copy_unmatched = op == DA_SET_UNION
+        || (op == DA_SET_DIFFERENCE && a_small);
+
+    size_t pos = 0;
+    for (size_t k = 0; k < nsmall; ++k)
+    {
+        const char* x = small + k*sz;
+        size_t skip = _da_gallop(large + pos*sz, nlarge - pos, sz, x, cmp);
+        if (copy_large)
+            out = _da_set_copy(out, large + pos*sz, skip, sz);
+        pos += skip;
+        bool matched = pos < nlarge && cmp(large + pos*sz, x) == 0;
+        if (matched)
+        {
+            // Matched elements are output from a by union and intersection.
+            if (op != DA_SET_DIFFERENCE)
+                out = _da_set_copy(out, a_small ? x : large + pos*sz, 1, sz);
+            pos += 1;
+        }
+        else if (copy_unmatched)
+        {
+            out = _da_set_copy(out, x, 1, sz);
+        }
+    }
+    if (copy_large)
+        out = _da_set_copy(out, large + pos*sz, nlarge - pos, sz);
+    return out;
+}
+
+static DA_ALWAYS_INLINE char* _da_set_run(char* out, const char* a,
+    size_t na, const char* b, size_t nb, size_t sz,
+    int (*cmp)(const void*, const void*), enum _da_set_op op)
+{
+    size_t nsmall = na < nb ? na : nb;
+    size_t nlarge = na < nb ? nb : na;
+    if (nlarge / DA_SET_GALLOP_RATIO > nsmall)
+        return _da_set_gallop(out, a, na, b, nb, sz, cmp, op);
+    return _da_set_merge(out, a, na, b, nb, sz, cmp, op);
+}
+
+static DA_ALWAYS_INLINE int _da_cmp_u32(const void* a, const void* b)
+{
+    uint32_t x;
+    uint32_t y;
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    return (x > y) - (x < y);
+}
+
+#if DA_X86_SIMD
+// Intersect blocks of four elements from each input: every element of the
+// block of a is compared against all four rotations of the block of b, and
+// whichever block has the smaller maximum is then advanced (both if equal).
+// Returns the end of the output and sets *ia and *ib to the elements of a and
+// b not yet consumed.
+static char* _da_intersect_sse2_u32(char* out, const uint32_t* a, size_t na,
+    const uint32_t* b, size_t nb, size_t* ia, size_t* ib)
+{
+    size_t i = 0;
+    size_t j = 0;
+    while (i + 4 <= na && j + 4 <= nb)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+        __m128i eq = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x39))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x4E)),
+                _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x93))));
+        unsigned mask = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq));
+        while (mask != 0)
+        {
+            memcpy(out, a + i + __builtin_ctz(mask), sizeof(uint32_t));
+            out += sizeof(uint32_t);
+            mask &= mask - 1;
+        }
+        uint32_t a_max = a[i+3];
+        uint32_t b_max = b[j+3];
+        i += (a_max <= b_max) * 4;
+        j += (b_max <= a_max) * 4;
+    }
+    *ia = i;
+    *ib = j;
+    return out;
+}
+#endif // DA_X86_SIMD
+
+// Run a set operation into a new darray with room for the largest possible
+// result, then shrink it to fit.
+static void* _da_set_op(const void* a, const void* b,
+    int (*cmp)(const void*, const void*), enum _da_set_op op, bool is_u32)
+{
+    size_t na = da_length(a);
+    size_t nb = da_length(b);
+    size_t sz = da_sizeof_elem(a);
+    size_t capacity = op == DA_SET_UNION ? na + nb
+        : op == DA_SET_DIFFERENCE ? na
+        : na < nb ? na : nb;
+    char* out = da_alloc_exact_custom(_da_mem_funcs(a), capacity, sz);
+    if (out == NULL)
+        return NULL;
+
+    const char* pa = a;
+    const char* pb = b;
+    char* end = out;
+    if (is_u32)
+    {
+#if DA_X86_SIMD
+        size_t nsmall = na < nb ? na : nb;
+        size_t nlarge = na < nb ? nb : na;
+        if (op == DA_SET_INTERSECT && nlarge / DA_SET_GALLOP_RATIO <= nsmall)
+        {
+            size_t i, j;
+            end = _da_intersect_sse2_u32(end, a, na, b, nb, &i, &j);
+            pa += i*sz;
+            pb += j*sz;
+            na -= i;
+            nb -= j;
+        }
+#endif // DA_X86_SIMD
+        end = _da_set_run(end, pa, na, pb, nb, sizeof(uint32_t), _da_cmp_u32,
+            op);
+    }
+    else
+    {
+        switch (sz)
+        {
+        case 4:  end = _da_set_run(end, pa, na, pb, nb, 4, cmp, op);  break;
+        case 8:  end = _da_set_run(end, pa, na, pb, nb, 8, cmp, op);  break;
+        default: end = _da_set_run(end, pa, na, pb, nb, sz, cmp, op); break;
+        }
+    }
+
+    size_t nelem = (size_t)(end - out) / sz;
+    void* fit = da_resize_exact(out, nelem);
+    if (fit != NULL)
+        return fit;
+    *DA_P_LENGTH_FROM_HANDLE(out) = nelem;
+    return out;
+}
+
+void* da_set_intersect(const void* a, const void* b,
+    int (*cmp)(const void*, const void*))
+{
+    return _da_set_op(a, b, cmp, DA_SET_INTERSECT, false);
+}
+
+void* da_set_union(const void* a, const void* b,
+    int (*cmp)(const void*, const void*))
+{
+    return _da_set_op(a, b, cmp, DA_SET_UNION, false);
+}
+
+void* da_set_difference(const void* a, const void* b,
+    int (*cmp)(const void*, const void*))
+{
+    return _da_set_op(a, b, cmp, DA_SET_DIFFERENCE, false);
+}
+
+uint32_t* da_set_intersect_u32(darray(const uint32_t) a,
+    darray(const uint32_t) b)
+{
+    return _da_set_op(a, b, NULL, DA_SET_INTERSECT, true);
+}
+
+uint32_t* da_set_union_u32(darray(const uint32_t) a, darray(const uint32_t) b)
+{
+    return _da_set_op(a, b, NULL, DA_SET_UNION, true);
+}
+
+uint32_t* da_set_difference_u32(darray(const uint32_t) a,
+    darray(const uint32_t) b)
+{
+    return _da_set_op(a, b, NULL, DA_SET_DIFFERENCE, true);
+}
+
+void da_search_many(const void* darr, const void* keys, size_t nkeys,
+    size_t* indices, int (*cmp)(const void*, const void*))
+{
+    const char* base = darr;
+    const char* key = keys;
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    size_t lo = 0;
+    for (size_t k = 0; k < nkeys; ++k, key += sz)
+    {
+        // A key that does not follow the previous one restarts from the front.
+        if (lo > 0 && cmp(base + (lo-1)*sz, key) >= 0)
+            lo = 0;
+        // Gallop forward until an element not less than the key is passed,
+        // then finish with a binary search over the last step.
+        size_t hi = lo;
+        size_t step = 1;
+        while (hi < nelem && cmp(base + hi*sz, key) < 0)
+        {
+            lo = hi + 1;
+            hi += step;
+            step *= 2;
+        }
+        if (hi > nelem)
+            hi = nelem;
+        lo += _da_bound(base + lo*sz, hi - lo, sz, key, cmp, false);
+        indices[k] = lo;
+    }
+}
+
+// Allocate `size` bytes with `mem_funcs` such that the returned pointer is
+// aligned to a cache line. The block must be released with
+// `_da_free_cache_aligned`.
+static void* _da_alloc_cache_aligned(struct da_mem_funcs mem_funcs,
+    size_t size)
+{
+    char* raw = mem_funcs.alloc_f(size + DA_CACHE_LINE_SIZE);
+    if (raw == NULL)
+        return NULL;
+    size_t shift = DA_CACHE_LINE_SIZE - (uintptr_t)raw % DA_CACHE_LINE_SIZE;
+    char* aligned = raw + shift;
+    // `shift` is in [1, DA_CACHE_LINE_SIZE] so it always fits in the byte
+    // before the aligned block.
+    aligned[-1] = (char)(shift - 1);
+    return aligned;
+}
+
+static void _da_free_cache_aligned(struct da_mem_funcs mem_funcs, void* ptr)
+{
+    if (ptr == NULL)
+        return;
+    char* aligned = ptr;
+    mem_funcs.free_f(aligned - ((unsigned char)aligned[-1] + 1));
+}
+
+struct da_eytzinger
+{
+    struct da_mem_funcs mem_funcs;
+    int (*cmp)(const void*, const void*);
+    size_t nelem;
+    size_t sz;
+    // Number of elements that are descendants of a node `log2(stride)` levels
+    // down. They are contiguous, and span roughly one cache line.
+    size_t stride;
+    // ranks[k] is the index in the sorted darray of the element at Eytzinger
+    // position k. Position 0 is unused so that the children of k are 2k and
+    // 2k+1.
+    size_t* ranks;
+    char* data;
+};
+
+static size_t _da_eytzinger_fill(struct da_eytzinger* ez, const char* sorted,
+    size_t rank, size_t k)
+{
+    if (k > ez->nelem)
+        return rank;
+    rank = _da_eytzinger_fill(ez, sorted, rank, 2*k);
+    memcpy(ez->data + k*ez->sz, sorted + rank*ez->sz, ez->sz);
+    ez->ranks[k] = rank;
+    return _da_eytzinger_fill(ez, sorted, rank+1, 2*k+1);
+}
+
+struct da_eytzinger* da_build_eytzinger(const void* sorted,
+    int (*cmp)(const void*, const void*))
+{
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(sorted);
+    struct da_eytzinger* ez = mem_funcs.alloc_f(sizeof(struct da_eytzinger));
+    if (ez == NULL)
+        return NULL;
+    ez->mem_funcs = mem_funcs;
+    ez->cmp = cmp;
+    ez->nelem = da_length(sorted);
+    ez->sz = da_sizeof_elem(sorted);
+    ez->stride = 1;
+    while (ez->stride*2*ez->sz <= DA_CACHE_LINE_SIZE)
+        ez->stride *= 2;
+    ez->ranks = mem_funcs.alloc_f((ez->nelem+1)*sizeof(size_t));
+    ez->data = _da_alloc_cache_aligned(mem_funcs, (ez->nelem+1)*ez->sz);
+    if (ez->ranks == NULL || ez->data == NULL)
+    {
+        da_eytzinger_free(ez);
+        return NULL;
+    }
+    _da_eytzinger_fill(ez, sorted, 0, 1);
+    return ez;
+}
+
+void da_eytzinger_free(struct da_eytzinger* index)
+{
+    if (index == NULL)
+        return;
+    struct da_mem_funcs mem_funcs = index->mem_funcs;
+    mem_funcs.free_f(index->ranks);
+    _da_free_cache_aligned(mem_funcs, index->data);
+    mem_funcs.free_f(index);
+}
+
+// Eytzinger position of the first element not less than `key`, or 0 if every
+// element is less than `key`.
+static size_t _da_eytzinger_search(const struct da_eytzinger* ez,
+    const void* key)
+{
+    const char* data = ez->data;
+    size_t nelem = ez->nelem;
+    size_t sz = ez->sz;
+    size_t prefetch_stride = ez->stride*sz;
+    int (*cmp)(const void*, const void*) = ez->cmp;
+    size_t k = 1;
+    while (k <= nelem)
+    {
+        DA_PREFETCH((const char*)((uintptr_t)data + k*prefetch_stride));
+        k = 2*k + (cmp(data + k*sz, key) < 0);
+    }
+    // The path descended right after the answer's node every time it went
+    // right; strip those steps and the final left step.
+    while (k & 1)
+        k >>= 1;
+    return k >> 1;
+}
+
+size_t da_eytzinger_lower_bound(const struct da_eytzinger* index,
+    const void* key)
+{
+    size_t k = _da_eytzinger_search(index, key);
+    return k == 0 ? index->nelem : index->ranks[k];
+}
+
+long da_eytzinger_find(const struct da_eytzinger* index, const void* key)
+{
+    size_t k = _da_eytzinger_search(index, key);
+    if (k == 0 || index->cmp(index->data + k*index->sz, key) != 0)
+        return -1;
+    return (long)index->ranks[k];
+}
+
+struct da_btree_index
+{
+    struct da_mem_funcs mem_funcs;
+    int (*cmp)(const void*, const void*);
+    size_t nelem;
+    size_t sz;
+    // Keys per node. Node k has children k*(fanout+1) + 1 ... k*(fanout+1) +
+    // fanout + 1.
+    size_t fanout;
+    size_t nnodes;
+    size_t* ranks;
+    char* data;
+};
+
+// In-order fill of the implicit tree. Slots left over once every element has
+// been placed are padded with copies of the largest element, so every node is
+// full and the slots read in order form a sorted sequence whose lower bound is
+// always a real element.
+static size_t _da_btree_index_fill(struct da_btree_index* bt,
+    const char* sorted, size_t rank, size_t k)
+{
+    if (k >= bt->nnodes)
+        return rank;
+    size_t first_child = k*(bt->fanout+1) + 1;
+    for (size_t i = 0; i < bt->fanout; ++i)
+    {
+        rank = _da_btree_index_fill(bt, sorted, rank, first_child + i);
+        size_t slot = k*bt->fanout + i;
+        size_t src = rank < bt->nelem ? rank : bt->nelem - 1;
+        memcpy(bt->data + slot*bt->sz, sorted + src*bt->sz, bt->sz);
+        bt->ranks[slot] = rank < bt->nelem ? rank++ : bt->nelem;
+    }
+    return _da_btree_index_fill(bt, sorted, rank, first_child + bt->fanout);
+}
+
+struct da_btree_index* da_build_btree_index(const void* sorted,
+    int (*cmp)(const void*, const void*))
+{
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(sorted);
+    struct da_btree_index* bt =
+        mem_funcs.alloc_f(sizeof(struct da_btree_index));
+    if (bt == NULL)
+        return NULL;
+    bt->mem_funcs = mem_funcs;
+    bt->cmp = cmp;
+    bt->nelem = da_length(sorted);
+    bt->sz = da_sizeof_elem(sorted);
+    bt->fanout = DA_CACHE_LINE_SIZE / bt->sz;
+    if (bt->fanout < 2)
+        bt->fanout = 2;
+    bt->nnodes = (bt->nelem + bt->fanout - 1) / bt->fanout;
+    size_t nslots = bt->nnodes*bt->fanout;
+    bt->ranks = mem_funcs.alloc_f((nslots+1)*sizeof(size_t));
+    bt->data = _da_alloc_cache_aligned(mem_funcs, (nslots+1)*bt->sz);
+    if (bt->ranks == NULL || bt->data == NULL)
+    {
+        da_btree_index_free(bt);
+        return NULL;
+    }
+    _da_btree_index_fill(bt, sorted, 0, 0);
+    return bt;
+}
+
+void da_btree_index_free(struct da_btree_index* index)
+{
+    if (index == NULL)
+        return;
+    struct da_mem_funcs mem_funcs = index->mem_funcs;
+    mem_funcs.free_f(index->ranks);
+    _da_free_cache_aligned(mem_funcs, index->data);
+    mem_funcs.free_f(index);
+}
+
+// Slot of the first element not less than `key`, or SIZE_MAX if every element
+// is less than `key`.
+static size_t _da_btree_index_search(const struct da_btree_index* bt,
+    const void* key)
+{
+    const char* data = bt->data;
+    size_t sz = bt->sz;
+    size_t fanout = bt->fanout;
+    size_t nnodes = bt->nnodes;
+    int (*cmp)(const void*, const void*) = bt->cmp;
+    size_t result = SIZE_MAX;
+    size_t k = 0;
+    while (k < nnodes)
+    {
+        size_t i = _da_bound(data + k*fanout*sz, fanout, sz, key, cmp, false);
+        if (i < fanout)
+            result = k*fanout + i;
+        k = k*(fanout+1) + i + 1;
+    }
+    return result;
+}
+
+size_t da_btree_index_lower_bound(const struct da_btree_index* index,
+    const void* key)
+{
+    size_t slot = _da_btree_index_search(index, key);
+    return slot == SIZE_MAX ? index->nelem : index->ranks[slot];
+}
+
+long da_btree_index_find(const struct da_btree_index* index, const void* key)
+{
+    size_t slot = _da_btree_index_search(index, key);
+    if (slot == SIZE_MAX
+        || index->cmp(index->data + slot*index->sz, key) != 0)
+        return -1;
+    return (long)index->ranks[slot];
+}
+
+//////////////////////////////////// HEAPS /////////////////////////////////////
+// Heaps are sifted by moving a hole instead of swapping: the element being
+// sifted is held in a buffer while its parents or children are moved over it
+// one copy at a time, and it is written once at its final position. Elements
+// larger than the buffer fall back to swapping, which the sifts below select
+// by passing a `NULL` buffer.
+#define DA_HEAP_HOLE_BUFFER_SIZE DA_SWAP_BUFFER_SIZE
+
+// Sift the element `value` down from the hole at `index`. Without a hole the
+// element is read from `index` and swapped down instead.
+static DA_ALWAYS_INLINE void _da_heap_sift_down(char* base, size_t index,
+    size_t nelem, size_t sz, size_t arity,
+    int (*cmp)(const void*, const void*), const char* value, bool hole)
+{
+    const char* v = hole ? value : base + index*sz;
+    size_t first;
+    while ((first = arity*index + 1) < nelem)
+    {
+        DA_PREFETCH(base + (arity*first + 1)*sz);
+        size_t last = nelem - first < arity ? nelem : first + arity;
+        size_t best = first;
+        for (size_t c = first + 1; c < last; ++c)
+            best = cmp(base + c*sz, base + best*sz) > 0 ? c : best;
+        if (cmp(base + best*sz, v) <= 0)
+            break;
+        if (hole)
+        {
+            memcpy(base + index*sz, base + best*sz, sz);
+        }
+        else
+        {
+            _da_memswap(base + index*sz, base + best*sz, sz);
+            v = base + best*sz;
+        }
+        index = best;
+    }
+    if (hole)
+        memcpy(base + index*sz, value, sz);
+}
+
+// Sift the element `value` up from the hole at `index`. Without a hole the
+// element is read from `index` and swapped up instead.
+static DA_ALWAYS_INLINE void _da_heap_sift_up(char* base, size_t index,
+    size_t sz, size_t arity, int (*cmp)(const void*, const void*),
+    const char* value, bool hole)
+{
+    const char* v = hole ? value : base + index*sz;
+    while (index > 0)
+    {
+        size_t parent = (index - 1) / arity;
+        if (cmp(base + parent*sz, v) >= 0)
+            break;
+        if (hole)
+        {
+            memcpy(base + index*sz, base + parent*sz, sz);
+        }
+        else
+        {
+            _da_memswap(base + index*sz, base + parent*sz, sz);
+            v = base + parent*sz;
+        }
+        index = parent;
+    }
+    if (hole)
+        memcpy(base + index*sz, value, sz);
+}
+
+// Sift the element `value` down from the hole at the root after a pop. The
+// element replacing the popped one was the last leaf, so it most likely
+// belongs near the bottom: the hole is moved all the way down along the
+// greatest children without comparing against `value`, and `value` is then
+// sifted up from there, saving a comparison per level.
+static DA_ALWAYS_INLINE void _da_heap_sift_bottom_up(char* base, size_t nelem,
+    size_t sz, size_t arity, int (*cmp)(const void*, const void*),
+    const char* value)
+{
+    size_t index = 0;
+    size_t first;
+    while ((first = arity*index + 1) < nelem)
+    {
+        // Fetch the grandchildren while the children are compared.
+        DA_PREFETCH(base + (arity*first + 1)*sz);
+        size_t last = nelem - first < arity ? nelem : first + arity;
+        size_t best = first;
+        for (size_t c = first + 1; c < last; ++c)
+            best = cmp(base + c*sz, base + best*sz) > 0 ? c : best;
+        memcpy(base + index*sz, base + best*sz, sz);
+        index = best;
+    }
+    _da_heap_sift_up(base, index, sz, arity, cmp, value, true);
+}
+
+// Instantiate a sift for the common element sizes and arities so that copies
+// and child index arithmetic compile to a few instructions.
+#define _DA_HEAP_DISPATCH(sz, arity, sift)                                     \
+    do                                                                         \
+    {                                                                          \
+        if ((sz) == 4 && (arity) == 2)      sift(4, 2);                        \
+        else if ((sz) == 4 && (arity) == 4) sift(4, 4);                        \
+        else if ((sz) == 8 && (arity) == 2) sift(8, 2);                        \
+        else if ((sz) == 8 && (arity) == 4) sift(8, 4);                        \
+        else                                sift(sz, arity);                   \
+    } while (0)
+
+static void _da_heap_down(char* base, size_t index, size_t nelem, size_t sz,
+    size_t arity, int (*cmp)(const void*, const void*), const char* value)
+{
+    bool hole = value != NULL;
+#define _DA_HEAP_SIFT_DOWN(SZ, ARITY) \
+    _da_heap_sift_down(base, index, nelem, SZ, ARITY, cmp, value, hole)
+    _DA_HEAP_DISPATCH(sz, arity, _DA_HEAP_SIFT_DOWN);
+#undef _DA_HEAP_SIFT_DOWN
+}
+
+static void _da_heap_up(char* base, size_t index, size_t sz, size_t arity,
+    int (*cmp)(const void*, const void*), const char* value)
+{
+    bool hole = value != NULL;
+#define _DA_HEAP_SIFT_UP(SZ, ARITY) \
+    _da_heap_sift_up(base, index, SZ, ARITY, cmp, value, hole)
+    _DA_HEAP_DISPATCH(sz, arity, _DA_HEAP_SIFT_UP);
+#undef _DA_HEAP_SIFT_UP
+}
+
+static void _da_heap_pop_down(char* base, size_t nelem, size_t sz,
+    size_t arity, int (*cmp)(const void*, const void*), const char* value)
+{
+    if (value == NULL)
+    {
+        _da_heap_down(base, 0, nelem, sz, arity, cmp, NULL);
+        return;
+    }
+#define _DA_HEAP_SIFT_BOTTOM_UP(SZ, ARITY) \
+    _da_heap_sift_bottom_up(base, nelem, SZ, ARITY, cmp, value)
+    _DA_HEAP_DISPATCH(sz, arity, _DA_HEAP_SIFT_BOTTOM_UP);
+#undef _DA_HEAP_SIFT_BOTTOM_UP
+}
+
+void da_heapify(void* darr, int (*cmp)(const void*, const void*),
+    size_t arity)
+{
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    char* base = darr;
+    char value[DA_HEAP_HOLE_BUFFER_SIZE];
+    if (nelem < 2)
+        return;
+    for (size_t i = (nelem - 2) / arity + 1; i-- > 0;)
+    {
+        if (sz <= DA_HEAP_HOLE_BUFFER_SIZE)
+        {
+            memcpy(value, base + i*sz, sz);
+            _da_heap_down(base, i, nelem, sz, arity, cmp, value);
+        }
+        else
+        {
+            _da_heap_down(base, i, nelem, sz, arity, cmp, NULL);
+        }
+    }
+}
+
+void* da_heap_push(void* darr, const void* value,
+    int (*cmp)(const void*, const void*), size_t arity)
+{
+    darr = da_reserve(darr, 1);
+    if (darr == NULL)
+        return NULL;
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    char* base = darr;
+    char tmp[DA_HEAP_HOLE_BUFFER_SIZE];
+    char* hole = NULL;
+    if (sz <= DA_HEAP_HOLE_BUFFER_SIZE)
+        hole = memcpy(tmp, value, sz);
+    else
+        memcpy(base + nelem*sz, value, sz);
+    *DA_P_LENGTH_FROM_HANDLE(darr) = nelem + 1;
+    _da_heap_up(base, nelem, sz, arity, cmp, hole);
+    return darr;
+}
+
+void da_heap_pop(void* darr, void* out, int (*cmp)(const void*, const void*),
+    size_t arity)
+{
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    char* base = darr;
+    char tmp[DA_HEAP_HOLE_BUFFER_SIZE];
+    if (out != NULL)
+        memcpy(out, base, sz);
+    *DA_P_LENGTH_FROM_HANDLE(darr) = --nelem;
+    if (nelem == 0)
+        return;
+    char* hole = NULL;
+    if (sz <= DA_HEAP_HOLE_BUFFER_SIZE)
+        hole = memcpy(tmp, base + nelem*sz, sz);
+    else
+        memcpy(base, base + nelem*sz, sz);
+    _da_heap_pop_down(base, nelem, sz, arity, cmp, hole);
+}
+
+void da_heap_replace(void* darr, const void* value, void* out,
+    int (*cmp)(const void*, const void*), size_t arity)
+{
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    char* base = darr;
+    char tmp[DA_HEAP_HOLE_BUFFER_SIZE];
+    char* hole = NULL;
+    // The new value may be read from the output buffer.
+    if (sz <= DA_HEAP_HOLE_BUFFER_SIZE)
+    {
+        hole = memcpy(tmp, value, sz);
+        if (out != NULL)
+            memcpy(out, base, sz);
+    }
+    else if (out == value)
+    {
+        _da_memswap(base, out, sz);
+    }
+    else
+    {
+        if (out != NULL)
+            memcpy(out, base, sz);
+        memcpy(base, value, sz);
+    }
+    _da_heap_down(base, 0, nelem, sz, arity, cmp, hole);
+}
+
+////////////////////////////////// REDUCTIONS //////////////////////////////////
+// Reductions are split over several independent accumulators. This breaks the
+// dependency of every iteration on the previous one, and the compiler keeps
+// each group of accumulators in a SIMD register and processes it with a
+// single vector instruction.
+#define DA_REDUCE_LANES 8
+
+// Each thread reduces at least this many elements, otherwise the cost of
+// starting threads outweighs the work they do.
+#define DA_PARALLEL_REDUCE_MIN_CHUNK 65536
+
+enum _da_reduce_op
+{
+    DA_REDUCE_SUM,
+    DA_REDUCE_MIN,
+    DA_REDUCE_MAX,
+    DA_REDUCE_ARGMIN,
+    DA_REDUCE_ARGMAX
+};
+
+// Sums are returned as `sum_type` but accumulated in `acc_type`. Signed
+// integers are accumulated in uint64_t so that overflow wraps instead of being
+// undefined, which would let the compiler vectorize on the assumption that it
+// never happens.
+#define _DA_DEFINE_REDUCTIONS(suffix, type, sum_type, acc_type)                \
+static DA_ALWAYS_INLINE acc_type _da_sum_range_##suffix(const type* p,         \
+    size_t nelem)                                                              \
+{                                                                              \
+    acc_type acc[DA_REDUCE_LANES] = {0};                                       \
+    size_t i = 0;                                                              \
+    for (; i + DA_REDUCE_LANES <= nelem; i += DA_REDUCE_LANES)                 \
+    {                                                                          \
+        for (size_t j = 0; j < DA_REDUCE_LANES; ++j)                           \
+            acc[j] += (acc_type)p[i+j];                                        \
+    }                                                                          \
+    acc_type sum = 0;                                                          \
+    for (size_t j = 0; j < DA_REDUCE_LANES; ++j)                               \
+        sum += acc[j];                                                         \
+    for (; i < nelem; ++i)                                                     \
+        sum += (acc_type)p[i];                                                 \
+    return sum;                                                                \
+}                                                                              \
+                                                                               \
+/* Smallest (or largest if `max`) element of p[0, nelem). nelem > 0. */       \
+static DA_ALWAYS_INLINE type _da_extreme_range_##suffix(const type* p,         \
+    size_t nelem, bool max)                                                    \
+{                                                                              \
+    type best[DA_REDUCE_LANES];                                                \
+    for (size_t j = 0; j < DA_REDUCE_LANES; ++j)                               \
+        best[j] = p[0];                                                        \
+    size_t i = 0;                                                              \
+    for (; i + DA_REDUCE_LANES <= nelem; i += DA_REDUCE_LANES)                 \
+    {                                                                          \
+        for (size_t j = 0; j < DA_REDUCE_LANES; ++j)                           \
+        {                                                                      \
+            type x = p[i+j];                                                   \
+            best[j] = (max ? x > best[j] : x < best[j]) ? x : best[j];         \
+        }                                                                      \
+    }                                                                          \
+    type result = best[0];                                                     \
+    for (size_t j = 1; j < DA_REDUCE_LANES; ++j)                               \
+    {                                                                          \
+        bool better = max ? best[j] > result : best[j] < result;               \
+        result = better ? best[j] : result;                                    \
+    }                                                                          \
+    for (; i < nelem; ++i)                                                     \
+        result = (max ? p[i] > result : p[i] < result) ? p[i] : result;        \
+    return result;                                                             \
+}                                                                              \
+                                                                               \
+/* Index of the first smallest (or largest if `max`) element of               \
+ * p[0, nelem). nelem > 0. Each lane keeps the first best element it sees, so  \
+ * ties between lanes are broken by the lower index. */                        \
+static DA_ALWAYS_INLINE size_t _da_arg_range_##suffix(const type* p,           \
+    size_t nelem, bool max)                                                    \
+{                                                                              \
+    type best[DA_REDUCE_LANES];                                                \
+    size_t index[DA_REDUCE_LANES];                                             \
+    for (size_t j = 0; j < DA_REDUCE_LANES; ++j)                               \
+    {                                                                          \
+        best[j] = p[0];                                                        \
+        index[j] = 0;                                                          \
+    }                                                                          \
+    size_t i = 0;                                                              \
+    for (; i + DA_REDUCE_LANES <= nelem; i += DA_REDUCE_LANES)                 \
+    {                                                                          \
+        for (size_t j = 0; j < DA_REDUCE_LANES; ++j)                           \
+        {                                                                      \
+            type x = p[i+j];                                                   \
+            bool better = max ? x > best[j] : x < best[j];                     \
+            best[j] = better ? x : best[j];                                    \
+            index[j] = better ? i+j : index[j];                                \
+        }                                                                      \
+    }                                                                          \
+    size_t b = 0;                                                              \
+    for (size_t j = 1; j < DA_REDUCE_LANES; ++j)                               \
+    {                                                                          \
+        bool better = max ? best[j] > best[b] : best[j] < best[b];             \
+        if (better || (best[j] == best[b] && index[j] < index[b]))             \
+            b = j;                                                             \
+    }                                                                          \
+    type result = best[b];                                                     \
+    size_t result_index = index[b];                                            \
+    for (; i < nelem; ++i)                                                     \
+    {                                                                          \
+        if (max ? p[i] > result : p[i] < result)                               \
+        {                                                                      \
+            result = p[i];                                                     \
+            result_index = i;                                                  \
+        }                                                                      \
+    }                                                                          \
+    return result_index;                                                       \
+}                                                                              \
+                                                                               \
+sum_type da_sum_##suffix(darray(const type) darr)                              \
+{                                                                              \
+    return (sum_type)_da_sum_range_##suffix(darr, da_length(darr));            \
+}                                                                              \
+                                                                               \
+type da_min_##suffix(darray(const type) darr)                                  \
+{                                                                              \
+    return _da_extreme_range_##suffix(darr, da_length(darr), false);           \
+}                                                                              \
+                                                                               \
+type da_max_##suffix(darray(const type) darr)                                  \
+{                                                                              \
+    return _da_extreme_range_##suffix(darr, da_length(darr), true);            \
+}                                                                              \
+                                                                               \
+long da_argmin_##suffix(darray(const type) darr)                               \
+{                                                                              \
+    size_t nelem = da_length(darr);                                            \
+    return nelem == 0 ? -1 : (long)_da_arg_range_##suffix(darr, nelem, false); \
+}                                                                              \
+                                                                               \
+long da_argmax_##suffix(darray(const type) darr)                               \
+{                                                                              \
+    size_t nelem = da_length(darr);                                            \
+    return nelem == 0 ? -1 : (long)_da_arg_range_##suffix(darr, nelem, true);  \
+}                                                                              \
+                                                                               \
+struct _da_reduce_job_##suffix                                                 \
+{                                                                              \
+    const type* base;                                                          \
+    size_t nelem;                                                              \
+    size_t nthreads;                                                           \
+    enum _da_reduce_op op;                                                     \
+    acc_type sums[DA_PARALLEL_MAX_THREADS];                                    \
+    type values[DA_PARALLEL_MAX_THREADS];                                      \
+    size_t indices[DA_PARALLEL_MAX_THREADS];                                   \
+};                                                                             \
+                                                                               \
+static void _da_reduce_chunk_##suffix(void* ctx, size_t id)                    \
+{                                                                              \
+    struct _da_reduce_job_##suffix* job = ctx;                                 \
+    size_t begin = job->nelem * id / job->nthreads;                            \
+    size_t end = job->nelem * (id+1) / job->nthreads;                          \
+    const type* p = job->base + begin;                                         \
+    switch (job->op)                                                           \
+    {                                                                          \
+    case DA_REDUCE_SUM:                                                        \
+        job->sums[id] = _da_sum_range_##suffix(p, end - begin);                \
+        break;                                                                 \
+    case DA_REDUCE_MIN:                                                        \
+    case DA_REDUCE_MAX:                                                        \
+        job->values[id] = _da_extreme_range_##suffix(p, end - begin,           \
+            job->op == DA_REDUCE_MAX);                                         \
+        break;                                                                 \
+    case DA_REDUCE_ARGMIN:                                                     \
+    case DA_REDUCE_ARGMAX:                                                     \
+        job->indices[id] = begin + _da_arg_range_##suffix(p, end - begin,      \
+            job->op == DA_REDUCE_ARGMAX);                                      \
+        break;                                                                 \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+/* Returns false if the darray is too small to split, in which case the     \
+ * caller performs the sequential reduction instead. Partial results are     \
+ * combined in thread order so ties resolve to the lowest index. */          \
+static bool _da_parallel_reduce_##suffix(struct _da_reduce_job_##suffix* job,  \
+    const type* darr, size_t nthreads, enum _da_reduce_op op)                  \
+{                                                                              \
+    job->base = darr;                                                          \
+    job->nelem = da_length(darr);                                              \
+    job->op = op;                                                              \
+    job->nthreads = _da_clamp_nthreads(nthreads, job->nelem,                   \
+        DA_PARALLEL_REDUCE_MIN_CHUNK);                                         \
+    if (job->nthreads == 1)                                                    \
+        return false;                                                          \
+    _da_parallel_run(job->nthreads, _da_reduce_chunk_##suffix, job);           \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+sum_type da_parallel_sum_##suffix(darray(const type) darr, size_t nthreads)    \
+{                                                                              \
+    struct _da_reduce_job_##suffix job;                                        \
+    if (!_da_parallel_reduce_##suffix(&job, darr, nthreads, DA_REDUCE_SUM))    \
+        return da_sum_##suffix(darr);                                          \
+    acc_type sum = 0;                                                          \
+    for (size_t t = 0; t < job.nthreads; ++t)                                  \
+        sum += job.sums[t];                                                    \
+    return (sum_type)sum;                                                      \
+}                                                                              \
+                                                                               \
+type da_parallel_min_##suffix(darray(const type) darr, size_t nthreads)        \
+{                                                                              \
+    struct _da_reduce_job_##suffix job;                                        \
+    if (!_da_parallel_reduce_##suffix(&job, darr, nthreads, DA_REDUCE_MIN))    \
+        return da_min_##suffix(darr);                                          \
+    type result = job.values[0];                                               \
+    for (size_t t = 1; t < job.nthreads; ++t)                                  \
+        result = job.values[t] < result ? job.values[t] : result;              \
+    return result;                                                             \
+}                                                                              \
+                                                                               \
+type da_parallel_max_##suffix(darray(const type) darr, size_t nthreads)        \
+{                                                                              \
+    struct _da_reduce_job_##suffix job;                                        \
+    if (!_da_parallel_reduce_##suffix(&job, darr, nthreads, DA_REDUCE_MAX))    \
+        return da_max_##suffix(darr);                                          \
+    type result = job.values[0];                                               \
+    for (size_t t = 1; t < job.nthreads; ++t)                                  \
+        result = job.values[t] > result ? job.values[t] : result;              \
+    return result;                                                             \
+}                                                                              \
+                                                                               \
+long da_parallel_argmin_##suffix(darray(const type) darr, size_t nthreads)     \
+{                                                                              \
+    struct _da_reduce_job_##suffix job;                                        \
+    if (!_da_parallel_reduce_##suffix(&job, darr, nthreads, DA_REDUCE_ARGMIN)) \
+        return da_argmin_##suffix(darr);                                       \
+    size_t result = job.indices[0];                                            \
+    for (size_t t = 1; t < job.nthreads; ++t)                                  \
+        result = darr[job.indices[t]] < darr[result] ? job.indices[t] : result;\
+    return (long)result;                                                       \
+}                                                                              \
+                                                                               \
+long da_parallel_argmax_##suffix(darray(const type) darr, size_t nthreads)     \
+{                                                                              \
+    struct _da_reduce_job_##suffix job;                                        \
+    if (!_da_parallel_reduce_##suffix(&job, darr, nthreads, DA_REDUCE_ARGMAX)) \
+        return da_argmax_##suffix(darr);                                       \
+    size_t result = job.indices[0];                                            \
+    for (size_t t = 1; t < job.nthreads; ++t)                                  \
+        result = darr[job.indices[t]] > darr[result] ? job.indices[t] : result;\
+    return (long)result;                                                       \
+}
+
+_DA_DEFINE_REDUCTIONS(i32, int32_t, int64_t, uint64_t)
+_DA_DEFINE_REDUCTIONS(u32, uint32_t, uint64_t, uint64_t)
+_DA_DEFINE_REDUCTIONS(i64, int64_t, int64_t, uint64_t)
+_DA_DEFINE_REDUCTIONS(u64, uint64_t, uint64_t, uint64_t)
+_DA_DEFINE_REDUCTIONS(f32, float, double, double)
+_DA_DEFINE_REDUCTIONS(f64, double, double, double)
+
+// Scans are computed four 32-bit or two 64-bit elements at a time with an
+// in-register prefix sum: the vector is added to itself shifted by one lane,
+// then by two lanes, and the running total of earlier vectors is added last.
+// Only that running total carries a dependency from one vector to the next.
+#if DA_X86_SIMD
+static size_t _da_scan_sse2_u32(uint32_t* p, size_t nelem, uint32_t* carry,
+    bool inclusive)
+{
+    __m128i c = _mm_set1_epi32((int)*carry);
+    size_t i = 0;
+    for (; i + 4 <= nelem; i += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(p + i));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        __m128i out = inclusive ? x : _mm_slli_si128(x, 4);
+        _mm_storeu_si128((__m128i*)(p + i), _mm_add_epi32(out, c));
+        c = _mm_add_epi32(c, _mm_shuffle_epi32(x, 0xFF));
+    }
+    *carry = (uint32_t)_mm_cvtsi128_si32(c);
+    return i;
+}
+
+static size_t _da_scan_sse2_u64(uint64_t* p, size_t nelem, uint64_t* carry,
+    bool inclusive)
+{
+    __m128i c = _mm_set1_epi64x((long long)*carry);
+    size_t i = 0;
+    for (; i + 2 <= nelem; i += 2)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(p + i));
+        x = _mm_add_epi64(x, _mm_slli_si128(x, 8));
+        __m128i out = inclusive ? x : _mm_slli_si128(x, 8);
+        _mm_storeu_si128((__m128i*)(p + i), _mm_add_epi64(out, c));
+        c = _mm_add_epi64(c, _mm_shuffle_epi32(x, 0xEE));
+    }
+    _mm_storel_epi64((__m128i*)carry, c);
+    return i;
+}
+
+static size_t _da_scan_sse2_f32(float* p, size_t nelem, float* carry,
+    bool inclusive)
+{
+    __m128 c = _mm_set1_ps(*carry);
+    size_t i = 0;
+    for (; i + 4 <= nelem; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(p + i);
+        x = _mm_add_ps(x,
+            _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+        x = _mm_add_ps(x,
+            _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+        __m128 out = inclusive ? x
+            : _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4));
+        _mm_storeu_ps(p + i, _mm_add_ps(out, c));
+        c = _mm_add_ps(c, _mm_shuffle_ps(x, x, 0xFF));
+    }
+    *carry = _mm_cvtss_f32(c);
+    return i;
+}
+
+static size_t _da_scan_sse2_f64(double* p, size_t nelem, double* carry,
+    bool inclusive)
+{
+    __m128d c = _mm_set1_pd(*carry);
+    size_t i = 0;
+    for (; i + 2 <= nelem; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(p + i);
+        x = _mm_add_pd(x,
+            _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(x), 8)));
+        __m128d out = inclusive ? x
+            : _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(x), 8));
+        _mm_storeu_pd(p + i, _mm_add_pd(out, c));
+        c = _mm_add_pd(c, _mm_unpackhi_pd(x, x));
+    }
+    *carry = _mm_cvtsd_f64(c);
+    return i;
+}
+
+#   define _DA_SCAN_SIMD(kernel, p, nelem, carry, inclusive)                   \
+        kernel(p, nelem, carry, inclusive)
+#else
+#   define _DA_SCAN_SIMD(kernel, p, nelem, carry, inclusive)                   \
+        ((void)(p), (void)(nelem), (void)(carry), (void)(inclusive), (size_t)0)
+#endif // DA_X86_SIMD
+
+// Each thread scans at least this many elements.
+#define DA_PARALLEL_SCAN_MIN_CHUNK 65536
+
+// `utype` is the type additions are performed in, so that signed integer
+// scans wrap on overflow like unsigned ones instead of being undefined.
+#define _DA_DEFINE_SCANS(suffix, type, utype, kernel)                          \
+/* Scan p[0, nelem) in place, starting from `carry`. Returns `carry` plus the  \
+ * sum of the elements. */                                                     \
+static type _da_scan_range_##suffix(type* p, size_t nelem, type carry,         \
+    bool inclusive)                                                            \
+{                                                                              \
+    size_t i = _DA_SCAN_SIMD(kernel, (utype*)p, nelem, (utype*)&carry,         \
+        inclusive);                                                            \
+    for (; i < nelem; ++i)                                                     \
+    {                                                                          \
+        type next = (type)((utype)carry + (utype)p[i]);                        \
+        p[i] = inclusive ? next : carry;                                       \
+        carry = next;                                                          \
+    }                                                                          \
+    return carry;                                                              \
+}                                                                              \
+                                                                               \
+void da_inclusive_scan_##suffix(darray(type) darr)                             \
+{                                                                              \
+    _da_scan_range_##suffix(darr, da_length(darr), 0, true);                   \
+}                                                                              \
+                                                                               \
+type da_exclusive_scan_##suffix(darray(type) darr)                             \
+{                                                                              \
+    return _da_scan_range_##suffix(darr, da_length(darr), 0, false);           \
+}                                                                              \
+                                                                               \
+struct _da_scan_job_##suffix                                                   \
+{                                                                              \
+    type* base;                                                                \
+    size_t nelem;                                                              \
+    size_t nthreads;                                                           \
+    bool inclusive;                                                            \
+    type offsets[DA_PARALLEL_MAX_THREADS];                                     \
+};                                                                             \
+                                                                               \
+/* First pass: total of each chunk, added in `utype` like the scan itself. */  \
+static void _da_scan_totals_##suffix(void* ctx, size_t id)                     \
+{                                                                              \
+    struct _da_scan_job_##suffix* job = ctx;                                   \
+    size_t begin = job->nelem * id / job->nthreads;                            \
+    size_t end = job->nelem * (id+1) / job->nthreads;                          \
+    const type* p = job->base;                                                 \
+    utype acc[DA_REDUCE_LANES] = {0};                                          \
+    size_t i = begin;                                                          \
+    for (; i + DA_REDUCE_LANES <= end; i += DA_REDUCE_LANES)                   \
+    {                                                                          \
+        for (size_t j = 0; j < DA_REDUCE_LANES; ++j)                           \
+            acc[j] += (utype)p[i+j];                                           \
+    }                                                                          \
+    utype total = 0;                                                           \
+    for (size_t j = 0; j < DA_REDUCE_LANES; ++j)                               \
+        total += acc[j];                                                       \
+    for (; i < end; ++i)                                                       \
+        total += (utype)p[i];                                                  \
+    job->offsets[id] = (type)total;                                            \
+}                                                                              \
+                                                                               \
+/* Second pass: scan each chunk starting from the total of the chunks before   \
+ * it. */                                                                      \
+static void _da_scan_chunk_##suffix(void* ctx, size_t id)                      \
+{                                                                              \
+    struct _da_scan_job_##suffix* job = ctx;                                   \
+    size_t begin = job->nelem * id / job->nthreads;                            \
+    size_t end = job->nelem * (id+1) / job->nthreads;                          \
+    _da_scan_range_##suffix(job->base + begin, end - begin, job->offsets[id],  \
+        job->inclusive);                                                       \
+}                                                                              \
+                                                                               \
+static type _da_parallel_scan_##suffix(darray(type) darr, size_t nthreads,     \
+    bool inclusive)                                                            \
+{                                                                              \
+    struct _da_scan_job_##suffix job = {                                       \
+        .base = darr,                                                          \
+        .nelem = da_length(darr),                                              \
+        .inclusive = inclusive                                                 \
+    };                                                                         \
+    job.nthreads = _da_clamp_nthreads(nthreads, job.nelem,                     \
+        DA_PARALLEL_SCAN_MIN_CHUNK);                                           \
+    if (job.nthreads == 1)                                                     \
+        return _da_scan_range_##suffix(darr, job.nelem, 0, inclusive);         \
+    _da_parallel_run(job.nthreads, _da_scan_totals_##suffix, &job);            \
+    type total = 0;                                                            \
+    for (size_t t = 0; t < job.nthreads; ++t)                                  \
+    {                                                                          \
+        type chunk_total = job.offsets[t];                                     \
+        job.offsets[t] = total;                                                \
+        total = (type)((utype)total + (utype)chunk_total);                     \
+    }                                                                          \
+    _da_parallel_run(job.nthreads, _da_scan_chunk_##suffix, &job);             \
+    return total;                                                              \
+}                                                                              \
+                                                                               \
+void da_parallel_inclusive_scan_##suffix(darray(type) darr, size_t nthreads)   \
+{                                                                              \
+    _da_parallel_scan_##suffix(darr, nthreads, true);                          \
+}                                                                              \
+                                                                               \
+type da_parallel_exclusive_scan_##suffix(darray(type) darr, size_t nthreads)   \
+{                                                                              \
+    return _da_parallel_scan_##suffix(darr, nthreads, false);                  \
+}
+
+_DA_DEFINE_SCANS(i32, int32_t, uint32_t, _da_scan_sse2_u32)
+_DA_DEFINE_SCANS(u32, uint32_t, uint32_t, _da_scan_sse2_u32)
+_DA_DEFINE_SCANS(i64, int64_t, uint64_t, _da_scan_sse2_u64)
+_DA_DEFINE_SCANS(u64, uint64_t, uint64_t, _da_scan_sse2_u64)
+_DA_DEFINE_SCANS(f32, float, float, _da_scan_sse2_f32)
+_DA_DEFINE_SCANS(f64, double, double, _da_scan_sse2_f64)
+
+/////////////////////////////////// DSTRING ////////////////////////////////////
+darray(char) dstr_alloc_empty(void)
+{
+    char* dstr = da_alloc(1, sizeof(char));
+    if (dstr == NULL)
+        return NULL;
+    dstr[0] = '\0';
+    return dstr;
+}
+
+darray(char) dstr_alloc_cstr(const char* src)
+{
+    size_t src_len_with_nullterm = strlen(src)+1;
+    char* dstr = da_alloc(src_len_with_nullterm, sizeof(char));
+    if (dstr == NULL)
+        return NULL;
+    memcpy(dstr, src, src_len_with_nullterm);
+    return dstr;
+}
+
+darray(char) dstr_alloc_dstr(const darray(char) src)
+{
+    size_t src_len_with_nullterm = da_length(src);
+    char* dstr = da_alloc(src_len_with_nullterm, sizeof(char));
+    if (dstr == NULL)
+        return NULL;
+    memcpy(dstr, src, src_len_with_nullterm);
+    return dstr;
+}
+
+darray(char) dstr_alloc_format(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    va_list copy;
+    va_copy(copy, args);
+    size_t size = vsnprintf(NULL, 0, format, copy) + 1 /* +1 for '\0' */;
+    va_end(copy);
+
+    char* dstr = da_alloc(size, sizeof(char));
+    if (dstr == NULL)
+        return NULL;
+    vsprintf(dstr, format, args);
+
+    va_end(args);
+    return dstr;
+}
+
+darray(char) dstr_alloc_empty_custom(struct da_mem_funcs mem_funcs)
+{
+    char* dstr = da_alloc_custom(mem_funcs, 1, sizeof(char));
+    if (dstr == NULL)
+        return NULL;
+    dstr[0] = '\0';
+    return dstr;
+}
+
+darray(char) dstr_alloc_cstr_custom(struct da_mem_funcs mem_funcs,
+    const char* src)
+{
+    size_t src_len_with_nullterm = strlen(src)+1;
+    char* dstr = da_alloc_custom(mem_funcs, src_len_with_nullterm, sizeof(char));
+    if (dstr == NULL)
+        return NULL;
+    memcpy(dstr, src, src_len_with_nullterm);
+    return dstr;
+}
+
+darray(char) dstr_alloc_dstr_custom(struct da_mem_funcs mem_funcs,
+    const darray(char) src)
+{
+    size_t src_len_with_nullterm = da_length(src);
+    char* dstr = da_alloc_custom(mem_funcs, src_len_with_nullterm, sizeof(char));
+    if (dstr == NULL)
+        return NULL;
+    memcpy(dstr, src, src_len_with_nullterm);
+    return dstr;
+}
+
+darray(char) dstr_alloc_format_custom(struct da_mem_funcs mem_funcs,
+    const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    va_list copy;
+    va_copy(copy, args);
+    size_t size = vsnprintf(NULL, 0, format, copy) + 1 /* +1 for '\0' */;
+    va_end(copy);
+
+    char* dstr = da_alloc_custom(mem_funcs, size, sizeof(char));
+    if (dstr == NULL)
+        return NULL;
+    vsprintf(dstr, format, args);
+
+    va_end(args);
+    return dstr;
+}
+
+void dstr_free(darray(char) dstr)
+{
+    da_free(dstr);
+}
+
+darray(char) dstr_reassign_empty(darray(char) allocated_dstr)
+{
+    *DA_P_LENGTH_FROM_HANDLE(allocated_dstr) = 0;
+    allocated_dstr = da_concat(allocated_dstr, "", 1);
+    return allocated_dstr;
+}
+
+darray(char) dstr_reassign_cstr(darray(char) allocated_dstr,
+    const char* src)
+{
+    *DA_P_LENGTH_FROM_HANDLE(allocated_dstr) = 0;
+    allocated_dstr = da_concat(allocated_dstr, src, strlen(src)+1);
+    return allocated_dstr;
+}
+
+darray(char) dstr_reassign_dstr(darray(char) allocated_dstr,
+    const darray(char) src)
+{
+    *DA_P_LENGTH_FROM_HANDLE(allocated_dstr) = 0;
+    allocated_dstr = da_concat(allocated_dstr, src, da_length(src));
+    return allocated_dstr;
+}
+
+darray(char) dstr_reassign_format(darray(char) allocated_dstr,
+    const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    
+    va_list copy;
+    va_copy(copy, args);
+    size_t size = vsnprintf(NULL, 0, format, copy) + 1 /* +1 for '\0' */;
+    va_end(copy);
+
+    *DA_P_LENGTH_FROM_HANDLE(allocated_dstr) = 0;
+    allocated_dstr = da_reserve(allocated_dstr, size);
+    if (allocated_dstr == NULL)
+        return NULL;
+    vsprintf(allocated_dstr, format, args);
+    *DA_P_LENGTH_FROM_HANDLE(allocated_dstr) = size;
+
+    va_end(args);
+    return allocated_dstr;
+}
+
+size_t dstr_length(const darray(char) dstr)
+{
+    // dstrings always have a null terminator so this should never underflow.
+    return da_length(dstr)-1;
+}
+
+darray(char) dstr_concat_char(darray(char) dest, char c)
+{
+    return dest = da_insert(dest, da_length(dest)-1, c);
+}
+
+darray(char) dstr_concat_cstr(darray(char) dest, const char* src)
+{
+    size_t dest_strlen = dstr_length(dest);
+    size_t src_strlen = strlen(src);
+    dest = da_reserve(dest, src_strlen);
+    if (dest == NULL)
+        return NULL;
+    memcpy(dest+dest_strlen, src, src_strlen+1);
+    *DA_P_LENGTH_FROM_HANDLE(dest) += src_strlen;
+    return dest;
+}
+
+darray(char) dstr_concat_dstr(darray(char) dest, const darray(char) src)
+{
+    size_t dest_strlen = dstr_length(dest);
+    size_t src_strlen = dstr_length(src);
+    dest = da_reserve(dest, src_strlen);
+    if (dest == NULL)
+        return NULL;
+    memcpy(dest+dest_strlen, src, src_strlen+1);
+    *DA_P_LENGTH_FROM_HANDLE(dest) += src_strlen;
+    return dest;
+}
+
+darray(char) dstr_concat_format(darray(char) dest, const char* format, ...)
+{
+    size_t dest_strlen = dstr_length(dest);
+
+    va_list args;
+    va_start(args, format);
+
+    va_list copy;
+    va_copy(copy, args);
+    size_t formatted_strlen = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+
+    dest = da_reserve(dest, formatted_strlen);
+    if (dest == NULL)
+        return NULL;
+    vsprintf(dest+dest_strlen, format, args);
+    *DA_P_LENGTH_FROM_HANDLE(dest) += formatted_strlen;
+
+    va_end(args);
+    return dest;
+}
+
+int dstr_cmp(const darray(char) s1, const char* s2)
+{
+    while (*s1 == *s2 && *s1 != '\0')
+    {
+        s1++;
+        s2++;
+    }
+    return *s1 - *s2;
+}
+
+int dstr_cmp_case(const darray(char) s1, const char* s2)
+{
+    while (tolower(*s1) == tolower(*s2) && *s1 != '\0')
+    {
+        s1++;
+        s2++;
+    }
+    return *s1 - *s2;
+}
+
+long dstr_find(darray(char) dstr, const char* substr)
+{
+    char* loc = strstr(dstr, substr);
+    if (loc == NULL)
+        return -1;
+    return loc - dstr;
+}
+
+static const char* _da_strcasestr(const char* haystack, const char* needle)
+{
+    const char* currh = haystack;
+    const char* currn = needle;
+    while (1)
+    {
+        if (*currn == '\0')
+            return haystack;
+        else if (*currh == '\0')
+            return NULL;
+
+        if (tolower(*currh) != tolower(*currn))
+        {
+            haystack = ++currh;
+            currn = needle;
+        }
+        else
+        {
+            currh++;
+            currn++;
+        }
+    }
+}
+
+long dstr_find_case(darray(char) dstr, const char* substr)
+{
+    const char* loc = _da_strcasestr(dstr, substr);
     if (loc == NULL)
         return -1;
-    return loc - dstr;
+    return loc - dstr;
+}
+
+darray(char) dstr_replace_all(darray(char) dstr, const char* substr,
+    const char* new_str)
+{
+    size_t substr_len = strlen(substr);
+    size_t new_str_len = strlen(new_str);
+    long loc;
+    while ((loc = dstr_find(dstr, substr)) != -1)
+    {
+        da_remove_arr(dstr, loc, substr_len);
+        if ((dstr = da_insert_arr(dstr, loc, new_str, new_str_len)) == NULL)
+            return NULL;
+    }
+    return dstr;
+}
+
+darray(char) dstr_replace_all_case(darray(char) dstr, const char* substr,
+    const char* new_str)
+{
+    size_t substr_len = strlen(substr);
+    size_t new_str_len = strlen(new_str);
+    long loc;
+    while ((loc = dstr_find_case(dstr, substr)) != -1)
+    {
+        da_remove_arr(dstr, loc, substr_len);
+        if ((dstr = da_insert_arr(dstr, loc, new_str, new_str_len)) == NULL)
+            return NULL;
+    }
+    return dstr;
+}
+
+void dstr_transform_lower(darray(char) dstr)
+{
+    da_foreach(dstr, c)
+        *c = tolower(*c);
+}
+
+void dstr_transform_upper(darray(char) dstr)
+{
+    da_foreach(dstr, c)
+        *c = toupper(*c);
+}
+
+darray(char) dstr_getline(darray(char) allocated_dstr, FILE* stream)
+{
+    return dstr_getdelim(allocated_dstr, '\n', stream);
+}
+
+darray(char) dstr_getdelim(darray(char) allocated_dstr, int delim, FILE* stream)
+{
+    allocated_dstr = dstr_reassign_empty(allocated_dstr);
+    if (allocated_dstr == NULL)
+        return NULL;
+    int c;
+    while ((c = fgetc(stream)) != delim)
+    {
+        if (delim != EOF && c == EOF)
+            return NULL;
+        allocated_dstr = dstr_concat_char(allocated_dstr, c);
+        if (allocated_dstr == NULL)
+            return NULL;
+    }
+    return allocated_dstr;
+}
+
+darray(char) dstr_trim(darray(char) dstr)
+{
+    size_t n;
+    char* tmp;
+
+    // Trim leading whitespace.
+    n = 0;
+    tmp = dstr;
+    while (isspace(*tmp++))
+        ++n;
+    da_remove_arr(dstr, 0, n);
+
+    // Trim trailing whitespace.
+    n = 0;
+    tmp = dstr + dstr_length(dstr) - 1;
+    while (isspace(*tmp--))
+        n++;
+    da_remove_arr(dstr, dstr_length(dstr)-n, n);
+
+    return dstr;
+}
+
+///////////////////////////////////// DMAP /////////////////////////////////////
+// Slots are probed in aligned groups of 16. The control byte of a full slot
+// holds 7 bits of its key's hash and is non-negative, so the empty and deleted
+// markers can be found from the sign bits alone.
+#define DMAP_GROUP_SIZE 16
+#define DMAP_CTRL_EMPTY ((signed char)-128)
+#define DMAP_CTRL_DELETED ((signed char)-2)
+// Rehash once full and deleted slots take up 7/8 of the capacity.
+#define DMAP_MAX_LOAD_NUM 7
+#define DMAP_MAX_LOAD_DEN 8
+
+struct dmap
+{
+    struct da_mem_funcs mem_funcs;
+    uint64_t (*hash)(const void* key);
+    bool (*eq)(const void* key1, const void* key2);
+    bool dstr_keys;
+    size_t key_size;
+    size_t val_size;
+    // Entries are stored as a key followed by its value at `val_offset`, both
+    // aligned for the largest power of two dividing their size. Empty values
+    // sit right after the key, at `key_size`.
+    size_t val_offset;
+    size_t slot_size;
+    size_t length;
+    size_t deleted;
+    darray(signed char) ctrl;
+    darray(char) slots;
+};
+
+// Largest power of two dividing `size`, which is the alignment of any type of
+// that size up to the alignment of `max_align_t`. Empty values need no
+// alignment, so a set's slots hold nothing but their key.
+static size_t _dmap_align(size_t size)
+{
+    if (size == 0)
+        return 1;
+    size_t align = size & -size;
+    if (align > alignof(max_align_t))
+        return alignof(max_align_t);
+    return align;
+}
+
+static DA_ALWAYS_INLINE uint64_t _dmap_mix(uint64_t x)
+{
+    x ^= x >> 32;
+    x *= UINT64_C(0xd6e8feb86659fd93);
+    x ^= x >> 32;
+    return x;
+}
+
+static DA_ALWAYS_INLINE uint64_t _dmap_hash_bytes(const void* data,
+    size_t size)
+{
+    const unsigned char* p = data;
+    uint64_t h = UINT64_C(0x9e3779b97f4a7c15) ^ size;
+    uint64_t w;
+    while (size >= 8)
+    {
+        memcpy(&w, p, 8);
+        h = _dmap_mix(h ^ w) * UINT64_C(0x9e3779b97f4a7c15);
+        p += 8;
+        size -= 8;
+    }
+    w = 0;
+    memcpy(&w, p, size);
+    return _dmap_mix(h ^ w);
+}
+
+uint64_t dmap_hash_bytes(const void* data, size_t size)
+{
+    return _dmap_hash_bytes(data, size);
+}
+
+static DA_ALWAYS_INLINE uint64_t _dmap_hash(const struct dmap* map,
+    const void* key)
+{
+    if (map->dstr_keys)
+        return _dmap_hash_bytes(key, strlen(key));
+    if (map->hash == NULL)
+    {
+        // Let the compiler unroll the common key sizes.
+        switch (map->key_size)
+        {
+        case 4:  return _dmap_hash_bytes(key, 4);
+        case 8:  return _dmap_hash_bytes(key, 8);
+        default: return _dmap_hash_bytes(key, map->key_size);
+        }
+    }
+    // User hashes may leave the high or low bits poorly mixed.
+    return _dmap_mix(map->hash(key) * UINT64_C(0x9e3779b97f4a7c15));
+}
+
+// Keys of `key_size` 4 or 8 compared bytewise are compared with a single
+// integer comparison. A `key_size` of 0 reads the key size from the map.
+static DA_ALWAYS_INLINE bool _dmap_eq(const struct dmap* map,
+    const char* slot, const void* key, size_t key_size)
+{
+    if (key_size != 0)
+        return memcmp(slot, key, key_size) == 0;
+    if (map->dstr_keys)
+        return strcmp(*(char* const*)slot, key) == 0;
+    if (map->eq == NULL)
+        return memcmp(slot, key, map->key_size) == 0;
+    return map->eq(slot, key);
+}
+
+// Key size the lookups of a map are specialized for, or 0 for none.
+static inline size_t _dmap_inline_key_size(const struct dmap* map)
+{
+    if (map->dstr_keys || map->eq != NULL)
+        return 0;
+    return map->key_size == 4 || map->key_size == 8 ? map->key_size : 0;
+}
+
+// Bitmask of the slots of a group whose control byte is `byte`.
+static DA_ALWAYS_INLINE unsigned _dmap_match(const signed char* group,
+    signed char byte)
+{
+#if DA_X86_SIMD
+    __m128i g = _mm_loadu_si128((const __m128i*)group);
+    return (unsigned)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(g, _mm_set1_epi8(byte)));
+#else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < DMAP_GROUP_SIZE; ++i)
+        mask |= (unsigned)(group[i] == byte) << i;
+    return mask;
+#endif // DA_X86_SIMD
+}
+
+// Bitmask of the empty and deleted slots of a group.
+static DA_ALWAYS_INLINE unsigned _dmap_match_free(const signed char* group)
+{
+#if DA_X86_SIMD
+    return (unsigned)_mm_movemask_epi8(
+        _mm_loadu_si128((const __m128i*)group));
+#else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < DMAP_GROUP_SIZE; ++i)
+        mask |= (unsigned)(group[i] < 0) << i;
+    return mask;
+#endif // DA_X86_SIMD
+}
+
+static inline size_t _dmap_capacity(const struct dmap* map)
+{
+    return da_length(map->ctrl);
+}
+
+// First slot of the group where the probe sequence of `hash` starts.
+static DA_ALWAYS_INLINE size_t _dmap_group_pos(const struct dmap* map,
+    uint64_t hash)
+{
+    return (size_t)(hash >> 7) & (_dmap_capacity(map) - 1)
+        & ~(size_t)(DMAP_GROUP_SIZE - 1);
+}
+
+// Index of the slot holding `key`, or -1 if there is none. Groups are probed
+// with a triangular sequence, which visits every group once as the number of
+// groups is a power of two.
+static DA_ALWAYS_INLINE long _dmap_find_slot_sz(const struct dmap* map,
+    const void* key, uint64_t hash, size_t key_size)
+{
+    size_t mask = _dmap_capacity(map) - 1;
+    signed char h2 = (signed char)(hash & 0x7f);
+    size_t pos = _dmap_group_pos(map, hash);
+    for (size_t step = DMAP_GROUP_SIZE;; step += DMAP_GROUP_SIZE)
+    {
+        const signed char* group = map->ctrl + pos;
+        for (unsigned m = _dmap_match(group, h2); m != 0; m &= m - 1)
+        {
+            size_t i = pos + _da_ctz64(m);
+            if (_dmap_eq(map, map->slots + i*map->slot_size, key, key_size))
+                return (long)i;
+        }
+        if (_dmap_match(group, DMAP_CTRL_EMPTY) != 0)
+            return -1;
+        pos = (pos + step) & mask;
+    }
+}
+
+static long _dmap_find_slot(const struct dmap* map, const void* key,
+    uint64_t hash)
+{
+    switch (_dmap_inline_key_size(map))
+    {
+    case 4:  return _dmap_find_slot_sz(map, key, hash, 4);
+    case 8:  return _dmap_find_slot_sz(map, key, hash, 8);
+    default: return _dmap_find_slot_sz(map, key, hash, 0);
+    }
+}
+
+// Index of the first empty or deleted slot on the probe sequence of `hash`.
+static DA_ALWAYS_INLINE size_t _dmap_free_slot(const struct dmap* map,
+    uint64_t hash)
+{
+    size_t mask = _dmap_capacity(map) - 1;
+    size_t pos = _dmap_group_pos(map, hash);
+    for (size_t step = DMAP_GROUP_SIZE;; step += DMAP_GROUP_SIZE)
+    {
+        unsigned m = _dmap_match_free(map->ctrl + pos);
+        if (m != 0)
+            return pos + _da_ctz64(m);
+        pos = (pos + step) & mask;
+    }
+}
+
+// Move every entry into new storage of `capacity` slots, dropping deleted
+// slots.
+static bool _dmap_rehash(struct dmap* map, size_t capacity)
+{
+    signed char* ctrl = da_alloc_exact_custom(map->mem_funcs, capacity, 1);
+    char* slots = da_alloc_exact_custom(map->mem_funcs, capacity,
+        map->slot_size);
+    if (ctrl == NULL || slots == NULL)
+    {
+        if (ctrl != NULL)
+            da_free(ctrl);
+        if (slots != NULL)
+            da_free(slots);
+        return false;
+    }
+    memset(ctrl, DMAP_CTRL_EMPTY, capacity);
+
+    struct dmap old = *map;
+    map->ctrl = ctrl;
+    map->slots = slots;
+    map->deleted = 0;
+    size_t old_capacity = old.ctrl == NULL ? 0 : da_length(old.ctrl);
+    for (size_t i = 0; i < old_capacity; ++i)
+    {
+        if (old.ctrl[i] < 0)
+            continue;
+        const char* slot = old.slots + i*map->slot_size;
+        const void* key = map->dstr_keys ? *(char* const*)slot : slot;
+        uint64_t hash = _dmap_hash(map, key);
+        size_t j = _dmap_free_slot(map, hash);
+        ctrl[j] = (signed char)(hash & 0x7f);
+        memcpy(slots + j*map->slot_size, slot, map->slot_size);
+    }
+    if (old.ctrl != NULL)
+    {
+        da_free(old.ctrl);
+        da_free(old.slots);
+    }
+    return true;
+}
+
+// Smallest power of two capacity holding `nelem` entries within the maximum
+// load factor.
+static size_t _dmap_capacity_for(size_t nelem)
+{
+    size_t capacity = DMAP_GROUP_SIZE;
+    while (capacity / DMAP_MAX_LOAD_DEN * DMAP_MAX_LOAD_NUM < nelem)
+        capacity *= 2;
+    return capacity;
+}
+
+static bool _dmap_init(struct dmap* map, struct da_mem_funcs mem_funcs,
+    size_t key_size, size_t val_size, uint64_t (*hash)(const void* key),
+    bool (*eq)(const void* key1, const void* key2), bool dstr_keys)
+{
+    size_t key_align = _dmap_align(key_size);
+    size_t val_align = _dmap_align(val_size);
+    size_t slot_align = key_align > val_align ? key_align : val_align;
+    *map = (struct dmap){
+        .mem_funcs = mem_funcs,
+        .hash = hash,
+        .eq = eq,
+        .dstr_keys = dstr_keys,
+        .key_size = key_size,
+        .val_size = val_size,
+        .val_offset = (key_size + val_align - 1) / val_align * val_align,
+    };
+    map->slot_size = (map->val_offset + val_size + slot_align - 1)
+        / slot_align * slot_align;
+    return _dmap_rehash(map, DMAP_GROUP_SIZE);
+}
+
+static struct dmap* _dmap_alloc(struct da_mem_funcs mem_funcs,
+    size_t key_size, size_t val_size, uint64_t (*hash)(const void* key),
+    bool (*eq)(const void* key1, const void* key2), bool dstr_keys)
+{
+    struct dmap* map = mem_funcs.alloc_f(sizeof(struct dmap));
+    if (map == NULL)
+        return NULL;
+    if (!_dmap_init(map, mem_funcs, key_size, val_size, hash, eq, dstr_keys))
+    {
+        mem_funcs.free_f(map);
+        return NULL;
+    }
+    return map;
+}
+
+struct dmap* dmap_alloc(size_t key_size, size_t val_size,
+    uint64_t (*hash)(const void* key),
+    bool (*eq)(const void* key1, const void* key2))
+{
+    return _dmap_alloc(DA_DEFAULT_MEM_FUNCS, key_size, val_size, hash, eq,
+        false);
+}
+
+struct dmap* dmap_alloc_custom(struct da_mem_funcs mem_funcs, size_t key_size,
+    size_t val_size, uint64_t (*hash)(const void* key),
+    bool (*eq)(const void* key1, const void* key2))
+{
+    return _dmap_alloc(mem_funcs, key_size, val_size, hash, eq, false);
+}
+
+struct dmap* dmap_alloc_dstr(size_t val_size)
+{
+    return _dmap_alloc(DA_DEFAULT_MEM_FUNCS, sizeof(char*), val_size, NULL,
+        NULL, true);
+}
+
+struct dmap* dmap_alloc_dstr_custom(struct da_mem_funcs mem_funcs,
+    size_t val_size)
+{
+    return _dmap_alloc(mem_funcs, sizeof(char*), val_size, NULL, NULL, true);
+}
+
+static void _dmap_free_keys(struct dmap* map)
+{
+    if (!map->dstr_keys)
+        return;
+    for (size_t i = 0; i < _dmap_capacity(map); ++i)
+        if (map->ctrl[i] >= 0)
+            dstr_free(*(char**)(map->slots + i*map->slot_size));
+}
+
+void dmap_free(struct dmap* map)
+{
+    if (map == NULL)
+        return;
+    _dmap_free_keys(map);
+    da_free(map->ctrl);
+    da_free(map->slots);
+    map->mem_funcs.free_f(map);
+}
+
+size_t dmap_length(const struct dmap* map)
+{
+    return map->length;
+}
+
+bool dmap_reserve(struct dmap* map, size_t nelem)
+{
+    size_t capacity = _dmap_capacity_for(nelem);
+    if (capacity <= _dmap_capacity(map))
+        return true;
+    return _dmap_rehash(map, capacity);
+}
+
+static void* _dmap_insert_hashed(struct dmap* map, const void* key,
+    const void* value, uint64_t hash)
+{
+    long found = _dmap_find_slot(map, key, hash);
+    if (found != -1)
+    {
+        char* val = map->slots + (size_t)found*map->slot_size
+            + map->val_offset;
+        if (value != NULL)
+            memcpy(val, value, map->val_size);
+        return val;
+    }
+
+    size_t i = _dmap_free_slot(map, hash);
+    size_t capacity = _dmap_capacity(map);
+    if (map->ctrl[i] == DMAP_CTRL_EMPTY && map->length + map->deleted + 1
+        > capacity / DMAP_MAX_LOAD_DEN * DMAP_MAX_LOAD_NUM)
+    {
+        // Grow if mostly full, otherwise rehash in place to clear the
+        // deleted slots.
+        if (map->length + 1 > capacity / DMAP_MAX_LOAD_DEN
+            * DMAP_MAX_LOAD_NUM / 2)
+            capacity *= 2;
+        if (!_dmap_rehash(map, capacity))
+            return NULL;
+        i = _dmap_free_slot(map, hash);
+    }
+
+    char* slot = map->slots + i*map->slot_size;
+    if (map->dstr_keys)
+    {
+        char* dstr = dstr_alloc_cstr_custom(map->mem_funcs, key);
+        if (dstr == NULL)
+            return NULL;
+        memcpy(slot, &dstr, sizeof(dstr));
+    }
+    else
+    {
+        memcpy(slot, key, map->key_size);
+    }
+    if (value != NULL)
+        memcpy(slot + map->val_offset, value, map->val_size);
+    else
+        memset(slot + map->val_offset, 0, map->val_size);
+    map->deleted -= map->ctrl[i] == DMAP_CTRL_DELETED;
+    map->ctrl[i] = (signed char)(hash & 0x7f);
+    map->length += 1;
+    return slot + map->val_offset;
+}
+
+void* dmap_insert(struct dmap* map, const void* key, const void* value)
+{
+    return _dmap_insert_hashed(map, key, value, _dmap_hash(map, key));
+}
+
+void* dmap_find(const struct dmap* map, const void* key)
+{
+    long i = _dmap_find_slot(map, key, _dmap_hash(map, key));
+    if (i == -1)
+        return NULL;
+    return map->slots + (size_t)i*map->slot_size + map->val_offset;
+}
+
+bool dmap_erase(struct dmap* map, const void* key)
+{
+    long found = _dmap_find_slot(map, key, _dmap_hash(map, key));
+    if (found == -1)
+        return false;
+    size_t i = (size_t)found;
+    if (map->dstr_keys)
+        dstr_free(*(char**)(map->slots + i*map->slot_size));
+    // A probe stops at the first group with an empty slot, so if this group
+    // has one no probe continues past it and the slot can be emptied.
+    const signed char* group = map->ctrl + (i & ~(size_t)(DMAP_GROUP_SIZE-1));
+    if (_dmap_match(group, DMAP_CTRL_EMPTY) != 0)
+    {
+        map->ctrl[i] = DMAP_CTRL_EMPTY;
+    }
+    else
+    {
+        map->ctrl[i] = DMAP_CTRL_DELETED;
+        map->deleted += 1;
+    }
+    map->length -= 1;
+    return true;
+}
+
+void dmap_clear(struct dmap* map)
+{
+    _dmap_free_keys(map);
+    memset(map->ctrl, DMAP_CTRL_EMPTY, _dmap_capacity(map));
+    map->length = 0;
+    map->deleted = 0;
+}
+
+bool dmap_next(const struct dmap* map, size_t* iter, const void** key,
+    void** value)
+{
+    for (size_t i = *iter; i < _dmap_capacity(map); ++i)
+    {
+        if (map->ctrl[i] < 0)
+            continue;
+        char* slot = map->slots + i*map->slot_size;
+        *key = map->dstr_keys ? *(char**)slot : slot;
+        if (value != NULL)
+            *value = slot + map->val_offset;
+        *iter = i + 1;
+        return true;
+    }
+    *iter = _dmap_capacity(map);
+    return false;
+}
+
+///////////////////////////////////// DSET /////////////////////////////////////
+// Bulk operations hash this many keys and prefetch the first group of each
+// before probing any of them, so that the cache misses of a batch overlap.
+#define DSET_BATCH_SIZE 16
+
+// A dset is a dmap with empty values. Its first member is the dmap, so
+// pointers to the two can be converted to each other.
+struct dset
+{
+    struct dmap map;
+};
+
+static DA_ALWAYS_INLINE void _dmap_prefetch(const struct dmap* map,
+    uint64_t hash)
+{
+    size_t pos = _dmap_group_pos(map, hash);
+    DA_PREFETCH(map->ctrl + pos);
+    DA_PREFETCH(map->slots + pos*map->slot_size);
+}
+
+struct dset* dset_alloc(size_t key_size, uint64_t (*hash)(const void* key),
+    bool (*eq)(const void* key1, const void* key2))
+{
+    return dset_alloc_custom(DA_DEFAULT_MEM_FUNCS, key_size, hash, eq);
+}
+
+struct dset* dset_alloc_custom(struct da_mem_funcs mem_funcs, size_t key_size,
+    uint64_t (*hash)(const void* key),
+    bool (*eq)(const void* key1, const void* key2))
+{
+    struct dset* set = mem_funcs.alloc_f(sizeof(struct dset));
+    if (set == NULL)
+        return NULL;
+    if (!_dmap_init(&set->map, mem_funcs, key_size, 0, hash, eq, false))
+    {
+        mem_funcs.free_f(set);
+        return NULL;
+    }
+    return set;
+}
+
+void dset_free(struct dset* set)
+{
+    dmap_free((struct dmap*)set);
+}
+
+size_t dset_length(const struct dset* set)
+{
+    return set->map.length;
+}
+
+bool dset_reserve(struct dset* set, size_t nelem)
+{
+    return dmap_reserve(&set->map, nelem);
+}
+
+bool dset_insert(struct dset* set, const void* key)
+{
+    return dmap_insert(&set->map, key, NULL) != NULL;
+}
+
+bool dset_contains(const struct dset* set, const void* key)
+{
+    return dmap_find(&set->map, key) != NULL;
+}
+
+bool dset_erase(struct dset* set, const void* key)
+{
+    return dmap_erase(&set->map, key);
+}
+
+void dset_clear(struct dset* set)
+{
+    dmap_clear(&set->map);
+}
+
+bool dset_next(const struct dset* set, size_t* iter, const void** key)
+{
+    return dmap_next(&set->map, iter, key, NULL);
+}
+
+bool dset_insert_many(struct dset* set, const void* keys, size_t nkeys)
+{
+    struct dmap* map = &set->map;
+    const char* k = keys;
+    uint64_t hashes[DSET_BATCH_SIZE];
+    for (size_t first = 0; first < nkeys; first += DSET_BATCH_SIZE)
+    {
+        size_t n = nkeys - first < DSET_BATCH_SIZE
+            ? nkeys - first : DSET_BATCH_SIZE;
+        for (size_t j = 0; j < n; ++j)
+        {
+            hashes[j] = _dmap_hash(map, k + (first + j)*map->key_size);
+            _dmap_prefetch(map, hashes[j]);
+        }
+        for (size_t j = 0; j < n; ++j)
+        {
+            const char* key = k + (first + j)*map->key_size;
+            if (_dmap_insert_hashed(map, key, NULL, hashes[j]) == NULL)
+                return false;
+        }
+    }
+    return true;
+}
+
+static DA_ALWAYS_INLINE size_t _dset_contains_many(const struct dmap* map,
+    const char* keys, size_t nkeys, bool* found, size_t key_size)
+{
+    size_t sz = key_size != 0 ? key_size : map->key_size;
+    size_t count = 0;
+    uint64_t hashes[DSET_BATCH_SIZE];
+    for (size_t first = 0; first < nkeys; first += DSET_BATCH_SIZE)
+    {
+        size_t n = nkeys - first < DSET_BATCH_SIZE
+            ? nkeys - first : DSET_BATCH_SIZE;
+        for (size_t j = 0; j < n; ++j)
+        {
+            hashes[j] = _dmap_hash(map, keys + (first + j)*sz);
+            _dmap_prefetch(map, hashes[j]);
+        }
+        for (size_t j = 0; j < n; ++j)
+        {
+            bool in = _dmap_find_slot_sz(map, keys + (first + j)*sz,
+                hashes[j], key_size) != -1;
+            if (found != NULL)
+                found[first + j] = in;
+            count += in;
+        }
+    }
+    return count;
+}
+
+size_t dset_contains_many(const struct dset* set, const void* keys,
+    size_t nkeys, bool* found)
+{
+    const struct dmap* map = &set->map;
+    switch (_dmap_inline_key_size(map))
+    {
+    case 4:  return _dset_contains_many(map, keys, nkeys, found, 4);
+    case 8:  return _dset_contains_many(map, keys, nkeys, found, 8);
+    default: return _dset_contains_many(map, keys, nkeys, found, 0);
+    }
+}
+
+//////////////////////////////////// DBITS /////////////////////////////////////
+#define DBITS_WORD_BITS 64
+// Set bits are counted ahead of blocks of this many words, one cache line.
+#define DBITS_BLOCK_WORDS 8
+
+struct dbits
+{
+    size_t nbits;
+    darray(uint64_t) words;
+    // ranks[b] is the number of set bits in the blocks before block b, with
+    // one extra entry holding the total. Only valid while `ranks_valid`.
+    darray(uint64_t) ranks;
+    bool ranks_valid;
+};
+
+enum _dbits_op
+{
+    DBITS_AND,
+    DBITS_OR,
+    DBITS_XOR,
+    DBITS_ANDNOT
+};
+
+static inline size_t _dbits_nwords(size_t nbits)
+{
+    return (nbits + DBITS_WORD_BITS - 1) / DBITS_WORD_BITS;
+}
+
+// Clear the bits of the last word past the length of the dbits.
+static inline void _dbits_mask_tail(struct dbits* bits)
+{
+    size_t tail = bits->nbits % DBITS_WORD_BITS;
+    if (tail != 0)
+        bits->words[bits->nbits / DBITS_WORD_BITS] &= (UINT64_C(1) << tail) - 1;
+}
+
+struct dbits* dbits_alloc(size_t nbits)
+{
+    return dbits_alloc_custom(DA_DEFAULT_MEM_FUNCS, nbits);
+}
+
+struct dbits* dbits_alloc_custom(struct da_mem_funcs mem_funcs, size_t nbits)
+{
+    struct dbits* bits = mem_funcs.alloc_f(sizeof(struct dbits));
+    if (bits == NULL)
+        return NULL;
+    size_t nwords = _dbits_nwords(nbits);
+    *bits = (struct dbits){
+        .nbits = nbits,
+        .words = da_alloc_custom(mem_funcs, nwords, sizeof(uint64_t)),
+    };
+    if (bits->words == NULL)
+    {
+        mem_funcs.free_f(bits);
+        return NULL;
+    }
+    memset(bits->words, 0, nwords*sizeof(uint64_t));
+    return bits;
+}
+
+void dbits_free(struct dbits* bits)
+{
+    if (bits == NULL)
+        return;
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(bits->words);
+    da_free(bits->words);
+    if (bits->ranks != NULL)
+        da_free(bits->ranks);
+    mem_funcs.free_f(bits);
+}
+
+size_t dbits_length(const struct dbits* bits)
+{
+    return bits->nbits;
+}
+
+darray(const uint64_t) dbits_words(const struct dbits* bits)
+{
+    return bits->words;
+}
+
+bool dbits_resize(struct dbits* bits, size_t nbits)
+{
+    size_t old_nwords = da_length(bits->words);
+    size_t nwords = _dbits_nwords(nbits);
+    if (nwords > old_nwords)
+    {
+        uint64_t* words = da_reserve(bits->words, nwords - old_nwords);
+        if (words == NULL)
+            return false;
+        memset(words + old_nwords, 0, (nwords - old_nwords)*sizeof(uint64_t));
+        bits->words = words;
+    }
+    *DA_P_LENGTH_FROM_HANDLE(bits->words) = nwords;
+    bits->nbits = nbits;
+    bits->ranks_valid = false;
+    _dbits_mask_tail(bits);
+    return true;
+}
+
+bool dbits_push(struct dbits* bits, bool value)
+{
+    size_t index = bits->nbits;
+    if (!dbits_resize(bits, index + 1))
+        return false;
+    bits->words[index / DBITS_WORD_BITS] |=
+        (uint64_t)value << (index % DBITS_WORD_BITS);
+    return true;
+}
+
+void dbits_set(struct dbits* bits, size_t index)
+{
+    bits->words[index / DBITS_WORD_BITS] |=
+        UINT64_C(1) << (index % DBITS_WORD_BITS);
+    bits->ranks_valid = false;
+}
+
+void dbits_clear(struct dbits* bits, size_t index)
+{
+    bits->words[index / DBITS_WORD_BITS] &=
+        ~(UINT64_C(1) << (index % DBITS_WORD_BITS));
+    bits->ranks_valid = false;
+}
+
+bool dbits_test(const struct dbits* bits, size_t index)
+{
+    return (bits->words[index / DBITS_WORD_BITS]
+        >> (index % DBITS_WORD_BITS)) & 1;
+}
+
+void dbits_fill(struct dbits* bits, bool value)
+{
+    memset(bits->words, value ? 0xff : 0,
+        da_length(bits->words)*sizeof(uint64_t));
+    _dbits_mask_tail(bits);
+    bits->ranks_valid = false;
+}
+
+static DA_ALWAYS_INLINE size_t _dbits_popcount_scalar(const uint64_t* words,
+    size_t nwords)
+{
+    // Independent counters let consecutive popcounts overlap.
+    size_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= nwords; i += 4)
+    {
+        c0 += _da_popcount64(words[i]);
+        c1 += _da_popcount64(words[i+1]);
+        c2 += _da_popcount64(words[i+2]);
+        c3 += _da_popcount64(words[i+3]);
+    }
+    for (; i < nwords; ++i)
+        c0 += _da_popcount64(words[i]);
+    return c0 + c1 + c2 + c3;
+}
+
+#if DA_X86_SIMD
+// Every CPU with AVX2 has the popcnt instruction, which the default target
+// does not assume.
+static __attribute__((target("avx2,popcnt"))) size_t _dbits_popcount_popcnt(
+    const uint64_t* words, size_t nwords)
+{
+    return _dbits_popcount_scalar(words, nwords);
+}
+#endif // DA_X86_SIMD
+
+static size_t _dbits_popcount_words(const uint64_t* words, size_t nwords)
+{
+#if DA_X86_SIMD
+    if (_da_has_avx2())
+        return _dbits_popcount_popcnt(words, nwords);
+#endif // DA_X86_SIMD
+    return _dbits_popcount_scalar(words, nwords);
+}
+
+size_t dbits_popcount(const struct dbits* bits)
+{
+    return _dbits_popcount_words(bits->words, da_length(bits->words));
+}
+
+long dbits_find_next_set(const struct dbits* bits, size_t index)
+{
+    if (index >= bits->nbits)
+        return -1;
+    size_t w = index / DBITS_WORD_BITS;
+    uint64_t word = bits->words[w]
+        & (~UINT64_C(0) << (index % DBITS_WORD_BITS));
+    size_t nwords = da_length(bits->words);
+    while (word == 0)
+    {
+        if (++w == nwords)
+            return -1;
+        word = bits->words[w];
+    }
+    return (long)(w*DBITS_WORD_BITS + _da_ctz64(word));
+}
+
+static DA_ALWAYS_INLINE uint64_t _dbits_apply(uint64_t a, uint64_t b,
+    enum _dbits_op op)
+{
+    switch (op)
+    {
+    case DBITS_AND: return a & b;
+    case DBITS_OR:  return a | b;
+    case DBITS_XOR: return a ^ b;
+    default:        return a & ~b;
+    }
+}
+
+#if DA_X86_SIMD
+static DA_ALWAYS_INLINE __m128i _dbits_apply_sse2(__m128i a, __m128i b,
+    enum _dbits_op op)
+{
+    switch (op)
+    {
+    case DBITS_AND: return _mm_and_si128(a, b);
+    case DBITS_OR:  return _mm_or_si128(a, b);
+    case DBITS_XOR: return _mm_xor_si128(a, b);
+    default:        return _mm_andnot_si128(b, a);
+    }
+}
+
+static DA_AVX2_INLINE __m256i _dbits_apply_avx2(__m256i a, __m256i b,
+    enum _dbits_op op)
+{
+    switch (op)
+    {
+    case DBITS_AND: return _mm256_and_si256(a, b);
+    case DBITS_OR:  return _mm256_or_si256(a, b);
+    case DBITS_XOR: return _mm256_xor_si256(a, b);
+    default:        return _mm256_andnot_si256(b, a);
+    }
+}
+
+static DA_TARGET_AVX2 size_t _dbits_combine_avx2(uint64_t* dst,
+    const uint64_t* src, size_t nwords, enum _dbits_op op)
+{
+    size_t i = 0;
+    for (; i + 4 <= nwords; i += 4)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _dbits_apply_avx2(a, b, op));
+    }
+    return i;
+}
+
+static size_t _dbits_combine_sse2(uint64_t* dst, const uint64_t* src,
+    size_t nwords, enum _dbits_op op)
+{
+    size_t i = 0;
+    for (; i + 2 <= nwords; i += 2)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _dbits_apply_sse2(a, b, op));
+    }
+    return i;
+}
+#endif // DA_X86_SIMD
+
+static void _dbits_combine(struct dbits* dst, const struct dbits* src,
+    enum _dbits_op op)
+{
+    size_t ndst = da_length(dst->words);
+    size_t nsrc = da_length(src->words);
+    size_t n = ndst < nsrc ? ndst : nsrc;
+    size_t i = 0;
+#if DA_X86_SIMD
+    i = _da_has_avx2() ? _dbits_combine_avx2(dst->words, src->words, n, op)
+        : _dbits_combine_sse2(dst->words, src->words, n, op);
+#endif // DA_X86_SIMD
+    for (; i < n; ++i)
+        dst->words[i] = _dbits_apply(dst->words[i], src->words[i], op);
+    // Words missing from `src` are clear.
+    if (op == DBITS_AND && ndst > n)
+        memset(dst->words + n, 0, (ndst - n)*sizeof(uint64_t));
+    _dbits_mask_tail(dst);
+    dst->ranks_valid = false;
+}
+
+void dbits_and(struct dbits* dst, const struct dbits* src)
+{
+    _dbits_combine(dst, src, DBITS_AND);
+}
+
+void dbits_or(struct dbits* dst, const struct dbits* src)
+{
+    _dbits_combine(dst, src, DBITS_OR);
+}
+
+void dbits_xor(struct dbits* dst, const struct dbits* src)
+{
+    _dbits_combine(dst, src, DBITS_XOR);
+}
+
+void dbits_andnot(struct dbits* dst, const struct dbits* src)
+{
+    _dbits_combine(dst, src, DBITS_ANDNOT);
+}
+
+bool dbits_build_index(struct dbits* bits)
+{
+    size_t nwords = da_length(bits->words);
+    size_t nblocks = (nwords + DBITS_BLOCK_WORDS - 1) / DBITS_BLOCK_WORDS;
+    uint64_t* ranks = bits->ranks;
+    if (ranks == NULL)
+        ranks = da_alloc_custom(_da_mem_funcs(bits->words), nblocks + 1,
+            sizeof(uint64_t));
+    else
+        ranks = da_resize(ranks, nblocks + 1);
+    if (ranks == NULL)
+        return false;
+    bits->ranks = ranks;
+
+    uint64_t total = 0;
+    for (size_t b = 0; b < nblocks; ++b)
+    {
+        ranks[b] = total;
+        size_t first = b*DBITS_BLOCK_WORDS;
+        size_t n = nwords - first < DBITS_BLOCK_WORDS
+            ? nwords - first : DBITS_BLOCK_WORDS;
+        total += _dbits_popcount_words(bits->words + first, n);
+    }
+    ranks[nblocks] = total;
+    bits->ranks_valid = true;
+    return true;
+}
+
+size_t dbits_rank(const struct dbits* bits, size_t index)
+{
+    size_t w = index / DBITS_WORD_BITS;
+    size_t first = 0;
+    size_t rank = 0;
+    if (bits->ranks_valid)
+    {
+        first = w / DBITS_BLOCK_WORDS * DBITS_BLOCK_WORDS;
+        rank = bits->ranks[w / DBITS_BLOCK_WORDS];
+    }
+    rank += _dbits_popcount_words(bits->words + first, w - first);
+    size_t tail = index % DBITS_WORD_BITS;
+    if (tail != 0)
+        rank += _da_popcount64(bits->words[w] & ((UINT64_C(1) << tail) - 1));
+    return rank;
+}
+
+// Index of the set bit of `word` with `rank` set bits before it.
+static inline unsigned _dbits_select_word(uint64_t word, unsigned rank)
+{
+    unsigned shift = 0;
+    for (;;)
+    {
+        unsigned count = _da_popcount64(word & 0xff);
+        if (rank < count)
+            break;
+        rank -= count;
+        word >>= 8;
+        shift += 8;
+    }
+    while (rank-- > 0)
+        word &= word - 1;
+    return shift + _da_ctz64(word);
+}
+
+long dbits_select(const struct dbits* bits, size_t rank)
+{
+    size_t nwords = da_length(bits->words);
+    size_t w = 0;
+    if (bits->ranks_valid)
+    {
+        // Find the last block with at most `rank` set bits before it.
+        size_t nblocks = da_length(bits->ranks) - 1;
+        if (rank >= bits->ranks[nblocks])
+            return -1;
+        size_t lo = 0;
+        size_t hi = nblocks;
+        while (hi - lo > 1)
+        {
+            size_t mid = lo + (hi - lo)/2;
+            if (bits->ranks[mid] <= rank)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        rank -= bits->ranks[lo];
+        w = lo*DBITS_BLOCK_WORDS;
+    }
+    else
+    {
+        // Skip whole blocks with the dispatched popcount before scanning
+        // words one at a time.
+        for (; w + DBITS_BLOCK_WORDS <= nwords; w += DBITS_BLOCK_WORDS)
+        {
+            size_t count = _dbits_popcount_words(bits->words + w,
+                DBITS_BLOCK_WORDS);
+            if (rank < count)
+                break;
+            rank -= count;
+        }
+    }
+    for (; w < nwords; ++w)
+    {
+        unsigned count = _da_popcount64(bits->words[w]);
+        if (rank < count)
+        {
+            return (long)(w*DBITS_WORD_BITS
+                + _dbits_select_word(bits->words[w], (unsigned)rank));
+        }
+        rank -= count;
+    }
+    return -1;
+}
+
+///////////////////////////////////// DSOA /////////////////////////////////////
+// Approximate number of bytes of records `dsoa_append_darray` and
+// `dsoa_to_darray` convert at a time, small enough for a batch of records to
+// stay in the L1 cache while it is copied column by column.
+#define DSOA_BATCH_BYTES 8192
+
+struct _dsoa_column
+{
+    size_t offset;
+    size_t size;
+    char* data;
+};
+
+struct dsoa
+{
+    struct da_mem_funcs mem_funcs;
+    size_t record_size;
+    size_t length;
+    size_t capacity;
+    // Cache line aligned block holding every column, each starting on a cache
+    // line of its own.
+    char* block;
+    size_t ncolumns;
+    struct _dsoa_column columns[];
+};
+
+static size_t _dsoa_column_bytes(size_t capacity, size_t size)
+{
+    size_t bytes = capacity*size;
+    return (bytes + DA_CACHE_LINE_SIZE - 1)
+        / DA_CACHE_LINE_SIZE * DA_CACHE_LINE_SIZE;
+}
+
+// Move the columns of `soa` into a new block of `capacity` records.
+static bool _dsoa_realloc(struct dsoa* soa, size_t capacity)
+{
+    size_t total = 0;
+    for (size_t c = 0; c < soa->ncolumns; ++c)
+        total += _dsoa_column_bytes(capacity, soa->columns[c].size);
+    char* block = _da_alloc_cache_aligned(soa->mem_funcs, total);
+    if (block == NULL)
+        return false;
+    char* data = block;
+    for (size_t c = 0; c < soa->ncolumns; ++c)
+    {
+        struct _dsoa_column* col = &soa->columns[c];
+        if (soa->length != 0)
+            memcpy(data, col->data, soa->length*col->size);
+        col->data = data;
+        data += _dsoa_column_bytes(capacity, col->size);
+    }
+    _da_free_cache_aligned(soa->mem_funcs, soa->block);
+    soa->block = block;
+    soa->capacity = capacity;
+    return true;
+}
+
+static bool _dsoa_grow(struct dsoa* soa, size_t nrecords)
+{
+    size_t length = soa->length + nrecords;
+    if (length <= soa->capacity)
+        return true;
+    return _dsoa_realloc(soa, DA_NEW_CAPACITY_FROM_LENGTH(length));
+}
+
+// Copy `n` fields of `size` bytes spaced `stride` bytes apart in `records` to
+// the consecutive elements of `column`, or the other way around if `scatter`.
+static DA_ALWAYS_INLINE void _dsoa_copy_strided(char* column, char* records,
+    size_t n, size_t size, size_t stride, bool scatter)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (scatter)
+            memcpy(records + i*stride, column + i*size, size);
+        else
+            memcpy(column + i*size, records + i*stride, size);
+    }
+}
+
+static void _dsoa_copy_field(char* column, char* records, size_t n,
+    size_t size, size_t stride, bool scatter)
+{
+    // Fixed sizes let each copy compile to a single load and store.
+    switch (size)
+    {
+    case 1: _dsoa_copy_strided(column, records, n, 1, stride, scatter); break;
+    case 2: _dsoa_copy_strided(column, records, n, 2, stride, scatter); break;
+    case 4: _dsoa_copy_strided(column, records, n, 4, stride, scatter); break;
+    case 8: _dsoa_copy_strided(column, records, n, 8, stride, scatter); break;
+    default:
+        _dsoa_copy_strided(column, records, n, size, stride, scatter);
+        break;
+    }
+}
+
+// Copy `n` records between `records` and the columns of `soa` starting at
+// record `index`, one batch of records at a time.
+static void _dsoa_copy_records(const struct dsoa* soa, size_t index,
+    char* records, size_t n, bool scatter)
+{
+    size_t rsz = soa->record_size;
+    size_t batch = DSOA_BATCH_BYTES / rsz == 0 ? 1 : DSOA_BATCH_BYTES / rsz;
+    for (size_t first = 0; first < n; first += batch)
+    {
+        size_t count = n - first < batch ? n - first : batch;
+        for (size_t c = 0; c < soa->ncolumns; ++c)
+        {
+            const struct _dsoa_column* col = &soa->columns[c];
+            _dsoa_copy_field(col->data + (index + first)*col->size,
+                records + first*rsz + col->offset, count, col->size, rsz,
+                scatter);
+        }
+    }
+}
+
+static void _dsoa_write(struct dsoa* soa, size_t index, const void* record)
+{
+    for (size_t c = 0; c < soa->ncolumns; ++c)
+    {
+        struct _dsoa_column* col = &soa->columns[c];
+        char* dst = col->data + index*col->size;
+        if (record == NULL)
+            memset(dst, 0, col->size);
+        else
+            memcpy(dst, (const char*)record + col->offset, col->size);
+    }
+}
+
+struct dsoa* dsoa_alloc(size_t record_size, const struct dsoa_field* fields,
+    size_t nfields)
+{
+    return dsoa_alloc_custom(DA_DEFAULT_MEM_FUNCS, record_size, fields,
+        nfields);
+}
+
+struct dsoa* dsoa_alloc_custom(struct da_mem_funcs mem_funcs,
+    size_t record_size, const struct dsoa_field* fields, size_t nfields)
+{
+    struct dsoa* soa = mem_funcs.alloc_f(
+        sizeof(struct dsoa) + nfields*sizeof(struct _dsoa_column));
+    if (soa == NULL)
+        return NULL;
+    soa->mem_funcs = mem_funcs;
+    soa->record_size = record_size;
+    soa->length = 0;
+    soa->capacity = 0;
+    soa->block = NULL;
+    soa->ncolumns = nfields;
+    for (size_t c = 0; c < nfields; ++c)
+    {
+        soa->columns[c] = (struct _dsoa_column){
+            .offset = fields[c].offset,
+            .size = fields[c].size,
+        };
+    }
+    if (!_dsoa_realloc(soa, DA_CAPACITY_MIN))
+    {
+        mem_funcs.free_f(soa);
+        return NULL;
+    }
+    return soa;
+}
+
+void dsoa_free(struct dsoa* soa)
+{
+    if (soa == NULL)
+        return;
+    struct da_mem_funcs mem_funcs = soa->mem_funcs;
+    _da_free_cache_aligned(mem_funcs, soa->block);
+    mem_funcs.free_f(soa);
+}
+
+size_t dsoa_length(const struct dsoa* soa)
+{
+    return soa->length;
+}
+
+size_t dsoa_capacity(const struct dsoa* soa)
+{
+    return soa->capacity;
+}
+
+void* dsoa_column(const struct dsoa* soa, size_t column)
+{
+    return soa->columns[column].data;
+}
+
+bool dsoa_reserve(struct dsoa* soa, size_t nrecords)
+{
+    return _dsoa_grow(soa, nrecords);
+}
+
+bool dsoa_resize(struct dsoa* soa, size_t length)
+{
+    if (length > soa->length)
+    {
+        if (!_dsoa_grow(soa, length - soa->length))
+            return false;
+        for (size_t c = 0; c < soa->ncolumns; ++c)
+        {
+            struct _dsoa_column* col = &soa->columns[c];
+            memset(col->data + soa->length*col->size, 0,
+                (length - soa->length)*col->size);
+        }
+    }
+    soa->length = length;
+    return true;
+}
+
+bool dsoa_push(struct dsoa* soa, const void* record)
+{
+    if (!_dsoa_grow(soa, 1))
+        return false;
+    _dsoa_write(soa, soa->length, record);
+    soa->length += 1;
+    return true;
+}
+
+bool dsoa_insert(struct dsoa* soa, size_t index, const void* record)
+{
+    if (!_dsoa_grow(soa, 1))
+        return false;
+    for (size_t c = 0; c < soa->ncolumns; ++c)
+    {
+        struct _dsoa_column* col = &soa->columns[c];
+        char* src = col->data + index*col->size;
+        memmove(src + col->size, src, (soa->length - index)*col->size);
+    }
+    _dsoa_write(soa, index, record);
+    soa->length += 1;
+    return true;
+}
+
+void dsoa_remove(struct dsoa* soa, size_t index, void* record)
+{
+    if (record != NULL)
+        dsoa_get(soa, index, record);
+    for (size_t c = 0; c < soa->ncolumns; ++c)
+    {
+        struct _dsoa_column* col = &soa->columns[c];
+        char* dst = col->data + index*col->size;
+        memmove(dst, dst + col->size, (soa->length - index - 1)*col->size);
+    }
+    soa->length -= 1;
+}
+
+void dsoa_get(const struct dsoa* soa, size_t index, void* record)
+{
+    for (size_t c = 0; c < soa->ncolumns; ++c)
+    {
+        const struct _dsoa_column* col = &soa->columns[c];
+        memcpy((char*)record + col->offset, col->data + index*col->size,
+            col->size);
+    }
+}
+
+void dsoa_set(struct dsoa* soa, size_t index, const void* record)
+{
+    _dsoa_write(soa, index, record);
+}
+
+bool dsoa_append_darray(struct dsoa* soa, const void* darr)
+{
+    size_t n = da_length(darr);
+    if (!_dsoa_grow(soa, n))
+        return false;
+    _dsoa_copy_records(soa, soa->length, (char*)darr, n, false);
+    soa->length += n;
+    return true;
+}
+
+struct dsoa* dsoa_from_darray(const void* darr,
+    const struct dsoa_field* fields, size_t nfields)
+{
+    struct dsoa* soa = dsoa_alloc_custom(_da_mem_funcs(darr),
+        da_sizeof_elem(darr), fields, nfields);
+    if (soa == NULL)
+        return NULL;
+    if (!dsoa_append_darray(soa, darr))
+    {
+        dsoa_free(soa);
+        return NULL;
+    }
+    return soa;
+}
+
+void* dsoa_to_darray(const struct dsoa* soa)
+{
+    char* darr = da_alloc_exact_custom(soa->mem_funcs, soa->length,
+        soa->record_size);
+    if (darr == NULL)
+        return NULL;
+    memset(darr, 0, soa->length*soa->record_size);
+    _dsoa_copy_records(soa, 0, darr, soa->length, true);
+    return darr;
+}
+
+//////////////////////////////////// DSMAP /////////////////////////////////////
+struct dsmap
+{
+    // NULL for scalar keys, which are compared as `key_type`.
+    int (*cmp)(const void*, const void*);
+    enum da_key_type key_type;
+    size_t key_size;
+    size_t val_size;
+    darray(char) keys;
+    darray(char) values;
+};
+
+#define _DSMAP_CMP_SCALAR(type, a, b)                                          \
+    do                                                                         \
+    {                                                                          \
+        type x, y;                                                             \
+        memcpy(&x, (a), sizeof(type));                                         \
+        memcpy(&y, (b), sizeof(type));                                         \
+        return (x > y) - (x < y);                                              \
+    } while (0)
+
+static DA_ALWAYS_INLINE int _dsmap_cmp(const struct dsmap* map, const void* a,
+    const void* b)
+{
+    if (map->cmp != NULL)
+        return map->cmp(a, b);
+    switch (map->key_type)
+    {
+    case DA_KEY_I32: _DSMAP_CMP_SCALAR(int32_t, a, b);
+    case DA_KEY_U32: _DSMAP_CMP_SCALAR(uint32_t, a, b);
+    case DA_KEY_I64: _DSMAP_CMP_SCALAR(int64_t, a, b);
+    case DA_KEY_U64: _DSMAP_CMP_SCALAR(uint64_t, a, b);
+    case DA_KEY_F32: _DSMAP_CMP_SCALAR(float, a, b);
+    default:         _DSMAP_CMP_SCALAR(double, a, b);
+    }
+}
+
+// Same as `_da_bound` for lower bounds, with the keys loaded and compared as
+// `type` so each step is a load, a compare, and a conditional move.
+#define _DSMAP_DEFINE_BOUND(suffix, type)                                      \
+static size_t _dsmap_bound_##suffix(const char* keys, size_t nelem,            \
+    const void* key)                                                           \
+{                                                                              \
+    if (nelem == 0)                                                            \
+        return 0;                                                              \
+    type k;                                                                    \
+    memcpy(&k, key, sizeof(type));                                             \
+    const type* first = (const type*)keys;                                     \
+    const type* base = first;                                                  \
+    while (nelem > 1)                                                          \
+    {                                                                          \
+        size_t half = nelem / 2;                                               \
+        DA_PREFETCH(base + (nelem - half) / 2);                                \
+        DA_PREFETCH(base + half + (nelem - half) / 2);                         \
+        base = base[half] < k ? base + half : base;                            \
+        nelem -= half;                                                         \
+    }                                                                          \
+    return (size_t)(base - first) + (*base < k);                               \
+}
+_DSMAP_DEFINE_BOUND(i32, int32_t)
+_DSMAP_DEFINE_BOUND(u32, uint32_t)
+_DSMAP_DEFINE_BOUND(i64, int64_t)
+_DSMAP_DEFINE_BOUND(u64, uint64_t)
+_DSMAP_DEFINE_BOUND(f32, float)
+_DSMAP_DEFINE_BOUND(f64, double)
+
+static size_t _dsmap_bound(const struct dsmap* map, const void* key)
+{
+    size_t n = da_length(map->keys);
+    if (map->cmp != NULL)
+        return _da_bound(map->keys, n, map->key_size, key, map->cmp, false);
+    switch (map->key_type)
+    {
+    case DA_KEY_I32: return _dsmap_bound_i32(map->keys, n, key);
+    case DA_KEY_U32: return _dsmap_bound_u32(map->keys, n, key);
+    case DA_KEY_I64: return _dsmap_bound_i64(map->keys, n, key);
+    case DA_KEY_U64: return _dsmap_bound_u64(map->keys, n, key);
+    case DA_KEY_F32: return _dsmap_bound_f32(map->keys, n, key);
+    default:         return _dsmap_bound_f64(map->keys, n, key);
+    }
+}
+
+// Index of the entry with a key equal to `key`, or -1.
+static long _dsmap_index(const struct dsmap* map, const void* key)
+{
+    size_t i = _dsmap_bound(map, key);
+    if (i == da_length(map->keys)
+        || _dsmap_cmp(map, map->keys + i*map->key_size, key) != 0)
+        return -1;
+    return (long)i;
+}
+
+static struct dsmap* _dsmap_alloc(struct da_mem_funcs mem_funcs,
+    size_t key_size, size_t val_size, int (*cmp)(const void*, const void*),
+    enum da_key_type key_type)
+{
+    struct dsmap* map = mem_funcs.alloc_f(sizeof(struct dsmap));
+    if (map == NULL)
+        return NULL;
+    *map = (struct dsmap){
+        .cmp = cmp,
+        .key_type = key_type,
+        .key_size = key_size,
+        .val_size = val_size,
+        .keys = da_alloc_custom(mem_funcs, 0, key_size),
+        .values = da_alloc_custom(mem_funcs, 0, val_size),
+    };
+    if (map->keys == NULL || map->values == NULL)
+    {
+        if (map->keys != NULL)
+            da_free(map->keys);
+        if (map->values != NULL)
+            da_free(map->values);
+        mem_funcs.free_f(map);
+        return NULL;
+    }
+    return map;
+}
+
+struct dsmap* dsmap_alloc(size_t key_size, size_t val_size,
+    int (*cmp)(const void*, const void*))
+{
+    return _dsmap_alloc(DA_DEFAULT_MEM_FUNCS, key_size, val_size, cmp,
+        DA_KEY_U32);
+}
+
+struct dsmap* dsmap_alloc_custom(struct da_mem_funcs mem_funcs,
+    size_t key_size, size_t val_size, int (*cmp)(const void*, const void*))
+{
+    return _dsmap_alloc(mem_funcs, key_size, val_size, cmp, DA_KEY_U32);
+}
+
+static size_t _dsmap_scalar_size(enum da_key_type key_type)
+{
+    switch (key_type)
+    {
+    case DA_KEY_I32:
+    case DA_KEY_U32:
+    case DA_KEY_F32:
+        return 4;
+    default:
+        return 8;
+    }
+}
+
+struct dsmap* dsmap_alloc_scalar(enum da_key_type key_type, size_t val_size)
+{
+    return _dsmap_alloc(DA_DEFAULT_MEM_FUNCS, _dsmap_scalar_size(key_type),
+        val_size, NULL, key_type);
+}
+
+struct dsmap* dsmap_alloc_scalar_custom(struct da_mem_funcs mem_funcs,
+    enum da_key_type key_type, size_t val_size)
+{
+    return _dsmap_alloc(mem_funcs, _dsmap_scalar_size(key_type), val_size,
+        NULL, key_type);
+}
+
+void dsmap_free(struct dsmap* map)
+{
+    if (map == NULL)
+        return;
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(map->keys);
+    da_free(map->keys);
+    da_free(map->values);
+    mem_funcs.free_f(map);
+}
+
+size_t dsmap_length(const struct dsmap* map)
+{
+    return da_length(map->keys);
+}
+
+const void* dsmap_keys(const struct dsmap* map)
+{
+    return map->keys;
+}
+
+void* dsmap_values(const struct dsmap* map)
+{
+    return map->values;
+}
+
+void* dsmap_insert(struct dsmap* map, const void* key, const void* value)
+{
+    size_t n = da_length(map->keys);
+    size_t i = _dsmap_bound(map, key);
+    char* val;
+    if (i < n && _dsmap_cmp(map, map->keys + i*map->key_size, key) == 0)
+    {
+        val = map->values + i*map->val_size;
+        if (value != NULL)
+            memcpy(val, value, map->val_size);
+        return val;
+    }
+    // Reserve both darrays before moving anything so that a failure leaves
+    // the map untouched.
+    char* keys = da_reserve(map->keys, 1);
+    if (keys == NULL)
+        return NULL;
+    map->keys = keys;
+    char* values = da_reserve(map->values, 1);
+    if (values == NULL)
+        return NULL;
+    map->values = values;
+
+    char* k = keys + i*map->key_size;
+    memmove(k + map->key_size, k, (n - i)*map->key_size);
+    memcpy(k, key, map->key_size);
+    val = values + i*map->val_size;
+    memmove(val + map->val_size, val, (n - i)*map->val_size);
+    if (value != NULL)
+        memcpy(val, value, map->val_size);
+    else
+        memset(val, 0, map->val_size);
+    *DA_P_LENGTH_FROM_HANDLE(keys) = n + 1;
+    *DA_P_LENGTH_FROM_HANDLE(values) = n + 1;
+    return val;
+}
+
+// The entries of a bulk insert are sorted as records holding the index of the
+// entry followed by its key, so that entries with equal keys stay in input
+// order.
+#define _DSMAP_ENTRY_SIZE(key_size) (sizeof(size_t)                            \
+    + ((key_size) + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t))
+
+static DA_ALWAYS_INLINE bool _dsmap_entry_less(const void* a, const void* b,
+    const void* ctx)
+{
+    int c = _dsmap_cmp(ctx, (const char*)a + sizeof(size_t),
+        (const char*)b + sizeof(size_t));
+    if (c != 0)
+        return c < 0;
+    size_t ia, ib;
+    memcpy(&ia, a, sizeof(size_t));
+    memcpy(&ib, b, sizeof(size_t));
+    return ia < ib;
+}
+
+#define _DSMAP_DEFINE_ENTRY_LESS(suffix, type)                                 \
+static DA_ALWAYS_INLINE bool _dsmap_entry_less_##suffix(const void* a,         \
+    const void* b, const void* ctx)                                            \
+{                                                                              \
+    (void)ctx;                                                                 \
+    type ka, kb;                                                               \
+    memcpy(&ka, (const char*)a + sizeof(size_t), sizeof(type));               \
+    memcpy(&kb, (const char*)b + sizeof(size_t), sizeof(type));                \
+    size_t ia, ib;                                                             \
+    memcpy(&ia, a, sizeof(size_t));                                            \
+    memcpy(&ib, b, sizeof(size_t));                                            \
+    return ka < kb || (!(kb < ka) && ia < ib);                                 \
+}
+_DSMAP_DEFINE_ENTRY_LESS(i32, int32_t)
+_DSMAP_DEFINE_ENTRY_LESS(u32, uint32_t)
+_DSMAP_DEFINE_ENTRY_LESS(i64, int64_t)
+_DSMAP_DEFINE_ENTRY_LESS(u64, uint64_t)
+_DSMAP_DEFINE_ENTRY_LESS(f32, float)
+_DSMAP_DEFINE_ENTRY_LESS(f64, double)
+
+// Scalar keys are sorted with a branchless partition, passing the entry size
+// as a constant so that the sort is specialized for it.
+static void _dsmap_sort_entries(const struct dsmap* map, char* entries,
+    size_t nentries, size_t esz)
+{
+    if (map->cmp != NULL)
+    {
+        _da_pdqsort(entries, nentries, esz, _dsmap_entry_less, map, false);
+        return;
+    }
+    switch (map->key_type)
+    {
+    case DA_KEY_I32:
+        _da_pdqsort(entries, nentries, _DSMAP_ENTRY_SIZE(sizeof(int32_t)),
+            _dsmap_entry_less_i32, map, true);
+        break;
+    case DA_KEY_U32:
+        _da_pdqsort(entries, nentries, _DSMAP_ENTRY_SIZE(sizeof(uint32_t)),
+            _dsmap_entry_less_u32, map, true);
+        break;
+    case DA_KEY_I64:
+        _da_pdqsort(entries, nentries, _DSMAP_ENTRY_SIZE(sizeof(int64_t)),
+            _dsmap_entry_less_i64, map, true);
+        break;
+    case DA_KEY_U64:
+        _da_pdqsort(entries, nentries, _DSMAP_ENTRY_SIZE(sizeof(uint64_t)),
+            _dsmap_entry_less_u64, map, true);
+        break;
+    case DA_KEY_F32:
+        _da_pdqsort(entries, nentries, _DSMAP_ENTRY_SIZE(sizeof(float)),
+            _dsmap_entry_less_f32, map, true);
+        break;
+    case DA_KEY_F64:
+        _da_pdqsort(entries, nentries, _DSMAP_ENTRY_SIZE(sizeof(double)),
+            _dsmap_entry_less_f64, map, true);
+        break;
+    }
+}
+
+bool dsmap_insert_many(struct dsmap* map, const void* keys, const void* values,
+    size_t nkeys)
+{
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(map->keys);
+    size_t ksz = map->key_size;
+    size_t vsz = map->val_size;
+    if (nkeys == 0)
+        return true;
+    size_t esz = _DSMAP_ENTRY_SIZE(ksz);
+    char* entries = mem_funcs.alloc_f(nkeys*esz);
+    if (entries == NULL)
+        return false;
+    for (size_t i = 0; i < nkeys; ++i)
+    {
+        memcpy(entries + i*esz, &i, sizeof(size_t));
+        memcpy(entries + i*esz + sizeof(size_t), (const char*)keys + i*ksz,
+            ksz);
+    }
+    _dsmap_sort_entries(map, entries, nkeys, esz);
+
+    // Keep the last entry of each run of equal keys.
+    size_t nunique = 0;
+    for (size_t i = 0; i < nkeys; ++i)
+    {
+        if (i + 1 < nkeys && _dsmap_cmp(map, entries + i*esz + sizeof(size_t),
+                entries + (i+1)*esz + sizeof(size_t)) == 0)
+            continue;
+        memmove(entries + nunique*esz, entries + i*esz, esz);
+        nunique += 1;
+    }
+
+    // Merge the existing entries and the new ones into new darrays.
+    size_t n = da_length(map->keys);
+    char* out_keys = da_alloc_custom(mem_funcs, n + nunique, ksz);
+    char* out_values = da_alloc_custom(mem_funcs, n + nunique, vsz);
+    if (out_keys == NULL || out_values == NULL)
+    {
+        if (out_keys != NULL)
+            da_free(out_keys);
+        if (out_values != NULL)
+            da_free(out_values);
+        mem_funcs.free_f(entries);
+        return false;
+    }
+    size_t i = 0;
+    size_t j = 0;
+    size_t out = 0;
+    while (i < n || j < nunique)
+    {
+        const char* entry = entries + j*esz;
+        int c = i == n ? 1 : j == nunique ? -1
+            : _dsmap_cmp(map, map->keys + i*ksz, entry + sizeof(size_t));
+        char* val = out_values + out*vsz;
+        if (c < 0)
+        {
+            memcpy(out_keys + out*ksz, map->keys + i*ksz, ksz);
+            memcpy(val, map->values + i*vsz, vsz);
+            i += 1;
+        }
+        else
+        {
+            size_t index;
+            memcpy(&index, entry, sizeof(size_t));
+            memcpy(out_keys + out*ksz, entry + sizeof(size_t), ksz);
+            if (values != NULL)
+                memcpy(val, (const char*)values + index*vsz, vsz);
+            else if (c == 0)
+                memcpy(val, map->values + i*vsz, vsz);
+            else
+                memset(val, 0, vsz);
+            i += c == 0;
+            j += 1;
+        }
+        out += 1;
+    }
+    *DA_P_LENGTH_FROM_HANDLE(out_keys) = out;
+    *DA_P_LENGTH_FROM_HANDLE(out_values) = out;
+    da_free(map->keys);
+    da_free(map->values);
+    map->keys = out_keys;
+    map->values = out_values;
+    mem_funcs.free_f(entries);
+    return true;
+}
+
+void* dsmap_find(const struct dsmap* map, const void* key)
+{
+    long i = _dsmap_index(map, key);
+    return i < 0 ? NULL : map->values + (size_t)i*map->val_size;
+}
+
+bool dsmap_erase(struct dsmap* map, const void* key)
+{
+    long i = _dsmap_index(map, key);
+    if (i < 0)
+        return false;
+    da_remove_arr(map->keys, (size_t)i, 1);
+    da_remove_arr(map->values, (size_t)i, 1);
+    return true;
+}
+
+void dsmap_clear(struct dsmap* map)
+{
+    *DA_P_LENGTH_FROM_HANDLE(map->keys) = 0;
+    *DA_P_LENGTH_FROM_HANDLE(map->values) = 0;
+}
+
+size_t dsmap_lower_bound(const struct dsmap* map, const void* key)
+{
+    return _dsmap_bound(map, key);
+}
+
+struct da_range dsmap_range(const struct dsmap* map, const void* lo,
+    const void* hi)
+{
+    struct da_range range = {0, da_length(map->keys)};
+    if (lo != NULL)
+        range.begin = _dsmap_bound(map, lo);
+    if (hi != NULL)
+        range.end = _dsmap_bound(map, hi);
+    if (range.end < range.begin)
+        range.end = range.begin;
+    return range;
+}
+
+/////////////////////////////////// DSLOTMAP ///////////////////////////////////
+#define DSLOTMAP_NO_SLOT UINT32_MAX
+
+// A slot is occupied while its generation is odd, in which case `link` is the
+// index of its value in the dense darray. A free slot links to the next free
+// slot instead.
+struct _dslot
+{
+    uint32_t generation;
+    uint32_t link;
+};
+
+struct dslotmap
+{
+    size_t val_size;
+    uint32_t free_head;
+    darray(struct _dslot) slots;
+    // dense_slots[i] is the slot of values[i].
+    darray(uint32_t) dense_slots;
+    darray(char) values;
+};
+
+struct dslotmap* dslotmap_alloc(size_t val_size)
+{
+    return dslotmap_alloc_custom(DA_DEFAULT_MEM_FUNCS, val_size);
+}
+
+struct dslotmap* dslotmap_alloc_custom(struct da_mem_funcs mem_funcs,
+    size_t val_size)
+{
+    struct dslotmap* map = mem_funcs.alloc_f(sizeof(struct dslotmap));
+    if (map == NULL)
+        return NULL;
+    *map = (struct dslotmap){
+        .val_size = val_size,
+        .free_head = DSLOTMAP_NO_SLOT,
+        .slots = da_alloc_custom(mem_funcs, 0, sizeof(struct _dslot)),
+        .dense_slots = da_alloc_custom(mem_funcs, 0, sizeof(uint32_t)),
+        .values = da_alloc_custom(mem_funcs, 0, val_size),
+    };
+    if (map->slots == NULL || map->dense_slots == NULL || map->values == NULL)
+    {
+        if (map->slots != NULL)
+            da_free(map->slots);
+        if (map->dense_slots != NULL)
+            da_free(map->dense_slots);
+        if (map->values != NULL)
+            da_free(map->values);
+        mem_funcs.free_f(map);
+        return NULL;
+    }
+    return map;
+}
+
+void dslotmap_free(struct dslotmap* map)
+{
+    if (map == NULL)
+        return;
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(map->slots);
+    da_free(map->slots);
+    da_free(map->dense_slots);
+    da_free(map->values);
+    mem_funcs.free_f(map);
 }
 
-darray(char) dstr_replace_all(darray(char) dstr, const char* substr,
-    const char* new_str)
+size_t dslotmap_length(const struct dslotmap* map)
 {
-    size_t substr_len = strlen(substr);
-    size_t new_str_len = strlen(new_str);
-    long loc;
-    while ((loc = dstr_find(dstr, substr)) != -1)
+    return da_length(map->values);
+}
+
+void* dslotmap_values(const struct dslotmap* map)
+{
+    return map->values;
+}
+
+struct dslotmap_handle dslotmap_handle_at(const struct dslotmap* map,
+    size_t index)
+{
+    uint32_t slot = map->dense_slots[index];
+    return (struct dslotmap_handle){slot, map->slots[slot].generation};
+}
+
+bool dslotmap_reserve(struct dslotmap* map, size_t nvalues)
+{
+    size_t free_slots = da_length(map->slots) - da_length(map->values);
+    if (nvalues > free_slots)
     {
-        da_remove_arr(dstr, loc, substr_len);
-        if ((dstr = da_insert_arr(dstr, loc, new_str, new_str_len)) == NULL)
-            return NULL;
+        struct _dslot* slots = da_reserve(map->slots, nvalues - free_slots);
+        if (slots == NULL)
+            return false;
+        map->slots = slots;
     }
-    return dstr;
+    uint32_t* dense_slots = da_reserve(map->dense_slots, nvalues);
+    if (dense_slots == NULL)
+        return false;
+    map->dense_slots = dense_slots;
+    char* values = da_reserve(map->values, nvalues);
+    if (values == NULL)
+        return false;
+    map->values = values;
+    return true;
 }
 
-darray(char) dstr_replace_all_case(darray(char) dstr, const char* substr,
-    const char* new_str)
+void* dslotmap_insert(struct dslotmap* map, const void* value,
+    struct dslotmap_handle* handle)
 {
-    size_t substr_len = strlen(substr);
-    size_t new_str_len = strlen(new_str);
-    long loc;
-    while ((loc = dstr_find_case(dstr, substr)) != -1)
+    if (map->free_head == DSLOTMAP_NO_SLOT
+        && da_length(map->slots) >= DSLOTMAP_NO_SLOT)
+        return NULL;
+    if (!dslotmap_reserve(map, 1))
+        return NULL;
+    uint32_t slot = map->free_head;
+    if (slot == DSLOTMAP_NO_SLOT)
     {
-        da_remove_arr(dstr, loc, substr_len);
-        if ((dstr = da_insert_arr(dstr, loc, new_str, new_str_len)) == NULL)
-            return NULL;
+        slot = (uint32_t)da_length(map->slots);
+        map->slots[slot].generation = 0;
+        *DA_P_LENGTH_FROM_HANDLE(map->slots) += 1;
     }
-    return dstr;
+    else
+    {
+        map->free_head = map->slots[slot].link;
+    }
+    size_t dense = da_length(map->values);
+    map->slots[slot].generation += 1;
+    map->slots[slot].link = (uint32_t)dense;
+    map->dense_slots[dense] = slot;
+    char* val = map->values + dense*map->val_size;
+    if (value != NULL)
+        memcpy(val, value, map->val_size);
+    else
+        memset(val, 0, map->val_size);
+    *DA_P_LENGTH_FROM_HANDLE(map->dense_slots) += 1;
+    *DA_P_LENGTH_FROM_HANDLE(map->values) += 1;
+    if (handle != NULL)
+        *handle = (struct dslotmap_handle){slot, map->slots[slot].generation};
+    return val;
 }
 
-void dstr_transform_lower(darray(char) dstr)
+static DA_ALWAYS_INLINE bool _dslotmap_valid(const struct dslotmap* map,
+    struct dslotmap_handle handle)
 {
-    da_foreach(dstr, c)
-        *c = tolower(*c);
+    return handle.index < da_length(map->slots)
+        && handle.generation % 2 == 1
+        && map->slots[handle.index].generation == handle.generation;
 }
 
-void dstr_transform_upper(darray(char) dstr)
+void* dslotmap_get(const struct dslotmap* map, struct dslotmap_handle handle)
 {
-    da_foreach(dstr, c)
-        *c = toupper(*c);
+    if (!_dslotmap_valid(map, handle))
+        return NULL;
+    return map->values + map->slots[handle.index].link*map->val_size;
 }
 
-darray(char) dstr_getline(darray(char) allocated_dstr, FILE* stream)
+bool dslotmap_erase(struct dslotmap* map, struct dslotmap_handle handle)
 {
-    return dstr_getdelim(allocated_dstr, '\n', stream);
+    if (!_dslotmap_valid(map, handle))
+        return false;
+    struct _dslot* slot = &map->slots[handle.index];
+    size_t dense = slot->link;
+    size_t last = da_length(map->values) - 1;
+    if (dense != last)
+    {
+        // Fill the hole with the last value and point its slot at it.
+        memcpy(map->values + dense*map->val_size,
+            map->values + last*map->val_size, map->val_size);
+        map->dense_slots[dense] = map->dense_slots[last];
+        map->slots[map->dense_slots[dense]].link = (uint32_t)dense;
+    }
+    slot->generation += 1;
+    slot->link = map->free_head;
+    map->free_head = handle.index;
+    *DA_P_LENGTH_FROM_HANDLE(map->dense_slots) = last;
+    *DA_P_LENGTH_FROM_HANDLE(map->values) = last;
+    return true;
 }
 
-darray(char) dstr_getdelim(darray(char) allocated_dstr, int delim, FILE* stream)
+void dslotmap_clear(struct dslotmap* map)
 {
-    allocated_dstr = dstr_reassign_empty(allocated_dstr);
-    if (allocated_dstr == NULL)
+    size_t n = da_length(map->values);
+    for (size_t i = 0; i < n; ++i)
+    {
+        struct _dslot* slot = &map->slots[map->dense_slots[i]];
+        slot->generation += 1;
+        slot->link = map->free_head;
+        map->free_head = map->dense_slots[i];
+    }
+    *DA_P_LENGTH_FROM_HANDLE(map->dense_slots) = 0;
+    *DA_P_LENGTH_FROM_HANDLE(map->values) = 0;
+}
+
+/////////////////////////////////// DJAGGED ////////////////////////////////////
+struct djagged
+{
+    size_t elem_size;
+    darray(char) values;
+    // Always holds one more offset than there are rows, the first being 0.
+    darray(size_t) offsets;
+};
+
+struct djagged* djagged_alloc(size_t elem_size)
+{
+    return djagged_alloc_custom(DA_DEFAULT_MEM_FUNCS, elem_size);
+}
+
+struct djagged* djagged_alloc_custom(struct da_mem_funcs mem_funcs,
+    size_t elem_size)
+{
+    struct djagged* jag = mem_funcs.alloc_f(sizeof(struct djagged));
+    if (jag == NULL)
         return NULL;
-    int c;
-    while ((c = fgetc(stream)) != delim)
+    *jag = (struct djagged){
+        .elem_size = elem_size,
+        .values = da_alloc_custom(mem_funcs, 0, elem_size),
+        .offsets = da_alloc_custom(mem_funcs, 1, sizeof(size_t)),
+    };
+    if (jag->values == NULL || jag->offsets == NULL)
     {
-        if (delim != EOF && c == EOF)
+        if (jag->values != NULL)
+            da_free(jag->values);
+        if (jag->offsets != NULL)
+            da_free(jag->offsets);
+        mem_funcs.free_f(jag);
+        return NULL;
+    }
+    jag->offsets[0] = 0;
+    return jag;
+}
+
+void djagged_free(struct djagged* jag)
+{
+    if (jag == NULL)
+        return;
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(jag->values);
+    da_free(jag->values);
+    da_free(jag->offsets);
+    mem_funcs.free_f(jag);
+}
+
+size_t djagged_nrows(const struct djagged* jag)
+{
+    return da_length(jag->offsets) - 1;
+}
+
+size_t djagged_length(const struct djagged* jag)
+{
+    return da_length(jag->values);
+}
+
+void* djagged_values(const struct djagged* jag)
+{
+    return jag->values;
+}
+
+const size_t* djagged_offsets(const struct djagged* jag)
+{
+    return jag->offsets;
+}
+
+void* djagged_row(const struct djagged* jag, size_t row)
+{
+    return jag->values + jag->offsets[row]*jag->elem_size;
+}
+
+size_t djagged_row_length(const struct djagged* jag, size_t row)
+{
+    return jag->offsets[row+1] - jag->offsets[row];
+}
+
+struct da_range djagged_row_range(const struct djagged* jag, size_t row)
+{
+    return (struct da_range){jag->offsets[row], jag->offsets[row+1]};
+}
+
+bool djagged_reserve(struct djagged* jag, size_t nrows, size_t nelem)
+{
+    size_t* offsets = da_reserve(jag->offsets, nrows);
+    if (offsets == NULL)
+        return false;
+    jag->offsets = offsets;
+    char* values = da_reserve(jag->values, nelem);
+    if (values == NULL)
+        return false;
+    jag->values = values;
+    return true;
+}
+
+static inline void _djagged_copy_back(struct djagged* jag, const void* src,
+    size_t nelem)
+{
+    char* dest = jag->values + da_length(jag->values)*jag->elem_size;
+    if (src != NULL)
+        memcpy(dest, src, nelem*jag->elem_size);
+    else
+        memset(dest, 0, nelem*jag->elem_size);
+    *DA_P_LENGTH_FROM_HANDLE(jag->values) += nelem;
+}
+
+bool djagged_push_row(struct djagged* jag, const void* src, size_t nelem)
+{
+    if (!djagged_reserve(jag, 1, nelem))
+        return false;
+    _djagged_copy_back(jag, src, nelem);
+    jag->offsets[da_length(jag->offsets)] = da_length(jag->values);
+    *DA_P_LENGTH_FROM_HANDLE(jag->offsets) += 1;
+    return true;
+}
+
+bool djagged_append(struct djagged* jag, const void* src, size_t nelem)
+{
+    if (!djagged_reserve(jag, 0, nelem))
+        return false;
+    _djagged_copy_back(jag, src, nelem);
+    jag->offsets[da_length(jag->offsets)-1] = da_length(jag->values);
+    return true;
+}
+
+void* djagged_push(struct djagged* jag, const void* elem)
+{
+    size_t n = da_length(jag->values);
+    if (n == da_capacity(jag->values))
+    {
+        char* values = da_reserve(jag->values, 1);
+        if (values == NULL)
             return NULL;
-        allocated_dstr = dstr_concat_char(allocated_dstr, c);
-        if (allocated_dstr == NULL)
+        jag->values = values;
+    }
+    char* dest = jag->values + n*jag->elem_size;
+    if (elem != NULL)
+        memcpy(dest, elem, jag->elem_size);
+    else
+        memset(dest, 0, jag->elem_size);
+    *DA_P_LENGTH_FROM_HANDLE(jag->values) = n + 1;
+    jag->offsets[da_length(jag->offsets)-1] = n + 1;
+    return dest;
+}
+
+void djagged_pop_row(struct djagged* jag)
+{
+    size_t nrows = djagged_nrows(jag);
+    *DA_P_LENGTH_FROM_HANDLE(jag->offsets) = nrows;
+    *DA_P_LENGTH_FROM_HANDLE(jag->values) = jag->offsets[nrows-1];
+}
+
+void djagged_clear(struct djagged* jag)
+{
+    *DA_P_LENGTH_FROM_HANDLE(jag->offsets) = 1;
+    *DA_P_LENGTH_FROM_HANDLE(jag->values) = 0;
+}
+
+struct djagged* djagged_from_nested(const void* rows, size_t elem_size)
+{
+    void* const* row_arrs = rows;
+    size_t nrows = da_length(rows);
+    size_t nelem = 0;
+    for (size_t i = 0; i < nrows; ++i)
+        nelem += da_length(row_arrs[i]);
+    struct djagged* jag = djagged_alloc_custom(_da_mem_funcs(rows), elem_size);
+    if (jag == NULL)
+        return NULL;
+    if (!djagged_reserve(jag, nrows, nelem))
+    {
+        djagged_free(jag);
+        return NULL;
+    }
+    for (size_t i = 0; i < nrows; ++i)
+    {
+        // Cannot fail once everything is reserved.
+        _djagged_copy_back(jag, row_arrs[i], da_length(row_arrs[i]));
+        jag->offsets[i+1] = da_length(jag->values);
+    }
+    *DA_P_LENGTH_FROM_HANDLE(jag->offsets) = nrows + 1;
+    return jag;
+}
+
+void* djagged_to_nested(const struct djagged* jag)
+{
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(jag->values);
+    size_t nrows = djagged_nrows(jag);
+    void** rows = da_alloc_exact_custom(mem_funcs, nrows, sizeof(void*));
+    if (rows == NULL)
+        return NULL;
+    for (size_t i = 0; i < nrows; ++i)
+    {
+        size_t len = djagged_row_length(jag, i);
+        rows[i] = da_alloc_exact_custom(mem_funcs, len, jag->elem_size);
+        if (rows[i] == NULL)
+        {
+            while (i-- > 0)
+                da_free(rows[i]);
+            da_free(rows);
             return NULL;
+        }
+        memcpy(rows[i], djagged_row(jag, i), len*jag->elem_size);
     }
-    return allocated_dstr;
+    return rows;
 }
 
-darray(char) dstr_trim(darray(char) dstr)
+/////////////////////////////////// DPACKED ////////////////////////////////////
+struct dpacked
 {
-    size_t n;
-    char* tmp;
+    unsigned width;
+    size_t length;
+    // Always holds `_dpacked_nwords(length, width)` words. The bits past the
+    // last element are clear, and the word after the one holding the last
+    // bit always exists, so an element can be read from two adjacent words
+    // without bounds checks.
+    darray(uint64_t) words;
+};
 
-    // Trim leading whitespace.
-    n = 0;
-    tmp = dstr;
-    while (isspace(*tmp++))
-        ++n;
-    da_remove_arr(dstr, 0, n);
+static inline size_t _dpacked_nwords(size_t length, unsigned width)
+{
+    return length*width/64 + 2;
+}
 
-    // Trim trailing whitespace.
-    n = 0;
-    tmp = dstr + dstr_length(dstr) - 1;
-    while (isspace(*tmp--))
-        n++;
-    da_remove_arr(dstr, dstr_length(dstr)-n, n);
+static inline uint64_t _dpacked_mask(unsigned width)
+{
+    return width == 64 ? UINT64_MAX : ((uint64_t)1 << width) - 1;
+}
 
-    return dstr;
+// Number of bits needed to store `value`, at least 1.
+static inline unsigned _dpacked_bit_width(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 64 - (unsigned)__builtin_clzll(value | 1);
+#else
+    unsigned n = 1;
+    while ((value >>= 1) != 0)
+        n += 1;
+    return n;
+#endif
+}
+
+static DA_ALWAYS_INLINE uint64_t _dpacked_load(const uint64_t* words,
+    unsigned width, size_t index)
+{
+    size_t bit = index*width;
+    unsigned off = bit % 64;
+    const uint64_t* w = words + bit/64;
+    // Shifting in two steps keeps the shift count below 64 when off is 0.
+    return ((w[0] >> off) | ((w[1] << 1) << (63 - off))) & _dpacked_mask(width);
+}
+
+static DA_ALWAYS_INLINE void _dpacked_store(uint64_t* words, unsigned width,
+    size_t index, uint64_t value)
+{
+    size_t bit = index*width;
+    unsigned off = bit % 64;
+    uint64_t mask = _dpacked_mask(width);
+    uint64_t* w = words + bit/64;
+    w[0] = (w[0] & ~(mask << off)) | (value << off);
+    w[1] = (w[1] & ~((mask >> 1) >> (63 - off))) | ((value >> 1) >> (63 - off));
+}
+
+// Appends elements to zeroed words one after another, writing each word once.
+struct _dpacked_writer
+{
+    uint64_t* words;
+    uint64_t acc;
+    unsigned fill;
+    unsigned width;
+};
+
+static DA_ALWAYS_INLINE void _dpacked_put(struct _dpacked_writer* wr,
+    uint64_t value)
+{
+    wr->acc |= value << wr->fill;
+    wr->fill += wr->width;
+    if (wr->fill >= 64)
+    {
+        *wr->words++ = wr->acc;
+        wr->fill -= 64;
+        wr->acc = wr->fill == 0 ? 0 : value >> (wr->width - wr->fill);
+    }
+}
+
+static DA_ALWAYS_INLINE void _dpacked_flush(struct _dpacked_writer* wr)
+{
+    *wr->words = wr->acc;
+}
+
+struct dpacked* dpacked_alloc(unsigned width)
+{
+    return dpacked_alloc_custom(DA_DEFAULT_MEM_FUNCS, width);
+}
+
+struct dpacked* dpacked_alloc_custom(struct da_mem_funcs mem_funcs,
+    unsigned width)
+{
+    struct dpacked* packed = mem_funcs.alloc_f(sizeof(struct dpacked));
+    if (packed == NULL)
+        return NULL;
+    size_t nwords = _dpacked_nwords(0, width);
+    *packed = (struct dpacked){
+        .width = width,
+        .length = 0,
+        .words = da_alloc_custom(mem_funcs, nwords, sizeof(uint64_t)),
+    };
+    if (packed->words == NULL)
+    {
+        mem_funcs.free_f(packed);
+        return NULL;
+    }
+    memset(packed->words, 0, nwords*sizeof(uint64_t));
+    return packed;
+}
+
+void dpacked_free(struct dpacked* packed)
+{
+    if (packed == NULL)
+        return;
+    struct da_mem_funcs mem_funcs = _da_mem_funcs(packed->words);
+    da_free(packed->words);
+    mem_funcs.free_f(packed);
+}
+
+size_t dpacked_length(const struct dpacked* packed)
+{
+    return packed->length;
+}
+
+unsigned dpacked_width(const struct dpacked* packed)
+{
+    return packed->width;
+}
+
+bool dpacked_reserve(struct dpacked* packed, size_t nelem)
+{
+    size_t nwords = _dpacked_nwords(packed->length + nelem, packed->width);
+    size_t cur = da_length(packed->words);
+    if (nwords <= cur)
+        return true;
+    uint64_t* words = da_reserve(packed->words, nwords - cur);
+    if (words == NULL)
+        return false;
+    packed->words = words;
+    return true;
+}
+
+// Grow the words to hold `length` elements. Must have been reserved.
+static inline void _dpacked_grow(struct dpacked* packed, size_t length)
+{
+    size_t nwords = _dpacked_nwords(length, packed->width);
+    size_t cur = da_length(packed->words);
+    if (nwords > cur)
+    {
+        memset(packed->words + cur, 0, (nwords - cur)*sizeof(uint64_t));
+        *DA_P_LENGTH_FROM_HANDLE(packed->words) = nwords;
+    }
+    packed->length = length;
+}
+
+// Repack every element at `width` bits into new words with room for `extra`
+// more elements, leaving the dpacked untouched on failure.
+static bool _dpacked_widen(struct dpacked* packed, unsigned width,
+    size_t extra)
+{
+    size_t nwords = _dpacked_nwords(packed->length, width);
+    uint64_t* words = da_alloc_custom(_da_mem_funcs(packed->words),
+        _dpacked_nwords(packed->length + extra, width), sizeof(uint64_t));
+    if (words == NULL)
+        return false;
+    *DA_P_LENGTH_FROM_HANDLE(words) = nwords;
+    memset(words, 0, nwords*sizeof(uint64_t));
+    struct _dpacked_writer wr = {words, 0, 0, width};
+    for (size_t i = 0; i < packed->length; ++i)
+        _dpacked_put(&wr, _dpacked_load(packed->words, packed->width, i));
+    _dpacked_flush(&wr);
+    da_free(packed->words);
+    packed->words = words;
+    packed->width = width;
+    return true;
+}
+
+uint64_t dpacked_get(const struct dpacked* packed, size_t index)
+{
+    return _dpacked_load(packed->words, packed->width, index);
+}
+
+bool dpacked_set(struct dpacked* packed, size_t index, uint64_t value)
+{
+    unsigned width = _dpacked_bit_width(value);
+    if (width > packed->width && !_dpacked_widen(packed, width, 0))
+        return false;
+    _dpacked_store(packed->words, packed->width, index, value);
+    return true;
+}
+
+bool dpacked_push(struct dpacked* packed, uint64_t value)
+{
+    unsigned width = _dpacked_bit_width(value);
+    if (width > packed->width)
+    {
+        if (!_dpacked_widen(packed, width, 1))
+            return false;
+    }
+    else if (!dpacked_reserve(packed, 1))
+    {
+        return false;
+    }
+    size_t index = packed->length;
+    _dpacked_grow(packed, index + 1);
+    _dpacked_store(packed->words, packed->width, index, value);
+    return true;
+}
+
+void dpacked_clear(struct dpacked* packed)
+{
+    size_t nwords = _dpacked_nwords(0, packed->width);
+    memset(packed->words, 0, nwords*sizeof(uint64_t));
+    *DA_P_LENGTH_FROM_HANDLE(packed->words) = nwords;
+    packed->length = 0;
+}
+
+static DA_ALWAYS_INLINE uint64_t _dpacked_read_uint(const char* p, size_t sz)
+{
+    switch (sz)
+    {
+    case 1:  return *(const uint8_t*)p;
+    case 2:  return *(const uint16_t*)p;
+    case 4:  return *(const uint32_t*)p;
+    default: return *(const uint64_t*)p;
+    }
+}
+
+static DA_ALWAYS_INLINE void _dpacked_pack(uint64_t* words, unsigned width,
+    const char* src, size_t nelem, size_t sz)
+{
+    struct _dpacked_writer wr = {words, 0, 0, width};
+    for (size_t i = 0; i < nelem; ++i)
+        _dpacked_put(&wr, _dpacked_read_uint(src + i*sz, sz));
+    _dpacked_flush(&wr);
+}
+
+struct dpacked* dpacked_from_darray(const void* darr)
+{
+    const char* src = darr;
+    size_t nelem = da_length(darr);
+    size_t sz = da_sizeof_elem(darr);
+    uint64_t max = 0;
+    for (size_t i = 0; i < nelem; ++i)
+    {
+        uint64_t value = _dpacked_read_uint(src + i*sz, sz);
+        max = value > max ? value : max;
+    }
+    unsigned width = _dpacked_bit_width(max);
+    struct dpacked* packed = dpacked_alloc_custom(_da_mem_funcs(darr), width);
+    if (packed == NULL)
+        return NULL;
+    if (!dpacked_reserve(packed, nelem))
+    {
+        dpacked_free(packed);
+        return NULL;
+    }
+    _dpacked_grow(packed, nelem);
+    switch (sz)
+    {
+    case 1:  _dpacked_pack(packed->words, width, src, nelem, 1); break;
+    case 2:  _dpacked_pack(packed->words, width, src, nelem, 2); break;
+    case 4:  _dpacked_pack(packed->words, width, src, nelem, 4); break;
+    default: _dpacked_pack(packed->words, width, src, nelem, 8); break;
+    }
+    return packed;
+}
+
+static DA_ALWAYS_INLINE void _dpacked_unpack_scalar(const uint64_t* words,
+    unsigned width, size_t begin, size_t end, char* out, size_t sz)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        uint64_t value = _dpacked_load(words, width, i);
+        switch (sz)
+        {
+        case 1:  ((uint8_t*)out)[i] = (uint8_t)value; break;
+        case 2:  ((uint16_t*)out)[i] = (uint16_t)value; break;
+        case 4:  ((uint32_t*)out)[i] = (uint32_t)value; break;
+        default: ((uint64_t*)out)[i] = value; break;
+        }
+    }
+}
+
+#if DA_X86_SIMD
+#define DPACKED_AVX2_MAX_WIDTH 25
+
+// Eight consecutive elements take exactly `width` bytes, so every group of
+// eight starts on a byte boundary and decodes with the same byte shuffle and
+// bit shifts. Each 128-bit lane loads the 16 bytes holding four elements,
+// gathers the four bytes holding each element into a 32-bit slot, then shifts
+// and masks it out. Returns the number of elements unpacked, leaving the
+// groups whose loads would pass the end of the words to the caller.
+static DA_TARGET_AVX2 size_t _dpacked_unpack_avx2_u32(const uint64_t* words,
+    size_t nwords, unsigned width, size_t nelem, uint32_t* out)
+{
+    uint8_t shuffle[32];
+    uint32_t shifts[8];
+    size_t half = 4*width/8;
+    for (unsigned j = 0; j < 8; ++j)
+    {
+        unsigned bit = j*width;
+        unsigned byte = bit/8 - (j < 4 ? 0 : (unsigned)half);
+        for (unsigned k = 0; k < 4; ++k)
+            shuffle[j*4 + k] = (uint8_t)(byte + k);
+        shifts[j] = bit % 8;
+    }
+    __m256i vshuffle = _mm256_loadu_si256((const __m256i*)shuffle);
+    __m256i vshifts = _mm256_loadu_si256((const __m256i*)shifts);
+    __m256i vmask = _mm256_set1_epi32((int)_dpacked_mask(width));
+
+    const char* base = (const char*)words;
+    size_t nbytes = nwords*sizeof(uint64_t);
+    size_t i = 0;
+    for (; i + 8 <= nelem; i += 8)
+    {
+        size_t byte = i/8*width;
+        if (byte + half + 16 > nbytes)
+            break;
+        __m128i lo = _mm_loadu_si128((const __m128i*)(base + byte));
+        __m128i hi = _mm_loadu_si128((const __m128i*)(base + byte + half));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        v = _mm256_shuffle_epi8(v, vshuffle);
+        v = _mm256_and_si256(_mm256_srlv_epi32(v, vshifts), vmask);
+        _mm256_storeu_si256((__m256i*)(out + i), v);
+    }
+    return i;
+}
+#endif // DA_X86_SIMD
+
+void* dpacked_to_darray(const struct dpacked* packed, size_t elem_size)
+{
+    size_t nelem = packed->length;
+    char* out = da_alloc_exact_custom(_da_mem_funcs(packed->words), nelem,
+        elem_size);
+    if (out == NULL)
+        return NULL;
+    const uint64_t* words = packed->words;
+    unsigned width = packed->width;
+    size_t begin = 0;
+#if DA_X86_SIMD
+    if (elem_size == 4 && width <= DPACKED_AVX2_MAX_WIDTH && _da_has_avx2())
+    {
+        begin = _dpacked_unpack_avx2_u32(words, da_length(words), width,
+            nelem, (uint32_t*)out);
+    }
+#endif // DA_X86_SIMD
+    switch (elem_size)
+    {
+    case 1:  _dpacked_unpack_scalar(words, width, begin, nelem, out, 1); break;
+    case 2:  _dpacked_unpack_scalar(words, width, begin, nelem, out, 2); break;
+    case 4:  _dpacked_unpack_scalar(words, width, begin, nelem, out, 4); break;
+    default: _dpacked_unpack_scalar(words, width, begin, nelem, out, 8); break;
+    }
+    return out;
 }
@@ -27,6 +27,7 @@
 #include <stdalign.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -320,18 +321,94 @@ void da_remove_arr(void* darr, size_t index, size_t nelem);
  * @param index_a : Index of the first element.
  * @param index_b : Index of the second element.
  *
- * @note da_swap uses byte by byte memory swapping to exchange two elements,
- *  which in many cases is slower than using an intermediate temp variable for
- *  the swap. The classic
+ * @note da_swap exchanges elements through a small fixed-size buffer since the
+ *  element type is not known at compile time. The classic
  *      tmp = darr[index_a];
  *      darr[index_a] = darr[index_b];
  *      darr[index_b] = tmp;
- *  may be faster than da_swap in many cases as optimizations including full
- *  word assignment and large scale memcopy generated by the compiler almost
- *  always outperform a byte by byte swap.
+ *  may be faster than da_swap in many cases as the compiler can keep `tmp` in
+ *  a register.
  */
 void da_swap(void* darr, size_t index_a, size_t index_b);
 
+/**@function
+ * @brief Reverse the order of all elements in `darr` in place.
+ *
+ * @param darr : Target darray.
+ */
+void da_reverse(void* darr);
+
+/**@function
+ * @brief Reverse the order of the `nelem` elements of `darr` starting at
+ *  `index` in place.
+ *
+ * @param darr : Target darray.
+ * @param index : Array index of the first element in the range.
+ * @param nelem : Number of elements in the range.
+ */
+void da_reverse_range(void* darr, size_t index, size_t nelem);
+
+/**@function
+ * @brief Rotate all elements of `darr` left by `k` positions in place, so that
+ *  the element at index `k` becomes the first element. Equivalent to C++'s
+ *  `std::rotate(begin, begin+k, end)`.
+ *
+ * @param darr : Target darray.
+ * @param k : Number of positions to rotate by. Values greater than the length
+ *  of `darr` wrap around.
+ *
+ * @note No memory is allocated. Short rotations are performed with a single
+ *  `memmove` and rotations by larger amounts are performed with block swaps.
+ */
+void da_rotate(void* darr, size_t k);
+
+/**@function
+ * @brief Rotate the `nelem` elements of `darr` starting at `index` left by `k`
+ *  positions in place.
+ *
+ * @param darr : Target darray.
+ * @param index : Array index of the first element in the range.
+ * @param nelem : Number of elements in the range.
+ * @param k : Number of positions to rotate by. Values greater than `nelem`
+ *  wrap around.
+ */
+void da_rotate_range(void* darr, size_t index, size_t nelem, size_t k);
+
+/**@function
+ * @brief Remove consecutive duplicate elements from `darr` in place, keeping
+ *  the first element of every run of equal elements. On a sorted darray this
+ *  removes every duplicate.
+ *
+ * @param darr : Target darray.
+ * @param eq : Equality function returning `true` if its arguments are equal.
+ *  If `NULL`, elements are compared bytewise with `memcmp`.
+ *
+ * @note Affects the length of the darray.
+ * @note The darray is compacted in a single pass and no memory is allocated.
+ */
+void da_unique(void* darr, bool (*eq)(const void*, const void*));
+
+/**@function
+ * @brief Remove every duplicate element from an unsorted darray in place,
+ *  keeping the first occurrence of each element in its original order.
+ *
+ * @param darr : Target darray.
+ * @param hash : Hash function. Elements that compare equal with `eq` must
+ *  hash to the same value.
+ * @param eq : Equality function returning `true` if its arguments are equal.
+ *
+ * @return `true` on success. `false` if the temporary hash table could not be
+ *  allocated, in which case `darr` is left untouched.
+ *
+ * @note If `hash` and `eq` are both `NULL` elements are hashed and compared
+ *  bytewise. Passing only one of the two as `NULL` is undefined.
+ * @note Affects the length of the darray.
+ * @note The temporary open-addressing hash table is allocated (and freed) with
+ *  the memory management functions of `darr`.
+ */
+bool da_dedupe(void* darr, size_t (*hash)(const void*),
+    bool (*eq)(const void*, const void*)) DA_WARN_UNUSED_RESULT;
+
 /**@macro
  * @brief Append `nelem` array elements from `src` to the back of darray `dest`
  *  reallocating memory in `dest` if neccesary. `src` is preserved across the
@@ -374,358 +451,2542 @@ void* da_concat(void* dest, const void* src, size_t nelem)
 #define da_foreach(/* ELEM_TYPE* */darr, itername)                             \
                                                      _da_foreach(darr, itername)
 
-/////////////////////////////////// DSTRING ////////////////////////////////////
 /**@function
- * @brief Allocate a dstring as the empty string `""`.
+ * @brief Build a new darray by applying `fn` to every element of `src`. The
+ *  new darray has the same length as `src` and is allocated once, with exact
+ *  capacity, before any element is written.
  *
- * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ * @param src : Source darray. Preserved across the call.
+ * @param out_elemsz : `sizeof` each element of the new darray.
+ * @param fn : Function called as `fn(out, in, ctx)` for every element, where
+ *  `in` points to an element of `src` and `out` to the element at the same
+ *  index of the new darray.
+ * @param ctx : User data passed to every call of `fn`.
+ *
+ * @return Pointer to the new darray on success. `NULL` on allocation failure.
+ *
+ * @note The new darray is allocated with the memory management functions of
+ *  `src`.
  */
-darray(char) dstr_alloc_empty(void) DA_WARN_UNUSED_RESULT;
+void* da_map(const void* src, size_t out_elemsz,
+    void (*fn)(void* out, const void* in, void* ctx), void* ctx)
+    DA_WARN_UNUSED_RESULT;
+
+/**@macro
+ * @brief Typed version of `da_map` whose new darray has elements of type
+ *  `out_type`.
+ *
+ * @param src : Source darray.
+ * @param out_type : Element type of the new darray.
+ * @param fn : Function called as `fn(out, in, ctx)` for every element.
+ * @param ctx : User data passed to every call of `fn`.
+ *
+ * @return Pointer to the new darray on success. `NULL` on allocation failure.
+ */
+#define /* out_type* */da_map_to(/* ELEM_TYPE* */src, out_type, fn, ctx)       \
+    ((out_type*)da_map(src, sizeof(out_type), fn, ctx))
 
 /**@function
- * @brief Allocate a dstring as copy of cstring `src`. `src` may also be a
- *  dstring.
+ * @brief Apply `fn` to every element of `darr` in place, from first to last.
  *
- * @param src : string to copy.
+ * @param darr : Target darray.
+ * @param fn : Function called as `fn(elem, ctx)` for every element.
+ * @param ctx : User data passed to every call of `fn`.
+ */
+void da_transform(void* darr, void (*fn)(void* elem, void* ctx), void* ctx);
+
+/**@macro
+ * @brief Maximum number of threads used by the parallel darray algorithms.
+ */
+#define DA_PARALLEL_MAX_THREADS 256
+
+/**@struct
+ * @brief Options controlling how `da_parallel_for` splits a darray between
+ *  threads. A zero initialized struct selects the defaults.
+ *
+ * @member nthreads : Number of threads to use, including the calling thread.
+ *  If `0` one thread per online processor is used. Values above
+ *  `DA_PARALLEL_MAX_THREADS` are clamped.
+ * @member chunk_size : Number of elements a thread claims at a time. If `0`
+ *  chunks start large and shrink as the remaining work runs out, so threads
+ *  that finish early pick up the tail of unevenly expensive work.
+ */
+struct da_parallel_opts
+{
+    size_t nthreads;
+    size_t chunk_size;
+};
+
+/**@function
+ * @brief Call `fn` once for every element of a darray, spreading the calls
+ *  over a pool of worker threads. Threads repeatedly claim the next chunk of
+ *  unprocessed elements until none are left.
  *
- * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ * @param darr : Target darray.
+ * @param fn : Function called as `fn(element, index, ctx)` where `element`
+ *  points to the element at `index`. Calls happen concurrently and in no
+ *  particular order.
+ * @param ctx : User data passed to every call of `fn`.
+ * @param opts : Scheduling options. If `NULL` the defaults are used.
+ *
+ * @note Chunk boundaries fall on cache line boundaries where the element size
+ *  allows, so threads writing to their own elements do not share cache lines.
+ * @note The worker threads are started on first use and reused by every later
+ *  call, as well as by the other parallel darray algorithms. Calls made from
+ *  inside `fn` run on the calling thread.
  */
-darray(char) dstr_alloc_cstr(const char* src) DA_WARN_UNUSED_RESULT;
+void da_parallel_for(void* darr,
+    void (*fn)(void* elem, size_t index, void* ctx), void* ctx,
+    const struct da_parallel_opts* opts);
+
+/////////////////////////////////// SORTING ////////////////////////////////////
+/**@enum
+ * @brief Scalar key types understood by the key-based sorting functions.
+ */
+enum da_key_type
+{
+    DA_KEY_I32,
+    DA_KEY_U32,
+    DA_KEY_I64,
+    DA_KEY_U64,
+    DA_KEY_F32,
+    DA_KEY_F64
+};
+
+/**@macro
+ * @brief Evaluates to the `enum da_key_type` describing the type of `expr`.
+ *  `expr` is not evaluated.
+ *
+ * @param expr : Expression of a 32 or 64 bit integer type, `float`, or
+ *  `double`.
+ */
+#define /* enum da_key_type */DA_KEY_TYPE_OF(expr)                            \
+                                                        _DA_KEY_TYPE_OF(expr)
 
 /**@function
- * @brief Allocate a dstring as a copy of dstring `src`. Faster than
- *  `dstr_alloc_cstr` when copying a dstring.
+ * @brief Sort the elements of `darr` in ascending order as defined by `cmp`.
+ *  The sort is not stable.
  *
- * @param src : dstring to copy.
+ * @param darr : Target darray.
+ * @param cmp : `qsort` compatible comparison function returning a negative
+ *  value, zero, or a positive value if the first argument is less than, equal
+ *  to, or greater than the second argument respectively.
+ *
+ * @note Implemented as a pattern-defeating quicksort: an introsort that falls
+ *  back to insertion sort for short ranges, to heapsort on repeatedly
+ *  unbalanced partitions, and finishes already sorted or nearly sorted input in
+ *  linear time. Element moves are specialized for 4, 8, and 16 byte elements.
+ */
+void da_sort(void* darr, int (*cmp)(const void*, const void*));
+
+/**@function
+ * @brief Sort a darray of a built-in scalar type in ascending order. Unlike
+ *  `da_sort`, comparisons are inlined and partitioning is branchless.
  *
- * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ * @param darr : Target darray.
+ *
+ * @note The position of NaN values in darrays of `float` and `double` is
+ *  unspecified.
  */
-darray(char) dstr_alloc_dstr(const darray(char) src) DA_WARN_UNUSED_RESULT;
+void da_sort_int(darray(int) darr);
+void da_sort_uint(darray(unsigned) darr);
+void da_sort_long(darray(long) darr);
+void da_sort_ulong(darray(unsigned long) darr);
+void da_sort_float(darray(float) darr);
+void da_sort_double(darray(double) darr);
 
 /**@function
- * @brief Allocate a dstring using `sprintf` style formatting.
+ * @brief Sort the elements of `darr` in ascending order of a scalar key
+ *  embedded in each element. The sort is not stable.
  *
- * @param format : `sprintf` style format string.
- * @param ... : va arg list for the format string.
+ * @param darr : Target darray.
+ * @param offset : Byte offset of the key within each element.
+ * @param type : Type of the key.
+ */
+void da_sort_by_key_offset(void* darr, size_t offset, enum da_key_type type);
+
+/**@macro
+ * @brief Sort a darray of structs in ascending order of the scalar struct
+ *  member `member`. The sort is not stable.
  *
- * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ * @param darr : Target darray.
+ * @param member : Identifier of the struct member used as the sort key. Must
+ *  be a 32 or 64 bit integer, `float`, or `double`.
  */
-darray(char) dstr_alloc_format(const char* format, ...) DA_WARN_UNUSED_RESULT;
+#define /* void */da_sort_by_key(/* ELEM_TYPE* */darr, member)                 \
+    da_sort_by_key_offset(darr, _DA_OFFSET_OF_MEMBER(darr, member),            \
+        DA_KEY_TYPE_OF((darr)->member))
 
 /**@function
- * @brief Allocate a dstring as the empty string `""`. All memory allocation,
- *  reallocation, and freeing will be handled using the provided memory
- *  management functions for this dstring.
+ * @brief Partially sort `darr` so that the element at index `nth` is the
+ *  element that would be there if the whole darray were sorted. Every element
+ *  before it compares less than or equal to it and every element after it
+ *  compares greater than or equal to it.
  *
- * @param mem_funcs : Memory management functions.
+ * @param darr : Target darray.
+ * @param nth : Index of the element to select. If `nth` is not less than the
+ *  length of `darr` the darray is left untouched.
+ * @param cmp : `qsort` compatible comparison function.
  *
- * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ * @note Implemented as an introselect using the partitioning of `da_sort`.
+ *  Runs in linear time on average and falls back to heapsort on repeatedly
+ *  unbalanced partitions, bounding the worst case at O(n log n).
  */
-darray(char) dstr_alloc_empty_custom(struct da_mem_funcs mem_funcs)
-    DA_WARN_UNUSED_RESULT;
+void da_nth_element(void* darr, size_t nth,
+    int (*cmp)(const void*, const void*));
 
 /**@function
- * @brief Allocate a dstring as copy of cstring `src`. `src` may also be a
- * dstring. All memory allocation, reallocation, and freeing will be handled
- * using the provided memory management functions for this dstring.
+ * @brief Compute several quantiles of `darr` without sorting it. Each
+ *  quantile is selected only within the range left between the quantiles
+ *  already selected, so the darray is partitioned once across all of them.
+ *
+ * @param darr : Target darray. Must not be empty.
+ * @param qs : Array of `nq` quantiles, each in [0.0, 1.0]. For example 0.5,
+ *  0.99, and 0.999 select the p50, p99, and p999. Need not be sorted.
+ * @param nq : Number of quantiles in `qs`.
+ * @param out : Array of `nq` elements of the element type of `darr`. The
+ *  element for `qs[i]` is copied to `out[i]`.
+ * @param cmp : `qsort` compatible comparison function.
+ *
+ * @note Quantiles use the nearest-rank definition: quantile q is the smallest
+ *  element that is greater than or equal to at least q of the elements,
+ *  i.e. the element at sorted index ceil(q * length) - 1 (0 for q = 0).
+ * @note The darray is reordered, as if by `da_nth_element`.
+ */
+void da_percentiles(void* darr, const double* qs, size_t nq, void* out,
+    int (*cmp)(const void*, const void*));
+
+/**@function
+ * @brief Sort a darray of fixed-width integers or floating point values in
+ *  ascending order using a least significant digit radix sort. The sort is
+ *  stable.
  *
- * @param mem_funcs : Memory management functions.
- * @param src : string to copy.
+ * @param darr : Target darray.
  *
- * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ * @return `true` on success. `false` if the auxiliary buffer could not be
+ *  allocated, in which case `darr` is left untouched.
+ *
+ * @note An auxiliary buffer the size of `darr` is allocated (and freed) with
+ *  the memory management functions of `darr`.
+ * @note Byte positions whose value is identical for every key are detected up
+ *  front and skipped, so keys with a small range sort in fewer passes.
+ * @note Floating point values are ordered by their IEEE-754 total order, so
+ *  `-0.0` sorts before `0.0` and NaNs sort to the ends of the darray.
  */
-darray(char) dstr_alloc_cstr_custom(struct da_mem_funcs mem_funcs,
-    const char* src) DA_WARN_UNUSED_RESULT;
+bool da_radix_sort_i32(darray(int32_t) darr) DA_WARN_UNUSED_RESULT;
+bool da_radix_sort_u32(darray(uint32_t) darr) DA_WARN_UNUSED_RESULT;
+bool da_radix_sort_i64(darray(int64_t) darr) DA_WARN_UNUSED_RESULT;
+bool da_radix_sort_u64(darray(uint64_t) darr) DA_WARN_UNUSED_RESULT;
+bool da_radix_sort_f32(darray(float) darr) DA_WARN_UNUSED_RESULT;
+bool da_radix_sort_f64(darray(double) darr) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Stable radix sort of the elements of `darr` in ascending order of a
+ *  scalar key embedded in each element.
+ *
+ * @param darr : Target darray.
+ * @param offset : Byte offset of the key within each element.
+ * @param type : Type of the key.
+ *
+ * @return `true` on success. `false` if the auxiliary buffer could not be
+ *  allocated, in which case `darr` is left untouched.
+ */
+bool da_radix_sort_by_key_offset(void* darr, size_t offset,
+    enum da_key_type type) DA_WARN_UNUSED_RESULT;
+
+/**@macro
+ * @brief Stable radix sort of a darray of structs in ascending order of the
+ *  scalar struct member `member`.
+ *
+ * @param darr : Target darray.
+ * @param member : Identifier of the struct member used as the sort key. Must
+ *  be a 32 or 64 bit integer, `float`, or `double`.
+ *
+ * @return `true` on success. `false` on allocation failure.
+ */
+#define /* bool */da_radix_sort_by_key(/* ELEM_TYPE* */darr, member)           \
+    da_radix_sort_by_key_offset(darr, _DA_OFFSET_OF_MEMBER(darr, member),      \
+        DA_KEY_TYPE_OF((darr)->member))
+
+/**@function
+ * @brief Sort a darray in ascending order using multiple threads. The darray
+ *  is split into one chunk per thread, the chunks are sorted concurrently, and
+ *  the sorted chunks are then merged pairwise, with every thread writing an
+ *  equal share of the output of each merge round.
+ *
+ * @param darr : Target darray.
+ * @param cmp : qsort compatible comparison function. Must be safe to call
+ *  from several threads at once.
+ * @param nthreads : Number of threads to use, including the calling thread.
+ *  If `0` one thread per online processor is used. Values above
+ *  `DA_PARALLEL_MAX_THREADS` are clamped.
+ *
+ * @return `true` on success. `false` if the auxiliary buffer could not be
+ *  allocated, in which case `darr` is left untouched.
+ *
+ * @note Darrays too short to benefit from more threads are sorted on the
+ *  calling thread with `da_sort` and no memory is allocated.
+ * @note The sort is not stable.
+ */
+bool da_parallel_sort(void* darr, int (*cmp)(const void*, const void*),
+    size_t nthreads) DA_WARN_UNUSED_RESULT;
+
+////////////////////////////////// SEARCHING ///////////////////////////////////
+/**@function
+ * @brief Find the first element of `darr` equal to `*value`.
+ *
+ * @param darr : Target darray.
+ * @param value : Pointer to the value being searched for.
+ *
+ * @return Index of the first element equal to `*value`, or `-1` if no element
+ *  is equal to `*value`.
+ *
+ * @note Elements are compared bytewise, so for floating point types `-0.0`
+ *  does not equal `0.0` and a NaN equals a NaN with the same bit pattern.
+ * @note Darrays of 1, 2, 4, or 8 byte elements are scanned with SSE2 or (when
+ *  supported by the processor) AVX2 compare and movemask instructions on x86.
+ *  Other element sizes are scanned with `memcmp`.
+ */
+long da_find(const void* darr, const void* value);
+
+/**@function
+ * @brief Count the elements of `darr` equal to `*value`.
+ *
+ * @param darr : Target darray.
+ * @param value : Pointer to the value being counted.
+ *
+ * @return Number of elements equal to `*value`.
+ *
+ * @note Elements are compared bytewise, as with `da_find`.
+ */
+size_t da_count(const void* darr, const void* value);
+
+/**@function
+ * @brief Check whether any element of `darr` is equal to `*value`.
+ *
+ * @param darr : Target darray.
+ * @param value : Pointer to the value being searched for.
+ *
+ * @return `true` if an element equal to `*value` exists, `false` otherwise.
+ *
+ * @note Elements are compared bytewise, as with `da_find`.
+ */
+bool da_contains(const void* darr, const void* value);
+
+/**@function
+ * @brief Find the first element of `darr` for which `pred` returns `true`.
+ *
+ * @param darr : Target darray.
+ * @param pred : Predicate called as `pred(element, ctx)`.
+ * @param ctx : User data passed through to `pred`.
+ *
+ * @return Index of the first matching element, or `-1` if no element matches.
+ */
+long da_find_if(const void* darr, bool (*pred)(const void*, void*), void* ctx);
+
+/**@macro
+ * @brief Same as `da_find`, but takes the value by value.
+ *
+ * @param darr : Target darray.
+ * @param value : Value of the same type as the elements of `darr`.
+ *
+ * @return Index of the first element equal to `value`, or `-1`.
+ */
+#define /* long */da_find_val(/* ELEM_TYPE* */darr, /* ELEM_TYPE */value)      \
+                                                      _da_find_val(darr, value)
+
+/**@macro
+ * @brief Same as `da_count`, but takes the value by value.
+ *
+ * @param darr : Target darray.
+ * @param value : Value of the same type as the elements of `darr`.
+ *
+ * @return Number of elements equal to `value`.
+ */
+#define /* size_t */da_count_val(/* ELEM_TYPE* */darr, /* ELEM_TYPE */value)   \
+                                                     _da_count_val(darr, value)
+
+/**@macro
+ * @brief Same as `da_contains`, but takes the value by value.
+ *
+ * @param darr : Target darray.
+ * @param value : Value of the same type as the elements of `darr`.
+ *
+ * @return `true` if an element equal to `value` exists, `false` otherwise.
+ */
+#define /* bool */da_contains_val(/* ELEM_TYPE* */darr, /* ELEM_TYPE */value)  \
+                                                  _da_contains_val(darr, value)
+
+/**@struct
+ * @brief Half-open range of darray indices [`begin`, `end`).
+ *
+ * @member begin : Index of the first element in the range.
+ * @member end : Index one past the last element in the range.
+ */
+struct da_range
+{
+    size_t begin;
+    size_t end;
+};
+
+/**@function
+ * @brief Find the first element of a sorted darray that does not compare less
+ *  than `key`.
+ *
+ * @param darr : Target darray, sorted in ascending order according to `cmp`.
+ * @param key : Pointer to the key being searched for.
+ * @param cmp : Comparison function. Called as `cmp(element, key)` and returns
+ *  a negative, zero, or positive value if `element` is less than, equal to,
+ *  or greater than `key`.
+ *
+ * @return Index of the first element not less than `key`, or the length of
+ *  `darr` if every element is less than `key`.
+ *
+ * @note The search is branchless and prefetches both possible midpoints of
+ *  its next step, so its running time does not depend on the outcome of each
+ *  comparison.
+ */
+size_t da_lower_bound(const void* darr, const void* key,
+    int (*cmp)(const void*, const void*));
+
+/**@function
+ * @brief Find the first element of a sorted darray that compares greater than
+ *  `key`.
+ *
+ * @param darr : Target darray, sorted in ascending order according to `cmp`.
+ * @param key : Pointer to the key being searched for.
+ * @param cmp : Comparison function called as `cmp(element, key)`.
+ *
+ * @return Index of the first element greater than `key`, or the length of
+ *  `darr` if no element is greater than `key`.
+ */
+size_t da_upper_bound(const void* darr, const void* key,
+    int (*cmp)(const void*, const void*));
+
+/**@function
+ * @brief Find the range of elements in a sorted darray that compare equal to
+ *  `key`.
+ *
+ * @param darr : Target darray, sorted in ascending order according to `cmp`.
+ * @param key : Pointer to the key being searched for.
+ * @param cmp : Comparison function called as `cmp(element, key)`.
+ *
+ * @return Range [`da_lower_bound`, `da_upper_bound`) of `key`. The range is
+ *  empty if no element equals `key`.
+ */
+struct da_range da_equal_range(const void* darr, const void* key,
+    int (*cmp)(const void*, const void*));
+
+/**@function
+ * @brief Insert the element pointed to by `value` into a sorted darray,
+ *  keeping the darray sorted. The element is inserted after any elements that
+ *  compare equal to it.
+ *
+ * @param darr : Target darray, sorted in ascending order according to `cmp`.
+ *  Upon function completion, `darr` may or may not point to its previous
+ *  block on the heap, potentially breaking references.
+ * @param value : Pointer to the element to insert.
+ * @param cmp : Comparison function called as `cmp(element, value)`.
+ *
+ * @return Pointer to the new location of the darray upon successful function
+ *  completion. If `da_insert_sorted` returns `NULL` reallocation failed and
+ *  `darr` is left untouched.
+ *
+ * @note Affects the length of the darray.
+ */
+void* da_insert_sorted(void* darr, const void* value,
+    int (*cmp)(const void*, const void*)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Insert a batch of `nbatch` elements into a sorted darray, keeping
+ *  the darray sorted. The batch is sorted, space for it is reserved once, and
+ *  the two are merged in place from back to front. Each batch element is
+ *  inserted after any elements of the darray that compare equal to it.
+ *
+ * @param darr : Target darray, sorted in ascending order according to `cmp`.
+ *  Upon function completion, `darr` may or may not point to its previous
+ *  block on the heap, potentially breaking references.
+ * @param batch : Array of `nbatch` elements to insert. Sorted in place by this
+ *  function. Must not overlap `darr`.
+ * @param nbatch : Number of elements in `batch`.
+ * @param cmp : `qsort` compatible comparison function.
+ *
+ * @return Pointer to the new location of the darray upon successful function
+ *  completion. If `da_merge_sorted_batch` returns `NULL` reallocation failed
+ *  and both `darr` and `batch` are left untouched.
+ *
+ * @note Costs O(n + k log k) for a darray of length n and a batch of k
+ *  elements, compared to O(n k) for k calls to `da_insert_sorted`. The
+ *  darray elements between two consecutive batch elements are found by
+ *  galloping and moved with a single `memmove`.
+ * @note Affects the length of the darray.
+ */
+void* da_merge_sorted_batch(void* darr, void* batch, size_t nbatch,
+    int (*cmp)(const void*, const void*)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Merge `narrays` sorted darrays into a new sorted darray. The output
+ *  is allocated once with a capacity equal to the summed lengths of the
+ *  inputs, and every element is selected with a loser tree (tournament tree),
+ *  which costs about log2(`narrays`) comparisons per element.
+ *
+ * @param arrays : Array of `narrays` darrays, each sorted in ascending order
+ *  according to `cmp` and all with the same element size. Preserved across
+ *  the call.
+ * @param narrays : Number of darrays in `arrays`. Must be at least one.
+ * @param cmp : `qsort` compatible comparison function.
+ *
+ * @return Pointer to the new darray on success. `NULL` on allocation failure.
+ *
+ * @note The merge is stable: elements that compare equal are output in the
+ *  order of the darrays they come from, and in their original order within a
+ *  darray.
+ * @note The new darray, and the small temporary tree, are allocated with the
+ *  memory management functions of `arrays[0]`.
+ */
+void* da_kway_merge(void* const* arrays, size_t narrays,
+    int (*cmp)(const void*, const void*)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Same as `da_kway_merge`, except that only the first of each run of
+ *  elements comparing equal is output, so the result contains no duplicates.
+ *
+ * @note The capacity of the new darray is the summed lengths of the inputs
+ *  even if duplicates were dropped.
+ */
+void* da_kway_merge_unique(void* const* arrays, size_t narrays,
+    int (*cmp)(const void*, const void*)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Set operations on sorted darrays. `da_set_intersect` keeps the
+ *  elements found in both `a` and `b`, `da_set_union` the elements found in
+ *  either, and `da_set_difference` the elements of `a` not found in `b`. The
+ *  result is written into a new sorted darray whose capacity is shrunk to its
+ *  length.
+ *
+ * @param a : Darray sorted in strictly ascending order according to `cmp`.
+ * @param b : Darray sorted in strictly ascending order according to `cmp`,
+ *  with the same element size as `a`.
+ * @param cmp : `qsort` compatible comparison function.
+ *
+ * @return Pointer to the new darray on success. `NULL` on allocation failure.
+ *
+ * @note Inputs of similar length are merged linearly. When one input is at
+ *  least 32 times longer than the other, each element of the shorter input is
+ *  located in the longer one by galloping from the previous match, which
+ *  costs O(k log(n/k)) comparisons instead of O(n + k).
+ * @note When an element is found in both inputs the element from `a` is
+ *  output.
+ * @note The new darray is allocated with the memory management functions of
+ *  `a`.
+ */
+void* da_set_intersect(const void* a, const void* b,
+    int (*cmp)(const void*, const void*)) DA_WARN_UNUSED_RESULT;
+void* da_set_union(const void* a, const void* b,
+    int (*cmp)(const void*, const void*)) DA_WARN_UNUSED_RESULT;
+void* da_set_difference(const void* a, const void* b,
+    int (*cmp)(const void*, const void*)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Set operations on sorted darrays of `uint32_t`, such as posting
+ *  lists. Same as the generic set operations with the comparison inlined.
+ *  Intersections of inputs of similar length compare blocks of four elements
+ *  from each input at once with SSE2 where available.
+ *
+ * @param a : Darray sorted in strictly ascending order.
+ * @param b : Darray sorted in strictly ascending order.
+ *
+ * @return Pointer to the new darray on success. `NULL` on allocation failure.
+ */
+uint32_t* da_set_intersect_u32(darray(const uint32_t) a,
+    darray(const uint32_t) b) DA_WARN_UNUSED_RESULT;
+uint32_t* da_set_union_u32(darray(const uint32_t) a,
+    darray(const uint32_t) b) DA_WARN_UNUSED_RESULT;
+uint32_t* da_set_difference_u32(darray(const uint32_t) a,
+    darray(const uint32_t) b) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Find the lower bound of each of `nkeys` keys in a sorted darray.
+ *  When the keys are sorted each search gallops forward from the result of
+ *  the previous one, so a batch of `k` keys costs `O(k log(n/k))` comparisons
+ *  rather than `O(k log n)` and touches memory in ascending order.
+ *
+ * @param darr : Target darray, sorted in ascending order according to `cmp`.
+ * @param keys : Array of `nkeys` keys, each the same size as an element of
+ *  `darr`. Unsorted keys give correct results, only more slowly.
+ * @param nkeys : Number of keys.
+ * @param indices : Array of `nkeys` elements that receives the lower bound
+ *  of each key.
+ * @param cmp : Comparison function called as `cmp(element, key)`.
+ */
+void da_search_many(const void* darr, const void* keys, size_t nkeys,
+    size_t* indices, int (*cmp)(const void*, const void*));
+
+/**@struct
+ * @brief Read-only search index storing a copy of a sorted darray in
+ *  Eytzinger (breadth-first) order. The first levels of the implicit search
+ *  tree share a handful of cache lines and the descendants of each node are
+ *  contiguous, so lookups touch far fewer cache lines than binary search over
+ *  the sorted darray and the next levels can be prefetched.
+ */
+struct da_eytzinger;
+
+/**@function
+ * @brief Build an Eytzinger search index from a sorted darray.
+ *
+ * @param sorted : Darray sorted in ascending order according to `cmp`. The
+ *  elements are copied, so later changes to `sorted` are not reflected in the
+ *  index.
+ * @param cmp : Comparison function used by every lookup on the index. Called
+ *  as `cmp(element, key)`.
+ *
+ * @return Pointer to a new index on success. `NULL` on allocation failure.
+ *
+ * @note Memory is allocated with the memory management functions of `sorted`.
+ */
+struct da_eytzinger* da_build_eytzinger(const void* sorted,
+    int (*cmp)(const void*, const void*)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Free an Eytzinger search index.
+ *
+ * @param index : Target index.
+ */
+void da_eytzinger_free(struct da_eytzinger* index);
+
+/**@function
+ * @brief Find the first element of the indexed darray not less than `key`.
+ *
+ * @param index : Target index.
+ * @param key : Pointer to the key being searched for.
+ *
+ * @return Index in the original sorted darray of the first element not less
+ *  than `key`, or the length of that darray if every element is less than
+ *  `key`.
+ */
+size_t da_eytzinger_lower_bound(const struct da_eytzinger* index,
+    const void* key);
+
+/**@function
+ * @brief Find an element of the indexed darray equal to `key`.
+ *
+ * @param index : Target index.
+ * @param key : Pointer to the key being searched for.
+ *
+ * @return Index in the original sorted darray of the first element equal to
+ *  `key`, or `-1` if no element is equal to `key`.
+ */
+long da_eytzinger_find(const struct da_eytzinger* index, const void* key);
+
+/**@struct
+ * @brief Read-only search index storing a copy of a sorted darray as an
+ *  implicit B-tree whose nodes each fill one cache line. A lookup costs one
+ *  cache miss per level of a tree with a fan-out of (64 / element size) + 1,
+ *  rather than one per level of a binary tree.
+ */
+struct da_btree_index;
+
+/**@function
+ * @brief Build a B-tree search index from a sorted darray.
+ *
+ * @param sorted : Darray sorted in ascending order according to `cmp`. The
+ *  elements are copied, so later changes to `sorted` are not reflected in the
+ *  index.
+ * @param cmp : Comparison function used by every lookup on the index. Called
+ *  as `cmp(element, key)`.
+ *
+ * @return Pointer to a new index on success. `NULL` on allocation failure.
+ *
+ * @note Memory is allocated with the memory management functions of `sorted`.
+ */
+struct da_btree_index* da_build_btree_index(const void* sorted,
+    int (*cmp)(const void*, const void*)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Free a B-tree search index.
+ *
+ * @param index : Target index.
+ */
+void da_btree_index_free(struct da_btree_index* index);
+
+/**@function
+ * @brief Find the first element of the indexed darray not less than `key`.
+ *
+ * @param index : Target index.
+ * @param key : Pointer to the key being searched for.
+ *
+ * @return Index in the original sorted darray of the first element not less
+ *  than `key`, or the length of that darray if every element is less than
+ *  `key`.
+ */
+size_t da_btree_index_lower_bound(const struct da_btree_index* index,
+    const void* key);
+
+/**@function
+ * @brief Find an element of the indexed darray equal to `key`.
+ *
+ * @param index : Target index.
+ * @param key : Pointer to the key being searched for.
+ *
+ * @return Index in the original sorted darray of the first element equal to
+ *  `key`, or `-1` if no element is equal to `key`.
+ */
+long da_btree_index_find(const struct da_btree_index* index, const void* key);
+
+/**@macro
+ * @brief Same as `da_lower_bound`, but takes the key by value.
+ *
+ * @param darr : Target darray.
+ * @param value : Key of the same type as the elements of `darr`.
+ * @param cmp : Comparison function called as `cmp(element, key)`.
+ *
+ * @return Index of the first element not less than `value`.
+ */
+#define /* size_t */da_lower_bound_val(/* ELEM_TYPE* */darr,                   \
+    /* ELEM_TYPE */value, cmp)                                                 \
+                                          _da_lower_bound_val(darr, value, cmp)
+
+/**@macro
+ * @brief Same as `da_upper_bound`, but takes the key by value.
+ *
+ * @param darr : Target darray.
+ * @param value : Key of the same type as the elements of `darr`.
+ * @param cmp : Comparison function called as `cmp(element, key)`.
+ *
+ * @return Index of the first element greater than `value`.
+ */
+#define /* size_t */da_upper_bound_val(/* ELEM_TYPE* */darr,                   \
+    /* ELEM_TYPE */value, cmp)                                                 \
+                                          _da_upper_bound_val(darr, value, cmp)
+
+/**@macro
+ * @brief Same as `da_equal_range`, but takes the key by value.
+ *
+ * @param darr : Target darray.
+ * @param value : Key of the same type as the elements of `darr`.
+ * @param cmp : Comparison function called as `cmp(element, key)`.
+ *
+ * @return Range of elements equal to `value`.
+ */
+#define /* struct da_range */da_equal_range_val(/* ELEM_TYPE* */darr,          \
+    /* ELEM_TYPE */value, cmp)                                                 \
+                                          _da_equal_range_val(darr, value, cmp)
+
+/**@macro
+ * @brief Same as `da_insert_sorted`, but takes the value to insert by value.
+ *
+ * @param darr : Target darray. Upon function completion, `darr` may or may not
+ *  point to its previous block on the heap, potentially breaking references.
+ * @param value : Value to be inserted into the darray.
+ * @param cmp : Comparison function called as `cmp(element, value)`.
+ *
+ * @return Pointer to the new location of the darray upon successful function
+ *  completion. If `da_insert_sorted_val` returns `NULL` reallocation failed
+ *  and `darr` is left untouched.
+ *
+ * @note Affects the length of the darray.
+ */
+#define /* ELEM_TYPE* */da_insert_sorted_val(/* ELEM_TYPE* */darr,             \
+    /* ELEM_TYPE */value, cmp)                                                 \
+                                        _da_insert_sorted_val(darr, value, cmp)
+
+//////////////////////////////////// HEAPS /////////////////////////////////////
+/**@function
+ * @brief Rearrange the elements of a darray into a heap, i.e. a priority queue
+ *  whose first element is the greatest according to `cmp`. Every element is
+ *  not less than its `arity` children, which are stored starting at index
+ *  `arity*i + 1` for the element at index `i`.
+ *
+ * @param darr : Target darray.
+ * @param cmp : `qsort` compatible comparison function. Pass a comparison
+ *  function with its result negated to keep the smallest element on top.
+ * @param arity : Number of children of each element. Must be at least 2 and
+ *  must be the same for every heap function called on `darr`.
+ *
+ * @note With an `arity` of 4 the children of an element share a cache line
+ *  for elements of up to 16 bytes and the heap is half as deep, so popping
+ *  from a large heap takes half as many cache misses as with a binary heap in
+ *  exchange for more comparisons per level. Sifting is specialized for
+ *  arities of 2 and 4.
+ */
+void da_heapify(void* darr, int (*cmp)(const void*, const void*),
+    size_t arity);
+
+/**@function
+ * @brief Insert a value into a heap.
+ *
+ * @param darr : Target heap. Upon function completion, `darr` may or may not
+ *  point to its previous block on the heap, potentially breaking references.
+ * @param value : Pointer to the value to be inserted.
+ * @param cmp : `qsort` compatible comparison function.
+ * @param arity : Number of children of each element of the heap.
+ *
+ * @return Pointer to the new location of the darray upon successful function
+ *  completion. If `da_heap_push` returns `NULL` reallocation failed and `darr`
+ *  is left untouched.
+ *
+ * @note Affects the length of the darray.
+ */
+void* da_heap_push(void* darr, const void* value,
+    int (*cmp)(const void*, const void*), size_t arity) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Remove the first (greatest) element of a heap.
+ *
+ * @param darr : Target heap. Popping from an empty heap is undefined.
+ * @param out : Buffer the removed element is copied to. May be `NULL`.
+ * @param cmp : `qsort` compatible comparison function.
+ * @param arity : Number of children of each element of the heap.
+ *
+ * @note Affects the length of the darray.
+ */
+void da_heap_pop(void* darr, void* out, int (*cmp)(const void*, const void*),
+    size_t arity);
+
+/**@function
+ * @brief Remove the first (greatest) element of a heap and insert a value in
+ *  its place. Faster than a `da_heap_pop` followed by a `da_heap_push`, as the
+ *  heap is only sifted once.
+ *
+ * @param darr : Target heap. Replacing in an empty heap is undefined.
+ * @param value : Pointer to the value to be inserted. May be equal to `out`.
+ * @param out : Buffer the removed element is copied to. May be `NULL`.
+ * @param cmp : `qsort` compatible comparison function.
+ * @param arity : Number of children of each element of the heap.
+ */
+void da_heap_replace(void* darr, const void* value, void* out,
+    int (*cmp)(const void*, const void*), size_t arity);
+
+/**@macro
+ * @brief Same as `da_heap_push`, but takes the value to insert by value.
+ *
+ * @param darr : Target heap. Upon function completion, `darr` may or may not
+ *  point to its previous block on the heap, potentially breaking references.
+ * @param value : Value to be inserted into the heap.
+ * @param cmp : `qsort` compatible comparison function.
+ * @param arity : Number of children of each element of the heap.
+ *
+ * @return Pointer to the new location of the darray upon successful function
+ *  completion. If `da_heap_push_val` returns `NULL` reallocation failed and
+ *  `darr` is left untouched.
+ *
+ * @note Affects the length of the darray.
+ */
+#define /* ELEM_TYPE* */da_heap_push_val(/* ELEM_TYPE* */darr,                 \
+    /* ELEM_TYPE */value, cmp, /* size_t */arity)                              \
+                                     _da_heap_push_val(darr, value, cmp, arity)
+
+/**@macro
+ * @brief Same as `da_heap_pop`, but returns the removed element by value.
+ *
+ * @param darr : Target heap. Popping from an empty heap is undefined.
+ * @param cmp : `qsort` compatible comparison function.
+ * @param arity : Number of children of each element of the heap.
+ *
+ * @return The removed element.
+ *
+ * @note Affects the length of the darray.
+ */
+#define /* ELEM_TYPE */da_heap_pop_val(/* ELEM_TYPE* */darr, cmp,              \
+    /* size_t */arity)                                                         \
+                                             _da_heap_pop_val(darr, cmp, arity)
+
+/**@macro
+ * @brief Same as `da_heap_replace`, but takes the value to insert and returns
+ *  the removed element by value.
+ *
+ * @param darr : Target heap. Replacing in an empty heap is undefined.
+ * @param value : Value to be inserted into the heap.
+ * @param cmp : `qsort` compatible comparison function.
+ * @param arity : Number of children of each element of the heap.
+ *
+ * @return The removed element.
+ */
+#define /* ELEM_TYPE */da_heap_replace_val(/* ELEM_TYPE* */darr,               \
+    /* ELEM_TYPE */value, cmp, /* size_t */arity)                              \
+                                  _da_heap_replace_val(darr, value, cmp, arity)
+
+////////////////////////////////// REDUCTIONS //////////////////////////////////
+/**@function
+ * @brief Sum the elements of a numeric darray. 32-bit integer elements are
+ *  summed into a 64-bit integer and `float` elements into a `double`.
+ *
+ * @param darr : Target darray.
+ *
+ * @return Sum of the elements of `darr`. `0` if `darr` is empty.
+ *
+ * @note The sum is split over several independent accumulators that the
+ *  compiler keeps in SIMD registers. For floating point types this changes
+ *  the order of the additions, so the result may differ in its last bits from
+ *  a sequential loop.
+ * @note 64-bit integer sums wrap on overflow.
+ */
+int64_t da_sum_i32(darray(const int32_t) darr);
+uint64_t da_sum_u32(darray(const uint32_t) darr);
+int64_t da_sum_i64(darray(const int64_t) darr);
+uint64_t da_sum_u64(darray(const uint64_t) darr);
+double da_sum_f32(darray(const float) darr);
+double da_sum_f64(darray(const double) darr);
+
+/**@function
+ * @brief Find the smallest element of a numeric darray.
+ *
+ * @param darr : Target darray. Must not be empty.
+ *
+ * @return Value of the smallest element of `darr`.
+ *
+ * @note The result is unspecified for floating point darrays containing NaN.
+ */
+int32_t da_min_i32(darray(const int32_t) darr);
+uint32_t da_min_u32(darray(const uint32_t) darr);
+int64_t da_min_i64(darray(const int64_t) darr);
+uint64_t da_min_u64(darray(const uint64_t) darr);
+float da_min_f32(darray(const float) darr);
+double da_min_f64(darray(const double) darr);
+
+/**@function
+ * @brief Find the largest element of a numeric darray.
+ *
+ * @param darr : Target darray. Must not be empty.
+ *
+ * @return Value of the largest element of `darr`.
+ *
+ * @note The result is unspecified for floating point darrays containing NaN.
+ */
+int32_t da_max_i32(darray(const int32_t) darr);
+uint32_t da_max_u32(darray(const uint32_t) darr);
+int64_t da_max_i64(darray(const int64_t) darr);
+uint64_t da_max_u64(darray(const uint64_t) darr);
+float da_max_f32(darray(const float) darr);
+double da_max_f64(darray(const double) darr);
+
+/**@function
+ * @brief Find the index of the smallest element of a numeric darray.
+ *
+ * @param darr : Target darray.
+ *
+ * @return Index of the first occurrence of the smallest element of `darr`.
+ *  `-1` if `darr` is empty.
+ */
+long da_argmin_i32(darray(const int32_t) darr);
+long da_argmin_u32(darray(const uint32_t) darr);
+long da_argmin_i64(darray(const int64_t) darr);
+long da_argmin_u64(darray(const uint64_t) darr);
+long da_argmin_f32(darray(const float) darr);
+long da_argmin_f64(darray(const double) darr);
+
+/**@function
+ * @brief Find the index of the largest element of a numeric darray.
+ *
+ * @param darr : Target darray.
+ *
+ * @return Index of the first occurrence of the largest element of `darr`.
+ *  `-1` if `darr` is empty.
+ */
+long da_argmax_i32(darray(const int32_t) darr);
+long da_argmax_u32(darray(const uint32_t) darr);
+long da_argmax_i64(darray(const int64_t) darr);
+long da_argmax_u64(darray(const uint64_t) darr);
+long da_argmax_f32(darray(const float) darr);
+long da_argmax_f64(darray(const double) darr);
+
+/**@function
+ * @brief Multi-threaded versions of the reductions above. The darray is split
+ *  into one contiguous chunk per thread, each chunk is reduced concurrently,
+ *  and the partial results are combined on the calling thread.
+ *
+ * @param darr : Target darray. Must not be empty for `min` and `max`.
+ * @param nthreads : Number of threads to use, including the calling thread.
+ *  If `0` one thread per online processor is used.
+ *
+ * @return Same as the corresponding sequential reduction.
+ *
+ * @note Each thread reduces at least 65536 elements. Smaller darrays are
+ *  reduced on the calling thread.
+ * @note Floating point sums depend on the number of threads used, as each
+ *  thread adds its chunk separately.
+ */
+int64_t da_parallel_sum_i32(darray(const int32_t) darr, size_t nthreads);
+uint64_t da_parallel_sum_u32(darray(const uint32_t) darr, size_t nthreads);
+int64_t da_parallel_sum_i64(darray(const int64_t) darr, size_t nthreads);
+uint64_t da_parallel_sum_u64(darray(const uint64_t) darr, size_t nthreads);
+double da_parallel_sum_f32(darray(const float) darr, size_t nthreads);
+double da_parallel_sum_f64(darray(const double) darr, size_t nthreads);
+int32_t da_parallel_min_i32(darray(const int32_t) darr, size_t nthreads);
+uint32_t da_parallel_min_u32(darray(const uint32_t) darr, size_t nthreads);
+int64_t da_parallel_min_i64(darray(const int64_t) darr, size_t nthreads);
+uint64_t da_parallel_min_u64(darray(const uint64_t) darr, size_t nthreads);
+float da_parallel_min_f32(darray(const float) darr, size_t nthreads);
+double da_parallel_min_f64(darray(const double) darr, size_t nthreads);
+int32_t da_parallel_max_i32(darray(const int32_t) darr, size_t nthreads);
+uint32_t da_parallel_max_u32(darray(const uint32_t) darr, size_t nthreads);
+int64_t da_parallel_max_i64(darray(const int64_t) darr, size_t nthreads);
+uint64_t da_parallel_max_u64(darray(const uint64_t) darr, size_t nthreads);
+float da_parallel_max_f32(darray(const float) darr, size_t nthreads);
+double da_parallel_max_f64(darray(const double) darr, size_t nthreads);
+long da_parallel_argmin_i32(darray(const int32_t) darr, size_t nthreads);
+long da_parallel_argmin_u32(darray(const uint32_t) darr, size_t nthreads);
+long da_parallel_argmin_i64(darray(const int64_t) darr, size_t nthreads);
+long da_parallel_argmin_u64(darray(const uint64_t) darr, size_t nthreads);
+long da_parallel_argmin_f32(darray(const float) darr, size_t nthreads);
+long da_parallel_argmin_f64(darray(const double) darr, size_t nthreads);
+long da_parallel_argmax_i32(darray(const int32_t) darr, size_t nthreads);
+long da_parallel_argmax_u32(darray(const uint32_t) darr, size_t nthreads);
+long da_parallel_argmax_i64(darray(const int64_t) darr, size_t nthreads);
+long da_parallel_argmax_u64(darray(const uint64_t) darr, size_t nthreads);
+long da_parallel_argmax_f32(darray(const float) darr, size_t nthreads);
+long da_parallel_argmax_f64(darray(const double) darr, size_t nthreads);
+
+/**@function
+ * @brief Replace every element of a numeric darray with the sum of itself and
+ *  all elements before it (inclusive prefix sum).
+ *
+ * @param darr : Target darray.
+ *
+ * @note Integer sums wrap on overflow.
+ * @note Several elements are summed at once in SIMD registers. For floating
+ *  point types this changes the order of the additions, so results may differ
+ *  in their last bits from a sequential loop.
+ */
+void da_inclusive_scan_i32(darray(int32_t) darr);
+void da_inclusive_scan_u32(darray(uint32_t) darr);
+void da_inclusive_scan_i64(darray(int64_t) darr);
+void da_inclusive_scan_u64(darray(uint64_t) darr);
+void da_inclusive_scan_f32(darray(float) darr);
+void da_inclusive_scan_f64(darray(double) darr);
+
+/**@function
+ * @brief Replace every element of a numeric darray with the sum of all
+ *  elements before it (exclusive prefix sum). The first element becomes `0`.
+ *  Scanning a darray of counts this way turns it into offsets, for example the
+ *  row offsets of a compressed sparse row matrix.
+ *
+ * @param darr : Target darray.
+ *
+ * @return Sum of all elements of `darr` before the scan, i.e. the offset one
+ *  past the last element.
+ *
+ * @note Integer sums wrap on overflow.
+ * @note Several elements are summed at once in SIMD registers. For floating
+ *  point types this changes the order of the additions, so results may differ
+ *  in their last bits from a sequential loop.
+ */
+int32_t da_exclusive_scan_i32(darray(int32_t) darr);
+uint32_t da_exclusive_scan_u32(darray(uint32_t) darr);
+int64_t da_exclusive_scan_i64(darray(int64_t) darr);
+uint64_t da_exclusive_scan_u64(darray(uint64_t) darr);
+float da_exclusive_scan_f32(darray(float) darr);
+double da_exclusive_scan_f64(darray(double) darr);
+
+/**@function
+ * @brief Multi-threaded versions of the scans above. The darray is split into
+ *  one chunk per thread. A first pass sums every chunk concurrently, the chunk
+ *  totals are scanned on the calling thread, and a second pass scans every
+ *  chunk concurrently starting from the total of the chunks before it.
+ *
+ * @param darr : Target darray.
+ * @param nthreads : Number of threads to use, including the calling thread.
+ *  If `0` one thread per online processor is used.
+ *
+ * @return The exclusive scans return the sum of all elements of `darr` before
+ *  the scan.
+ *
+ * @note Each thread scans at least 65536 elements. Smaller darrays are scanned
+ *  on the calling thread.
+ * @note Floating point results depend on the number of threads used.
+ */
+void da_parallel_inclusive_scan_i32(darray(int32_t) darr, size_t nthreads);
+void da_parallel_inclusive_scan_u32(darray(uint32_t) darr, size_t nthreads);
+void da_parallel_inclusive_scan_i64(darray(int64_t) darr, size_t nthreads);
+void da_parallel_inclusive_scan_u64(darray(uint64_t) darr, size_t nthreads);
+void da_parallel_inclusive_scan_f32(darray(float) darr, size_t nthreads);
+void da_parallel_inclusive_scan_f64(darray(double) darr, size_t nthreads);
+int32_t da_parallel_exclusive_scan_i32(darray(int32_t) darr,
+    size_t nthreads);
+uint32_t da_parallel_exclusive_scan_u32(darray(uint32_t) darr,
+    size_t nthreads);
+int64_t da_parallel_exclusive_scan_i64(darray(int64_t) darr,
+    size_t nthreads);
+uint64_t da_parallel_exclusive_scan_u64(darray(uint64_t) darr,
+    size_t nthreads);
+float da_parallel_exclusive_scan_f32(darray(float) darr,
+    size_t nthreads);
+double da_parallel_exclusive_scan_f64(darray(double) darr,
+    size_t nthreads);
+
+/////////////////////////////////// DSTRING ////////////////////////////////////
+/**@function
+ * @brief Allocate a dstring as the empty string `""`.
+ *
+ * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ */
+darray(char) dstr_alloc_empty(void) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Allocate a dstring as copy of cstring `src`. `src` may also be a
+ *  dstring.
+ *
+ * @param src : string to copy.
+ *
+ * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ */
+darray(char) dstr_alloc_cstr(const char* src) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Allocate a dstring as a copy of dstring `src`. Faster than
+ *  `dstr_alloc_cstr` when copying a dstring.
+ *
+ * @param src : dstring to copy.
+ *
+ * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ */
+darray(char) dstr_alloc_dstr(const darray(char) src) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Allocate a dstring using `sprintf` style formatting.
+ *
+ * @param format : `sprintf` style format string.
+ * @param ... : va arg list for the format string.
+ *
+ * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ */
+darray(char) dstr_alloc_format(const char* format, ...) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Allocate a dstring as the empty string `""`. All memory allocation,
+ *  reallocation, and freeing will be handled using the provided memory
+ *  management functions for this dstring.
+ *
+ * @param mem_funcs : Memory management functions.
+ *
+ * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ */
+darray(char) dstr_alloc_empty_custom(struct da_mem_funcs mem_funcs)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Allocate a dstring as copy of cstring `src`. `src` may also be a
+ * dstring. All memory allocation, reallocation, and freeing will be handled
+ * using the provided memory management functions for this dstring.
+ *
+ * @param mem_funcs : Memory management functions.
+ * @param src : string to copy.
+ *
+ * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ */
+darray(char) dstr_alloc_cstr_custom(struct da_mem_funcs mem_funcs,
+    const char* src) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Allocate a dstring as a copy of dstring `src`. Faster than
+ *  `dstr_alloc_cstr_custom` when copying a dstring. All memory allocation,
+ *  reallocation, and freeing will be handled using the provided memory
+ *  management functions for this dstring.
+ *
+ * @param mem_funcs : Memory management functions.
+ * @param src : dstring to copy.
+ *
+ * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ */
+darray(char) dstr_alloc_dstr_custom(struct da_mem_funcs mem_funcs,
+    const darray(char) src) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Allocate a dstring using `sprintf` style formatting. All memory
+ *  allocation, reallocation, and freeing will be handled using the provided
+ *  memory management functions for this dstring.
+ *
+ * @param mem_funcs : Memory management functions.
+ * @param format : `sprintf` style format string.
+ * @param ... : va arg list for the format string.
+ *
+ * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ */
+darray(char) dstr_alloc_format_custom(struct da_mem_funcs mem_funcs,
+    const char* format, ...) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Free a dstring. Equivalent to calling `da_free` on `dstr`.
+ *
+ * @param dstr : dstring to free.
+ */
+void dstr_free(darray(char) dstr);
+
+/**@function
+ * @brief Reassign the contents of an allocated dstring to the empty string
+ *  `""`, reallocating memory only when neccesary.
+ *
+ * @param allocated_dstr : Dstring containing memory allocated by one of the
+ *  dstr_alloc functions.
+ *
+ * @return Pointer to the reassigned dstring on success. `NULL` on allocation
+ *  failure.
+ */
+darray(char) dstr_reassign_empty(darray(char) allocated_dstr)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Reassign the contents of an allocated dstring to that of a cstring,
+ *  reallocating memory only when neccesary.
+ *
+ * @param allocated_dstr : Dstring containing memory allocated by one of the
+ *  dstr_alloc functions.
+ * @param src : string to copy.
+ *
+ * @return Pointer to the reassigned dstring on success. `NULL` on allocation
+ *  failure.
+ */
+darray(char) dstr_reassign_cstr(darray(char) allocated_dstr, const char* src)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Reassign the contents of an allocated dstring to that of a dstring,
+ *  reallocating memory only when neccesary.
+ *
+ * @param allocated_dstr : Dstring containing memory allocated by one of the
+ *  dstr_alloc functions.
+ * @param src : dstring to copy.
+ *
+ * @return Pointer to the reassigned dstring on success. `NULL` on allocation
+ *  failure.
+ */
+darray(char) dstr_reassign_dstr(darray(char) allocated_dstr,
+    const darray(char) src) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Reassign the contents of an allocated dstring using `sprintf` style
+ *  formatting, reallocating memory only when neccesary.
+ *
+ * @param allocated_dstr : Dstring containing memory allocated by one of the
+ *  dstr_alloc functions.
+ * @param format : `sprintf` style format string.
+ * @param ... : va arg list for the format string.
+ *
+ * @return Pointer to the reassigned dstring on success. `NULL` on allocation
+ *  failure.
+ */
+darray(char) dstr_reassign_format(darray(char) allocated_dstr,
+    const char* format, ...) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Returns the length of `dstr` without its null terminator. Equivalent
+ *  to `da_length(dstr)-1`. O(1) compared to the O(n) `strlen`.
+ *
+ * @param dstr : Target dstring.
+ *
+ * @return Length of `dstr` without its null terminator.
+ */
+size_t dstr_length(const darray(char) dstr);
+
+/**@function
+ * @brief Append character `c` to dstring `dest`.
+ *
+ * @param dest : Target dstring that will be appended to. Like `da_concat`
+ *  references to `dest` may be invalidated across the function call. Use the
+ *  return value of `dstr_concat_char` as truth for the location of `dest` after
+ *  function completion.
+ * @param c : character to append to `dest`.
+ *
+ * @return Pointer to the new location of the dstring upon successful function
+ *  completion. If `dstr_concat_char` returns `NULL`, reallocation failed and
+ *  `dstr` is left untouched.
+ */
+darray(char) dstr_concat_char(darray(char) dest, char c) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Append `src` to dstring `dest`. `src` may also be a dstring.
+ *
+ * @param dest : Target dstring that will be appended to. Like `da_concat`
+ *  references to `dest` may be invalidated across the function call. Use the
+ *  return value of `dstr_concat_cstr` as truth for the location of `dest` after
+ *  function completion.
+ * @param src : cstring to append to `dest`.
+ *
+ * @return Pointer to the new location of the dstring upon successful function
+ *  completion. If `dstr_concat_cstr` returns `NULL`, reallocation failed and
+ *  `dstr` is left untouched.
+ */
+darray(char) dstr_concat_cstr(darray(char) dest, const char* src)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Append `src` to dstring `dest`. Faster than `dstr_concat_cstr` for
+ *  cat-ing a dstring to another dstring.
+ *
+ * @param dest : Target dstring that will be appended to. Like `da_concat`
+ *  references to `dest` may be invalidated across the function call. Use the
+ *  return value of `dstr_concat_dstr` as truth for the location of `dest` after
+ *  function completion.
+ * @param src : dstring to append to `dest`.
+ */
+darray(char) dstr_concat_dstr(darray(char) dest, const darray(char) src)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Append a string to dstring `dest` using `sprintf` style formatting.
+ *
+ * @param dest : Target dstring that will be appended to. Like `da_concat`
+ *  references to `dest` may be invalidated across the function call. Use the
+ *  return value of `dstr_concat_format` as truth for the location of `dest`
+ *  after function completion.
+ * @param format : `sprintf` style format string.
+ * @param ... : va arg list for the format string.
+ */
+darray(char) dstr_concat_format(darray(char) dest, const char* format, ...)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Comparison function. Currently functionally equivalent to `strcmp`.
+ *
+ * @param s1 : First dstring.
+ * @param s2 : Second dstring.
+ *
+ * @return `strcmp` style comparison of `s1` and `s2`.
+ */
+int dstr_cmp(const darray(char) s1, const char* s2);
+
+/**@function
+ * @brief Comparison function. Currently functionally equivalent to
+ *  `strcasecmp`.
+ *
+ * @param s1 : First dstring.
+ * @param s2 : Second dstring.
+ *
+ * @return `strcmp` style comparison of `s1` and `s2`.
+ */
+int dstr_cmp_case(const darray(char) s1, const char* s2);
+
+/**@function
+ * @brief Returns the index of the first occurrence of `substr` in `dstr` or
+ *  -1 if `substr` was not found. Similar to Python's `str.find`.
+ *
+ * @param dstr : Target dstring to search.
+ * @param substr : Target substring to find in `dstr`.
+ *
+ * @return Index of the first occurence of `substr` if `substr` was found. `-1`
+ *  if  substr was not found.
+ */
+long dstr_find(darray(char) dstr, const char* substr);
+
+/**@function
+ * @brief Returns the index of the first case insensitive occurrence of
+ *  `substr` in `dstr` or -1 if `substr` was not found. Similar to Python's
+ *  `str.find`.
+ *
+ * @param dstr : Target dstring to search.
+ * @param substr : Target substring to find in `dstr`.
+ *
+ * @return Index of the first occurence of `substr` if `substr` was found. `-1`
+ *  if substr was not found.
+ */
+long dstr_find_case(darray(char) dstr, const char* substr);
+
+/**@function
+ * @brief Replace all occurrences of `substr` in `dstr` with `new_str`.
+ *
+ * @param dstr : Target dstring. Upon function completion, `dstr` may or may not
+ *  point to its previous block on the heap, potentially breaking references.
+ * @param substr : Substring in `dstr` that will be replaces.
+ * @param new_substr : String that will replace `substr`.
+ *
+ * @return The new location of `dstr` after function completion. If
+ *  `dstr_replace_all` returns `NULL` reallocation failed somewhere and `dstr`
+ *  may be corrupted.
+ */
+darray(char) dstr_replace_all(darray(char) dstr, const char* substr,
+    const char* new_str) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Replace all occurrences of `substr` (case insensitive) in `dstr` with
+ *  `new_str`.
+ *
+ * @param dstr : Target dstring. Upon function completion, `dstr` may or may not
+ *  point to its previous block on the heap, potentially breaking references.
+ * @param substr : Substring in `dstr` that will be replaces.
+ * @param new_substr : String that will replace `substr`.
+ *
+ * @return The new location of `dstr` after function completion. If
+ *  `dstr_replace_all_case` returns `NULL` reallocation failed somewhere and
+ *  `dstr` may be corrupted.
+ */
+darray(char) dstr_replace_all_case(darray(char) dstr, const char* substr,
+    const char* new_str) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Transform `dstr` to lower case in place.
+ *
+ * @param dstr : Target dstring to transform.
+ */
+void dstr_transform_lower(darray(char) dstr);
+
+/**@function
+ * @brief Transform `dstr` to upper case in place.
+ *
+ * @param dstr : Target dstring to transform.
+ */
+void dstr_transform_upper(darray(char) dstr);
+
+/**@function
+ * @brief Read an entire line from `stream` and store it in `dstr`. Equivalent
+ *  to calling `dstr_getdelim` with `delim == '\n'`.
+ *
+ * @param allocated_dstr : Dstring containing memory allocated by one of the
+ *  dstr_alloc functions.
+ * @param stream : Input stream opened for reading.
+ *
+ * @return The new location of `allocated_dstr` after function completion.`NULL`
+ *  on failure (including end-of-file condition).
+ */
+darray(char) dstr_getline(darray(char) allocated_dstr, FILE* stream)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Read characters from `stream` up to but not including `delim` and
+ *  store them in `dstr`.
+ *
+ * @param allocated_dstr : Dstring containing memory allocated by one of the
+ *  dstr_alloc functions.
+ * @param delim : Character denoting end-of-read. If delim is set to EOF,
+ *  `dstr_getdelim` will read all characters from a stream.
+ * @param stream : Input stream opened for reading.
+ *
+ * @return The new location of `allocated_dstr` after function completion.`NULL`
+ *  on failure (including end-of-file condition if `delim != EOF`).
+ */
+darray(char) dstr_getdelim(darray(char) allocated_dstr, int delim, FILE* stream)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Trims leading and trailing whitespace from `dstr`.
+ *
+ * @param : Target dstring. Upon function completion, `dstr` may or may not
+ *  point to its previous block on the heap, potentially breaking references.
+ *
+ * @return The new location of `dstr` after function completion. If `dstr_trim`
+ *  returns `NULL` reallocation failed and `dstr` is left untouched.
+ */
+darray(char) dstr_trim(darray(char) dstr) DA_WARN_UNUSED_RESULT;
+
+///////////////////////////////////// DMAP /////////////////////////////////////
+/**@struct
+ * @brief Open-addressing hash map from fixed-size keys, or from dstring keys,
+ *  to fixed-size values. Entries are stored in darrays in groups of 16 slots,
+ *  each slot with a control byte holding 7 bits of its key's hash, so a lookup
+ *  compares the hash bits of a whole group at once (with SSE2 where
+ *  available) and only calls the equality function on the likely matches.
+ *
+ * @note Pointers to keys and values are invalidated by any insertion.
+ */
+struct dmap;
+
+/**@function
+ * @brief Allocate an empty dmap from keys of `key_size` bytes to values of
+ *  `val_size` bytes.
+ *
+ * @param key_size : `sizeof` each key.
+ * @param val_size : `sizeof` each value. May be `0` to use the dmap as a set.
+ * @param hash : Hash function of a key. If `NULL`, keys are hashed bytewise.
+ * @param eq : Equality function of two keys. If `NULL`, keys are compared
+ *  bytewise. Passing only one of `hash` and `eq` as `NULL` is undefined.
+ *
+ * @return Pointer to the new dmap on success. `NULL` on allocation failure.
+ */
+struct dmap* dmap_alloc(size_t key_size, size_t val_size,
+    uint64_t (*hash)(const void* key),
+    bool (*eq)(const void* key1, const void* key2)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Same as `dmap_alloc`, but all memory allocation, reallocation, and
+ *  freeing will be handled using the provided memory management functions.
+ */
+struct dmap* dmap_alloc_custom(struct da_mem_funcs mem_funcs, size_t key_size,
+    size_t val_size, uint64_t (*hash)(const void* key),
+    bool (*eq)(const void* key1, const void* key2)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Allocate an empty dmap from strings to values of `val_size` bytes.
+ *  Keys are passed to and returned from the dmap functions as strings rather
+ *  than as pointers to keys. The dmap stores a dstring copy of each key.
+ *
+ * @param val_size : `sizeof` each value. May be `0` to use the dmap as a set.
+ *
+ * @return Pointer to the new dmap on success. `NULL` on allocation failure.
+ */
+struct dmap* dmap_alloc_dstr(size_t val_size) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Same as `dmap_alloc_dstr`, but all memory allocation, reallocation,
+ *  and freeing will be handled using the provided memory management functions.
+ */
+struct dmap* dmap_alloc_dstr_custom(struct da_mem_funcs mem_funcs,
+    size_t val_size) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Free a dmap.
+ *
+ * @param map : Dmap to free. May be `NULL`.
+ */
+void dmap_free(struct dmap* map);
+
+/**@function
+ * @brief Returns the number of entries in a dmap.
+ */
+size_t dmap_length(const struct dmap* map);
+
+/**@function
+ * @brief Make room for at least `nelem` entries, so that inserting up to
+ *  `nelem` entries in total does not rehash the dmap.
+ *
+ * @param map : Target dmap.
+ * @param nelem : Number of entries to make room for.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dmap is left untouched.
+ */
+bool dmap_reserve(struct dmap* map, size_t nelem) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Insert an entry into a dmap, or overwrite the value of the entry with
+ *  an equal key.
+ *
+ * @param map : Target dmap.
+ * @param key : Pointer to the key, or the string for dstring keys.
+ * @param value : Pointer to the value. If `NULL`, the value of a new entry is
+ *  zeroed and the value of an existing entry is left untouched.
+ *
+ * @return Pointer to the value stored in the dmap. `NULL` on allocation
+ *  failure, in which case the dmap is left untouched. With a `val_size` of
+ *  `0`, the pointer is one past the stored key and must not be dereferenced.
+ */
+void* dmap_insert(struct dmap* map, const void* key, const void* value)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Find the entry with a key equal to `key`.
+ *
+ * @param map : Target dmap.
+ * @param key : Pointer to the key, or the string for dstring keys.
+ *
+ * @return Pointer to the value of the entry, or `NULL` if there is no entry
+ *  with a key equal to `key`.
+ */
+void* dmap_find(const struct dmap* map, const void* key);
+
+/**@function
+ * @brief Remove the entry with a key equal to `key`.
+ *
+ * @param map : Target dmap.
+ * @param key : Pointer to the key, or the string for dstring keys.
+ *
+ * @return `true` if an entry was removed, `false` if there is no entry with a
+ *  key equal to `key`.
+ */
+bool dmap_erase(struct dmap* map, const void* key);
+
+/**@function
+ * @brief Remove every entry from a dmap, keeping its capacity.
+ */
+void dmap_clear(struct dmap* map);
+
+/**@function
+ * @brief Iterate over the entries of a dmap in unspecified order.
+ *
+ * @param map : Target dmap.
+ * @param iter : Iteration state. Must be set to `0` before the first call.
+ * @param key : Set to the key of the next entry, which is a pointer to the key
+ *  or the dstring for dstring keys.
+ * @param value : Set to a pointer to the value of the next entry. May be
+ *  `NULL`.
+ *
+ * @return `true` if `key` and `value` were set to the next entry, `false` once
+ *  every entry has been visited.
+ *
+ * @note Erasing the entry just returned does not disturb iteration.
+ */
+bool dmap_next(const struct dmap* map, size_t* iter, const void** key,
+    void** value);
+
+/**@function
+ * @brief Hash function used for keys hashed bytewise and for dstring keys.
+ *
+ * @param data : Bytes to hash.
+ * @param size : Number of bytes to hash.
+ *
+ * @return 64-bit hash of the bytes.
+ */
+uint64_t dmap_hash_bytes(const void* data, size_t size);
+
+///////////////////////////////////// DSET /////////////////////////////////////
+/**@struct
+ * @brief Open-addressing hash set of fixed-size keys. Same layout as a dmap
+ *  with empty values: each key is stored inline in its slot, next to nothing
+ *  but a control byte. Lookups of 4 and 8 byte keys compared bytewise are
+ *  specialized to compare keys as integers.
+ */
+struct dset;
+
+/**@function
+ * @brief Allocate an empty dset of keys of `key_size` bytes.
+ *
+ * @param key_size : `sizeof` each key.
+ * @param hash : Hash function of a key. If `NULL`, keys are hashed bytewise.
+ * @param eq : Equality function of two keys. If `NULL`, keys are compared
+ *  bytewise. Passing only one of `hash` and `eq` as `NULL` is undefined.
+ *
+ * @return Pointer to the new dset on success. `NULL` on allocation failure.
+ */
+struct dset* dset_alloc(size_t key_size, uint64_t (*hash)(const void* key),
+    bool (*eq)(const void* key1, const void* key2)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Same as `dset_alloc`, but all memory allocation, reallocation, and
+ *  freeing will be handled using the provided memory management functions.
+ */
+struct dset* dset_alloc_custom(struct da_mem_funcs mem_funcs, size_t key_size,
+    uint64_t (*hash)(const void* key),
+    bool (*eq)(const void* key1, const void* key2)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Free a dset.
+ *
+ * @param set : Dset to free. May be `NULL`.
+ */
+void dset_free(struct dset* set);
+
+/**@function
+ * @brief Returns the number of keys in a dset.
+ */
+size_t dset_length(const struct dset* set);
+
+/**@function
+ * @brief Make room for at least `nelem` keys, so that inserting up to `nelem`
+ *  keys in total does not rehash the dset.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dset is left untouched.
+ */
+bool dset_reserve(struct dset* set, size_t nelem) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Insert a key into a dset, if no equal key is in the dset already.
+ *
+ * @param set : Target dset.
+ * @param key : Pointer to the key.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dset is left untouched.
+ */
+bool dset_insert(struct dset* set, const void* key) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Returns `true` if a key equal to `key` is in the dset.
+ */
+bool dset_contains(const struct dset* set, const void* key);
+
+/**@function
+ * @brief Remove the key equal to `key` from a dset.
+ *
+ * @return `true` if a key was removed, `false` if no key equal to `key` is in
+ *  the dset.
+ */
+bool dset_erase(struct dset* set, const void* key);
+
+/**@function
+ * @brief Remove every key from a dset, keeping its capacity.
+ */
+void dset_clear(struct dset* set);
+
+/**@function
+ * @brief Iterate over the keys of a dset in unspecified order.
+ *
+ * @param set : Target dset.
+ * @param iter : Iteration state. Must be set to `0` before the first call.
+ * @param key : Set to a pointer to the next key.
+ *
+ * @return `true` if `key` was set to the next key, `false` once every key has
+ *  been visited.
+ */
+bool dset_next(const struct dset* set, size_t* iter, const void** key);
+
+/**@function
+ * @brief Insert an array of keys into a dset.
+ *
+ * @param set : Target dset.
+ * @param keys : Array of `nkeys` keys, such as a darray.
+ * @param nkeys : Number of keys to insert.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  keys before the one that failed have been inserted.
+ *
+ * @note Keys are hashed in batches of 16 and the slots they probe first are
+ *  prefetched before any of them is inserted, so for sets larger than the
+ *  cache the memory accesses of a batch overlap rather than waiting on each
+ *  other.
+ */
+bool dset_insert_many(struct dset* set, const void* keys, size_t nkeys)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Look up an array of keys in a dset.
+ *
+ * @param set : Target dset.
+ * @param keys : Array of `nkeys` keys, such as a darray.
+ * @param nkeys : Number of keys to look up.
+ * @param found : Array of `nkeys` flags set to whether each key is in the
+ *  dset. May be `NULL`.
+ *
+ * @return Number of keys found in the dset.
+ *
+ * @note Lookups are prefetched in batches, like the insertions of
+ *  `dset_insert_many`.
+ */
+size_t dset_contains_many(const struct dset* set, const void* keys,
+    size_t nkeys, bool* found);
+
+//////////////////////////////////// DBITS /////////////////////////////////////
+/**@struct
+ * @brief Bitset stored in a darray of 64-bit words, using one bit per element
+ *  where a `darray(bool)` uses eight. Bit `i` is bit `i % 64` of word
+ *  `i / 64`, and the bits of the last word past the length of the bitset are
+ *  always clear.
+ */
+struct dbits;
+
+/**@function
+ * @brief Allocate a dbits of `nbits` clear bits.
+ *
+ * @param nbits : Initial number of bits.
+ *
+ * @return Pointer to the new dbits on success. `NULL` on allocation failure.
+ */
+struct dbits* dbits_alloc(size_t nbits) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Same as `dbits_alloc`, but all memory allocation, reallocation, and
+ *  freeing will be handled using the provided memory management functions.
+ */
+struct dbits* dbits_alloc_custom(struct da_mem_funcs mem_funcs, size_t nbits)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Free a dbits.
+ *
+ * @param bits : Dbits to free. May be `NULL`.
+ */
+void dbits_free(struct dbits* bits);
+
+/**@function
+ * @brief Returns the number of bits in a dbits.
+ */
+size_t dbits_length(const struct dbits* bits);
+
+/**@function
+ * @brief Returns the darray of words holding the bits of a dbits. The darray
+ *  may move when the dbits grows.
+ */
+darray(const uint64_t) dbits_words(const struct dbits* bits);
+
+/**@function
+ * @brief Change the number of bits in a dbits. Added bits are clear.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dbits is left untouched.
+ */
+bool dbits_resize(struct dbits* bits, size_t nbits) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Append a bit to a dbits.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dbits is left untouched.
+ */
+bool dbits_push(struct dbits* bits, bool value) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Set, clear, or test bit `index` of a dbits. `index` must be less
+ *  than the length of the dbits.
+ */
+void dbits_set(struct dbits* bits, size_t index);
+void dbits_clear(struct dbits* bits, size_t index);
+bool dbits_test(const struct dbits* bits, size_t index);
+
+/**@function
+ * @brief Set or clear every bit of a dbits.
+ */
+void dbits_fill(struct dbits* bits, bool value);
+
+/**@function
+ * @brief Returns the number of set bits in a dbits.
+ */
+size_t dbits_popcount(const struct dbits* bits);
+
+/**@function
+ * @brief Find the first set bit at or after `index`.
+ *
+ * @return Index of the bit, or `-1` if no bit at or after `index` is set.
+ */
+long dbits_find_next_set(const struct dbits* bits, size_t index);
+
+/**@function
+ * @brief Combine `src` into `dst` bitwise: `dst &= src`, `dst |= src`,
+ *  `dst ^= src`, and `dst &= ~src` respectively. If `src` is shorter than
+ *  `dst`, its missing bits are treated as clear. If it is longer, its extra
+ *  bits are ignored.
+ *
+ * @note Words are combined 256 bits at a time with AVX2, or 128 bits at a
+ *  time with SSE2, where available.
+ */
+void dbits_and(struct dbits* dst, const struct dbits* src);
+void dbits_or(struct dbits* dst, const struct dbits* src);
+void dbits_xor(struct dbits* dst, const struct dbits* src);
+void dbits_andnot(struct dbits* dst, const struct dbits* src);
+
+/**@function
+ * @brief Build an index of a dbits that makes `dbits_rank` take constant time
+ *  and `dbits_select` logarithmic time. The index stores the number of set
+ *  bits before each 512-bit block, taking 1/8 of the memory of the bits. It is
+ *  discarded by any function that modifies the dbits.
+ *
+ * @return `true` on success. `false` on allocation failure.
+ */
+bool dbits_build_index(struct dbits* bits) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Returns the number of set bits before bit `index`. `index` may be
+ *  equal to the length of the dbits.
+ *
+ * @note Takes linear time unless the dbits has an index built by
+ *  `dbits_build_index`.
+ */
+size_t dbits_rank(const struct dbits* bits, size_t index);
+
+/**@function
+ * @brief Find the set bit with `rank` set bits before it.
+ *
+ * @return Index of the bit, or `-1` if the dbits has no more than `rank` set
+ *  bits.
+ *
+ * @note Takes linear time unless the dbits has an index built by
+ *  `dbits_build_index`.
+ */
+long dbits_select(const struct dbits* bits, size_t rank);
+
+///////////////////////////////////// DSOA /////////////////////////////////////
+/**@struct
+ * @brief Describes one member of a record struct that a dsoa stores in its
+ *  own column.
+ *
+ * @member offset : Offset of the member in the record struct.
+ * @member size : Size of the member in bytes.
+ */
+struct dsoa_field
+{
+    size_t offset;
+    size_t size;
+};
+
+/**@macro
+ * @brief Initializer of a `struct dsoa_field` for member `member` of struct
+ *  type `type`.
+ */
+#define DSOA_FIELD(type, member) \
+    ((struct dsoa_field){offsetof(type, member), sizeof(((type*)0)->member)})
+
+/**@struct
+ * @brief Struct-of-arrays container of records. Each field of a record is
+ *  stored in its own column, and all columns share one length and capacity,
+ *  so a loop that reads one field of every record only loads that field into
+ *  the cache. Records are passed in and out as instances of the record struct
+ *  described by the dsoa's fields.
+ */
+struct dsoa;
+
+/**@function
+ * @brief Allocate an empty dsoa of records of `record_size` bytes.
+ *
+ * @param record_size : Size of the record struct.
+ * @param fields : Array of `nfields` fields of the record struct. Column `i`
+ *  stores field `fields[i]`. Bytes of the record struct not covered by any
+ *  field, such as padding, are not stored.
+ * @param nfields : Number of fields, at least one.
+ *
+ * @return Pointer to the new dsoa on success. `NULL` on allocation failure.
+ */
+struct dsoa* dsoa_alloc(size_t record_size, const struct dsoa_field* fields,
+    size_t nfields) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Same as `dsoa_alloc`, but all memory allocation, reallocation, and
+ *  freeing will be handled using the provided memory management functions.
+ */
+struct dsoa* dsoa_alloc_custom(struct da_mem_funcs mem_funcs,
+    size_t record_size, const struct dsoa_field* fields, size_t nfields)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Free a dsoa.
+ *
+ * @param soa : Dsoa to free. May be `NULL`.
+ */
+void dsoa_free(struct dsoa* soa);
+
+/**@function
+ * @brief Returns the number of records in a dsoa.
+ */
+size_t dsoa_length(const struct dsoa* soa);
+
+/**@function
+ * @brief Returns the number of records a dsoa can hold before its columns
+ *  are reallocated.
+ */
+size_t dsoa_capacity(const struct dsoa* soa);
+
+/**@function
+ * @brief Returns a pointer to the first element of column `column` of a dsoa,
+ *  usable as a plain array of `dsoa_length(soa)` elements of the column's
+ *  field. Columns are aligned to a 64-byte cache line. The pointer is
+ *  invalidated when the dsoa is reallocated.
+ */
+void* dsoa_column(const struct dsoa* soa, size_t column);
+
+/**@function
+ * @brief Ensure a dsoa can hold `nrecords` more records without being
+ *  reallocated.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dsoa is left untouched.
+ */
+bool dsoa_reserve(struct dsoa* soa, size_t nrecords) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Change the number of records in a dsoa. The fields of added records
+ *  are zeroed.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dsoa is left untouched.
+ */
+bool dsoa_resize(struct dsoa* soa, size_t length) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Append a record to a dsoa.
+ *
+ * @param soa : Target dsoa.
+ * @param record : Pointer to the record struct to append. If `NULL`, the
+ *  fields of the appended record are zeroed.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dsoa is left untouched.
+ */
+bool dsoa_push(struct dsoa* soa, const void* record) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Insert a record into a dsoa at position `index`, moving the records
+ *  after it back by one in every column.
+ *
+ * @param soa : Target dsoa.
+ * @param index : Index of the new record, at most the length of the dsoa.
+ * @param record : Pointer to the record struct to insert. If `NULL`, the
+ *  fields of the inserted record are zeroed.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dsoa is left untouched.
+ */
+bool dsoa_insert(struct dsoa* soa, size_t index, const void* record)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Remove the record at position `index` of a dsoa, moving the records
+ *  after it forward by one in every column.
+ *
+ * @param soa : Target dsoa.
+ * @param index : Index of the record to remove.
+ * @param record : If not `NULL`, the fields of the removed record are copied
+ *  into the record struct it points to.
+ */
+void dsoa_remove(struct dsoa* soa, size_t index, void* record);
+
+/**@function
+ * @brief Copy the fields of record `index` of a dsoa into the record struct
+ *  pointed to by `record`, or copy the fields of `record` into record `index`
+ *  of the dsoa.
+ */
+void dsoa_get(const struct dsoa* soa, size_t index, void* record);
+void dsoa_set(struct dsoa* soa, size_t index, const void* record);
+
+/**@function
+ * @brief Append every record of a darray of record structs to a dsoa.
+ *
+ * @param soa : Target dsoa.
+ * @param darr : Darray of record structs of the size the dsoa was allocated
+ *  with.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dsoa is left untouched.
+ *
+ * @note Records are split into columns in batches that fit in the L1 cache,
+ *  so each record is loaded from memory once regardless of the number of
+ *  columns.
+ */
+bool dsoa_append_darray(struct dsoa* soa, const void* darr)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Allocate a dsoa holding the records of a darray of record structs.
+ *  The dsoa uses the memory management functions of `darr`.
+ *
+ * @param fields : Array of `nfields` fields of the record struct, as for
+ *  `dsoa_alloc`. The size of the record struct is the element size of `darr`.
+ *
+ * @return Pointer to the new dsoa on success. `NULL` on allocation failure.
+ */
+struct dsoa* dsoa_from_darray(const void* darr,
+    const struct dsoa_field* fields, size_t nfields) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Allocate a darray holding the records of a dsoa as record structs.
+ *  The darray uses the memory management functions of the dsoa. Bytes of the
+ *  record structs not covered by any field are zeroed.
+ *
+ * @return Pointer to the new darray on success. `NULL` on allocation failure.
+ */
+void* dsoa_to_darray(const struct dsoa* soa) DA_WARN_UNUSED_RESULT;
+
+//////////////////////////////////// DSMAP /////////////////////////////////////
+/**@struct
+ * @brief Sorted flat map from fixed-size keys to fixed-size values. Keys and
+ *  values are stored in two parallel darrays sorted by key, so lookups are
+ *  branchless binary searches over contiguous keys and iterating in key order
+ *  is a linear scan. Inserting and erasing single entries moves the entries
+ *  after them, making the map best suited to maps that are built in bulk and
+ *  then mostly read.
+ */
+struct dsmap;
+
+/**@function
+ * @brief Allocate an empty dsmap.
+ *
+ * @param key_size : Size of a key in bytes.
+ * @param val_size : Size of a value in bytes. May be zero.
+ * @param cmp : `qsort` compatible comparison function ordering keys.
+ *
+ * @return Pointer to the new dsmap on success. `NULL` on allocation failure.
+ */
+struct dsmap* dsmap_alloc(size_t key_size, size_t val_size,
+    int (*cmp)(const void*, const void*)) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Same as `dsmap_alloc`, but all memory allocation, reallocation, and
+ *  freeing will be handled using the provided memory management functions.
+ */
+struct dsmap* dsmap_alloc_custom(struct da_mem_funcs mem_funcs,
+    size_t key_size, size_t val_size, int (*cmp)(const void*, const void*))
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Allocate an empty dsmap whose keys are scalars of type `key_type`,
+ *  compared with the built-in operators instead of a comparison function.
+ *
+ * @param key_type : Type of the keys.
+ * @param val_size : Size of a value in bytes. May be zero.
+ *
+ * @return Pointer to the new dsmap on success. `NULL` on allocation failure.
+ */
+struct dsmap* dsmap_alloc_scalar(enum da_key_type key_type, size_t val_size)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Same as `dsmap_alloc_scalar`, but all memory allocation,
+ *  reallocation, and freeing will be handled using the provided memory
+ *  management functions.
+ */
+struct dsmap* dsmap_alloc_scalar_custom(struct da_mem_funcs mem_funcs,
+    enum da_key_type key_type, size_t val_size) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Free a dsmap.
+ *
+ * @param map : Dsmap to free. May be `NULL`.
+ */
+void dsmap_free(struct dsmap* map);
+
+/**@function
+ * @brief Returns the number of entries in a dsmap.
+ */
+size_t dsmap_length(const struct dsmap* map);
+
+/**@function
+ * @brief Returns the darray of keys of a dsmap in ascending order, or the
+ *  darray of values in the same order. Entry `i` of the map is key `i` and
+ *  value `i`. Values may be modified in place. Both darrays may move when an
+ *  entry is inserted.
+ */
+const void* dsmap_keys(const struct dsmap* map);
+void* dsmap_values(const struct dsmap* map);
+
+/**@function
+ * @brief Insert an entry into a dsmap, or find the entry with an equal key.
+ *
+ * @param map : Target dsmap.
+ * @param key : Pointer to the key.
+ * @param value : Pointer to the value to store. If `NULL`, the value of a new
+ *  entry is zeroed and the value of an existing entry is left untouched.
+ *
+ * @return Pointer to the value of the entry. `NULL` on allocation failure, in
+ *  which case the dsmap is left untouched.
+ */
+void* dsmap_insert(struct dsmap* map, const void* key, const void* value)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Insert `nkeys` entries into a dsmap. The new entries are sorted and
+ *  deduplicated once and then merged with the existing entries in a single
+ *  pass, which is much faster than inserting them one at a time.
+ *
+ * @param map : Target dsmap.
+ * @param keys : Array of `nkeys` keys in any order. If a key appears more than
+ *  once, the entry that appears last is inserted.
+ * @param values : Array of `nkeys` values matching `keys`. If `NULL`, the
+ *  values of new entries are zeroed and the values of existing entries are
+ *  left untouched.
+ * @param nkeys : Number of entries.
+ *
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dsmap is left untouched.
+ */
+bool dsmap_insert_many(struct dsmap* map, const void* keys, const void* values,
+    size_t nkeys) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Find the value of the entry with a key equal to `key`.
+ *
+ * @return Pointer to the value, or `NULL` if no entry has an equal key.
+ */
+void* dsmap_find(const struct dsmap* map, const void* key);
+
+/**@function
+ * @brief Remove the entry with a key equal to `key` from a dsmap.
+ *
+ * @return `true` if an entry was removed, `false` if none had an equal key.
+ */
+bool dsmap_erase(struct dsmap* map, const void* key);
+
+/**@function
+ * @brief Remove every entry from a dsmap.
+ */
+void dsmap_clear(struct dsmap* map);
+
+/**@function
+ * @brief Returns the index of the first entry with a key not less than `key`,
+ *  or the length of the dsmap if there is none.
+ */
+size_t dsmap_lower_bound(const struct dsmap* map, const void* key);
+
+/**@function
+ * @brief Returns the range of indices of the entries with keys in
+ *  [`lo`, `hi`), to be used with `dsmap_keys` and `dsmap_values`.
+ *
+ * @param map : Target dsmap.
+ * @param lo : Pointer to the lowest key in the range. If `NULL`, the range
+ *  starts at the first entry.
+ * @param hi : Pointer to the key one past the range. If `NULL`, the range ends
+ *  at the last entry.
+ */
+struct da_range dsmap_range(const struct dsmap* map, const void* lo,
+    const void* hi);
+
+/////////////////////////////////// DSLOTMAP ///////////////////////////////////
+/**@struct
+ * @brief Handle to a value stored in a dslotmap. Handles stay valid while the
+ *  other values of the map are inserted and erased, and once the value they
+ *  refer to is erased every lookup with them fails. A zero initialized handle
+ *  never refers to a value.
+ *
+ * @member index : Index of the slot of the value.
+ * @member generation : Number of times the slot had been filled or emptied
+ *  when the value was inserted.
+ */
+struct dslotmap_handle
+{
+    uint32_t index;
+    uint32_t generation;
+};
+
+/**@struct
+ * @brief Slot map of fixed-size values. Values are kept contiguous in a dense
+ *  darray for iteration, and handles reach them through an array of slots,
+ *  so inserting and erasing take constant time and never invalidate the
+ *  handles of other values. Erasing a value moves the last value into its
+ *  place in the dense darray.
+ *
+ * @note Each slot counts its reuses in 32 bits. After 2^31 reuses of one slot
+ *  a stale handle to it becomes indistinguishable from a valid one.
+ */
+struct dslotmap;
+
+/**@function
+ * @brief Allocate an empty dslotmap.
+ *
+ * @param val_size : Size of a value in bytes.
+ *
+ * @return Pointer to the new dslotmap on success. `NULL` on allocation
+ *  failure.
+ */
+struct dslotmap* dslotmap_alloc(size_t val_size) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Same as `dslotmap_alloc`, but all memory allocation, reallocation,
+ *  and freeing will be handled using the provided memory management
+ *  functions.
+ */
+struct dslotmap* dslotmap_alloc_custom(struct da_mem_funcs mem_funcs,
+    size_t val_size) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Free a dslotmap.
+ *
+ * @param map : Dslotmap to free. May be `NULL`.
+ */
+void dslotmap_free(struct dslotmap* map);
+
+/**@function
+ * @brief Returns the number of values in a dslotmap.
+ */
+size_t dslotmap_length(const struct dslotmap* map);
+
+/**@function
+ * @brief Returns the dense darray of values of a dslotmap, in no particular
+ *  order. Values may be modified in place. The darray may move when a value
+ *  is inserted.
+ */
+void* dslotmap_values(const struct dslotmap* map);
+
+/**@function
+ * @brief Returns the handle of the value at position `index` of the darray
+ *  returned by `dslotmap_values`.
+ */
+struct dslotmap_handle dslotmap_handle_at(const struct dslotmap* map,
+    size_t index);
+
+/**@function
+ * @brief Ensure a dslotmap can hold `nvalues` more values without
+ *  reallocating.
+ *
+ * @return `true` on success. `false` on allocation failure.
+ */
+bool dslotmap_reserve(struct dslotmap* map, size_t nvalues)
+    DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Insert a value into a dslotmap.
+ *
+ * @param map : Target dslotmap.
+ * @param value : Pointer to the value to store. If `NULL`, the value is
+ *  zeroed.
+ * @param handle : Set to the handle of the new value. May be `NULL`.
+ *
+ * @return Pointer to the stored value. `NULL` on allocation failure, in which
+ *  case the dslotmap is left untouched.
+ */
+void* dslotmap_insert(struct dslotmap* map, const void* value,
+    struct dslotmap_handle* handle) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Find the value referred to by a handle.
+ *
+ * @return Pointer to the value, or `NULL` if the handle does not refer to a
+ *  value of the dslotmap.
+ */
+void* dslotmap_get(const struct dslotmap* map, struct dslotmap_handle handle);
+
+/**@function
+ * @brief Erase the value referred to by a handle.
+ *
+ * @return `true` if a value was erased, `false` if the handle does not refer
+ *  to a value of the dslotmap.
+ */
+bool dslotmap_erase(struct dslotmap* map, struct dslotmap_handle handle);
+
+/**@function
+ * @brief Erase every value of a dslotmap, invalidating every handle.
+ */
+void dslotmap_clear(struct dslotmap* map);
+
+/////////////////////////////////// DJAGGED ////////////////////////////////////
+/**@struct
+ * @brief Jagged array of rows of fixed-size elements in compressed sparse row
+ *  layout. The elements of every row are stored back to back in one values
+ *  darray, and an offsets darray records where each row begins, so a jagged
+ *  array costs two allocations no matter how many rows it holds and walking
+ *  its rows in order is a linear scan. Only the last row can grow.
+ */
+struct djagged;
+
+/**@function
+ * @brief Allocate a djagged with no rows.
+ *
+ * @param elem_size : Size of an element in bytes.
+ *
+ * @return Pointer to the new djagged on success. `NULL` on allocation
+ *  failure.
+ */
+struct djagged* djagged_alloc(size_t elem_size) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Same as `djagged_alloc`, but all memory allocation, reallocation,
+ *  and freeing will be handled using the provided memory management
+ *  functions.
+ */
+struct djagged* djagged_alloc_custom(struct da_mem_funcs mem_funcs,
+    size_t elem_size) DA_WARN_UNUSED_RESULT;
+
+/**@function
+ * @brief Free a djagged.
+ *
+ * @param jag : Djagged to free. May be `NULL`.
+ */
+void djagged_free(struct djagged* jag);
+
+/**@function
+ * @brief Returns the number of rows in a djagged.
+ */
+size_t djagged_nrows(const struct djagged* jag);
+
+/**@function
+ * @brief Returns the total number of elements in all rows of a djagged.
+ */
+size_t djagged_length(const struct djagged* jag);
+
+/**@function
+ * @brief Returns the darray of the elements of every row of a djagged, row
+ *  after row. Elements may be modified in place. The darray may move when
+ *  elements are added.
+ */
+void* djagged_values(const struct djagged* jag);
+
+/**@function
+ * @brief Returns the darray of `djagged_nrows(jag) + 1` offsets of a djagged.
+ *  Row `row` holds the elements of `djagged_values(jag)` at indices
+ *  [`offsets[row]`, `offsets[row+1]`). The darray may move when rows are
+ *  added.
+ */
+const size_t* djagged_offsets(const struct djagged* jag);
 
 /**@function
- * @brief Allocate a dstring as a copy of dstring `src`. Faster than
- *  `dstr_alloc_cstr_custom` when copying a dstring. All memory allocation,
- *  reallocation, and freeing will be handled using the provided memory
- *  management functions for this dstring.
- *
- * @param mem_funcs : Memory management functions.
- * @param src : dstring to copy.
- *
- * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ * @brief Returns a pointer to the first element of row `row` of a djagged,
+ *  usable as a plain array of `djagged_row_length(jag, row)` elements. The
+ *  pointer is invalidated when elements are added.
  */
-darray(char) dstr_alloc_dstr_custom(struct da_mem_funcs mem_funcs,
-    const darray(char) src) DA_WARN_UNUSED_RESULT;
+void* djagged_row(const struct djagged* jag, size_t row);
 
 /**@function
- * @brief Allocate a dstring using `sprintf` style formatting. All memory
- *  allocation, reallocation, and freeing will be handled using the provided
- *  memory management functions for this dstring.
- *
- * @param mem_funcs : Memory management functions.
- * @param format : `sprintf` style format string.
- * @param ... : va arg list for the format string.
- *
- * @return Pointer to a new dstring on success. `NULL` on allocation failure.
+ * @brief Returns the number of elements in row `row` of a djagged.
  */
-darray(char) dstr_alloc_format_custom(struct da_mem_funcs mem_funcs,
-    const char* format, ...) DA_WARN_UNUSED_RESULT;
+size_t djagged_row_length(const struct djagged* jag, size_t row);
 
 /**@function
- * @brief Free a dstring. Equivalent to calling `da_free` on `dstr`.
- *
- * @param dstr : dstring to free.
+ * @brief Returns the indices of the elements of row `row` in the darray
+ *  returned by `djagged_values`, for use with ranged darray functions such
+ *  as `da_reverse_range`.
  */
-void dstr_free(darray(char) dstr);
+struct da_range djagged_row_range(const struct djagged* jag, size_t row);
 
 /**@function
- * @brief Reassign the contents of an allocated dstring to the empty string
- *  `""`, reallocating memory only when neccesary.
- *
- * @param allocated_dstr : Dstring containing memory allocated by one of the
- *  dstr_alloc functions.
+ * @brief Ensure a djagged can hold `nrows` more rows and `nelem` more
+ *  elements without reallocating.
  *
- * @return Pointer to the reassigned dstring on success. `NULL` on allocation
- *  failure.
+ * @return `true` on success. `false` on allocation failure.
  */
-darray(char) dstr_reassign_empty(darray(char) allocated_dstr)
+bool djagged_reserve(struct djagged* jag, size_t nrows, size_t nelem)
     DA_WARN_UNUSED_RESULT;
 
 /**@function
- * @brief Reassign the contents of an allocated dstring to that of a cstring,
- *  reallocating memory only when neccesary.
+ * @brief Append a row to a djagged.
  *
- * @param allocated_dstr : Dstring containing memory allocated by one of the
- *  dstr_alloc functions.
- * @param src : string to copy.
+ * @param jag : Target djagged.
+ * @param src : Array of `nelem` elements making up the new row. If `NULL`,
+ *  the elements are zeroed.
+ * @param nelem : Number of elements in the new row. May be zero.
  *
- * @return Pointer to the reassigned dstring on success. `NULL` on allocation
- *  failure.
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  djagged is left untouched.
  */
-darray(char) dstr_reassign_cstr(darray(char) allocated_dstr, const char* src)
+bool djagged_push_row(struct djagged* jag, const void* src, size_t nelem)
     DA_WARN_UNUSED_RESULT;
 
 /**@function
- * @brief Reassign the contents of an allocated dstring to that of a dstring,
- *  reallocating memory only when neccesary.
+ * @brief Append elements to the last row of a djagged, which must have at
+ *  least one row.
  *
- * @param allocated_dstr : Dstring containing memory allocated by one of the
- *  dstr_alloc functions.
- * @param src : dstring to copy.
+ * @param jag : Target djagged.
+ * @param src : Array of `nelem` elements to append. If `NULL`, the elements
+ *  are zeroed.
+ * @param nelem : Number of elements to append.
  *
- * @return Pointer to the reassigned dstring on success. `NULL` on allocation
- *  failure.
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  djagged is left untouched.
  */
-darray(char) dstr_reassign_dstr(darray(char) allocated_dstr,
-    const darray(char) src) DA_WARN_UNUSED_RESULT;
+bool djagged_append(struct djagged* jag, const void* src, size_t nelem)
+    DA_WARN_UNUSED_RESULT;
 
 /**@function
- * @brief Reassign the contents of an allocated dstring using `sprintf` style
- *  formatting, reallocating memory only when neccesary.
+ * @brief Append one element to the last row of a djagged, which must have at
+ *  least one row.
  *
- * @param allocated_dstr : Dstring containing memory allocated by one of the
- *  dstr_alloc functions.
- * @param format : `sprintf` style format string.
- * @param ... : va arg list for the format string.
+ * @param jag : Target djagged.
+ * @param elem : Pointer to the element to append. If `NULL`, the element is
+ *  zeroed.
  *
- * @return Pointer to the reassigned dstring on success. `NULL` on allocation
- *  failure.
+ * @return Pointer to the stored element. `NULL` on allocation failure, in
+ *  which case the djagged is left untouched.
  */
-darray(char) dstr_reassign_format(darray(char) allocated_dstr,
-    const char* format, ...) DA_WARN_UNUSED_RESULT;
+void* djagged_push(struct djagged* jag, const void* elem)
+    DA_WARN_UNUSED_RESULT;
 
 /**@function
- * @brief Returns the length of `dstr` without its null terminator. Equivalent
- *  to `da_length(dstr)-1`. O(1) compared to the O(n) `strlen`.
- *
- * @param dstr : Target dstring.
- *
- * @return Length of `dstr` without its null terminator.
+ * @brief Remove the last row of a djagged, which must have at least one row.
  */
-size_t dstr_length(const darray(char) dstr);
+void djagged_pop_row(struct djagged* jag);
 
 /**@function
- * @brief Append character `c` to dstring `dest`.
- *
- * @param dest : Target dstring that will be appended to. Like `da_concat`
- *  references to `dest` may be invalidated across the function call. Use the
- *  return value of `dstr_concat_char` as truth for the location of `dest` after
- *  function completion.
- * @param c : character to append to `dest`.
- *
- * @return Pointer to the new location of the dstring upon successful function
- *  completion. If `dstr_concat_char` returns `NULL`, reallocation failed and
- *  `dstr` is left untouched.
+ * @brief Remove every row of a djagged.
  */
-darray(char) dstr_concat_char(darray(char) dest, char c) DA_WARN_UNUSED_RESULT;
+void djagged_clear(struct djagged* jag);
 
 /**@function
- * @brief Append `src` to dstring `dest`. `src` may also be a dstring.
+ * @brief Allocate a djagged holding the rows of a darray of darrays. The
+ *  djagged uses the memory management functions of `rows`.
  *
- * @param dest : Target dstring that will be appended to. Like `da_concat`
- *  references to `dest` may be invalidated across the function call. Use the
- *  return value of `dstr_concat_cstr` as truth for the location of `dest` after
- *  function completion.
- * @param src : cstring to append to `dest`.
+ * @param rows : Darray of row darrays whose elements are `elem_size` bytes.
+ * @param elem_size : Size of an element in bytes. Passed explicitly so that
+ *  `rows` may be empty.
  *
- * @return Pointer to the new location of the dstring upon successful function
- *  completion. If `dstr_concat_cstr` returns `NULL`, reallocation failed and
- *  `dstr` is left untouched.
+ * @return Pointer to the new djagged on success. `NULL` on allocation
+ *  failure.
  */
-darray(char) dstr_concat_cstr(darray(char) dest, const char* src)
+struct djagged* djagged_from_nested(const void* rows, size_t elem_size)
     DA_WARN_UNUSED_RESULT;
 
 /**@function
- * @brief Append `src` to dstring `dest`. Faster than `dstr_concat_cstr` for
- *  cat-ing a dstring to another dstring.
+ * @brief Allocate a darray of darrays holding the rows of a djagged. The
+ *  outer darray and every row darray use the memory management functions of
+ *  the djagged, and each row darray must be freed with `da_free` before the
+ *  outer darray.
  *
- * @param dest : Target dstring that will be appended to. Like `da_concat`
- *  references to `dest` may be invalidated across the function call. Use the
- *  return value of `dstr_concat_dstr` as truth for the location of `dest` after
- *  function completion.
- * @param src : dstring to append to `dest`.
+ * @return Pointer to the new darray of row darrays on success. `NULL` on
+ *  allocation failure.
  */
-darray(char) dstr_concat_dstr(darray(char) dest, const darray(char) src)
-    DA_WARN_UNUSED_RESULT;
+void* djagged_to_nested(const struct djagged* jag) DA_WARN_UNUSED_RESULT;
 
-/**@function
- * @brief Append a string to dstring `dest` using `sprintf` style formatting.
- *
- * @param dest : Target dstring that will be appended to. Like `da_concat`
- *  references to `dest` may be invalidated across the function call. Use the
- *  return value of `dstr_concat_format` as truth for the location of `dest`
- *  after function completion.
- * @param format : `sprintf` style format string.
- * @param ... : va arg list for the format string.
+/////////////////////////////////// DPACKED ////////////////////////////////////
+/**@struct
+ * @brief Darray of unsigned integers packed at a fixed bit width. Element `i`
+ *  occupies bits [`i*width`, `(i+1)*width`) of a darray of 64-bit words, so
+ *  a column of 12-bit values takes 12 bits per element instead of 32.
+ *  Storing a value that does not fit in the current width widens every
+ *  element to the width of that value.
  */
-darray(char) dstr_concat_format(darray(char) dest, const char* format, ...)
-    DA_WARN_UNUSED_RESULT;
+struct dpacked;
 
 /**@function
- * @brief Comparison function. Currently functionally equivalent to `strcmp`.
+ * @brief Allocate an empty dpacked.
  *
- * @param s1 : First dstring.
- * @param s2 : Second dstring.
+ * @param width : Initial number of bits per element, between 1 and 64.
  *
- * @return `strcmp` style comparison of `s1` and `s2`.
+ * @return Pointer to the new dpacked on success. `NULL` on allocation
+ *  failure.
  */
-int dstr_cmp(const darray(char) s1, const char* s2);
+struct dpacked* dpacked_alloc(unsigned width) DA_WARN_UNUSED_RESULT;
 
 /**@function
- * @brief Comparison function. Currently functionally equivalent to
- *  `strcasecmp`.
- *
- * @param s1 : First dstring.
- * @param s2 : Second dstring.
- *
- * @return `strcmp` style comparison of `s1` and `s2`.
+ * @brief Same as `dpacked_alloc`, but all memory allocation, reallocation,
+ *  and freeing will be handled using the provided memory management
+ *  functions.
  */
-int dstr_cmp_case(const darray(char) s1, const char* s2);
+struct dpacked* dpacked_alloc_custom(struct da_mem_funcs mem_funcs,
+    unsigned width) DA_WARN_UNUSED_RESULT;
 
 /**@function
- * @brief Returns the index of the first occurrence of `substr` in `dstr` or
- *  -1 if `substr` was not found. Similar to Python's `str.find`.
+ * @brief Free a dpacked.
  *
- * @param dstr : Target dstring to search.
- * @param substr : Target substring to find in `dstr`.
- *
- * @return Index of the first occurence of `substr` if `substr` was found. `-1`
- *  if  substr was not found.
+ * @param packed : Dpacked to free. May be `NULL`.
  */
-long dstr_find(darray(char) dstr, const char* substr);
+void dpacked_free(struct dpacked* packed);
 
 /**@function
- * @brief Returns the index of the first case insensitive occurrence of
- *  `substr` in `dstr` or -1 if `substr` was not found. Similar to Python's
- *  `str.find`.
- *
- * @param dstr : Target dstring to search.
- * @param substr : Target substring to find in `dstr`.
- *
- * @return Index of the first occurence of `substr` if `substr` was found. `-1`
- *  if substr was not found.
+ * @brief Returns the number of elements in a dpacked.
  */
-long dstr_find_case(darray(char) dstr, const char* substr);
+size_t dpacked_length(const struct dpacked* packed);
 
 /**@function
- * @brief Replace all occurrences of `substr` in `dstr` with `new_str`.
- *
- * @param dstr : Target dstring. Upon function completion, `dstr` may or may not
- *  point to its previous block on the heap, potentially breaking references.
- * @param substr : Substring in `dstr` that will be replaces.
- * @param new_substr : String that will replace `substr`.
- *
- * @return The new location of `dstr` after function completion. If
- *  `dstr_replace_all` returns `NULL` reallocation failed somewhere and `dstr`
- *  may be corrupted.
+ * @brief Returns the number of bits per element of a dpacked.
  */
-darray(char) dstr_replace_all(darray(char) dstr, const char* substr,
-    const char* new_str) DA_WARN_UNUSED_RESULT;
+unsigned dpacked_width(const struct dpacked* packed);
 
 /**@function
- * @brief Replace all occurrences of `substr` (case insensitive) in `dstr` with
- *  `new_str`.
- *
- * @param dstr : Target dstring. Upon function completion, `dstr` may or may not
- *  point to its previous block on the heap, potentially breaking references.
- * @param substr : Substring in `dstr` that will be replaces.
- * @param new_substr : String that will replace `substr`.
+ * @brief Ensure a dpacked can hold `nelem` more elements at its current width
+ *  without reallocating.
  *
- * @return The new location of `dstr` after function completion. If
- *  `dstr_replace_all_case` returns `NULL` reallocation failed somewhere and
- *  `dstr` may be corrupted.
+ * @return `true` on success. `false` on allocation failure.
  */
-darray(char) dstr_replace_all_case(darray(char) dstr, const char* substr,
-    const char* new_str) DA_WARN_UNUSED_RESULT;
+bool dpacked_reserve(struct dpacked* packed, size_t nelem)
+    DA_WARN_UNUSED_RESULT;
 
 /**@function
- * @brief Transform `dstr` to lower case in place.
- *
- * @param dstr : Target dstring to transform.
+ * @brief Returns element `index` of a dpacked.
  */
-void dstr_transform_lower(darray(char) dstr);
+uint64_t dpacked_get(const struct dpacked* packed, size_t index);
 
 /**@function
- * @brief Transform `dstr` to upper case in place.
+ * @brief Set element `index` of a dpacked to `value`, widening the dpacked
+ *  first if `value` does not fit in its width.
  *
- * @param dstr : Target dstring to transform.
+ * @return `true` on success. `false` on allocation failure while widening,
+ *  in which case the dpacked is left untouched.
  */
-void dstr_transform_upper(darray(char) dstr);
+bool dpacked_set(struct dpacked* packed, size_t index, uint64_t value)
+    DA_WARN_UNUSED_RESULT;
 
 /**@function
- * @brief Read an entire line from `stream` and store it in `dstr`. Equivalent
- *  to calling `dstr_getdelim` with `delim == '\n'`.
- *
- * @param allocated_dstr : Dstring containing memory allocated by one of the
- *  dstr_alloc functions.
- * @param stream : Input stream opened for reading.
+ * @brief Append `value` to a dpacked, widening the dpacked first if `value`
+ *  does not fit in its width.
  *
- * @return The new location of `allocated_dstr` after function completion.`NULL`
- *  on failure (including end-of-file condition).
+ * @return `true` on success. `false` on allocation failure, in which case the
+ *  dpacked is left untouched.
  */
-darray(char) dstr_getline(darray(char) allocated_dstr, FILE* stream)
+bool dpacked_push(struct dpacked* packed, uint64_t value)
     DA_WARN_UNUSED_RESULT;
 
 /**@function
- * @brief Read characters from `stream` up to but not including `delim` and
- *  store them in `dstr`.
+ * @brief Remove every element of a dpacked. The width is kept.
+ */
+void dpacked_clear(struct dpacked* packed);
+
+/**@function
+ * @brief Allocate a dpacked holding the elements of a darray of unsigned
+ *  integers, at the smallest width that fits its largest element. The dpacked
+ *  uses the memory management functions of `darr`.
  *
- * @param allocated_dstr : Dstring containing memory allocated by one of the
- *  dstr_alloc functions.
- * @param delim : Character denoting end-of-read. If delim is set to EOF,
- *  `dstr_getdelim` will read all characters from a stream.
- * @param stream : Input stream opened for reading.
+ * @param darr : Darray of `uint8_t`, `uint16_t`, `uint32_t`, or `uint64_t`.
  *
- * @return The new location of `allocated_dstr` after function completion.`NULL`
- *  on failure (including end-of-file condition if `delim != EOF`).
+ * @return Pointer to the new dpacked on success. `NULL` on allocation
+ *  failure.
  */
-darray(char) dstr_getdelim(darray(char) allocated_dstr, int delim, FILE* stream)
-    DA_WARN_UNUSED_RESULT;
+struct dpacked* dpacked_from_darray(const void* darr) DA_WARN_UNUSED_RESULT;
 
 /**@function
- * @brief Trims leading and trailing whitespace from `dstr`.
+ * @brief Allocate a darray holding the elements of a dpacked. The darray uses
+ *  the memory management functions of the dpacked.
  *
- * @param : Target dstring. Upon function completion, `dstr` may or may not
- *  point to its previous block on the heap, potentially breaking references.
+ * @param elem_size : Size of the unsigned integer elements of the new darray:
+ *  1, 2, 4, or 8. Elements wider than `elem_size` bytes are truncated.
  *
- * @return The new location of `dstr` after function completion. If `dstr_trim`
- *  returns `NULL` reallocation failed and `dstr` is left untouched.
+ * @return Pointer to the new darray on success. `NULL` on allocation failure.
+ *
+ * @note Unpacking into 32-bit elements from a width of at most 25 bits uses
+ *  AVX2 when the CPU supports it, decoding eight elements per iteration.
  */
-darray(char) dstr_trim(darray(char) dstr) DA_WARN_UNUSED_RESULT;
+void* dpacked_to_darray(const struct dpacked* packed, size_t elem_size)
+    DA_WARN_UNUSED_RESULT;
 
 /////////////////////////////////// INTERNAL ///////////////////////////////////
 struct _darray
@@ -740,6 +3001,23 @@ struct _darray
 #define DA_NEW_CAPACITY_FROM_LENGTH(length) ((length) < DA_CAPACITY_MIN ? \
     DA_CAPACITY_MIN : ((length)*DA_CAPACITY_FACTOR))
 
+#define _DA_OFFSET_OF_MEMBER(darr_h, member) \
+    ((size_t)((char*)&(darr_h)->member - (char*)(darr_h)))
+
+#define _DA_KEY_TYPE_SIGNED(type) \
+    (sizeof(type) == 4 ? DA_KEY_I32 : DA_KEY_I64)
+#define _DA_KEY_TYPE_UNSIGNED(type) \
+    (sizeof(type) == 4 ? DA_KEY_U32 : DA_KEY_U64)
+#define _DA_KEY_TYPE_OF(expr) _Generic((expr),                  \
+    int: _DA_KEY_TYPE_SIGNED(int),                               \
+    unsigned: _DA_KEY_TYPE_UNSIGNED(unsigned),                   \
+    long: _DA_KEY_TYPE_SIGNED(long),                             \
+    unsigned long: _DA_KEY_TYPE_UNSIGNED(unsigned long),         \
+    long long: _DA_KEY_TYPE_SIGNED(long long),                   \
+    unsigned long long: _DA_KEY_TYPE_UNSIGNED(unsigned long long), \
+    float: DA_KEY_F32,                                           \
+    double: DA_KEY_F64)
+
 #define DA_P_HEAD_FROM_HANDLE(darr_h) (((char*)darr_h)-sizeof(struct _darray))
 #define DA_P_SIZEOF_ELEM_FROM_HANDLE(darr_h) ((size_t*) \
     (DA_P_HEAD_FROM_HANDLE(darr_h) + offsetof(struct _darray, _elemsz)))
@@ -828,6 +3106,88 @@ do                                                                             \
         _darr[_indx] = _value;                                                 \
 }while(0)
 
+#define /* long */_da_find_val(/* ELEM_TYPE* */darr, /* ELEM_TYPE */value)     \
+({                                                                             \
+    __auto_type _darr = darr;                                                  \
+    __typeof__(*_darr) _value = value;                                         \
+    /* return */da_find(_darr, &_value);                                       \
+})
+
+#define /* size_t */_da_count_val(/* ELEM_TYPE* */darr, /* ELEM_TYPE */value)  \
+({                                                                             \
+    __auto_type _darr = darr;                                                  \
+    __typeof__(*_darr) _value = value;                                         \
+    /* return */da_count(_darr, &_value);                                      \
+})
+
+#define /* bool */_da_contains_val(/* ELEM_TYPE* */darr, /* ELEM_TYPE */value) \
+({                                                                             \
+    __auto_type _darr = darr;                                                  \
+    __typeof__(*_darr) _value = value;                                         \
+    /* return */da_contains(_darr, &_value);                                   \
+})
+
+#define /* size_t */_da_lower_bound_val(/* ELEM_TYPE* */darr,                  \
+    /* ELEM_TYPE */value, cmp)                                                 \
+({                                                                             \
+    __auto_type _darr = darr;                                                  \
+    __typeof__(*_darr) _value = value;                                         \
+    /* return */da_lower_bound(_darr, &_value, cmp);                           \
+})
+
+#define /* size_t */_da_upper_bound_val(/* ELEM_TYPE* */darr,                  \
+    /* ELEM_TYPE */value, cmp)                                                 \
+({                                                                             \
+    __auto_type _darr = darr;                                                  \
+    __typeof__(*_darr) _value = value;                                         \
+    /* return */da_upper_bound(_darr, &_value, cmp);                           \
+})
+
+#define /* struct da_range */_da_equal_range_val(/* ELEM_TYPE* */darr,         \
+    /* ELEM_TYPE */value, cmp)                                                 \
+({                                                                             \
+    __auto_type _darr = darr;                                                  \
+    __typeof__(*_darr) _value = value;                                         \
+    /* return */da_equal_range(_darr, &_value, cmp);                           \
+})
+
+#define /* ELEM_TYPE* */_da_insert_sorted_val(/* ELEM_TYPE* */darr,            \
+    /* ELEM_TYPE */value, cmp)                                                 \
+({                                                                             \
+    __auto_type _darr = darr;                                                  \
+    __typeof__(*_darr) _value = value;                                         \
+    _darr = da_insert_sorted(_darr, &_value, cmp);                             \
+    /* return */_darr;                                                         \
+})
+
+#define /* ELEM_TYPE* */_da_heap_push_val(/* ELEM_TYPE* */darr,                \
+    /* ELEM_TYPE */value, cmp, /* size_t */arity)                              \
+({                                                                             \
+    __auto_type _darr = darr;                                                  \
+    __typeof__(*_darr) _value = value;                                         \
+    _darr = da_heap_push(_darr, &_value, cmp, arity);                          \
+    /* return */_darr;                                                         \
+})
+
+#define /* ELEM_TYPE */_da_heap_pop_val(/* ELEM_TYPE* */darr, cmp,             \
+    /* size_t */arity)                                                         \
+({                                                                             \
+    __auto_type _darr = darr;                                                  \
+    __typeof__(*_darr) _out;                                                   \
+    da_heap_pop(_darr, &_out, cmp, arity);                                     \
+    /* return */_out;                                                          \
+})
+
+#define /* ELEM_TYPE */_da_heap_replace_val(/* ELEM_TYPE* */darr,              \
+    /* ELEM_TYPE */value, cmp, /* size_t */arity)                              \
+({                                                                             \
+    __auto_type _darr = darr;                                                  \
+    __typeof__(*_darr) _value = value;                                         \
+    __typeof__(*_darr) _out;                                                   \
+    da_heap_replace(_darr, &_value, &_out, cmp, arity);                        \
+    /* return */_out;                                                          \
+})
+
 #define DA_MERGE_IDENTIFIER_HELPER(a, b) a##b
 #define DA_MERGE_IDENTIFIER(a, b) DA_MERGE_IDENTIFIER_HELPER(a, b)
 
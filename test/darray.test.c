@@ -37,6 +37,26 @@ struct da_mem_funcs custom_mem_funcs = {
     .free_f=custom_free
 };
 
+// Records the size of the largest allocation, to check memory footprints.
+size_t largest_alloc;
+void* largest_malloc(size_t size)
+{
+    largest_alloc = size > largest_alloc ? size : largest_alloc;
+    return malloc(size);
+}
+
+void* largest_realloc(void* ptr, size_t size)
+{
+    largest_alloc = size > largest_alloc ? size : largest_alloc;
+    return realloc(ptr, size);
+}
+
+struct da_mem_funcs largest_mem_funcs = {
+    .alloc_f=largest_malloc,
+    .realloc_f=largest_realloc,
+    .free_f=free
+};
+
 EMU_TEST(da_length)
 {
     struct _darray dastruct;
@@ -448,6 +468,226 @@ EMU_TEST(da_swap)
     EMU_END_TEST();
 }
 
+EMU_TEST(da_reverse__int)
+{
+    int* da = da_alloc(0, sizeof(int));
+    da_reverse(da); // empty darray
+    EMU_REQUIRE_EQ_UINT(da_length(da), 0);
+
+    for (int len = 1; len <= 9; ++len)
+    {
+        da = da_resize(da, len);
+        for (int i = 0; i < len; ++i)
+            da[i] = i;
+        da_reverse(da);
+        for (int i = 0; i < len; ++i)
+            EMU_EXPECT_EQ_INT(da[i], len-1-i);
+    }
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+struct three_bytes
+{
+    char c[3];
+};
+
+EMU_TEST(da_reverse__odd_element_size)
+{
+    const size_t len = 7;
+    struct three_bytes* da = da_alloc(len, sizeof(struct three_bytes));
+    for (size_t i = 0; i < len; ++i)
+        da[i] = (struct three_bytes){{i, i+1, i+2}};
+
+    da_reverse(da);
+    for (size_t i = 0; i < len; ++i)
+    {
+        EMU_EXPECT_EQ_INT(da[i].c[0], len-1-i);
+        EMU_EXPECT_EQ_INT(da[i].c[1], len-i);
+        EMU_EXPECT_EQ_INT(da[i].c[2], len+1-i);
+    }
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_reverse_range)
+{
+    int* da = da_alloc(8, sizeof(int));
+    for (size_t i = 0; i < da_length(da); ++i)
+        da[i] = i;
+
+    da_reverse_range(da, 2, 4);
+    int expected[] = {0, 1, 5, 4, 3, 2, 6, 7};
+    for (size_t i = 0; i < da_length(da); ++i)
+        EMU_EXPECT_EQ_INT(da[i], expected[i]);
+
+    da_reverse_range(da, 0, 0);
+    for (size_t i = 0; i < da_length(da); ++i)
+        EMU_EXPECT_EQ_INT(da[i], expected[i]);
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(da_reverse)
+{
+    EMU_ADD(da_reverse__int);
+    EMU_ADD(da_reverse__odd_element_size);
+    EMU_ADD(da_reverse_range);
+    EMU_END_GROUP();
+}
+
+EMU_TEST(da_rotate__short_and_long_rotations)
+{
+    // Long enough that both the memmove and block swap paths are taken.
+    const size_t len = 1000;
+    int* da = da_alloc(len, sizeof(int));
+
+    size_t ks[] = {0, 1, 3, 64, 65, 333, 500, 936, 999, 1000, 1001, 2500};
+    for (size_t n = 0; n < sizeof(ks)/sizeof(ks[0]); ++n)
+    {
+        for (size_t i = 0; i < len; ++i)
+            da[i] = i;
+        da_rotate(da, ks[n]);
+        for (size_t i = 0; i < len; ++i)
+            EMU_EXPECT_EQ_INT(da[i], (i + ks[n]) % len);
+    }
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_rotate__empty)
+{
+    int* da = da_alloc(0, sizeof(int));
+    da_rotate(da, 3);
+    EMU_EXPECT_EQ_UINT(da_length(da), 0);
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_rotate_range)
+{
+    int* da = da_alloc(8, sizeof(int));
+    for (size_t i = 0; i < da_length(da); ++i)
+        da[i] = i;
+
+    da_rotate_range(da, 1, 5, 2);
+    int expected[] = {0, 3, 4, 5, 1, 2, 6, 7};
+    for (size_t i = 0; i < da_length(da); ++i)
+        EMU_EXPECT_EQ_INT(da[i], expected[i]);
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(da_rotate)
+{
+    EMU_ADD(da_rotate__short_and_long_rotations);
+    EMU_ADD(da_rotate__empty);
+    EMU_ADD(da_rotate_range);
+    EMU_END_GROUP();
+}
+
+struct tagged
+{
+    int key;
+    int tag;
+};
+
+bool tagged_eq(const void* a, const void* b)
+{
+    return ((const struct tagged*)a)->key == ((const struct tagged*)b)->key;
+}
+
+size_t tagged_hash(const void* a)
+{
+    return (size_t)((const struct tagged*)a)->key;
+}
+
+EMU_TEST(da_unique)
+{
+    darray(int) da = da_alloc(0, sizeof(int));
+    EMU_REQUIRE_NOT_NULL(da);
+    da_unique(da, NULL);
+    EMU_EXPECT_EQ_UINT(da_length(da), 0);
+    da_free(da);
+
+    int vals[] = {1, 1, 2, 3, 3, 3, 4, 5, 5};
+    int expected[] = {1, 2, 3, 4, 5};
+    da = da_alloc(sizeof(vals)/sizeof(int), sizeof(int));
+    memcpy(da, vals, sizeof(vals));
+    da_unique(da, NULL);
+    EMU_REQUIRE_EQ_UINT(da_length(da), sizeof(expected)/sizeof(int));
+    EMU_EXPECT_EQ_INT(memcmp(da, expected, sizeof(expected)), 0);
+    da_free(da);
+
+    struct tagged* tda = da_alloc(6, sizeof(struct tagged));
+    for (size_t i = 0; i < da_length(tda); ++i)
+    {
+        tda[i].key = (int)i / 2;
+        tda[i].tag = (int)i;
+    }
+    da_unique(tda, tagged_eq);
+    EMU_REQUIRE_EQ_UINT(da_length(tda), 3);
+    for (size_t i = 0; i < da_length(tda); ++i)
+    {
+        EMU_EXPECT_EQ_INT(tda[i].key, (int)i);
+        EMU_EXPECT_EQ_INT(tda[i].tag, (int)i * 2);
+    }
+    da_free(tda);
+
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_dedupe__first_occurrence_order)
+{
+    const size_t nelem = 3000;
+    darray(int) da = da_alloc(nelem, sizeof(int));
+    int* expected = malloc(nelem*sizeof(int));
+    size_t nexpected = 0;
+    for (size_t i = 0; i < nelem; ++i)
+    {
+        da[i] = rand() % 500;
+        bool seen = false;
+        for (size_t j = 0; j < nexpected; ++j)
+            seen = seen || expected[j] == da[i];
+        if (!seen)
+            expected[nexpected++] = da[i];
+    }
+    EMU_REQUIRE_TRUE(da_dedupe(da, NULL, NULL));
+    EMU_REQUIRE_EQ_UINT(da_length(da), nexpected);
+    EMU_EXPECT_EQ_INT(memcmp(da, expected, nexpected*sizeof(int)), 0);
+    free(expected);
+    da_free(da);
+
+    struct tagged* tda = da_alloc(nelem, sizeof(struct tagged));
+    for (size_t i = 0; i < nelem; ++i)
+    {
+        tda[i].key = (int)(i % 7);
+        tda[i].tag = (int)i;
+    }
+    EMU_REQUIRE_TRUE(da_dedupe(tda, tagged_hash, tagged_eq));
+    EMU_REQUIRE_EQ_UINT(da_length(tda), 7);
+    for (size_t i = 0; i < da_length(tda); ++i)
+    {
+        EMU_EXPECT_EQ_INT(tda[i].key, (int)i);
+        EMU_EXPECT_EQ_INT(tda[i].tag, (int)i);
+    }
+    da_free(tda);
+
+    EMU_END_TEST();
+}
+
+EMU_GROUP(da_dedupe)
+{
+    EMU_ADD(da_unique);
+    EMU_ADD(da_dedupe__first_occurrence_order);
+    EMU_END_GROUP();
+}
+
 EMU_TEST(da_concat__darray_cat)
 {
     int* src = da_alloc(2, sizeof(int));
@@ -587,84 +827,1329 @@ EMU_TEST(da_foreach__iterates_through_all_elements)
     {
         EMU_EXPECT_EQ_INT(da[i], i + 1);
     }
-
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_foreach__iterates_forward)
+{
+    int* da = da_alloc(INITIAL_NUM_ELEMS, sizeof(int));
+
+    for (size_t i = 0; i < da_length(da); ++i){da[i] = i;}
+    int last = -1;
+    da_foreach(da, iter)
+    {
+        EMU_EXPECT_GE_INT(*iter, last);
+        last = *iter;
+    }
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_foreach__iterates_once_per_element)
+{
+    int* da = da_alloc(INITIAL_NUM_ELEMS, sizeof(int));
+
+    unsigned counter = 0;
+    da_foreach(da, iter)
+    {
+        counter += 1;
+    }
+    EMU_EXPECT_EQ_UINT(counter, INITIAL_NUM_ELEMS);
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_foreach__nested_darrays)
+{
+    int** nested = da_alloc_exact(INITIAL_NUM_ELEMS, sizeof(int*));
+    da_foreach(nested, iter)
+    {
+        *iter = da_alloc(INITIAL_NUM_ELEMS, sizeof(int*));
+    }
+
+    unsigned counter = 0;
+    da_foreach(nested, row)
+    {
+        da_foreach(*row, col)
+        {
+            counter += 1;
+        }
+    }
+    EMU_EXPECT_EQ_UINT(counter, INITIAL_NUM_ELEMS*INITIAL_NUM_ELEMS);
+
+    da_foreach(nested, iter)
+    {
+        da_free(*iter);
+    }
+    da_free(nested);
+    EMU_END_TEST();
+}
+
+struct pfor_elem
+{
+    size_t index;
+    int visits;
+    char pad[11];
+};
+
+static void pfor_visit(void* elem, size_t index, void* ctx)
+{
+    (void)ctx;
+    struct pfor_elem* e = elem;
+    e->index = index;
+    e->visits += 1;
+}
+
+EMU_TEST(da_parallel_for__visits_each_element_once)
+{
+    size_t thread_counts[] = {0, 1, 3, 8};
+    size_t chunk_sizes[] = {0, 1, 100};
+    darray(struct pfor_elem) da = da_alloc(10007, sizeof(struct pfor_elem));
+    for (size_t t = 0; t < sizeof(thread_counts)/sizeof(*thread_counts); ++t)
+    {
+        for (size_t c = 0; c < sizeof(chunk_sizes)/sizeof(*chunk_sizes); ++c)
+        {
+            memset(da, 0, da_length(da)*sizeof(struct pfor_elem));
+            struct da_parallel_opts opts = {
+                .nthreads = thread_counts[t],
+                .chunk_size = chunk_sizes[c]
+            };
+            da_parallel_for(da, pfor_visit, NULL, &opts);
+            bool all_once = true;
+            for (size_t i = 0; i < da_length(da); ++i)
+                all_once = all_once && da[i].visits == 1 && da[i].index == i;
+            EMU_EXPECT_TRUE(all_once);
+        }
+    }
+    da_parallel_for(da, pfor_visit, NULL, NULL);
+    EMU_EXPECT_EQ_INT(da[10006].visits, 2);
+
+    da = da_resize(da, 0);
+    da_parallel_for(da, pfor_visit, NULL, NULL);
+    da_free(da);
+    EMU_END_TEST();
+}
+
+static void pfor_increment(void* elem, size_t index, void* ctx)
+{
+    (void)index;
+    (void)ctx;
+    *(int*)elem += 1;
+}
+
+static void pfor_increment_row(void* elem, size_t index, void* ctx)
+{
+    (void)index;
+    (void)ctx;
+    // Nested parallel calls run on the calling thread.
+    da_parallel_for(*(darray(int)*)elem, pfor_increment, NULL,
+        &(struct da_parallel_opts){.nthreads = 4});
+}
+
+EMU_TEST(da_parallel_for__nested_parallel_calls)
+{
+    darray(darray(int)) rows = da_alloc(16, sizeof(darray(int)));
+    for (size_t r = 0; r < da_length(rows); ++r)
+    {
+        rows[r] = da_alloc(1000 + r, sizeof(int));
+        memset(rows[r], 0, da_length(rows[r])*sizeof(int));
+    }
+    da_parallel_for(rows, pfor_increment_row, NULL,
+        &(struct da_parallel_opts){.nthreads = 4, .chunk_size = 1});
+    for (size_t r = 0; r < da_length(rows); ++r)
+    {
+        bool all_once = true;
+        for (size_t i = 0; i < da_length(rows[r]); ++i)
+            all_once = all_once && rows[r][i] == 1;
+        EMU_EXPECT_TRUE(all_once);
+        da_free(rows[r]);
+    }
+    da_free(rows);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(da_foreach)
+{
+    EMU_ADD(da_foreach__iterates_through_all_elements);
+    EMU_ADD(da_foreach__iterates_forward);
+    EMU_ADD(da_foreach__iterates_once_per_element);
+    EMU_ADD(da_foreach__nested_darrays);
+    EMU_ADD(da_parallel_for__visits_each_element_once);
+    EMU_ADD(da_parallel_for__nested_parallel_calls);
+    EMU_END_GROUP();
+}
+
+struct map_elem
+{
+    int id;
+    double weight;
+};
+
+static void map_weight(void* out, const void* in, void* ctx)
+{
+    const struct map_elem* e = in;
+    *(double*)out = e->weight * *(double*)ctx;
+}
+
+EMU_TEST(da_map)
+{
+    darray(struct map_elem) src = da_alloc(100, sizeof(struct map_elem));
+    for (size_t i = 0; i < da_length(src); ++i)
+        src[i] = (struct map_elem){.id = (int)i, .weight = (double)i / 2};
+    double scale = 4.0;
+    darray(double) weights = da_map_to(src, double, map_weight, &scale);
+    EMU_REQUIRE_NOT_NULL(weights);
+    EMU_EXPECT_EQ_UINT(da_length(weights), 100);
+    EMU_EXPECT_EQ_UINT(da_capacity(weights), 100);
+    EMU_EXPECT_EQ_UINT(da_sizeof_elem(weights), sizeof(double));
+    bool all_mapped = true;
+    for (size_t i = 0; i < da_length(weights); ++i)
+        all_mapped = all_mapped && weights[i] == (double)i * 2;
+    EMU_EXPECT_TRUE(all_mapped);
+    EMU_EXPECT_EQ_INT(src[99].id, 99);
+    da_free(weights);
+
+    src = da_resize(src, 0);
+    weights = da_map(src, sizeof(double), map_weight, &scale);
+    EMU_REQUIRE_NOT_NULL(weights);
+    EMU_EXPECT_EQ_UINT(da_length(weights), 0);
+    da_free(weights);
+    da_free(src);
+    EMU_END_TEST();
+}
+
+static void transform_add(void* elem, void* ctx)
+{
+    *(int*)elem += *(int*)ctx;
+}
+
+EMU_TEST(da_transform)
+{
+    darray(int) da = da_alloc(INITIAL_NUM_ELEMS, sizeof(int));
+    for (size_t i = 0; i < da_length(da); ++i)
+        da[i] = (int)i;
+    int addend = 10;
+    da_transform(da, transform_add, &addend);
+    for (size_t i = 0; i < da_length(da); ++i)
+        EMU_EXPECT_EQ_INT(da[i], (int)i + 10);
+    da_free(da);
+    EMU_END_TEST();
+}
+
+int cmp_int(const void* a, const void* b)
+{
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+#define SORT_NUM_ELEMS 2000
+
+void fill_sort_pattern(int* arr, size_t nelem, int pattern)
+{
+    for (size_t i = 0; i < nelem; ++i)
+    {
+        switch (pattern)
+        {
+        case 0: arr[i] = rand(); break;                  // random
+        case 1: arr[i] = i; break;                       // ascending
+        case 2: arr[i] = nelem - i; break;               // descending
+        case 3: arr[i] = 42; break;                      // all equal
+        case 4: arr[i] = rand() % 4; break;              // few unique
+        default: arr[i] = i < nelem/2 ? i : nelem - i;   // organ pipe
+        }
+    }
+}
+
+EMU_TEST(da_sort__patterns)
+{
+    size_t lengths[] = {0, 1, 2, 3, 23, 24, 25, 129, SORT_NUM_ELEMS};
+    for (int pattern = 0; pattern < 6; ++pattern)
+    {
+        for (size_t n = 0; n < sizeof(lengths)/sizeof(lengths[0]); ++n)
+        {
+            int* da = da_alloc(lengths[n], sizeof(int));
+            int* da2 = da_alloc(lengths[n], sizeof(int));
+            int* expected = da_alloc(lengths[n], sizeof(int));
+            fill_sort_pattern(da, lengths[n], pattern);
+            memcpy(da2, da, lengths[n]*sizeof(int));
+            memcpy(expected, da, lengths[n]*sizeof(int));
+            qsort(expected, lengths[n], sizeof(int), cmp_int);
+
+            da_sort(da, cmp_int);
+            da_sort_int(da2);
+            for (size_t i = 0; i < lengths[n]; ++i)
+            {
+                EMU_EXPECT_EQ_INT(da[i], expected[i]);
+                EMU_EXPECT_EQ_INT(da2[i], expected[i]);
+            }
+
+            da_free(da);
+            da_free(da2);
+            da_free(expected);
+        }
+    }
+    EMU_END_TEST();
+}
+
+struct wide_elem
+{
+    int key;
+    char payload[60];
+};
+
+int cmp_wide_elem(const void* a, const void* b)
+{
+    return cmp_int(&((const struct wide_elem*)a)->key,
+        &((const struct wide_elem*)b)->key);
+}
+
+EMU_TEST(da_sort__large_elements)
+{
+    struct wide_elem* da = da_alloc(SORT_NUM_ELEMS, sizeof(struct wide_elem));
+    for (size_t i = 0; i < da_length(da); ++i)
+    {
+        da[i].key = rand() % 100;
+        memset(da[i].payload, da[i].key, sizeof(da[i].payload));
+    }
+
+    da_sort(da, cmp_wide_elem);
+    for (size_t i = 1; i < da_length(da); ++i)
+        EMU_EXPECT_GE_INT(da[i].key, da[i-1].key);
+    for (size_t i = 0; i < da_length(da); ++i)
+        EMU_EXPECT_EQ_INT(da[i].payload[59], da[i].key);
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_sort__scalar_types)
+{
+    double* dbl = da_alloc(SORT_NUM_ELEMS, sizeof(double));
+    for (size_t i = 0; i < da_length(dbl); ++i)
+        dbl[i] = (rand() - RAND_MAX/2) / 7.0;
+    da_sort_double(dbl);
+    for (size_t i = 1; i < da_length(dbl); ++i)
+        EMU_EXPECT_TRUE(dbl[i] >= dbl[i-1]);
+    da_free(dbl);
+
+    unsigned long* ul = da_alloc(SORT_NUM_ELEMS, sizeof(unsigned long));
+    for (size_t i = 0; i < da_length(ul); ++i)
+        ul[i] = ((unsigned long)rand() << 16) ^ rand();
+    da_sort_ulong(ul);
+    for (size_t i = 1; i < da_length(ul); ++i)
+        EMU_EXPECT_GE_UINT(ul[i], ul[i-1]);
+    da_free(ul);
+
+    EMU_END_TEST();
+}
+
+struct keyed_elem
+{
+    char tag;
+    double weight;
+    int id;
+};
+
+EMU_TEST(da_sort_by_key)
+{
+    struct keyed_elem* da = da_alloc(SORT_NUM_ELEMS, sizeof(struct keyed_elem));
+    for (size_t i = 0; i < da_length(da); ++i)
+    {
+        da[i].id = rand() - RAND_MAX/2;
+        da[i].weight = -da[i].id / 3.0;
+        da[i].tag = 't';
+    }
+
+    da_sort_by_key(da, id);
+    for (size_t i = 1; i < da_length(da); ++i)
+        EMU_EXPECT_GE_INT(da[i].id, da[i-1].id);
+
+    da_sort_by_key(da, weight);
+    for (size_t i = 1; i < da_length(da); ++i)
+    {
+        EMU_EXPECT_TRUE(da[i].weight >= da[i-1].weight);
+        EMU_EXPECT_EQ_INT(da[i].tag, 't');
+    }
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_radix_sort__scalar_types)
+{
+    darray(int32_t) i32 = da_alloc(SORT_NUM_ELEMS, sizeof(int32_t));
+    for (size_t i = 0; i < da_length(i32); ++i)
+        i32[i] = rand() - RAND_MAX/2;
+    EMU_REQUIRE_TRUE(da_radix_sort_i32(i32));
+    for (size_t i = 1; i < da_length(i32); ++i)
+        EMU_EXPECT_GE_INT(i32[i], i32[i-1]);
+    da_free(i32);
+
+    // Every byte but the lowest is identical, so most passes are skipped.
+    darray(uint64_t) u64 = da_alloc(SORT_NUM_ELEMS, sizeof(uint64_t));
+    for (size_t i = 0; i < da_length(u64); ++i)
+        u64[i] = UINT64_C(0xABCDEF0000000000) | (uint64_t)(rand() & 0xFF);
+    EMU_REQUIRE_TRUE(da_radix_sort_u64(u64));
+    for (size_t i = 1; i < da_length(u64); ++i)
+        EMU_EXPECT_GE_UINT(u64[i], u64[i-1]);
+    da_free(u64);
+
+    darray(double) f64 = da_alloc(SORT_NUM_ELEMS, sizeof(double));
+    for (size_t i = 0; i < da_length(f64); ++i)
+        f64[i] = (rand() - RAND_MAX/2) / 7.0;
+    f64[0] = -0.0;
+    f64[1] = 0.0;
+    EMU_REQUIRE_TRUE(da_radix_sort_f64(f64));
+    for (size_t i = 1; i < da_length(f64); ++i)
+        EMU_EXPECT_TRUE(f64[i] >= f64[i-1]);
+    da_free(f64);
+
+    darray(float) empty = da_alloc(0, sizeof(float));
+    EMU_EXPECT_TRUE(da_radix_sort_f32(empty));
+    da_free(empty);
+
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_radix_sort_by_key__stable)
+{
+    struct keyed_elem* da = da_alloc(SORT_NUM_ELEMS, sizeof(struct keyed_elem));
+    for (size_t i = 0; i < da_length(da); ++i)
+    {
+        da[i].id = (int)i;
+        da[i].weight = (double)(rand() % 16) - 8.0;
+        da[i].tag = 't';
+    }
+
+    EMU_REQUIRE_TRUE(da_radix_sort_by_key(da, weight));
+    for (size_t i = 1; i < da_length(da); ++i)
+    {
+        EMU_EXPECT_TRUE(da[i].weight >= da[i-1].weight);
+        if (da[i].weight == da[i-1].weight)
+            EMU_EXPECT_GT_INT(da[i].id, da[i-1].id);
+        EMU_EXPECT_EQ_INT(da[i].tag, 't');
+    }
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_parallel_sort)
+{
+    const size_t nelem = 200000;
+    const size_t thread_counts[] = {0, 1, 2, 3, 5, 8};
+    int* expected = malloc(nelem*sizeof(int));
+    EMU_REQUIRE_NOT_NULL(expected);
+    for (int pattern = 0; pattern < 6; ++pattern)
+    {
+        for (size_t t = 0; t < sizeof(thread_counts)/sizeof(size_t); ++t)
+        {
+            darray(int) da = da_alloc(nelem, sizeof(int));
+            EMU_REQUIRE_NOT_NULL(da);
+            fill_sort_pattern(da, nelem, pattern);
+            memcpy(expected, da, nelem*sizeof(int));
+            qsort(expected, nelem, sizeof(int), cmp_int);
+            EMU_REQUIRE_TRUE(da_parallel_sort(da, cmp_int, thread_counts[t]));
+            EMU_EXPECT_EQ_INT(memcmp(da, expected, nelem*sizeof(int)), 0);
+            da_free(da);
+        }
+    }
+    free(expected);
+
+    struct wide_elem* wide = da_alloc(nelem, sizeof(struct wide_elem));
+    EMU_REQUIRE_NOT_NULL(wide);
+    for (size_t i = 0; i < nelem; ++i)
+    {
+        wide[i].key = rand();
+        wide[i].payload[0] = (char)wide[i].key;
+    }
+    EMU_REQUIRE_TRUE(da_parallel_sort(wide, cmp_wide_elem, 6));
+    for (size_t i = 1; i < nelem; ++i)
+    {
+        EMU_EXPECT_GE_INT(wide[i].key, wide[i-1].key);
+        EMU_EXPECT_EQ_INT(wide[i].payload[0], (char)wide[i].key);
+    }
+    da_free(wide);
+
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_nth_element)
+{
+    size_t n = SORT_NUM_ELEMS;
+    darray(int) da = da_alloc(n, sizeof(int));
+    darray(int) sorted = da_alloc(n, sizeof(int));
+    // Random, few distinct values, sorted, and reversed inputs.
+    for (int pattern = 0; pattern < 4; ++pattern)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            int values[] = {
+                rand(), rand() % 4, (int)i, (int)(n - i)};
+            sorted[i] = values[pattern];
+        }
+        size_t nths[] = {0, 1, n / 3, n / 2, n - 2, n - 1};
+        for (size_t k = 0; k < sizeof(nths)/sizeof(*nths); ++k)
+        {
+            memcpy(da, sorted, n * sizeof(int));
+            da_nth_element(da, nths[k], cmp_int);
+            int pivot = da[nths[k]];
+            bool partitioned = true;
+            for (size_t i = 0; i < n; ++i)
+            {
+                partitioned = partitioned
+                    && (i < nths[k] ? da[i] <= pivot : da[i] >= pivot);
+            }
+            EMU_EXPECT_TRUE(partitioned);
+            if (k == 0)
+                da_sort(sorted, cmp_int);
+            EMU_EXPECT_EQ_INT(pivot, sorted[nths[k]]);
+        }
+    }
+
+    // Out of range indices leave the darray untouched.
+    memcpy(da, sorted, n * sizeof(int));
+    da_nth_element(da, n, cmp_int);
+    EMU_EXPECT_TRUE(memcmp(da, sorted, n * sizeof(int)) == 0);
+    da_free(sorted);
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_percentiles)
+{
+    darray(int) da = da_alloc(1000, sizeof(int));
+    for (size_t i = 0; i < da_length(da); ++i)
+        da[i] = (int)i + 1;
+    for (size_t i = da_length(da); i-- > 1;)
+        da_swap(da, i, (size_t)rand() % (i + 1));
+
+    double qs[] = {0.99, 0.5, 0.999, 0.0, 1.0, 0.5, 0.0015};
+    int out[sizeof(qs)/sizeof(*qs)];
+    da_percentiles(da, qs, sizeof(qs)/sizeof(*qs), out, cmp_int);
+    EMU_EXPECT_EQ_INT(out[0], 990);
+    EMU_EXPECT_EQ_INT(out[1], 500);
+    EMU_EXPECT_EQ_INT(out[2], 999);
+    EMU_EXPECT_EQ_INT(out[3], 1);
+    EMU_EXPECT_EQ_INT(out[4], 1000);
+    EMU_EXPECT_EQ_INT(out[5], 500);
+    EMU_EXPECT_EQ_INT(out[6], 2);
+
+    da = da_resize(da, 1);
+    da_percentiles(da, qs, 3, out, cmp_int);
+    EMU_EXPECT_EQ_INT(out[0], da[0]);
+    EMU_EXPECT_EQ_INT(out[2], da[0]);
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(da_sort)
+{
+    EMU_ADD(da_sort__patterns);
+    EMU_ADD(da_sort__large_elements);
+    EMU_ADD(da_sort__scalar_types);
+    EMU_ADD(da_sort_by_key);
+    EMU_ADD(da_radix_sort__scalar_types);
+    EMU_ADD(da_radix_sort_by_key__stable);
+    EMU_ADD(da_parallel_sort);
+    EMU_ADD(da_nth_element);
+    EMU_ADD(da_percentiles);
+    EMU_END_GROUP();
+}
+
+EMU_TEST(container_style_type)
+{
+    int* da = da_alloc(INITIAL_NUM_ELEMS, sizeof(int));
+    darray(int) da2 = da; // check for no compiler warnings
+
+    da_free(da2);
+    EMU_END_TEST();
+}
+
+size_t linear_lower_bound(const int* arr, size_t nelem, int key)
+{
+    size_t i = 0;
+    while (i < nelem && arr[i] < key)
+        ++i;
+    return i;
+}
+
+size_t linear_upper_bound(const int* arr, size_t nelem, int key)
+{
+    size_t i = 0;
+    while (i < nelem && arr[i] <= key)
+        ++i;
+    return i;
+}
+
+EMU_TEST(da_lower_bound__and__da_upper_bound)
+{
+    size_t lengths[] = {0, 1, 2, 3, 7, 8, 9, 100, 1000};
+    for (size_t n = 0; n < sizeof(lengths)/sizeof(size_t); ++n)
+    {
+        darray(int) da = da_alloc(lengths[n], sizeof(int));
+        for (size_t i = 0; i < da_length(da); ++i)
+            da[i] = rand() % 50;
+        da_sort_int(da);
+        for (int key = -1; key <= 50; ++key)
+        {
+            EMU_EXPECT_EQ_UINT(da_lower_bound(da, &key, cmp_int),
+                linear_lower_bound(da, da_length(da), key));
+            EMU_EXPECT_EQ_UINT(da_upper_bound(da, &key, cmp_int),
+                linear_upper_bound(da, da_length(da), key));
+            struct da_range range = da_equal_range(da, &key, cmp_int);
+            EMU_EXPECT_EQ_UINT(range.begin,
+                linear_lower_bound(da, da_length(da), key));
+            EMU_EXPECT_EQ_UINT(range.end,
+                linear_upper_bound(da, da_length(da), key));
+        }
+        da_free(da);
+    }
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_bound_val_macros)
+{
+    darray(int) da = da_alloc(5, sizeof(int));
+    int vals[] = {1, 3, 3, 3, 7};
+    memcpy(da, vals, sizeof(vals));
+    EMU_EXPECT_EQ_UINT(da_lower_bound_val(da, 3, cmp_int), 1);
+    EMU_EXPECT_EQ_UINT(da_upper_bound_val(da, 3, cmp_int), 4);
+    EMU_EXPECT_EQ_UINT(da_lower_bound_val(da, 8, cmp_int), 5);
+    struct da_range range = da_equal_range_val(da, 5, cmp_int);
+    EMU_EXPECT_EQ_UINT(range.begin, 4);
+    EMU_EXPECT_EQ_UINT(range.end, 4);
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_insert_sorted)
+{
+    darray(int) da = da_alloc(0, sizeof(int));
+    for (int i = 0; i < 500; ++i)
+    {
+        int val = rand() % 100;
+        if (i % 2)
+            da = da_insert_sorted(da, &val, cmp_int);
+        else
+            da = da_insert_sorted_val(da, val, cmp_int);
+        EMU_REQUIRE_NOT_NULL(da);
+    }
+    EMU_EXPECT_EQ_UINT(da_length(da), 500);
+    for (size_t i = 1; i < da_length(da); ++i)
+        EMU_EXPECT_GE_INT(da[i], da[i-1]);
+    da_free(da);
+    EMU_END_TEST();
+}
+
+struct merge_elem
+{
+    int key;
+    int seq;
+};
+
+static int cmp_merge_elem(const void* a, const void* b)
+{
+    int x = ((const struct merge_elem*)a)->key;
+    int y = ((const struct merge_elem*)b)->key;
+    return (x > y) - (x < y);
+}
+
+EMU_TEST(da_merge_sorted_batch)
+{
+    darray(struct merge_elem) da = da_alloc(0, sizeof(struct merge_elem));
+    darray(struct merge_elem) expected = da_alloc(0,
+        sizeof(struct merge_elem));
+    for (int i = 0; i < 3000; ++i)
+    {
+        struct merge_elem e = {.key = 2 * i, .seq = 0};
+        da = da_push(da, e);
+        expected = da_push(expected, e);
+    }
+    // Keys before, after, between, and equal to existing keys, in a shuffled
+    // order. Equal keys are inserted after the existing ones.
+    struct merge_elem batch[500];
+    for (int i = 0; i < 500; ++i)
+    {
+        batch[i] = (struct merge_elem){.key = (i * 37) % 6200 - 100,
+            .seq = 1};
+    }
+    for (size_t i = 0; i < 500; ++i)
+        expected = da_insert_sorted(expected, &batch[i], cmp_merge_elem);
+
+    da = da_merge_sorted_batch(da, batch, 500, cmp_merge_elem);
+    EMU_REQUIRE_NOT_NULL(da);
+    EMU_EXPECT_EQ_UINT(da_length(da), 3500);
+    bool all_match = true;
+    for (size_t i = 0; i < da_length(da); ++i)
+    {
+        all_match = all_match && da[i].key == expected[i].key
+            && da[i].seq == expected[i].seq;
+    }
+    EMU_EXPECT_TRUE(all_match);
+    EMU_EXPECT_TRUE(batch[0].key <= batch[1].key);
+
+    // Merging into an empty darray, and an empty batch.
+    da = da_resize(da, 0);
+    da = da_merge_sorted_batch(da, batch, 3, cmp_merge_elem);
+    EMU_EXPECT_EQ_UINT(da_length(da), 3);
+    EMU_EXPECT_EQ_INT(da[2].key, batch[2].key);
+    da = da_merge_sorted_batch(da, batch, 0, cmp_merge_elem);
+    EMU_EXPECT_EQ_UINT(da_length(da), 3);
+    da_free(expected);
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_kway_merge)
+{
+    // Sources of different lengths, including empty ones, whose keys
+    // interleave and repeat both within and across sources.
+    darray(struct merge_elem) arrays[7];
+    size_t total = 0;
+    for (int a = 0; a < 7; ++a)
+    {
+        size_t len = a == 2 || a == 5 ? 0 : (size_t)(a * 50 + 1);
+        arrays[a] = da_alloc(len, sizeof(struct merge_elem));
+        for (size_t i = 0; i < len; ++i)
+            arrays[a][i] = (struct merge_elem){.key = (int)(i * (size_t)a) / 3,
+                .seq = a * 1000 + (int)i};
+        total += len;
+    }
+
+    darray(struct merge_elem) merged = da_kway_merge((void* const*)arrays, 7,
+        cmp_merge_elem);
+    EMU_REQUIRE_NOT_NULL(merged);
+    EMU_EXPECT_EQ_UINT(da_length(merged), total);
+    EMU_EXPECT_EQ_UINT(da_capacity(merged), total);
+    bool stable_order = true;
+    for (size_t i = 1; i < da_length(merged); ++i)
+    {
+        stable_order = stable_order && (merged[i-1].key < merged[i].key
+            || (merged[i-1].key == merged[i].key
+                && merged[i-1].seq < merged[i].seq));
+    }
+    EMU_EXPECT_TRUE(stable_order);
+    da_free(merged);
+
+    merged = da_kway_merge_unique((void* const*)arrays, 7, cmp_merge_elem);
+    EMU_REQUIRE_NOT_NULL(merged);
+    bool strictly_increasing = true;
+    for (size_t i = 1; i < da_length(merged); ++i)
+        strictly_increasing = strictly_increasing
+            && merged[i-1].key < merged[i].key;
+    EMU_EXPECT_TRUE(strictly_increasing);
+    EMU_EXPECT_EQ_INT(merged[0].key, 0);
+    EMU_EXPECT_EQ_INT(merged[0].seq, 0);
+    EMU_EXPECT_EQ_INT(merged[da_length(merged) - 1].key, 300 * 6 / 3);
+    da_free(merged);
+
+    // A single source is copied.
+    merged = da_kway_merge((void* const*)&arrays[3], 1, cmp_merge_elem);
+    EMU_REQUIRE_NOT_NULL(merged);
+    EMU_EXPECT_EQ_UINT(da_length(merged), da_length(arrays[3]));
+    EMU_EXPECT_TRUE(memcmp(merged, arrays[3],
+        da_length(merged) * sizeof(struct merge_elem)) == 0);
+    da_free(merged);
+    for (int a = 0; a < 7; ++a)
+        da_free(arrays[a]);
+    EMU_END_TEST();
+}
+
+static int cmp_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Set of the multiples of `step` below `limit`.
+static darray(uint32_t) multiples_u32(uint32_t step, uint32_t limit)
+{
+    darray(uint32_t) da = da_alloc(0, sizeof(uint32_t));
+    for (uint32_t x = 0; x < limit; x += step)
+        da = da_push(da, x);
+    return da;
+}
+
+// Check one set operation result against membership in the input sets, all of
+// whose elements are below `limit`.
+static bool set_op_matches(darray(const uint32_t) result,
+    darray(const uint32_t) a, darray(const uint32_t) b, uint32_t limit,
+    int op)
+{
+    if (result == NULL || da_capacity(result) != da_length(result))
+        return false;
+    size_t r = 0;
+    for (uint32_t x = 0; x < limit; ++x)
+    {
+        size_t ia = da_lower_bound(a, &x, cmp_u32);
+        size_t ib = da_lower_bound(b, &x, cmp_u32);
+        bool in_a = ia < da_length(a) && a[ia] == x;
+        bool in_b = ib < da_length(b) && b[ib] == x;
+        bool expected = op == 0 ? in_a && in_b
+            : op == 1 ? in_a || in_b
+            : in_a && !in_b;
+        if (expected && (r >= da_length(result) || result[r++] != x))
+            return false;
+    }
+    return r == da_length(result);
+}
+
+EMU_TEST(da_set_intersect__and__da_set_union__and__da_set_difference)
+{
+    // Inputs of similar length, with a tail that is not a multiple of the
+    // SIMD block size, skewed inputs in either order, and empty inputs.
+    const uint32_t limit = 6000;
+    const uint32_t steps[][2] = {{2, 3}, {3, 2}, {5, 5}, {1, 7}, {2, 997},
+        {997, 2}, {1, 6001}, {6001, 3}};
+    for (size_t t = 0; t < sizeof(steps) / sizeof(steps[0]); ++t)
+    {
+        darray(uint32_t) a = multiples_u32(steps[t][0], limit);
+        darray(uint32_t) b = multiples_u32(steps[t][1], limit);
+        if (steps[t][0] > limit)
+            a = da_resize(a, 0);
+        if (steps[t][1] > limit)
+            b = da_resize(b, 0);
+
+        uint32_t* r = da_set_intersect(a, b, cmp_u32);
+        EMU_EXPECT_TRUE(set_op_matches(r, a, b, limit, 0));
+        da_free(r);
+        r = da_set_union(a, b, cmp_u32);
+        EMU_EXPECT_TRUE(set_op_matches(r, a, b, limit, 1));
+        da_free(r);
+        r = da_set_difference(a, b, cmp_u32);
+        EMU_EXPECT_TRUE(set_op_matches(r, a, b, limit, 2));
+        da_free(r);
+
+        r = da_set_intersect_u32(a, b);
+        EMU_EXPECT_TRUE(set_op_matches(r, a, b, limit, 0));
+        da_free(r);
+        r = da_set_union_u32(a, b);
+        EMU_EXPECT_TRUE(set_op_matches(r, a, b, limit, 1));
+        da_free(r);
+        r = da_set_difference_u32(a, b);
+        EMU_EXPECT_TRUE(set_op_matches(r, a, b, limit, 2));
+        da_free(r);
+
+        da_free(a);
+        da_free(b);
+    }
+
+    // Elements found in both inputs are output from the first one.
+    darray(struct merge_elem) x = da_alloc(200, sizeof(struct merge_elem));
+    darray(struct merge_elem) y = da_alloc(3, sizeof(struct merge_elem));
+    for (int i = 0; i < 200; ++i)
+        x[i] = (struct merge_elem){.key = i, .seq = 0};
+    for (int i = 0; i < 3; ++i)
+        y[i] = (struct merge_elem){.key = i * 50, .seq = 1};
+    darray(struct merge_elem) z = da_set_intersect(y, x, cmp_merge_elem);
+    EMU_REQUIRE_NOT_NULL(z);
+    EMU_REQUIRE_EQ_UINT(da_length(z), 3);
+    EMU_EXPECT_EQ_INT(z[2].key, 100);
+    EMU_EXPECT_EQ_INT(z[2].seq, 1);
+    da_free(z);
+    z = da_set_union(x, y, cmp_merge_elem);
+    EMU_REQUIRE_NOT_NULL(z);
+    EMU_REQUIRE_EQ_UINT(da_length(z), 200);
+    EMU_EXPECT_EQ_INT(z[50].seq, 0);
+    da_free(z);
+    z = da_set_difference(x, y, cmp_merge_elem);
+    EMU_REQUIRE_NOT_NULL(z);
+    EMU_REQUIRE_EQ_UINT(da_length(z), 197);
+    EMU_EXPECT_EQ_INT(z[48].key, 49);
+    EMU_EXPECT_EQ_INT(z[49].key, 51);
+    da_free(z);
+    da_free(x);
+    da_free(y);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_search_many)
+{
+    darray(int) da = da_alloc(1000, sizeof(int));
+    for (size_t i = 0; i < da_length(da); ++i)
+        da[i] = rand() % 2000;
+    da_sort_int(da);
+
+    const size_t nkeys = 300;
+    int keys[300];
+    size_t indices[300];
+    for (size_t i = 0; i < nkeys; ++i)
+        keys[i] = rand() % 2100 - 50;
+    // Unsorted keys.
+    da_search_many(da, keys, nkeys, indices, cmp_int);
+    for (size_t i = 0; i < nkeys; ++i)
+        EMU_EXPECT_EQ_UINT(indices[i], da_lower_bound(da, &keys[i], cmp_int));
+    // Sorted keys.
+    qsort(keys, nkeys, sizeof(int), cmp_int);
+    da_search_many(da, keys, nkeys, indices, cmp_int);
+    for (size_t i = 0; i < nkeys; ++i)
+        EMU_EXPECT_EQ_UINT(indices[i], da_lower_bound(da, &keys[i], cmp_int));
+
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_eytzinger__and__da_btree_index)
+{
+    size_t lengths[] = {0, 1, 2, 15, 16, 17, 100, 1000, 5000};
+    for (size_t n = 0; n < sizeof(lengths)/sizeof(size_t); ++n)
+    {
+        darray(int) da = da_alloc(lengths[n], sizeof(int));
+        for (size_t i = 0; i < da_length(da); ++i)
+            da[i] = 2 * (rand() % 3000);
+        da_sort_int(da);
+
+        struct da_eytzinger* ez = da_build_eytzinger(da, cmp_int);
+        EMU_REQUIRE_NOT_NULL(ez);
+        struct da_btree_index* bt = da_build_btree_index(da, cmp_int);
+        EMU_REQUIRE_NOT_NULL(bt);
+        for (int key = -1; key <= 6001; key += 1 + rand() % 7)
+        {
+            size_t expected = da_lower_bound(da, &key, cmp_int);
+            long expected_find =
+                expected < da_length(da) && da[expected] == key ?
+                (long)expected : -1;
+            EMU_EXPECT_EQ_UINT(da_eytzinger_lower_bound(ez, &key), expected);
+            EMU_EXPECT_EQ_UINT(da_btree_index_lower_bound(bt, &key), expected);
+            EMU_EXPECT_EQ_INT(da_eytzinger_find(ez, &key), expected_find);
+            EMU_EXPECT_EQ_INT(da_btree_index_find(bt, &key), expected_find);
+        }
+        da_btree_index_free(bt);
+        da_eytzinger_free(ez);
+        da_free(da);
+    }
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_eytzinger__large_elements)
+{
+    struct wide_elem* da = da_alloc(777, sizeof(struct wide_elem));
+    for (size_t i = 0; i < da_length(da); ++i)
+        da[i].key = (int)i * 3;
+
+    struct da_eytzinger* ez = da_build_eytzinger(da, cmp_wide_elem);
+    EMU_REQUIRE_NOT_NULL(ez);
+    struct da_btree_index* bt = da_build_btree_index(da, cmp_wide_elem);
+    EMU_REQUIRE_NOT_NULL(bt);
+    for (int k = -2; k < 777*3 + 2; ++k)
+    {
+        struct wide_elem key = {.key = k};
+        size_t expected = k <= 0 ? 0 : ((size_t)k + 2) / 3;
+        if (expected > 777)
+            expected = 777;
+        EMU_EXPECT_EQ_UINT(da_eytzinger_lower_bound(ez, &key), expected);
+        EMU_EXPECT_EQ_UINT(da_btree_index_lower_bound(bt, &key), expected);
+    }
+    da_btree_index_free(bt);
+    da_eytzinger_free(ez);
+    da_free(da);
+    EMU_END_TEST();
+}
+
+#define DEFINE_FIND_CHECK(type)                                                \
+void find_check_##type(size_t nelem, size_t* failures)                         \
+{                                                                              \
+    darray(type) da = da_alloc(nelem, sizeof(type));                           \
+    for (size_t i = 0; i < nelem; ++i)                                         \
+        da[i] = (type)(rand() % 5);                                            \
+    for (int v = 0; v < 6; ++v)                                                \
+    {                                                                          \
+        type value = (type)v;                                                  \
+        long first = -1;                                                       \
+        size_t count = 0;                                                      \
+        for (size_t i = nelem; i-- > 0;)                                       \
+        {                                                                      \
+            if (da[i] == value)                                                \
+            {                                                                  \
+                first = (long)i;                                               \
+                count += 1;                                                    \
+            }                                                                  \
+        }                                                                      \
+        *failures += da_find(da, &value) != first;                             \
+        *failures += da_count(da, &value) != count;                            \
+        *failures += da_contains(da, &value) != (first != -1);                 \
+    }                                                                          \
+    da_free(da);                                                               \
+}
+DEFINE_FIND_CHECK(int8_t)
+DEFINE_FIND_CHECK(int16_t)
+DEFINE_FIND_CHECK(int32_t)
+DEFINE_FIND_CHECK(int64_t)
+DEFINE_FIND_CHECK(double)
+
+EMU_TEST(da_find__and__da_count)
+{
+    size_t lengths[] = {0, 1, 7, 8, 15, 16, 17, 31, 33, 63, 64, 65, 129, 1000};
+    size_t failures = 0;
+    for (size_t n = 0; n < sizeof(lengths)/sizeof(size_t); ++n)
+    {
+        find_check_int8_t(lengths[n], &failures);
+        find_check_int16_t(lengths[n], &failures);
+        find_check_int32_t(lengths[n], &failures);
+        find_check_int64_t(lengths[n], &failures);
+        find_check_double(lengths[n], &failures);
+    }
+    EMU_EXPECT_EQ_UINT(failures, 0);
+
+    // Element sizes without a SIMD kernel.
+    struct three_bytes* da = da_alloc(100, sizeof(struct three_bytes));
+    memset(da, 0, 100*sizeof(struct three_bytes));
+    struct three_bytes needle = {{1, 2, 3}};
+    EMU_EXPECT_EQ_INT(da_find(da, &needle), -1);
+    da[40] = needle;
+    da[70] = needle;
+    EMU_EXPECT_EQ_INT(da_find(da, &needle), 40);
+    EMU_EXPECT_EQ_UINT(da_count(da, &needle), 2);
+    EMU_EXPECT_TRUE(da_contains(da, &needle));
+    da_free(da);
+
+    EMU_END_TEST();
+}
+
+bool is_greater_than(const void* elem, void* ctx)
+{
+    return *(const int*)elem > *(int*)ctx;
+}
+
+EMU_TEST(da_find_if__and__val_macros)
+{
+    darray(int) da = da_alloc(10, sizeof(int));
+    for (size_t i = 0; i < da_length(da); ++i)
+        da[i] = (int)i * 10;
+    int limit = 35;
+    EMU_EXPECT_EQ_INT(da_find_if(da, is_greater_than, &limit), 4);
+    limit = 90;
+    EMU_EXPECT_EQ_INT(da_find_if(da, is_greater_than, &limit), -1);
+
+    EMU_EXPECT_EQ_INT(da_find_val(da, 70), 7);
+    EMU_EXPECT_EQ_INT(da_find_val(da, 71), -1);
+    EMU_EXPECT_EQ_UINT(da_count_val(da, 0), 1);
+    EMU_EXPECT_TRUE(da_contains_val(da, 90));
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(da_search)
+{
+    EMU_ADD(da_find__and__da_count);
+    EMU_ADD(da_find_if__and__val_macros);
+    EMU_ADD(da_lower_bound__and__da_upper_bound);
+    EMU_ADD(da_bound_val_macros);
+    EMU_ADD(da_insert_sorted);
+    EMU_ADD(da_merge_sorted_batch);
+    EMU_ADD(da_kway_merge);
+    EMU_ADD(da_set_intersect__and__da_set_union__and__da_set_difference);
+    EMU_ADD(da_search_many);
+    EMU_ADD(da_eytzinger__and__da_btree_index);
+    EMU_ADD(da_eytzinger__large_elements);
+    EMU_END_GROUP();
+}
+
+// Elements too large to be sifted through a hole.
+struct big_elem
+{
+    int key;
+    char payload[124];
+};
+
+static int cmp_big_elem(const void* a, const void* b)
+{
+    return cmp_int(&((const struct big_elem*)a)->key,
+        &((const struct big_elem*)b)->key);
+}
+
+static bool is_heap(const void* darr, int (*cmp)(const void*, const void*),
+    size_t arity)
+{
+    const char* base = darr;
+    size_t sz = da_sizeof_elem(darr);
+    for (size_t i = 1; i < da_length(darr); ++i)
+        if (cmp(base + ((i - 1) / arity)*sz, base + i*sz) < 0)
+            return false;
+    return true;
+}
+
+EMU_TEST(da_heapify__and__da_heap_pop)
+{
+    for (size_t arity = 2; arity <= 5; ++arity)
+    {
+        darray(int) da = da_alloc(1000, sizeof(int));
+        for (size_t i = 0; i < da_length(da); ++i)
+            da[i] = (int)((i * 7919) % 500);
+        da_heapify(da, cmp_int, arity);
+        EMU_EXPECT_TRUE(is_heap(da, cmp_int, arity));
+
+        bool descending = true;
+        int prev = 500;
+        while (da_length(da) > 0)
+        {
+            int top;
+            da_heap_pop(da, &top, cmp_int, arity);
+            descending = descending && top <= prev
+                && is_heap(da, cmp_int, arity);
+            prev = top;
+        }
+        EMU_EXPECT_TRUE(descending);
+        EMU_EXPECT_EQ_INT(prev, 0);
+        da_free(da);
+
+        darray(struct big_elem) big = da_alloc(300, sizeof(struct big_elem));
+        for (size_t i = 0; i < da_length(big); ++i)
+            big[i] = (struct big_elem){.key = (int)((i * 31) % 300)};
+        da_heapify(big, cmp_big_elem, arity);
+        EMU_EXPECT_TRUE(is_heap(big, cmp_big_elem, arity));
+        descending = true;
+        for (int expected = 299; da_length(big) > 0; --expected)
+        {
+            descending = descending
+                && da_heap_pop_val(big, cmp_big_elem, arity).key == expected;
+        }
+        EMU_EXPECT_TRUE(descending);
+        da_free(big);
+    }
+
+    // Popping without an output buffer discards the top.
+    darray(int) da = da_alloc(2, sizeof(int));
+    da[0] = 1;
+    da[1] = 2;
+    da_heapify(da, cmp_int, 4);
+    da_heap_pop(da, NULL, cmp_int, 4);
+    EMU_REQUIRE_EQ_UINT(da_length(da), 1);
+    EMU_EXPECT_EQ_INT(da[0], 1);
+    da_free(da);
+    EMU_END_TEST();
+}
+
+EMU_TEST(da_heap_push__and__da_heap_replace)
+{
+    for (size_t arity = 2; arity <= 4; arity += 2)
+    {
+        darray(int) da = da_alloc(0, sizeof(int));
+        bool heap = true;
+        for (int i = 0; i < 1000; ++i)
+        {
+            da = da_heap_push_val(da, (i * 7919) % 1000, cmp_int, arity);
+            heap = heap && is_heap(da, cmp_int, arity);
+        }
+        EMU_EXPECT_TRUE(heap);
+        EMU_EXPECT_EQ_UINT(da_length(da), 1000);
+        EMU_EXPECT_EQ_INT(da[0], 999);
+
+        // Replacing the top with smaller values keeps the 1000 smallest of
+        // the values seen so far.
+        for (int i = 0; i < 500; ++i)
+        {
+            int out = da_heap_replace_val(da, -i, cmp_int, arity);
+            heap = heap && out == 999 - i && is_heap(da, cmp_int, arity);
+        }
+        EMU_EXPECT_TRUE(heap);
+        int value = -1000;
+        da_heap_replace(da, &value, &value, cmp_int, arity);
+        EMU_EXPECT_EQ_INT(value, 499);
+        EMU_EXPECT_TRUE(is_heap(da, cmp_int, arity));
+        da_free(da);
+
+        darray(struct big_elem) big = da_alloc(0, sizeof(struct big_elem));
+        for (int i = 0; i < 100; ++i)
+        {
+            big = da_heap_push_val(big, (struct big_elem){.key = i},
+                cmp_big_elem, arity);
+        }
+        EMU_EXPECT_TRUE(is_heap(big, cmp_big_elem, arity));
+        struct big_elem elem = {.key = -1};
+        da_heap_replace(big, &elem, &elem, cmp_big_elem, arity);
+        EMU_EXPECT_EQ_INT(elem.key, 99);
+        EMU_EXPECT_EQ_INT(big[0].key, 98);
+        EMU_EXPECT_TRUE(is_heap(big, cmp_big_elem, arity));
+        da_free(big);
+    }
+    EMU_END_TEST();
+}
+
+EMU_GROUP(da_heap)
+{
+    EMU_ADD(da_heapify__and__da_heap_pop);
+    EMU_ADD(da_heap_push__and__da_heap_replace);
+    EMU_END_GROUP();
+}
+
+EMU_TEST(da_sum__and__da_min__and__da_max)
+{
+    darray(int32_t) da = da_alloc(1000, sizeof(int32_t));
+    int64_t expected = 0;
+    for (size_t i = 0; i < da_length(da); ++i)
+    {
+        da[i] = INT32_MAX - (int32_t)((i * 7919) % 1000);
+        expected += da[i];
+    }
+    EMU_EXPECT_EQ_INT(da_sum_i32(da), expected);
+    EMU_EXPECT_EQ_INT(da_min_i32(da), INT32_MAX - 999);
+    EMU_EXPECT_EQ_INT(da_max_i32(da), INT32_MAX);
+
+    darray(double) dd = da_alloc(14, sizeof(double));
+    for (size_t i = 0; i < da_length(dd); ++i)
+        dd[i] = (double)i - 6.5;
+    EMU_EXPECT_EQ_DOUBLE(da_sum_f64(dd), 0.0);
+    EMU_EXPECT_EQ_DOUBLE(da_min_f64(dd), -6.5);
+    EMU_EXPECT_EQ_DOUBLE(da_max_f64(dd), 6.5);
+
+    dd = da_resize(dd, 0);
+    EMU_EXPECT_EQ_DOUBLE(da_sum_f64(dd), 0.0);
+    da_free(dd);
     da_free(da);
     EMU_END_TEST();
 }
 
-EMU_TEST(da_foreach__iterates_forward)
+EMU_TEST(da_argmin__and__da_argmax)
 {
-    int* da = da_alloc(INITIAL_NUM_ELEMS, sizeof(int));
-
-    for (size_t i = 0; i < da_length(da); ++i){da[i] = i;}
-    int last = -1;
-    da_foreach(da, iter)
-    {
-        EMU_EXPECT_GE_INT(*iter, last);
-        last = *iter;
-    }
-
+    darray(uint64_t) da = da_alloc(37, sizeof(uint64_t));
+    for (size_t i = 0; i < da_length(da); ++i)
+        da[i] = 5;
+    EMU_EXPECT_EQ_INT(da_argmin_u64(da), 0);
+    EMU_EXPECT_EQ_INT(da_argmax_u64(da), 0);
+    // Ties resolve to the first occurrence wherever they fall among the
+    // accumulator lanes and the scalar tail.
+    da[3] = 1; da[10] = 1; da[36] = 1;
+    da[17] = 9; da[30] = 9;
+    EMU_EXPECT_EQ_INT(da_argmin_u64(da), 3);
+    EMU_EXPECT_EQ_INT(da_argmax_u64(da), 17);
+    da[36] = 0;
+    EMU_EXPECT_EQ_INT(da_argmin_u64(da), 36);
+
+    darray(float) df = da_alloc(5, sizeof(float));
+    df[0] = 1.f; df[1] = -2.f; df[2] = 3.f; df[3] = -2.f; df[4] = 3.f;
+    EMU_EXPECT_EQ_INT(da_argmin_f32(df), 1);
+    EMU_EXPECT_EQ_INT(da_argmax_f32(df), 2);
+    df = da_resize(df, 0);
+    EMU_EXPECT_EQ_INT(da_argmin_f32(df), -1);
+    EMU_EXPECT_EQ_INT(da_argmax_f32(df), -1);
+    da_free(df);
     da_free(da);
     EMU_END_TEST();
 }
 
-EMU_TEST(da_foreach__iterates_once_per_element)
+EMU_TEST(da_parallel_reductions)
 {
-    int* da = da_alloc(INITIAL_NUM_ELEMS, sizeof(int));
+    size_t n = 1000003;
+    darray(int64_t) da = da_alloc(n, sizeof(int64_t));
+    for (size_t i = 0; i < n; ++i)
+        da[i] = (int64_t)((i * 2654435761u) % 100000) - 50000;
+    da[n / 3] = -60000;
+    da[2 * n / 3] = -60000;
+    da[n - 1] = 70000;
 
-    unsigned counter = 0;
-    da_foreach(da, iter)
+    for (size_t nthreads = 0; nthreads <= 5; ++nthreads)
     {
-        counter += 1;
+        EMU_EXPECT_EQ_INT(da_parallel_sum_i64(da, nthreads), da_sum_i64(da));
+        EMU_EXPECT_EQ_INT(da_parallel_min_i64(da, nthreads), -60000);
+        EMU_EXPECT_EQ_INT(da_parallel_max_i64(da, nthreads), 70000);
+        EMU_EXPECT_EQ_INT(da_parallel_argmin_i64(da, nthreads), n / 3);
+        EMU_EXPECT_EQ_INT(da_parallel_argmax_i64(da, nthreads), n - 1);
     }
-    EMU_EXPECT_EQ_UINT(counter, INITIAL_NUM_ELEMS);
 
+    // Small darrays fall back to the sequential reduction.
+    da = da_resize(da, 10);
+    EMU_EXPECT_EQ_INT(da_parallel_sum_i64(da, 4), da_sum_i64(da));
+
+    // 64-bit sums wrap on overflow: 18 * INT64_MAX is -18 modulo 2^64.
+    da = da_resize(da, 18);
+    da_fill(da, INT64_MAX);
+    EMU_EXPECT_EQ_INT(da_sum_i64(da), -18);
     da_free(da);
     EMU_END_TEST();
 }
 
-EMU_TEST(da_foreach__nested_darrays)
+EMU_TEST(da_inclusive_scan__and__da_exclusive_scan)
 {
-    int** nested = da_alloc_exact(INITIAL_NUM_ELEMS, sizeof(int*));
-    da_foreach(nested, iter)
-    {
-        *iter = da_alloc(INITIAL_NUM_ELEMS, sizeof(int*));
-    }
-
-    unsigned counter = 0;
-    da_foreach(nested, row)
+    // Every length up to a few SIMD vectors, to cover the scalar tail.
+    for (size_t n = 0; n <= 11; ++n)
     {
-        da_foreach(*row, col)
+        darray(int32_t) incl = da_alloc(n, sizeof(int32_t));
+        darray(uint64_t) excl = da_alloc(n, sizeof(uint64_t));
+        darray(float) fincl = da_alloc(n, sizeof(float));
+        darray(double) fexcl = da_alloc(n, sizeof(double));
+        for (size_t i = 0; i < n; ++i)
         {
-            counter += 1;
+            incl[i] = (int32_t)i - 3;
+            excl[i] = i + 1;
+            fincl[i] = (float)i;
+            fexcl[i] = 0.5;
+        }
+        da_inclusive_scan_i32(incl);
+        EMU_EXPECT_EQ_UINT(da_exclusive_scan_u64(excl), n * (n+1) / 2);
+        da_inclusive_scan_f32(fincl);
+        EMU_EXPECT_EQ_DOUBLE(da_exclusive_scan_f64(fexcl), 0.5 * n);
+        bool all_match = true;
+        for (size_t i = 0; i < n; ++i)
+        {
+            all_match = all_match
+                && incl[i] == (int32_t)(i * (i+1) / 2) - 3 * (int32_t)(i+1)
+                && excl[i] == i * (i+1) / 2
+                && fincl[i] == (float)(i * (i+1) / 2)
+                && fexcl[i] == 0.5 * i;
         }
+        EMU_EXPECT_TRUE(all_match);
+        da_free(fexcl);
+        da_free(fincl);
+        da_free(excl);
+        da_free(incl);
     }
-    EMU_EXPECT_EQ_UINT(counter, INITIAL_NUM_ELEMS*INITIAL_NUM_ELEMS);
 
-    da_foreach(nested, iter)
-    {
-        da_free(*iter);
-    }
-    da_free(nested);
+    // Integer scans wrap on overflow.
+    darray(uint32_t) wrap = da_alloc(6, sizeof(uint32_t));
+    da_fill(wrap, UINT32_MAX);
+    EMU_EXPECT_EQ_UINT(da_exclusive_scan_u32(wrap), UINT32_MAX - 5);
+    EMU_EXPECT_EQ_UINT(wrap[5], UINT32_MAX - 4);
+    da_free(wrap);
     EMU_END_TEST();
 }
 
-EMU_GROUP(da_foreach)
+EMU_TEST(da_parallel_scans)
 {
-    EMU_ADD(da_foreach__iterates_through_all_elements);
-    EMU_ADD(da_foreach__iterates_forward);
-    EMU_ADD(da_foreach__iterates_once_per_element);
-    EMU_ADD(da_foreach__nested_darrays);
-    EMU_END_GROUP();
+    size_t n = 300007;
+    darray(int64_t) expected = da_alloc(n, sizeof(int64_t));
+    darray(int64_t) da = da_alloc(n, sizeof(int64_t));
+    for (size_t nthreads = 0; nthreads <= 5; ++nthreads)
+    {
+        for (size_t i = 0; i < n; ++i)
+            da[i] = expected[i] = (int64_t)(i % 7) - 2;
+        int64_t total = da_exclusive_scan_i64(expected);
+        EMU_EXPECT_EQ_INT(da_parallel_exclusive_scan_i64(da, nthreads), total);
+        EMU_EXPECT_TRUE(memcmp(da, expected, n * sizeof(int64_t)) == 0);
+
+        for (size_t i = 0; i < n; ++i)
+            da[i] = expected[i] = (int64_t)(i % 5);
+        da_inclusive_scan_i64(expected);
+        da_parallel_inclusive_scan_i64(da, nthreads);
+        EMU_EXPECT_TRUE(memcmp(da, expected, n * sizeof(int64_t)) == 0);
+    }
+
+    // Chunk totals wrap on overflow like the sequential scan.
+    da_fill(da, INT64_MAX);
+    da_fill(expected, INT64_MAX);
+    da_inclusive_scan_i64(expected);
+    da_parallel_inclusive_scan_i64(da, 4);
+    EMU_EXPECT_TRUE(memcmp(da, expected, n * sizeof(int64_t)) == 0);
+    da_free(da);
+    da_free(expected);
+    EMU_END_TEST();
 }
 
-EMU_TEST(container_style_type)
+EMU_GROUP(da_reductions)
 {
-    int* da = da_alloc(INITIAL_NUM_ELEMS, sizeof(int));
-    darray(int) da2 = da; // check for no compiler warnings
-
-    da_free(da2);
-    EMU_END_TEST();
+    EMU_ADD(da_sum__and__da_min__and__da_max);
+    EMU_ADD(da_argmin__and__da_argmax);
+    EMU_ADD(da_parallel_reductions);
+    EMU_ADD(da_inclusive_scan__and__da_exclusive_scan);
+    EMU_ADD(da_parallel_scans);
+    EMU_END_GROUP();
 }
 
 EMU_GROUP(darray_functions)
@@ -684,9 +2169,18 @@ EMU_GROUP(darray_functions)
     EMU_ADD(da_remove);
     EMU_ADD(da_remove_arr);
     EMU_ADD(da_swap);
+    EMU_ADD(da_reverse);
+    EMU_ADD(da_rotate);
+    EMU_ADD(da_dedupe);
     EMU_ADD(da_concat);
     EMU_ADD(da_fill);
     EMU_ADD(da_foreach);
+    EMU_ADD(da_map);
+    EMU_ADD(da_transform);
+    EMU_ADD(da_sort);
+    EMU_ADD(da_search);
+    EMU_ADD(da_heap);
+    EMU_ADD(da_reductions);
     EMU_ADD(container_style_type);
     EMU_END_GROUP();
 }
@@ -1285,6 +2779,1014 @@ EMU_GROUP(dstring_functions)
     EMU_END_GROUP();
 }
 
+EMU_TEST(dmap_insert__and__dmap_find)
+{
+    struct dmap* map = dmap_alloc(sizeof(int), sizeof(double), NULL, NULL);
+    EMU_REQUIRE_NOT_NULL(map);
+    EMU_EXPECT_EQ_UINT(dmap_length(map), 0);
+    int key = 7;
+    EMU_EXPECT_NULL(dmap_find(map, &key));
+
+    // Enough entries to rehash several times.
+    bool inserted = true;
+    for (int i = 0; i < 10000; ++i)
+    {
+        double value = i * 0.5;
+        inserted = inserted && dmap_insert(map, &i, &value) != NULL;
+    }
+    EMU_EXPECT_TRUE(inserted);
+    EMU_EXPECT_EQ_UINT(dmap_length(map), 10000);
+    bool found = true;
+    for (int i = 0; i < 10000; ++i)
+    {
+        double* value = dmap_find(map, &i);
+        found = found && value != NULL && *value == i * 0.5;
+    }
+    EMU_EXPECT_TRUE(found);
+    key = 10000;
+    EMU_EXPECT_NULL(dmap_find(map, &key));
+    key = -1;
+    EMU_EXPECT_NULL(dmap_find(map, &key));
+
+    // Inserting an existing key overwrites its value, unless the value is
+    // `NULL`.
+    key = 42;
+    double value = -1.0;
+    double* stored = dmap_insert(map, &key, &value);
+    EMU_REQUIRE_NOT_NULL(stored);
+    EMU_EXPECT_EQ(*stored, -1.0);
+    stored = dmap_insert(map, &key, NULL);
+    EMU_REQUIRE_NOT_NULL(stored);
+    EMU_EXPECT_EQ(*stored, -1.0);
+    key = 20000;
+    stored = dmap_insert(map, &key, NULL);
+    EMU_REQUIRE_NOT_NULL(stored);
+    EMU_EXPECT_EQ(*stored, 0.0);
+    EMU_EXPECT_EQ_UINT(dmap_length(map), 10001);
+    dmap_free(map);
+    EMU_END_TEST();
+}
+
+struct point
+{
+    short x;
+    short y;
+    char tag; // Ignored by hash and equality.
+};
+
+static uint64_t hash_point(const void* key)
+{
+    const struct point* p = key;
+    return (uint64_t)(unsigned short)p->x << 16 | (unsigned short)p->y;
+}
+
+static bool eq_point(const void* key1, const void* key2)
+{
+    const struct point* p = key1;
+    const struct point* q = key2;
+    return p->x == q->x && p->y == q->y;
+}
+
+EMU_TEST(dmap_custom_hash__and__dmap_erase)
+{
+    struct dmap* map = dmap_alloc(sizeof(struct point), sizeof(int),
+        hash_point, eq_point);
+    EMU_REQUIRE_NOT_NULL(map);
+    for (int i = 0; i < 4000; ++i)
+    {
+        struct point p = {.x = (short)(i % 64), .y = (short)(i / 64),
+            .tag = 'a'};
+        EMU_REQUIRE_NOT_NULL(dmap_insert(map, &p, &i));
+    }
+
+    // Erase every other entry, leaving deleted slots behind, then insert new
+    // keys over them.
+    bool erased = true;
+    for (int i = 0; i < 4000; i += 2)
+    {
+        struct point p = {.x = (short)(i % 64), .y = (short)(i / 64),
+            .tag = 'b'};
+        erased = erased && dmap_erase(map, &p) && !dmap_erase(map, &p);
+    }
+    EMU_EXPECT_TRUE(erased);
+    EMU_EXPECT_EQ_UINT(dmap_length(map), 2000);
+    for (int round = 0; round < 10; ++round)
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            struct point p = {.x = (short)-1, .y = (short)i};
+            if (dmap_insert(map, &p, &round) == NULL
+                || !dmap_erase(map, &p))
+                erased = false;
+        }
+    }
+    EMU_EXPECT_TRUE(erased);
+    EMU_EXPECT_EQ_UINT(dmap_length(map), 2000);
+    bool found = true;
+    for (int i = 0; i < 4000; ++i)
+    {
+        struct point p = {.x = (short)(i % 64), .y = (short)(i / 64)};
+        int* value = dmap_find(map, &p);
+        found = found && (i % 2 == 0 ? value == NULL
+            : value != NULL && *value == i);
+    }
+    EMU_EXPECT_TRUE(found);
+
+    dmap_clear(map);
+    EMU_EXPECT_EQ_UINT(dmap_length(map), 0);
+    struct point p = {.x = 1, .y = 0};
+    EMU_EXPECT_NULL(dmap_find(map, &p));
+    dmap_free(map);
+    EMU_END_TEST();
+}
+
+EMU_TEST(dmap_alloc_dstr)
+{
+    cust_counter = 0;
+    struct dmap* map = dmap_alloc_dstr_custom(custom_mem_funcs, sizeof(int));
+    EMU_REQUIRE_NOT_NULL(map);
+    EMU_EXPECT_TRUE(cust_counter > 0);
+    char buf[32];
+    for (int i = 0; i < 500; ++i)
+    {
+        snprintf(buf, sizeof(buf), "key %d", i);
+        EMU_REQUIRE_NOT_NULL(dmap_insert(map, buf, &i));
+    }
+    // Keys are copied, so the buffer can be reused for lookups.
+    snprintf(buf, sizeof(buf), "key %d", 123);
+    int* value = dmap_find(map, buf);
+    EMU_REQUIRE_NOT_NULL(value);
+    EMU_EXPECT_EQ_INT(*value, 123);
+    EMU_EXPECT_NULL(dmap_find(map, "key 500"));
+    EMU_EXPECT_TRUE(dmap_erase(map, "key 0"));
+    EMU_EXPECT_NULL(dmap_find(map, "key 0"));
+    EMU_EXPECT_EQ_UINT(dmap_length(map), 499);
+    dmap_free(map);
+    EMU_END_TEST();
+}
+
+EMU_TEST(dmap_next)
+{
+    struct dmap* map = dmap_alloc_dstr(sizeof(int));
+    EMU_REQUIRE_NOT_NULL(map);
+    const char* words[] = {"alpha", "beta", "gamma", "delta", "epsilon"};
+    for (int i = 0; i < 5; ++i)
+        EMU_REQUIRE_NOT_NULL(dmap_insert(map, words[i], &i));
+
+    // Every entry is visited once, and erasing the current entry does not
+    // disturb iteration.
+    int seen = 0;
+    size_t iter = 0;
+    const void* key;
+    void* value;
+    while (dmap_next(map, &iter, &key, &value))
+    {
+        int i = *(int*)value;
+        EMU_EXPECT_STREQ(key, words[i]);
+        seen |= 1 << i;
+        if (i % 2 == 0)
+            EMU_EXPECT_TRUE(dmap_erase(map, key));
+    }
+    EMU_EXPECT_EQ_INT(seen, 0x1f);
+    EMU_EXPECT_EQ_UINT(dmap_length(map), 2);
+    EMU_EXPECT_FALSE(dmap_next(map, &iter, &key, NULL));
+    dmap_free(map);
+    EMU_END_TEST();
+}
+
+EMU_TEST(dmap_alloc__empty_values)
+{
+    struct dmap* map = dmap_alloc(sizeof(uint32_t), 0, NULL, NULL);
+    EMU_REQUIRE_NOT_NULL(map);
+    bool inserted = true;
+    for (uint32_t i = 0; i < 100; ++i)
+        inserted = inserted && dmap_insert(map, &i, NULL) != NULL;
+    EMU_REQUIRE_TRUE(inserted);
+
+    // Empty values take no room in a slot: each sits right after its key.
+    bool packed = true;
+    size_t iter = 0;
+    const void* key;
+    void* value;
+    while (dmap_next(map, &iter, &key, &value))
+    {
+        packed = packed && (char*)value == (const char*)key + sizeof(uint32_t)
+            && dmap_find(map, key) == value;
+    }
+    EMU_EXPECT_TRUE(packed);
+    dmap_free(map);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(dmap_functions)
+{
+    EMU_ADD(dmap_insert__and__dmap_find);
+    EMU_ADD(dmap_custom_hash__and__dmap_erase);
+    EMU_ADD(dmap_alloc_dstr);
+    EMU_ADD(dmap_next);
+    EMU_ADD(dmap_alloc__empty_values);
+    EMU_END_GROUP();
+}
+
+EMU_TEST(dset_insert__and__dset_contains)
+{
+    // 4 and 8 byte keys take the inline path, 3 byte keys the generic one.
+    size_t key_sizes[] = {4, 8, 3};
+    for (size_t k = 0; k < 3; ++k)
+    {
+        size_t sz = key_sizes[k];
+        struct dset* set = dset_alloc(sz, NULL, NULL);
+        EMU_REQUIRE_NOT_NULL(set);
+        bool inserted = true;
+        for (uint64_t i = 0; i < 5000; ++i)
+        {
+            uint64_t key = i * 3;
+            inserted = inserted && dset_insert(set, &key)
+                && dset_insert(set, &key);
+        }
+        EMU_EXPECT_TRUE(inserted);
+        EMU_EXPECT_EQ_UINT(dset_length(set), 5000);
+        bool found = true;
+        for (uint64_t key = 0; key < 15000; ++key)
+            found = found && dset_contains(set, &key) == (key % 3 == 0);
+        EMU_EXPECT_TRUE(found);
+
+        uint64_t key = 3;
+        EMU_EXPECT_TRUE(dset_erase(set, &key));
+        EMU_EXPECT_FALSE(dset_erase(set, &key));
+        EMU_EXPECT_FALSE(dset_contains(set, &key));
+        size_t iter = 0;
+        size_t count = 0;
+        const void* it;
+        while (dset_next(set, &iter, &it))
+            count += 1;
+        EMU_EXPECT_EQ_UINT(count, 4999);
+        dset_clear(set);
+        EMU_EXPECT_EQ_UINT(dset_length(set), 0);
+        dset_free(set);
+    }
+    EMU_END_TEST();
+}
+
+EMU_TEST(dset_insert_many__and__dset_contains_many)
+{
+    struct dset* set = dset_alloc(sizeof(uint32_t), NULL, NULL);
+    EMU_REQUIRE_NOT_NULL(set);
+    // Keys repeat within the array, and within a batch.
+    darray(uint32_t) keys = da_alloc(3001, sizeof(uint32_t));
+    for (size_t i = 0; i < da_length(keys); ++i)
+        keys[i] = (uint32_t)(i % 1000) * 2;
+    EMU_REQUIRE_TRUE(dset_insert_many(set, keys, da_length(keys)));
+    EMU_EXPECT_EQ_UINT(dset_length(set), 1000);
+
+    darray(uint32_t) queries = da_alloc(2001, sizeof(uint32_t));
+    for (size_t i = 0; i < da_length(queries); ++i)
+        queries[i] = (uint32_t)i;
+    bool* found = malloc(da_length(queries) * sizeof(bool));
+    EMU_REQUIRE_NOT_NULL(found);
+    EMU_EXPECT_EQ_UINT(dset_contains_many(set, queries, da_length(queries),
+        found), 1000);
+    bool matches = true;
+    for (size_t i = 0; i < da_length(queries); ++i)
+        matches = matches && found[i] == (i % 2 == 0 && i < 2000);
+    EMU_EXPECT_TRUE(matches);
+    EMU_EXPECT_EQ_UINT(dset_contains_many(set, queries, 7, NULL), 4);
+    EMU_EXPECT_EQ_UINT(dset_contains_many(set, queries, 0, NULL), 0);
+
+    free(found);
+    da_free(queries);
+    da_free(keys);
+    dset_free(set);
+    EMU_END_TEST();
+}
+
+EMU_TEST(dset_reserve__slot_footprint)
+{
+    // Room for 100000 keys at a 7/8 maximum load takes 131072 slots, each
+    // holding nothing but its key.
+    size_t key_sizes[] = {4, 8};
+    for (size_t k = 0; k < 2; ++k)
+    {
+        largest_alloc = 0;
+        struct dset* set = dset_alloc_custom(largest_mem_funcs, key_sizes[k],
+            NULL, NULL);
+        EMU_REQUIRE_NOT_NULL(set);
+        EMU_REQUIRE_TRUE(dset_reserve(set, 100000));
+        EMU_EXPECT_EQ_UINT(largest_alloc,
+            sizeof(struct _darray) + 131072*key_sizes[k]);
+        dset_free(set);
+    }
+    EMU_END_TEST();
+}
+
+EMU_GROUP(dset_functions)
+{
+    EMU_ADD(dset_insert__and__dset_contains);
+    EMU_ADD(dset_insert_many__and__dset_contains_many);
+    EMU_ADD(dset_reserve__slot_footprint);
+    EMU_END_GROUP();
+}
+
+EMU_TEST(dbits_set__and__dbits_clear__and__dbits_push)
+{
+    struct dbits* bits = dbits_alloc(130);
+    EMU_REQUIRE_NOT_NULL(bits);
+    EMU_EXPECT_EQ_UINT(dbits_length(bits), 130);
+    EMU_EXPECT_EQ_UINT(dbits_popcount(bits), 0);
+    EMU_EXPECT_EQ_INT(dbits_find_next_set(bits, 0), -1);
+    dbits_set(bits, 0);
+    dbits_set(bits, 64);
+    dbits_set(bits, 129);
+    dbits_set(bits, 70);
+    dbits_clear(bits, 70);
+    EMU_EXPECT_TRUE(dbits_test(bits, 64));
+    EMU_EXPECT_FALSE(dbits_test(bits, 70));
+    EMU_EXPECT_EQ_UINT(dbits_popcount(bits), 3);
+    EMU_EXPECT_EQ_INT(dbits_find_next_set(bits, 1), 64);
+    EMU_EXPECT_EQ_INT(dbits_find_next_set(bits, 65), 129);
+    EMU_EXPECT_EQ_INT(dbits_find_next_set(bits, 130), -1);
+
+    // Pushed bits follow the existing ones, across word boundaries.
+    bool pushed = true;
+    for (size_t i = 0; i < 200; ++i)
+        pushed = pushed && dbits_push(bits, i % 3 == 0);
+    EMU_EXPECT_TRUE(pushed);
+    EMU_EXPECT_EQ_UINT(dbits_length(bits), 330);
+    EMU_EXPECT_EQ_UINT(da_length(dbits_words(bits)), 6);
+    bool matches = true;
+    for (size_t i = 0; i < 200; ++i)
+        matches = matches && dbits_test(bits, 130 + i) == (i % 3 == 0);
+    EMU_EXPECT_TRUE(matches);
+    EMU_EXPECT_EQ_UINT(dbits_popcount(bits), 3 + 67);
+
+    // Shrinking clears the bits past the new length, so growing again does
+    // not bring them back.
+    EMU_REQUIRE_TRUE(dbits_resize(bits, 129));
+    EMU_EXPECT_EQ_UINT(dbits_popcount(bits), 2);
+    EMU_REQUIRE_TRUE(dbits_resize(bits, 1000));
+    EMU_EXPECT_EQ_UINT(dbits_popcount(bits), 2);
+    dbits_fill(bits, true);
+    EMU_EXPECT_EQ_UINT(dbits_popcount(bits), 1000);
+    dbits_fill(bits, false);
+    EMU_EXPECT_EQ_UINT(dbits_popcount(bits), 0);
+    dbits_free(bits);
+    EMU_END_TEST();
+}
+
+EMU_TEST(dbits_and__or__xor__andnot)
+{
+    // Lengths that differ, are not multiples of a word, and span several
+    // SIMD blocks.
+    const size_t lengths[][2] = {{1000, 1000}, {1000, 700}, {700, 1000}};
+    for (size_t t = 0; t < 3; ++t)
+    {
+        for (int op = 0; op < 4; ++op)
+        {
+            struct dbits* dst = dbits_alloc(lengths[t][0]);
+            struct dbits* src = dbits_alloc(lengths[t][1]);
+            EMU_REQUIRE_NOT_NULL(dst);
+            EMU_REQUIRE_NOT_NULL(src);
+            for (size_t i = 0; i < lengths[t][0]; ++i)
+                if (i % 3 == 0 || i % 5 == 0)
+                    dbits_set(dst, i);
+            for (size_t i = 0; i < lengths[t][1]; ++i)
+                if (i % 2 == 0)
+                    dbits_set(src, i);
+            switch (op)
+            {
+            case 0:  dbits_and(dst, src);    break;
+            case 1:  dbits_or(dst, src);     break;
+            case 2:  dbits_xor(dst, src);    break;
+            default: dbits_andnot(dst, src); break;
+            }
+            bool matches = true;
+            size_t expected_count = 0;
+            for (size_t i = 0; i < lengths[t][0]; ++i)
+            {
+                bool a = i % 3 == 0 || i % 5 == 0;
+                bool b = i < lengths[t][1] && i % 2 == 0;
+                bool expected = op == 0 ? a && b
+                    : op == 1 ? a || b
+                    : op == 2 ? a != b
+                    : a && !b;
+                matches = matches && dbits_test(dst, i) == expected;
+                expected_count += expected;
+            }
+            EMU_EXPECT_TRUE(matches);
+            EMU_EXPECT_EQ_UINT(dbits_popcount(dst), expected_count);
+            dbits_free(dst);
+            dbits_free(src);
+        }
+    }
+    EMU_END_TEST();
+}
+
+EMU_TEST(dbits_rank__and__dbits_select)
+{
+    struct dbits* bits = dbits_alloc(0);
+    EMU_REQUIRE_NOT_NULL(bits);
+    for (size_t i = 0; i < 5000; ++i)
+        EMU_REQUIRE_TRUE(dbits_push(bits, (i * 7919) % 11 < 4));
+    size_t total = dbits_popcount(bits);
+
+    for (int indexed = 0; indexed < 2; ++indexed)
+    {
+        if (indexed)
+            EMU_REQUIRE_TRUE(dbits_build_index(bits));
+        bool ranks_match = true;
+        bool selects_match = true;
+        size_t rank = 0;
+        for (size_t i = 0; i <= dbits_length(bits); ++i)
+        {
+            ranks_match = ranks_match && dbits_rank(bits, i) == rank;
+            if (i < dbits_length(bits) && dbits_test(bits, i))
+            {
+                selects_match = selects_match
+                    && dbits_select(bits, rank) == (long)i;
+                rank += 1;
+            }
+        }
+        EMU_EXPECT_TRUE(ranks_match);
+        EMU_EXPECT_TRUE(selects_match);
+        EMU_EXPECT_EQ_UINT(rank, total);
+        EMU_EXPECT_EQ_INT(dbits_select(bits, total), -1);
+    }
+
+    // Modifying the dbits discards the index.
+    dbits_set(bits, 4999);
+    dbits_set(bits, 0);
+    size_t expected = total + !((0 * 7919) % 11 < 4)
+        + !((4999 * 7919) % 11 < 4);
+    EMU_EXPECT_EQ_UINT(dbits_rank(bits, 5000), expected);
+    EMU_EXPECT_EQ_INT(dbits_select(bits, expected - 1), 4999);
+    dbits_free(bits);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(dbits_functions)
+{
+    EMU_ADD(dbits_set__and__dbits_clear__and__dbits_push);
+    EMU_ADD(dbits_and__or__xor__andnot);
+    EMU_ADD(dbits_rank__and__dbits_select);
+    EMU_END_GROUP();
+}
+
+EMU_TEST(dsmap_insert__and__dsmap_find__and__dsmap_erase)
+{
+    // Once with scalar keys and once with a comparison function.
+    for (int scalar = 0; scalar < 2; ++scalar)
+    {
+        struct dsmap* map = scalar
+            ? dsmap_alloc_scalar(DA_KEY_TYPE_OF((int)0), sizeof(double))
+            : dsmap_alloc(sizeof(int), sizeof(double), cmp_int);
+        EMU_REQUIRE_NOT_NULL(map);
+        bool inserted = true;
+        for (int i = 0; i < 200; ++i)
+        {
+            int key = (i * 37) % 200 - 100;
+            double value = key * 2.0;
+            inserted = inserted && dsmap_insert(map, &key, &value) != NULL;
+        }
+        EMU_REQUIRE_TRUE(inserted);
+        EMU_EXPECT_EQ_UINT(dsmap_length(map), 200);
+
+        const int* keys = dsmap_keys(map);
+        const double* values = dsmap_values(map);
+        bool sorted = true;
+        for (int i = 0; i < 200; ++i)
+            sorted = sorted && keys[i] == i - 100 && values[i] == keys[i] * 2.0;
+        EMU_EXPECT_TRUE(sorted);
+
+        int key = 42;
+        double* found = dsmap_find(map, &key);
+        EMU_REQUIRE_NOT_NULL(found);
+        EMU_EXPECT_EQ(*found, 84.0);
+        key = 100;
+        EMU_EXPECT_NULL(dsmap_find(map, &key));
+        key = -101;
+        EMU_EXPECT_NULL(dsmap_find(map, &key));
+
+        // Inserting an existing key overwrites its value unless it is NULL.
+        key = 42;
+        double value = -1.0;
+        EMU_REQUIRE_NOT_NULL(dsmap_insert(map, &key, &value));
+        EMU_REQUIRE_NOT_NULL(dsmap_insert(map, &key, NULL));
+        EMU_EXPECT_EQ(*(double*)dsmap_find(map, &key), -1.0);
+        key = 1000;
+        double* zeroed = dsmap_insert(map, &key, NULL);
+        EMU_REQUIRE_NOT_NULL(zeroed);
+        EMU_EXPECT_EQ(*zeroed, 0.0);
+        EMU_EXPECT_EQ_UINT(dsmap_length(map), 201);
+
+        bool erased = true;
+        for (int k = -100; k < 100; k += 2)
+            erased = erased && dsmap_erase(map, &k);
+        EMU_EXPECT_TRUE(erased);
+        key = -100;
+        EMU_EXPECT_FALSE(dsmap_erase(map, &key));
+        EMU_EXPECT_EQ_UINT(dsmap_length(map), 101);
+        key = -99;
+        EMU_EXPECT_EQ_UINT(dsmap_lower_bound(map, &key), 0);
+        key = 0;
+        EMU_EXPECT_EQ_UINT(dsmap_lower_bound(map, &key), 50);
+        EMU_EXPECT_EQ(*(double*)dsmap_find(map, &(int){1}), 2.0);
+
+        dsmap_clear(map);
+        EMU_EXPECT_EQ_UINT(dsmap_length(map), 0);
+        EMU_EXPECT_NULL(dsmap_find(map, &key));
+        dsmap_free(map);
+    }
+    EMU_END_TEST();
+}
+
+EMU_TEST(dsmap_insert_many__and__dsmap_range)
+{
+    struct dsmap* map = dsmap_alloc_scalar(DA_KEY_F64, sizeof(int));
+    EMU_REQUIRE_NOT_NULL(map);
+    double keys[300];
+    int values[300];
+    for (int i = 0; i < 300; ++i)
+    {
+        // Every key appears three times, and the last one should win.
+        keys[i] = (double)((i * 7) % 100) - 50.5;
+        values[i] = i;
+    }
+    EMU_REQUIRE_TRUE(dsmap_insert_many(map, keys, values, 300));
+    EMU_EXPECT_EQ_UINT(dsmap_length(map), 100);
+    const double* map_keys = dsmap_keys(map);
+    const int* map_values = dsmap_values(map);
+    bool matches = true;
+    for (int i = 0; i < 100; ++i)
+    {
+        int last = 0;
+        for (int j = 0; j < 300; ++j)
+            if (keys[j] == i - 50.5)
+                last = j;
+        matches = matches && map_keys[i] == i - 50.5 && map_values[i] == last;
+    }
+    EMU_EXPECT_TRUE(matches);
+
+    // Merging keeps the values of existing keys when no values are given.
+    double more[] = {1000.0, -0.5, -1000.0, 1000.0};
+    int before = *(int*)dsmap_find(map, &more[1]);
+    EMU_REQUIRE_TRUE(dsmap_insert_many(map, more, NULL, 4));
+    EMU_EXPECT_EQ_UINT(dsmap_length(map), 102);
+    EMU_EXPECT_EQ(*(int*)dsmap_find(map, &more[1]), before);
+    EMU_EXPECT_EQ(*(int*)dsmap_find(map, &more[0]), 0);
+    map_keys = dsmap_keys(map);
+    EMU_EXPECT_EQ(map_keys[0], -1000.0);
+    EMU_EXPECT_EQ(map_keys[101], 1000.0);
+    EMU_REQUIRE_TRUE(dsmap_insert_many(map, more, NULL, 0));
+    EMU_EXPECT_EQ_UINT(dsmap_length(map), 102);
+    map_keys = dsmap_keys(map);
+
+    double lo = -10.0;
+    double hi = 10.0;
+    struct da_range range = dsmap_range(map, &lo, &hi);
+    EMU_EXPECT_EQ_UINT(range.end - range.begin, 20);
+    EMU_EXPECT_EQ(map_keys[range.begin], -9.5);
+    EMU_EXPECT_EQ(map_keys[range.end - 1], 9.5);
+    range = dsmap_range(map, NULL, &lo);
+    EMU_EXPECT_EQ_UINT(range.begin, 0);
+    EMU_EXPECT_EQ_UINT(range.end, 42);
+    range = dsmap_range(map, &hi, NULL);
+    EMU_EXPECT_EQ_UINT(range.end, 102);
+    range = dsmap_range(map, &hi, &lo);
+    EMU_EXPECT_EQ_UINT(range.end, range.begin);
+    dsmap_free(map);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(dsmap_functions)
+{
+    EMU_ADD(dsmap_insert__and__dsmap_find__and__dsmap_erase);
+    EMU_ADD(dsmap_insert_many__and__dsmap_range);
+    EMU_END_GROUP();
+}
+
+EMU_TEST(dslotmap_insert__and__dslotmap_erase)
+{
+    struct dslotmap* map = dslotmap_alloc(sizeof(int));
+    EMU_REQUIRE_NOT_NULL(map);
+    struct dslotmap_handle handles[100];
+    bool inserted = true;
+    for (int i = 0; i < 100; ++i)
+        inserted = inserted && dslotmap_insert(map, &i, &handles[i]) != NULL;
+    EMU_REQUIRE_TRUE(inserted);
+    EMU_EXPECT_EQ_UINT(dslotmap_length(map), 100);
+    EMU_EXPECT_NULL(dslotmap_get(map, (struct dslotmap_handle){0}));
+
+    // Erasing moves values in the dense darray but not behind the handles.
+    bool erased = true;
+    for (int i = 0; i < 100; i += 3)
+        erased = erased && dslotmap_erase(map, handles[i]);
+    EMU_EXPECT_TRUE(erased);
+    EMU_EXPECT_FALSE(dslotmap_erase(map, handles[0]));
+    EMU_EXPECT_EQ_UINT(dslotmap_length(map), 66);
+    bool found = true;
+    for (int i = 0; i < 100; ++i)
+    {
+        int* value = dslotmap_get(map, handles[i]);
+        found = found && (i % 3 == 0 ? value == NULL : *value == i);
+    }
+    EMU_EXPECT_TRUE(found);
+
+    // The dense values are contiguous and agree with their handles.
+    const int* values = dslotmap_values(map);
+    int sum = 0;
+    bool consistent = true;
+    for (size_t i = 0; i < dslotmap_length(map); ++i)
+    {
+        sum += values[i];
+        int* value = dslotmap_get(map, dslotmap_handle_at(map, i));
+        consistent = consistent && value == &values[i];
+    }
+    EMU_EXPECT_TRUE(consistent);
+    EMU_EXPECT_EQ(sum, 4950 - 1683);
+
+    // Reused slots hand out new generations, so stale handles stay stale.
+    struct dslotmap_handle reused;
+    int* zeroed = dslotmap_insert(map, NULL, &reused);
+    EMU_REQUIRE_NOT_NULL(zeroed);
+    EMU_EXPECT_EQ(*zeroed, 0);
+    EMU_EXPECT_EQ(reused.index, handles[99].index);
+    EMU_EXPECT_NULL(dslotmap_get(map, handles[99]));
+    EMU_EXPECT_EQ(dslotmap_get(map, reused), zeroed);
+
+    dslotmap_clear(map);
+    EMU_EXPECT_EQ_UINT(dslotmap_length(map), 0);
+    EMU_EXPECT_NULL(dslotmap_get(map, reused));
+    EMU_EXPECT_NULL(dslotmap_get(map, handles[1]));
+    EMU_REQUIRE_TRUE(dslotmap_reserve(map, 1000));
+    int value = 7;
+    struct dslotmap_handle handle;
+    EMU_REQUIRE_NOT_NULL(dslotmap_insert(map, &value, &handle));
+    EMU_EXPECT_EQ(*(int*)dslotmap_get(map, handle), 7);
+    dslotmap_free(map);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(dslotmap_functions)
+{
+    EMU_ADD(dslotmap_insert__and__dslotmap_erase);
+    EMU_END_GROUP();
+}
+
+EMU_TEST(djagged_push_row__and__djagged_push)
+{
+    struct djagged* jag = djagged_alloc(sizeof(int));
+    EMU_REQUIRE_NOT_NULL(jag);
+    EMU_EXPECT_EQ_UINT(djagged_nrows(jag), 0);
+    int first[] = {1, 2, 3};
+    EMU_REQUIRE_TRUE(djagged_push_row(jag, first, 3));
+    EMU_REQUIRE_TRUE(djagged_push_row(jag, NULL, 0));
+    bool pushed = true;
+    for (int i = 0; i < 100; ++i)
+        pushed = pushed && djagged_push(jag, &i) != NULL;
+    EMU_REQUIRE_TRUE(pushed);
+    EMU_REQUIRE_TRUE(djagged_push_row(jag, NULL, 2));
+    int tail[] = {7, 8};
+    EMU_REQUIRE_TRUE(djagged_append(jag, tail, 2));
+
+    EMU_EXPECT_EQ_UINT(djagged_nrows(jag), 3);
+    EMU_EXPECT_EQ_UINT(djagged_length(jag), 107);
+    EMU_EXPECT_EQ_UINT(djagged_row_length(jag, 0), 3);
+    EMU_EXPECT_EQ_UINT(djagged_row_length(jag, 1), 100);
+    EMU_EXPECT_EQ_UINT(djagged_row_length(jag, 2), 4);
+    const int* row = djagged_row(jag, 1);
+    bool same = true;
+    for (int i = 0; i < 100; ++i)
+        same = same && row[i] == i;
+    EMU_EXPECT_TRUE(same);
+    row = djagged_row(jag, 2);
+    EMU_EXPECT_TRUE(row[0] == 0 && row[1] == 0 && row[2] == 7 && row[3] == 8);
+    const size_t* offsets = djagged_offsets(jag);
+    EMU_EXPECT_EQ_UINT(da_length(offsets), 4);
+    EMU_EXPECT_EQ_UINT(offsets[3], 107);
+
+    // Row ranges work with the ranged darray functions.
+    struct da_range range = djagged_row_range(jag, 0);
+    da_reverse_range(djagged_values(jag), range.begin, range.end-range.begin);
+    row = djagged_row(jag, 0);
+    EMU_EXPECT_TRUE(row[0] == 3 && row[1] == 2 && row[2] == 1);
+
+    djagged_pop_row(jag);
+    EMU_EXPECT_EQ_UINT(djagged_nrows(jag), 2);
+    EMU_EXPECT_EQ_UINT(djagged_length(jag), 103);
+    djagged_clear(jag);
+    EMU_EXPECT_EQ_UINT(djagged_nrows(jag), 0);
+    EMU_EXPECT_EQ_UINT(djagged_length(jag), 0);
+    djagged_free(jag);
+    EMU_END_TEST();
+}
+
+EMU_TEST(djagged_from_nested__and__djagged_to_nested)
+{
+    darray(darray(int)) nested = da_alloc(4, sizeof(darray(int)));
+    EMU_REQUIRE_NOT_NULL(nested);
+    for (int i = 0; i < 4; ++i)
+    {
+        nested[i] = da_alloc((size_t)i*3, sizeof(int));
+        EMU_REQUIRE_NOT_NULL(nested[i]);
+        for (int j = 0; j < i*3; ++j)
+            nested[i][j] = i*100 + j;
+    }
+    struct djagged* jag = djagged_from_nested(nested, sizeof(int));
+    EMU_REQUIRE_NOT_NULL(jag);
+    EMU_EXPECT_EQ_UINT(djagged_nrows(jag), 4);
+    EMU_EXPECT_EQ_UINT(djagged_length(jag), 18);
+    EMU_EXPECT_EQ_UINT(djagged_row_length(jag, 0), 0);
+    EMU_EXPECT_EQ(((int*)djagged_row(jag, 3))[8], 308);
+
+    darray(darray(int)) copy = djagged_to_nested(jag);
+    EMU_REQUIRE_NOT_NULL(copy);
+    EMU_REQUIRE_EQ_UINT(da_length(copy), 4);
+    bool same = true;
+    for (int i = 0; i < 4; ++i)
+    {
+        same = same && da_length(copy[i]) == da_length(nested[i])
+            && memcmp(copy[i], nested[i], da_length(nested[i])*sizeof(int)) == 0;
+        da_free(copy[i]);
+        da_free(nested[i]);
+    }
+    EMU_EXPECT_TRUE(same);
+    da_free(copy);
+    da_free(nested);
+    djagged_free(jag);
+
+    darray(darray(int)) empty = da_alloc(0, sizeof(darray(int)));
+    EMU_REQUIRE_NOT_NULL(empty);
+    jag = djagged_from_nested(empty, sizeof(int));
+    EMU_REQUIRE_NOT_NULL(jag);
+    EMU_EXPECT_EQ_UINT(djagged_nrows(jag), 0);
+    djagged_free(jag);
+    da_free(empty);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(djagged_functions)
+{
+    EMU_ADD(djagged_push_row__and__djagged_push);
+    EMU_ADD(djagged_from_nested__and__djagged_to_nested);
+    EMU_END_GROUP();
+}
+
+EMU_TEST(dpacked_push__and__dpacked_set)
+{
+    struct dpacked* packed = dpacked_alloc(3);
+    EMU_REQUIRE_NOT_NULL(packed);
+    bool pushed = true;
+    for (uint64_t i = 0; i < 1000; ++i)
+        pushed = pushed && dpacked_push(packed, i % 8);
+    EMU_REQUIRE_TRUE(pushed);
+    EMU_EXPECT_EQ_UINT(dpacked_width(packed), 3);
+    EMU_EXPECT_EQ_UINT(dpacked_length(packed), 1000);
+
+    // Values that do not fit widen every element.
+    EMU_REQUIRE_TRUE(dpacked_push(packed, 1000));
+    EMU_EXPECT_EQ_UINT(dpacked_width(packed), 10);
+    EMU_REQUIRE_TRUE(dpacked_set(packed, 5, UINT64_MAX));
+    EMU_EXPECT_EQ_UINT(dpacked_width(packed), 64);
+    EMU_EXPECT_EQ_UINT(dpacked_get(packed, 5), UINT64_MAX);
+    EMU_REQUIRE_TRUE(dpacked_set(packed, 5, 5));
+    bool same = true;
+    for (size_t i = 0; i < 1000; ++i)
+        same = same && dpacked_get(packed, i) == i % 8;
+    EMU_EXPECT_TRUE(same);
+    EMU_EXPECT_EQ_UINT(dpacked_get(packed, 1000), 1000);
+
+    dpacked_clear(packed);
+    EMU_EXPECT_EQ_UINT(dpacked_length(packed), 0);
+    EMU_REQUIRE_TRUE(dpacked_reserve(packed, 10));
+    EMU_REQUIRE_TRUE(dpacked_push(packed, 42));
+    EMU_EXPECT_EQ_UINT(dpacked_get(packed, 0), 42);
+    dpacked_free(packed);
+    EMU_END_TEST();
+}
+
+EMU_TEST(dpacked_from_darray__and__dpacked_to_darray)
+{
+    const size_t nelem = 1003;
+    uint32_t* src = da_alloc(nelem, sizeof(uint32_t));
+    EMU_REQUIRE_NOT_NULL(src);
+    // Unpack at every width into every element size, covering both the
+    // vectorized and scalar paths and partial groups at the end.
+    bool same = true;
+    for (unsigned width = 1; width <= 32; ++width)
+    {
+        uint32_t mask = width == 32 ? UINT32_MAX : (1u << width) - 1;
+        for (size_t i = 0; i < nelem; ++i)
+            src[i] = ((uint32_t)rand() * 2654435761u) & mask;
+        src[nelem-1] = mask;
+        struct dpacked* packed = dpacked_from_darray(src);
+        EMU_REQUIRE_NOT_NULL(packed);
+        same = same && dpacked_width(packed) == width
+            && dpacked_length(packed) == nelem;
+        uint32_t* u32 = dpacked_to_darray(packed, sizeof(uint32_t));
+        uint64_t* u64 = dpacked_to_darray(packed, sizeof(uint64_t));
+        uint8_t* u8 = dpacked_to_darray(packed, sizeof(uint8_t));
+        EMU_REQUIRE_NOT_NULL(u32);
+        EMU_REQUIRE_NOT_NULL(u64);
+        EMU_REQUIRE_NOT_NULL(u8);
+        same = same && da_length(u32) == nelem && da_sizeof_elem(u8) == 1;
+        for (size_t i = 0; i < nelem; ++i)
+        {
+            same = same && u32[i] == src[i] && u64[i] == src[i]
+                && u8[i] == (uint8_t)src[i]
+                && dpacked_get(packed, i) == src[i];
+        }
+        da_free(u8);
+        da_free(u64);
+        da_free(u32);
+        dpacked_free(packed);
+    }
+    EMU_EXPECT_TRUE(same);
+    da_free(src);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(dpacked_functions)
+{
+    EMU_ADD(dpacked_push__and__dpacked_set);
+    EMU_ADD(dpacked_from_darray__and__dpacked_to_darray);
+    EMU_END_GROUP();
+}
+
+struct particle
+{
+    char tag;
+    double mass;
+    int id;
+    float pos[3];
+};
+
+static const struct dsoa_field particle_fields[] = {
+    DSOA_FIELD(struct particle, id),
+    DSOA_FIELD(struct particle, mass),
+    DSOA_FIELD(struct particle, tag),
+    DSOA_FIELD(struct particle, pos),
+};
+
+static struct particle make_particle(int id)
+{
+    return (struct particle){
+        .tag = (char)('a' + id % 26),
+        .mass = id * 0.5,
+        .id = id,
+        .pos = {(float)id, (float)-id, 1.0f},
+    };
+}
+
+static bool particle_eq(struct particle p, int id)
+{
+    struct particle q = make_particle(id);
+    return p.tag == q.tag && p.mass == q.mass && p.id == q.id
+        && memcmp(p.pos, q.pos, sizeof(p.pos)) == 0;
+}
+
+EMU_TEST(dsoa_push__and__dsoa_insert__and__dsoa_remove)
+{
+    cust_counter = 0;
+    struct dsoa* soa = dsoa_alloc_custom(custom_mem_funcs,
+        sizeof(struct particle), particle_fields, 4);
+    EMU_REQUIRE_NOT_NULL(soa);
+    EMU_EXPECT_TRUE(cust_counter > 0);
+    bool pushed = true;
+    for (int i = 0; i < 100; ++i)
+    {
+        struct particle p = make_particle(i);
+        pushed = pushed && dsoa_push(soa, &p);
+    }
+    EMU_REQUIRE_TRUE(pushed);
+    EMU_EXPECT_EQ_UINT(dsoa_length(soa), 100);
+    EMU_EXPECT_TRUE(dsoa_capacity(soa) >= 100);
+
+    // Columns are plain, cache line aligned arrays.
+    int* ids = dsoa_column(soa, 0);
+    double* masses = dsoa_column(soa, 1);
+    float (*pos)[3] = dsoa_column(soa, 3);
+    bool aligned = true;
+    for (size_t c = 0; c < 4; ++c)
+        aligned = aligned && (uintptr_t)dsoa_column(soa, c) % 64 == 0;
+    EMU_EXPECT_TRUE(aligned);
+    bool matches = true;
+    for (int i = 0; i < 100; ++i)
+    {
+        matches = matches && ids[i] == i && masses[i] == i * 0.5
+            && pos[i][1] == (float)-i;
+    }
+    EMU_EXPECT_TRUE(matches);
+
+    struct particle p = make_particle(1000);
+    EMU_REQUIRE_TRUE(dsoa_insert(soa, 0, &p));
+    p = make_particle(2000);
+    EMU_REQUIRE_TRUE(dsoa_insert(soa, 50, &p));
+    EMU_REQUIRE_TRUE(dsoa_insert(soa, dsoa_length(soa), NULL));
+    EMU_EXPECT_EQ_UINT(dsoa_length(soa), 103);
+    struct particle out;
+    dsoa_get(soa, 0, &out);
+    EMU_EXPECT_TRUE(particle_eq(out, 1000));
+    dsoa_get(soa, 50, &out);
+    EMU_EXPECT_TRUE(particle_eq(out, 2000));
+    dsoa_get(soa, 51, &out);
+    EMU_EXPECT_TRUE(particle_eq(out, 49));
+    dsoa_get(soa, 102, &out);
+    EMU_EXPECT_EQ(out.id, 0);
+    EMU_EXPECT_EQ(out.tag, 0);
+    EMU_EXPECT_EQ(out.pos[2], 0.0f);
+
+    dsoa_remove(soa, 50, &out);
+    EMU_EXPECT_TRUE(particle_eq(out, 2000));
+    dsoa_remove(soa, 0, NULL);
+    dsoa_remove(soa, dsoa_length(soa) - 1, NULL);
+    EMU_EXPECT_EQ_UINT(dsoa_length(soa), 100);
+    ids = dsoa_column(soa, 0);
+    matches = true;
+    for (int i = 0; i < 100; ++i)
+    {
+        dsoa_get(soa, (size_t)i, &out);
+        matches = matches && ids[i] == i && particle_eq(out, i);
+    }
+    EMU_EXPECT_TRUE(matches);
+
+    p = make_particle(7);
+    dsoa_set(soa, 3, &p);
+    dsoa_get(soa, 3, &out);
+    EMU_EXPECT_TRUE(particle_eq(out, 7));
+
+    // Growing zeroes the added records even where removed records were.
+    EMU_REQUIRE_TRUE(dsoa_resize(soa, 10));
+    EMU_REQUIRE_TRUE(dsoa_resize(soa, 20));
+    dsoa_get(soa, 15, &out);
+    EMU_EXPECT_EQ(out.id, 0);
+    EMU_EXPECT_EQ(out.mass, 0.0);
+    EMU_EXPECT_EQ(out.pos[0], 0.0f);
+    dsoa_free(soa);
+    EMU_END_TEST();
+}
+
+EMU_TEST(dsoa_from_darray__and__dsoa_to_darray)
+{
+    struct particle* aos = da_alloc(5000, sizeof(struct particle));
+    EMU_REQUIRE_NOT_NULL(aos);
+    memset(aos, 0, 5000*sizeof(struct particle));
+    for (int i = 0; i < 5000; ++i)
+        aos[i] = make_particle(i);
+
+    struct dsoa* soa = dsoa_from_darray(aos, particle_fields, 4);
+    EMU_REQUIRE_NOT_NULL(soa);
+    EMU_EXPECT_EQ_UINT(dsoa_length(soa), 5000);
+    int* ids = dsoa_column(soa, 0);
+    char* tags = dsoa_column(soa, 2);
+    bool matches = true;
+    for (int i = 0; i < 5000; ++i)
+        matches = matches && ids[i] == i && tags[i] == aos[i].tag;
+    EMU_EXPECT_TRUE(matches);
+
+    // Appending converts onto the end of the existing records.
+    EMU_REQUIRE_TRUE(dsoa_append_darray(soa, aos));
+    EMU_EXPECT_EQ_UINT(dsoa_length(soa), 10000);
+    struct particle out;
+    dsoa_get(soa, 9999, &out);
+    EMU_EXPECT_TRUE(particle_eq(out, 4999));
+
+    dsoa_remove(soa, 0, NULL);
+    struct particle* back = dsoa_to_darray(soa);
+    EMU_REQUIRE_NOT_NULL(back);
+    EMU_EXPECT_EQ_UINT(da_length(back), 9999);
+    EMU_EXPECT_EQ_UINT(da_sizeof_elem(back), sizeof(struct particle));
+    // Records are compared field by field, as their padding is unspecified.
+    bool same = true;
+    for (int i = 0; i < 4999; ++i)
+        same = same && particle_eq(back[i], i + 1);
+    for (int i = 0; i < 5000; ++i)
+        same = same && particle_eq(back[4999 + i], i);
+    EMU_EXPECT_TRUE(same);
+    da_free(back);
+    dsoa_free(soa);
+
+    // Fields not stored in the dsoa come back zeroed.
+    soa = dsoa_from_darray(aos, particle_fields, 2);
+    EMU_REQUIRE_NOT_NULL(soa);
+    back = dsoa_to_darray(soa);
+    EMU_REQUIRE_NOT_NULL(back);
+    EMU_EXPECT_EQ(back[10].id, 10);
+    EMU_EXPECT_EQ(back[10].mass, 5.0);
+    EMU_EXPECT_EQ(back[10].tag, 0);
+    EMU_EXPECT_EQ(back[10].pos[0], 0.0f);
+    da_free(back);
+    dsoa_free(soa);
+    da_free(aos);
+    EMU_END_TEST();
+}
+
+EMU_GROUP(dsoa_functions)
+{
+    EMU_ADD(dsoa_push__and__dsoa_insert__and__dsoa_remove);
+    EMU_ADD(dsoa_from_darray__and__dsoa_to_darray);
+    EMU_END_GROUP();
+}
+
 struct foo
 {
     int a;
@@ -1323,6 +3825,14 @@ EMU_GROUP(all_tests)
 {
     EMU_ADD(darray_functions);
     EMU_ADD(dstring_functions);
+    EMU_ADD(dmap_functions);
+    EMU_ADD(dset_functions);
+    EMU_ADD(dbits_functions);
+    EMU_ADD(dsoa_functions);
+    EMU_ADD(dsmap_functions);
+    EMU_ADD(dslotmap_functions);
+    EMU_ADD(djagged_functions);
+    EMU_ADD(dpacked_functions);
     EMU_ADD(testing_with_additional_types);
     EMU_END_GROUP();
 }
@@ -1,5 +1,6 @@
 #include "perf.test.h"
 #include "../../darray.h"
+#include <unistd.h>
 
 int* arr;
 int* darr;
@@ -225,3 +226,1241 @@ void swap_rand(void)
     swap_rand_helper(nelem, MED_SIZE);
     swap_rand_helper(nelem, LARGE_SIZE);
 }
+
+// MAP RAND ////////////////////////////////////////////////////////////////////
+void double_int(void* out, const void* in, void* ctx)
+{
+    (void)ctx;
+    *(int*)out = *(const int*)in * 2;
+}
+
+void map_rand_helper(size_t max_sz)
+{
+    darr = da_alloc(max_sz, sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr[i] = rand();
+    }
+
+    int* mapped = da_alloc(0, sizeof(int));
+    begin = clock();
+    da_foreach(darr, iter)
+    {
+        mapped = da_push(mapped, *iter * 2);
+    }
+    end = clock();
+    da_free(mapped);
+    print_results(DARR, max_sz, begin, end);
+
+    begin = clock();
+    mapped = da_map_to(darr, int, double_int, NULL);
+    end = clock();
+    da_free(mapped);
+    da_free(darr);
+    print_results(DARR_MAP, max_sz, begin, end);
+}
+
+void map_rand(void)
+{
+    puts("MAPPING AN ARRAY INTO A NEW ARRAY");
+    map_rand_helper(MED_SIZE);
+    map_rand_helper(LARGE_SIZE);
+}
+
+// SORT RAND ///////////////////////////////////////////////////////////////////
+int cmp_int(const void* a, const void* b)
+{
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+void sort_rand_helper(size_t max_sz)
+{
+    arr = malloc(max_sz*sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        arr[i] = rand();
+    }
+    begin = clock();
+    qsort(arr, max_sz, sizeof(int), cmp_int);
+    end = clock();
+    free(arr);
+    print_results(CARR_QSORT, max_sz, begin, end);
+
+    darr = da_alloc(max_sz, sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr[i] = rand();
+    }
+    begin = clock();
+    da_sort(darr, cmp_int);
+    end = clock();
+    da_free(darr);
+    print_results(DARR_SORT, max_sz, begin, end);
+
+    darr = da_alloc(max_sz, sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr[i] = rand();
+    }
+    begin = clock();
+    da_sort_int(darr);
+    end = clock();
+    da_free(darr);
+    print_results(DARR_SORT_T, max_sz, begin, end);
+}
+
+void sort_rand(void)
+{
+    puts("SORT AN ARRAY OF RANDOM INTEGERS");
+    sort_rand_helper(SMALL_SIZE);
+    sort_rand_helper(MED_SIZE);
+    sort_rand_helper(LARGE_SIZE);
+}
+
+// RADIX SORT RAND /////////////////////////////////////////////////////////////
+void radix_sort_rand_helper(size_t max_sz)
+{
+    darray(uint32_t) darr32 = da_alloc(max_sz, sizeof(uint32_t));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr32[i] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+    }
+    begin = clock();
+    da_sort_uint(darr32);
+    end = clock();
+    da_free(darr32);
+    print_results(DARR_SORT_T, max_sz, begin, end);
+
+    darr32 = da_alloc(max_sz, sizeof(uint32_t));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr32[i] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+    }
+    begin = clock();
+    if (!da_radix_sort_u32(darr32))
+        puts("da_radix_sort_u32 allocation failure");
+    end = clock();
+    da_free(darr32);
+    print_results(DARR_RADIX, max_sz, begin, end);
+}
+
+void radix_sort_rand(void)
+{
+    puts("RADIX SORT AN ARRAY OF RANDOM 32-BIT INTEGERS");
+    radix_sort_rand_helper(MED_SIZE);
+    radix_sort_rand_helper(LARGE_SIZE);
+}
+
+// PERCENTILES RAND ////////////////////////////////////////////////////////////
+void percentiles_rand_helper(size_t max_sz)
+{
+    double qs[] = {0.5, 0.99, 0.999};
+    int out[3];
+    long sum = 0;
+
+    darr = da_alloc(max_sz, sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr[i] = rand();
+    }
+    begin = clock();
+    da_sort(darr, cmp_int);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        size_t rank = (size_t)(qs[i] * max_sz);
+        sum += darr[rank > 0 ? rank - 1 : 0];
+    }
+    end = clock();
+    da_free(darr);
+    print_results(DARR_SORT, max_sz, begin, end);
+
+    darr = da_alloc(max_sz, sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr[i] = rand();
+    }
+    begin = clock();
+    da_percentiles(darr, qs, 3, out, cmp_int);
+    end = clock();
+    sum += out[0] + out[1] + out[2];
+    da_free(darr);
+    print_results(DARR_SELECT, max_sz, begin, end);
+    if (sum == 0)
+        puts("all percentiles zero");
+}
+
+void percentiles_rand(void)
+{
+    puts("P50, P99, AND P999 OF AN ARRAY OF RANDOM INTEGERS");
+    percentiles_rand_helper(MED_SIZE);
+    percentiles_rand_helper(LARGE_SIZE);
+}
+
+// PARALLEL SORT SCALING ///////////////////////////////////////////////////////
+void parallel_sort_scaling_helper(size_t max_sz, size_t nthreads)
+{
+    char label[32];
+    snprintf(label, sizeof(label), "darray (%zu thr)", nthreads);
+
+    darr = da_alloc(max_sz, sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr[i] = rand();
+    }
+    double wbegin = wall_msec();
+    if (!da_parallel_sort(darr, cmp_int, nthreads))
+        puts("da_parallel_sort allocation failure");
+    double wend = wall_msec();
+    da_free(darr);
+    print_results_wall(label, max_sz, wbegin, wend);
+}
+
+void parallel_sort_scaling(void)
+{
+    puts("PARALLEL SORT AN ARRAY OF RANDOM INTEGERS (WALL CLOCK)");
+    long nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = nprocs > 0 ? (size_t)nprocs : 1;
+    size_t nthreads = 1;
+    for (; nthreads <= max_threads; nthreads *= 2)
+        parallel_sort_scaling_helper(LARGE_SIZE, nthreads);
+    if (nthreads/2 != max_threads)
+        parallel_sort_scaling_helper(LARGE_SIZE, max_threads);
+}
+
+// SEARCH RAND /////////////////////////////////////////////////////////////////
+void search_rand_helper(size_t max_sz)
+{
+    darr = da_alloc(max_sz, sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr[i] = rand();
+    }
+    da_sort_int(darr);
+    int* keys = malloc(NUM_LOOKUPS*sizeof(int));
+    size_t* indices = malloc(NUM_LOOKUPS*sizeof(size_t));
+    for (size_t i = 0; i < NUM_LOOKUPS; ++i)
+    {
+        keys[i] = darr[rand() % max_sz];
+    }
+
+    size_t found = 0;
+    begin = clock();
+    for (size_t i = 0; i < NUM_LOOKUPS; ++i)
+    {
+        found += bsearch(&keys[i], darr, max_sz, sizeof(int), cmp_int) != NULL;
+    }
+    end = clock();
+    print_results(CARR_BSEARCH, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < NUM_LOOKUPS; ++i)
+    {
+        found += da_lower_bound(darr, &keys[i], cmp_int);
+    }
+    end = clock();
+    print_results(DARR_BOUND, max_sz, begin, end);
+
+    struct da_eytzinger* ez = da_build_eytzinger(darr, cmp_int);
+    begin = clock();
+    for (size_t i = 0; i < NUM_LOOKUPS; ++i)
+    {
+        found += da_eytzinger_lower_bound(ez, &keys[i]);
+    }
+    end = clock();
+    da_eytzinger_free(ez);
+    print_results(DARR_EYTZINGER, max_sz, begin, end);
+
+    struct da_btree_index* bt = da_build_btree_index(darr, cmp_int);
+    begin = clock();
+    for (size_t i = 0; i < NUM_LOOKUPS; ++i)
+    {
+        found += da_btree_index_lower_bound(bt, &keys[i]);
+    }
+    end = clock();
+    da_btree_index_free(bt);
+    print_results(DARR_BTREE, max_sz, begin, end);
+
+    qsort(keys, NUM_LOOKUPS, sizeof(int), cmp_int);
+    begin = clock();
+    da_search_many(darr, keys, NUM_LOOKUPS, indices, cmp_int);
+    end = clock();
+    print_results(DARR_BATCH, max_sz, begin, end);
+
+    if (found == 0)
+        puts("no keys found");
+    free(indices);
+    free(keys);
+    da_free(darr);
+}
+
+void search_rand(void)
+{
+    puts("SEARCH A SORTED ARRAY FOR 1000000 RANDOM KEYS");
+    search_rand_helper(MED_SIZE);
+    search_rand_helper(LARGE_SIZE);
+}
+
+// MERGE BATCH RAND ////////////////////////////////////////////////////////////
+// Inserts a batch of random keys, 1% of the size of the darray, into a sorted
+// darray. Inserting the keys one at a time is only timed for darrays small
+// enough to finish in reasonable time.
+void merge_batch_rand_helper(size_t max_sz, bool insert_one_by_one)
+{
+    size_t nbatch = max_sz / 100;
+    int* batch = malloc(nbatch*sizeof(int));
+
+    if (insert_one_by_one)
+    {
+        darr = da_alloc(max_sz, sizeof(int));
+        for (size_t i = 0; i < max_sz; ++i)
+        {
+            darr[i] = rand();
+        }
+        da_sort_int(darr);
+        for (size_t i = 0; i < nbatch; ++i)
+        {
+            batch[i] = rand();
+        }
+        begin = clock();
+        for (size_t i = 0; i < nbatch; ++i)
+        {
+            darr = da_insert_sorted(darr, &batch[i], cmp_int);
+        }
+        end = clock();
+        da_free(darr);
+        print_results(DARR_INSERT_S, nbatch, begin, end);
+    }
+
+    darr = da_alloc(max_sz, sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr[i] = rand();
+    }
+    da_sort_int(darr);
+    for (size_t i = 0; i < nbatch; ++i)
+    {
+        batch[i] = rand();
+    }
+    begin = clock();
+    darr = da_merge_sorted_batch(darr, batch, nbatch, cmp_int);
+    end = clock();
+    da_free(darr);
+    free(batch);
+    print_results(DARR_MERGE_B, nbatch, begin, end);
+}
+
+void merge_batch_rand(void)
+{
+    puts("INSERT A BATCH OF RANDOM KEYS INTO A SORTED ARRAY");
+    merge_batch_rand_helper(MED_SIZE, true);
+    merge_batch_rand_helper(LARGE_SIZE, false);
+}
+
+// K-WAY MERGE RAND ////////////////////////////////////////////////////////////
+void kway_merge_rand_helper(size_t narrays, size_t array_sz)
+{
+    int** arrays = malloc(narrays*sizeof(int*));
+    for (size_t a = 0; a < narrays; ++a)
+    {
+        arrays[a] = da_alloc(array_sz, sizeof(int));
+        for (size_t i = 0; i < array_sz; ++i)
+        {
+            arrays[a][i] = rand();
+        }
+        da_sort_int(arrays[a]);
+    }
+
+    begin = clock();
+    darr = da_alloc(0, sizeof(int));
+    for (size_t a = 0; a < narrays; ++a)
+    {
+        darr = da_concat(darr, arrays[a], array_sz);
+    }
+    da_sort(darr, cmp_int);
+    end = clock();
+    da_free(darr);
+    print_results(DARR_SORT, narrays*array_sz, begin, end);
+
+    begin = clock();
+    darr = da_kway_merge((void* const*)arrays, narrays, cmp_int);
+    end = clock();
+    da_free(darr);
+    print_results(DARR_KWAY, narrays*array_sz, begin, end);
+
+    for (size_t a = 0; a < narrays; ++a)
+    {
+        da_free(arrays[a]);
+    }
+    free(arrays);
+}
+
+void kway_merge_rand(void)
+{
+    puts("MERGE 256 SORTED ARRAYS OF RANDOM INTEGERS");
+    kway_merge_rand_helper(256, MED_SIZE / 256);
+    kway_merge_rand_helper(256, LARGE_SIZE / 256);
+}
+
+// SET INTERSECT RAND //////////////////////////////////////////////////////////
+int cmp_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Strictly increasing random sequence, like a posting list.
+uint32_t* random_set_u32(size_t nelem, uint32_t max_gap)
+{
+    uint32_t* set = da_alloc(nelem, sizeof(uint32_t));
+    uint32_t x = 0;
+    for (size_t i = 0; i < nelem; ++i)
+    {
+        x += 1 + (uint32_t)rand() % max_gap;
+        set[i] = x;
+    }
+    return set;
+}
+
+void set_intersect_rand_helper(size_t na, size_t nb)
+{
+    uint32_t* a = random_set_u32(na, 4);
+    uint32_t* b = random_set_u32(nb, (uint32_t)(4 * na / nb));
+    size_t found = 0;
+
+    uint32_t* out = malloc((na < nb ? na : nb)*sizeof(uint32_t));
+    begin = clock();
+    size_t n = 0;
+    for (size_t i = 0, j = 0; i < na && j < nb;)
+    {
+        if (a[i] < b[j])
+        {
+            ++i;
+        }
+        else if (b[j] < a[i])
+        {
+            ++j;
+        }
+        else
+        {
+            out[n++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    end = clock();
+    found += n;
+    free(out);
+    print_results(CARR, na + nb, begin, end);
+
+    begin = clock();
+    uint32_t* r = da_set_intersect(a, b, cmp_u32);
+    end = clock();
+    found += da_length(r);
+    da_free(r);
+    print_results(DARR_SET, na + nb, begin, end);
+
+    begin = clock();
+    r = da_set_intersect_u32(a, b);
+    end = clock();
+    found += da_length(r);
+    da_free(r);
+    print_results(DARR_SET_T, na + nb, begin, end);
+
+    da_free(a);
+    da_free(b);
+    if (found != 3 * n)
+        puts("intersections differ");
+}
+
+void set_intersect_rand(void)
+{
+    puts("INTERSECT SORTED SETS OF RANDOM INTEGERS");
+    set_intersect_rand_helper(MED_SIZE, MED_SIZE);
+    set_intersect_rand_helper(LARGE_SIZE, LARGE_SIZE);
+    puts("  (second set 1000 times smaller)");
+    set_intersect_rand_helper(LARGE_SIZE, LARGE_SIZE / 1000);
+}
+
+// HEAP RAND ///////////////////////////////////////////////////////////////////
+// Pushes random keys onto a heap, then pops them all.
+void heap_rand_helper(size_t max_sz)
+{
+    size_t arities[] = {2, 4};
+    const char* labels[] = {DARR_HEAP2, DARR_HEAP4};
+    for (size_t a = 0; a < 2; ++a)
+    {
+        srand(1);
+        begin = clock();
+        darr = da_alloc(0, sizeof(int));
+        for (size_t i = 0; i < max_sz; ++i)
+        {
+            darr = da_heap_push_val(darr, rand(), cmp_int, arities[a]);
+        }
+        while (da_length(darr) > 0)
+        {
+            da_heap_pop(darr, NULL, cmp_int, arities[a]);
+        }
+        end = clock();
+        da_free(darr);
+        print_results(labels[a], max_sz, begin, end);
+    }
+}
+
+void heap_rand(void)
+{
+    puts("PUSH AND POP RANDOM INTEGERS ON A HEAP");
+    heap_rand_helper(MED_SIZE);
+    heap_rand_helper(LARGE_SIZE / 10);
+}
+
+// DMAP RAND ///////////////////////////////////////////////////////////////////
+// Inserts random keys into a hash map, finds each of them, then erases them.
+void dmap_rand_helper(size_t max_sz)
+{
+    int* keys = malloc(max_sz*sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        keys[i] = rand();
+    }
+    size_t found = 0;
+
+    struct dmap* map = dmap_alloc(sizeof(int), sizeof(int), NULL, NULL);
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        int value = (int)i;
+        if (dmap_insert(map, &keys[i], &value) == NULL)
+        {
+            puts("dmap_insert failed");
+        }
+    }
+    end = clock();
+    print_results(DMAP_INSERT, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        found += dmap_find(map, &keys[i]) != NULL;
+    }
+    end = clock();
+    print_results(DMAP_FIND, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        dmap_erase(map, &keys[i]);
+    }
+    end = clock();
+    print_results(DMAP_ERASE, max_sz, begin, end);
+
+    dmap_free(map);
+    free(keys);
+    if (found != max_sz)
+        puts("keys missing");
+}
+
+void dmap_rand(void)
+{
+    puts("INSERT, FIND, AND ERASE RANDOM INTEGER KEYS IN A HASH MAP");
+    dmap_rand_helper(MED_SIZE);
+    dmap_rand_helper(LARGE_SIZE / 10);
+}
+
+// DSET RAND ///////////////////////////////////////////////////////////////////
+// Inserts random IDs into a hash set, then looks up as many random IDs, about
+// half of which are in the set.
+void dset_rand_helper(size_t max_sz)
+{
+    uint32_t* ids = da_alloc(max_sz, sizeof(uint32_t));
+    uint32_t* queries = da_alloc(max_sz, sizeof(uint32_t));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        ids[i] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+        queries[i] = i % 2 == 0 ? ids[(size_t)rand() % (i + 1)]
+            : (uint32_t)rand() << 16 ^ (uint32_t)rand();
+    }
+    size_t found = 0;
+
+    struct dset* set = dset_alloc(sizeof(uint32_t), NULL, NULL);
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        if (!dset_insert(set, &ids[i]))
+        {
+            puts("dset_insert failed");
+        }
+    }
+    end = clock();
+    print_results(DSET_INSERT, max_sz, begin, end);
+    dset_free(set);
+
+    set = dset_alloc(sizeof(uint32_t), NULL, NULL);
+    begin = clock();
+    if (!dset_insert_many(set, ids, max_sz))
+    {
+        puts("dset_insert_many failed");
+    }
+    end = clock();
+    print_results(DSET_INSERT_B, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        found += dset_contains(set, &queries[i]);
+    }
+    end = clock();
+    print_results(DSET_FIND, max_sz, begin, end);
+
+    begin = clock();
+    found -= dset_contains_many(set, queries, max_sz, NULL);
+    end = clock();
+    print_results(DSET_FIND_B, max_sz, begin, end);
+
+    dset_free(set);
+    da_free(queries);
+    da_free(ids);
+    if (found != 0)
+        puts("lookups differ");
+}
+
+void dset_rand(void)
+{
+    puts("INSERT AND LOOK UP RANDOM IDS IN A HASH SET");
+    dset_rand_helper(MED_SIZE);
+    dset_rand_helper(LARGE_SIZE / 10);
+}
+
+// DBITS RAND //////////////////////////////////////////////////////////////////
+// Combines and counts two random bitmaps NUM_FINDS times, then answers
+// NUM_FINDS*NUM_FINDS random rank and select queries with and without the
+// rank index.
+void dbits_rand_helper(size_t max_sz)
+{
+    struct dbits* a = dbits_alloc(max_sz);
+    struct dbits* b = dbits_alloc(max_sz);
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        if (rand() % 2)
+            dbits_set(a, i);
+        if (rand() % 2)
+            dbits_set(b, i);
+    }
+    size_t nqueries = NUM_FINDS * NUM_FINDS;
+    size_t* queries = malloc(nqueries*sizeof(size_t));
+    for (size_t i = 0; i < nqueries; ++i)
+    {
+        queries[i] = (size_t)rand() % max_sz;
+    }
+    size_t total = 0;
+
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        dbits_xor(a, b);
+    }
+    end = clock();
+    print_results(DBITS_XOR, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        total += dbits_popcount(a);
+    }
+    end = clock();
+    print_results(DBITS_POPCOUNT, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < nqueries; ++i)
+    {
+        total -= dbits_rank(a, queries[i]);
+    }
+    end = clock();
+    print_results(DBITS_RANK, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < nqueries; ++i)
+    {
+        total += (size_t)dbits_select(a, queries[i] / 2);
+    }
+    end = clock();
+    print_results(DBITS_SELECT, max_sz, begin, end);
+
+    if (!dbits_build_index(a))
+    {
+        puts("dbits_build_index failed");
+    }
+    begin = clock();
+    for (size_t i = 0; i < nqueries; ++i)
+    {
+        total += dbits_rank(a, queries[i]);
+    }
+    end = clock();
+    print_results(DBITS_RANK_I, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < nqueries; ++i)
+    {
+        total -= (size_t)dbits_select(a, queries[i] / 2);
+    }
+    end = clock();
+    print_results(DBITS_SELECT_I, max_sz, begin, end);
+
+    free(queries);
+    dbits_free(b);
+    dbits_free(a);
+    if (total == 0)
+        puts("no bits set");
+}
+
+void dbits_rand(void)
+{
+    puts("COMBINE, COUNT, RANK AND SELECT RANDOM BITMAPS");
+    dbits_rand_helper(MED_SIZE);
+    dbits_rand_helper(LARGE_SIZE / 10);
+}
+
+// DSOA RAND ///////////////////////////////////////////////////////////////////
+// Sums one field of random 64-byte records NUM_FINDS times, stored as a darray
+// of structs and as a dsoa, and converts between the two layouts.
+void dsoa_rand_helper(size_t max_sz)
+{
+    const struct dsoa_field fields[] = {
+        DSOA_FIELD(struct perf_record, id),
+        DSOA_FIELD(struct perf_record, pos),
+        DSOA_FIELD(struct perf_record, mass),
+        DSOA_FIELD(struct perf_record, name),
+    };
+    struct perf_record* aos = da_alloc(max_sz, sizeof(struct perf_record));
+    memset(aos, 0, max_sz*sizeof(struct perf_record));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        aos[i].id = (int)i;
+        aos[i].mass = rand() / (double)RAND_MAX;
+    }
+    double sum = 0;
+
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        for (size_t i = 0; i < max_sz; ++i)
+        {
+            sum += aos[i].mass;
+        }
+    }
+    end = clock();
+    print_results(DARR_AOS_SUM, max_sz, begin, end);
+
+    struct dsoa* soa = dsoa_alloc(sizeof(struct perf_record), fields, 4);
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        if (!dsoa_push(soa, &aos[i]))
+        {
+            puts("dsoa_push failed");
+        }
+    }
+    end = clock();
+    print_results(DSOA_PUSH, max_sz, begin, end);
+    dsoa_free(soa);
+
+    begin = clock();
+    soa = dsoa_from_darray(aos, fields, 4);
+    end = clock();
+    print_results(DSOA_FROM_AOS, max_sz, begin, end);
+
+    const double* mass = dsoa_column(soa, 2);
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        for (size_t i = 0; i < max_sz; ++i)
+        {
+            sum -= mass[i];
+        }
+    }
+    end = clock();
+    print_results(DSOA_SUM, max_sz, begin, end);
+
+    begin = clock();
+    struct perf_record* back = dsoa_to_darray(soa);
+    end = clock();
+    print_results(DSOA_TO_AOS, max_sz, begin, end);
+
+    if (memcmp(back, aos, max_sz*sizeof(struct perf_record)) != 0)
+        puts("conversion differs");
+    da_free(back);
+    dsoa_free(soa);
+    da_free(aos);
+    if (sum > 1 || sum < -1)
+        puts("sums differ");
+}
+
+void dsoa_rand(void)
+{
+    puts("SUM ONE FIELD OF RANDOM RECORDS");
+    dsoa_rand_helper(MED_SIZE);
+    dsoa_rand_helper(LARGE_SIZE / 100);
+}
+
+// DSMAP RAND //////////////////////////////////////////////////////////////////
+// Builds a sorted flat map from random IDs in bulk, then looks up as many
+// random IDs, about half of which are in the map.
+void dsmap_rand_helper(size_t max_sz)
+{
+    uint32_t* ids = da_alloc(max_sz, sizeof(uint32_t));
+    uint32_t* queries = da_alloc(max_sz, sizeof(uint32_t));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        ids[i] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+        queries[i] = i % 2 == 0 ? ids[(size_t)rand() % (i + 1)]
+            : (uint32_t)rand() << 16 ^ (uint32_t)rand();
+    }
+    size_t found = 0;
+
+    struct dsmap* map = dsmap_alloc_scalar(DA_KEY_U32, sizeof(uint32_t));
+    begin = clock();
+    if (!dsmap_insert_many(map, ids, ids, max_sz))
+    {
+        puts("dsmap_insert_many failed");
+    }
+    end = clock();
+    print_results(DSMAP_BUILD, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        found += dsmap_find(map, &queries[i]) != NULL;
+    }
+    end = clock();
+    print_results(DSMAP_FIND, max_sz, begin, end);
+    dsmap_free(map);
+
+    map = dsmap_alloc(sizeof(uint32_t), sizeof(uint32_t), cmp_u32);
+    if (!dsmap_insert_many(map, ids, ids, max_sz))
+    {
+        puts("dsmap_insert_many failed");
+    }
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        found -= dsmap_find(map, &queries[i]) != NULL;
+    }
+    end = clock();
+    print_results(DSMAP_FIND_CMP, max_sz, begin, end);
+
+    dsmap_free(map);
+    da_free(queries);
+    da_free(ids);
+    if (found != 0)
+        puts("lookups differ");
+}
+
+void dsmap_rand(void)
+{
+    puts("BUILD AND LOOK UP RANDOM IDS IN A SORTED MAP");
+    dsmap_rand_helper(MED_SIZE);
+    dsmap_rand_helper(LARGE_SIZE / 100);
+}
+
+// DSLOTMAP RAND ///////////////////////////////////////////////////////////////
+// Inserts values into a slot map, then looks them up and erases them through
+// their handles in random order.
+void dslotmap_rand_helper(size_t max_sz)
+{
+    struct dslotmap_handle* handles = malloc(max_sz*sizeof(*handles));
+    size_t* order = malloc(max_sz*sizeof(size_t));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        order[i] = i;
+    }
+    for (size_t i = max_sz - 1; i > 0; --i)
+    {
+        size_t j = (size_t)rand() % (i + 1);
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    size_t sum = 0;
+
+    struct dslotmap* map = dslotmap_alloc(sizeof(uint32_t));
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        uint32_t value = (uint32_t)i;
+        if (dslotmap_insert(map, &value, &handles[i]) == NULL)
+        {
+            puts("dslotmap_insert failed");
+        }
+    }
+    end = clock();
+    print_results(SLOTMAP_INSERT, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        sum += *(uint32_t*)dslotmap_get(map, handles[order[i]]);
+    }
+    end = clock();
+    print_results(SLOTMAP_GET, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        if (!dslotmap_erase(map, handles[order[i]]))
+        {
+            puts("dslotmap_erase failed");
+        }
+    }
+    end = clock();
+    print_results(SLOTMAP_ERASE, max_sz, begin, end);
+
+    dslotmap_free(map);
+    free(order);
+    free(handles);
+    if (sum != max_sz*(max_sz - 1)/2)
+        puts("sums differ");
+}
+
+void dslotmap_rand(void)
+{
+    puts("INSERT, LOOK UP AND ERASE VALUES IN RANDOM ORDER IN A SLOT MAP");
+    dslotmap_rand_helper(MED_SIZE);
+    dslotmap_rand_helper(LARGE_SIZE / 10);
+}
+
+// DJAGGED RAND ////////////////////////////////////////////////////////////////
+// Builds adjacency lists of random length as a darray of darrays and as a
+// djagged, then sums every element of every row NUM_FINDS times.
+void djagged_rand_helper(size_t max_sz)
+{
+    size_t nrows = max_sz / 8;
+    size_t* lengths = malloc(nrows*sizeof(size_t));
+    for (size_t i = 0; i < nrows; ++i)
+    {
+        lengths[i] = (size_t)rand() % 16;
+    }
+    long long sum = 0;
+
+    begin = clock();
+    darray(darray(int)) nested = da_alloc(nrows, sizeof(darray(int)));
+    for (size_t i = 0; i < nrows; ++i)
+    {
+        nested[i] = da_alloc(0, sizeof(int));
+        for (size_t j = 0; j < lengths[i]; ++j)
+        {
+            nested[i] = da_push(nested[i], (int)j);
+        }
+    }
+    end = clock();
+    print_results(DARR_NESTED_BLD, nrows, begin, end);
+
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        for (size_t i = 0; i < nrows; ++i)
+        {
+            for (size_t j = 0; j < da_length(nested[i]); ++j)
+            {
+                sum += nested[i][j];
+            }
+        }
+    }
+    end = clock();
+    print_results(DARR_NESTED_SUM, nrows, begin, end);
+
+    begin = clock();
+    struct djagged* jag = djagged_alloc(sizeof(int));
+    for (size_t i = 0; i < nrows; ++i)
+    {
+        if (!djagged_push_row(jag, NULL, 0))
+        {
+            puts("djagged_push_row failed");
+        }
+        for (size_t j = 0; j < lengths[i]; ++j)
+        {
+            int value = (int)j;
+            if (djagged_push(jag, &value) == NULL)
+            {
+                puts("djagged_push failed");
+            }
+        }
+    }
+    end = clock();
+    print_results(DJAGGED_BUILD, nrows, begin, end);
+
+    const int* values = djagged_values(jag);
+    const size_t* offsets = djagged_offsets(jag);
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        for (size_t i = 0; i < nrows; ++i)
+        {
+            for (size_t j = offsets[i]; j < offsets[i+1]; ++j)
+            {
+                sum -= values[j];
+            }
+        }
+    }
+    end = clock();
+    print_results(DJAGGED_SUM, nrows, begin, end);
+
+    djagged_free(jag);
+    for (size_t i = 0; i < nrows; ++i)
+    {
+        da_free(nested[i]);
+    }
+    da_free(nested);
+    free(lengths);
+    if (sum != 0)
+        puts("sums differ");
+}
+
+void djagged_rand(void)
+{
+    puts("BUILD AND SUM ROWS OF RANDOM LENGTH IN A JAGGED ARRAY");
+    djagged_rand_helper(MED_SIZE);
+    djagged_rand_helper(LARGE_SIZE / 10);
+}
+
+// DPACKED RAND ////////////////////////////////////////////////////////////////
+// Pushes random 12-bit values into a dpacked, reads them back one at a time,
+// and unpacks them into a darray of uint32_t in bulk.
+void dpacked_rand_helper(size_t max_sz)
+{
+    uint64_t sum = 0;
+    struct dpacked* packed = dpacked_alloc(12);
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        if (!dpacked_push(packed, (uint64_t)rand() % 4096))
+        {
+            puts("dpacked_push failed");
+        }
+    }
+    end = clock();
+    print_results(DPACKED_PUSH, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        sum += dpacked_get(packed, i);
+    }
+    end = clock();
+    print_results(DPACKED_GET, max_sz, begin, end);
+
+    begin = clock();
+    uint32_t* unpacked = dpacked_to_darray(packed, sizeof(uint32_t));
+    end = clock();
+    print_results(DPACKED_UNPACK, max_sz, begin, end);
+
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        sum -= unpacked[i];
+    }
+    da_free(unpacked);
+    dpacked_free(packed);
+    if (sum != 0)
+        puts("sums differ");
+}
+
+void dpacked_rand(void)
+{
+    puts("PUSH, GET AND UNPACK RANDOM 12-BIT VALUES IN A PACKED ARRAY");
+    dpacked_rand_helper(MED_SIZE);
+    dpacked_rand_helper(LARGE_SIZE);
+}
+
+// FIND RAND ///////////////////////////////////////////////////////////////////
+void find_rand_helper(size_t max_sz)
+{
+    int* keys = malloc(NUM_FINDS*sizeof(int));
+    for (size_t i = 0; i < NUM_FINDS; ++i)
+    {
+        keys[i] = rand();
+    }
+    size_t found = 0;
+
+    arr = malloc(max_sz*sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        arr[i] = rand();
+    }
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        for (size_t i = 0; i < max_sz; ++i)
+        {
+            if (arr[i] == keys[k])
+            {
+                found += i;
+                break;
+            }
+        }
+    }
+    end = clock();
+    free(arr);
+    print_results(CARR, max_sz, begin, end);
+
+    darr = da_alloc(max_sz, sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr[i] = rand();
+    }
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        found += da_find(darr, &keys[k]);
+    }
+    end = clock();
+    da_free(darr);
+    print_results(DARR_FIND, max_sz, begin, end);
+
+    if (found == 0)
+        puts("no keys found");
+    free(keys);
+}
+
+void find_rand(void)
+{
+    puts("LINEAR SEARCH AN ARRAY FOR 100 RANDOM VALUES");
+    find_rand_helper(MED_SIZE);
+    find_rand_helper(LARGE_SIZE);
+}
+
+// REDUCE RAND /////////////////////////////////////////////////////////////////
+void reduce_rand(void)
+{
+    puts("SUM AND ARGMAX AN ARRAY OF RANDOM INTEGERS (WALL CLOCK)");
+    int64_t sum = 0;
+    long argmax = 0;
+
+    arr = malloc(LARGE_SIZE*sizeof(int));
+    for (size_t i = 0; i < LARGE_SIZE; ++i)
+    {
+        arr[i] = rand();
+    }
+    double wbegin = wall_msec();
+    size_t carr_argmax = 0;
+    for (size_t i = 0; i < LARGE_SIZE; ++i)
+    {
+        sum += arr[i];
+        if (arr[i] > arr[carr_argmax])
+            carr_argmax = i;
+    }
+    double wend = wall_msec();
+    argmax += (long)carr_argmax;
+    free(arr);
+    print_results_wall(CARR, LARGE_SIZE, wbegin, wend);
+
+    darr = da_alloc(LARGE_SIZE, sizeof(int));
+    for (size_t i = 0; i < LARGE_SIZE; ++i)
+    {
+        darr[i] = rand();
+    }
+    wbegin = wall_msec();
+    sum += da_sum_i32(darr);
+    argmax += da_argmax_i32(darr);
+    wend = wall_msec();
+    print_results_wall(DARR_REDUCE, LARGE_SIZE, wbegin, wend);
+
+    char label[48];
+    long nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t nthreads = nprocs > 0 ? (size_t)nprocs : 1;
+    snprintf(label, sizeof(label), "darray (%zu thr)", nthreads);
+    wbegin = wall_msec();
+    sum += da_parallel_sum_i32(darr, nthreads);
+    argmax += da_parallel_argmax_i32(darr, nthreads);
+    wend = wall_msec();
+    da_free(darr);
+    print_results_wall(label, LARGE_SIZE, wbegin, wend);
+
+    if (sum == 0 && argmax == 0)
+        puts("empty reduction");
+}
+
+// SCAN RAND ///////////////////////////////////////////////////////////////////
+void scan_rand(void)
+{
+    puts("PREFIX SUM AN ARRAY OF RANDOM INTEGERS (WALL CLOCK)");
+    arr = malloc(LARGE_SIZE*sizeof(int));
+    for (size_t i = 0; i < LARGE_SIZE; ++i)
+    {
+        arr[i] = rand() % 16;
+    }
+    double wbegin = wall_msec();
+    for (size_t i = 1; i < LARGE_SIZE; ++i)
+    {
+        arr[i] += arr[i-1];
+    }
+    double wend = wall_msec();
+    free(arr);
+    print_results_wall(CARR, LARGE_SIZE, wbegin, wend);
+
+    darr = da_alloc(LARGE_SIZE, sizeof(int));
+    for (size_t i = 0; i < LARGE_SIZE; ++i)
+    {
+        darr[i] = rand() % 16;
+    }
+    wbegin = wall_msec();
+    da_inclusive_scan_i32(darr);
+    wend = wall_msec();
+    print_results_wall(DARR_SCAN, LARGE_SIZE, wbegin, wend);
+
+    char label[48];
+    long nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t nthreads = nprocs > 0 ? (size_t)nprocs : 1;
+    snprintf(label, sizeof(label), "darray (%zu thr)", nthreads);
+    wbegin = wall_msec();
+    da_parallel_inclusive_scan_i32(darr, nthreads);
+    wend = wall_msec();
+    da_free(darr);
+    print_results_wall(label, LARGE_SIZE, wbegin, wend);
+}
+
+// PARALLEL FOR SCALING ////////////////////////////////////////////////////////
+// Per-element work that grows with the index, so an even split of the
+// elements between threads would leave the last thread with most of the work.
+void skewed_work(void* elem, size_t index, void* ctx)
+{
+    size_t nelem = *(size_t*)ctx;
+    unsigned x = *(unsigned*)elem | 1;
+    for (size_t i = 0; i < index * 2000 / nelem; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+    }
+    *(unsigned*)elem = x;
+}
+
+void parallel_for_scaling_helper(size_t max_sz, size_t nthreads)
+{
+    char label[32];
+    snprintf(label, sizeof(label), "darray (%zu thr)", nthreads);
+
+    darr = da_alloc(max_sz, sizeof(int));
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        darr[i] = rand();
+    }
+    struct da_parallel_opts opts = {.nthreads = nthreads};
+    double wbegin = wall_msec();
+    da_parallel_for(darr, skewed_work, &max_sz, &opts);
+    double wend = wall_msec();
+    da_free(darr);
+    print_results_wall(label, max_sz, wbegin, wend);
+}
+
+void parallel_for_scaling(void)
+{
+    puts("APPLY A SKEWED CPU-BOUND TRANSFORM TO AN ARRAY (WALL CLOCK)");
+    long nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = nprocs > 0 ? (size_t)nprocs : 1;
+    size_t nthreads = 1;
+    for (; nthreads <= max_threads; nthreads *= 2)
+        parallel_for_scaling_helper(MED_SIZE, nthreads);
+    if (nthreads/2 != max_threads)
+        parallel_for_scaling_helper(MED_SIZE, max_threads);
+}
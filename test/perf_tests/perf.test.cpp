@@ -1,6 +1,12 @@
 #include "perf.test.h"
 #include <vector>
 #include <algorithm>
+#include <numeric>
+#include <map>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
 
 // FILL ////////////////////////////////////////////////////////////////////////
 void fill_pre_sized_helper(size_t max_sz)
@@ -189,3 +195,746 @@ void swap_rand(void)
     swap_rand_helper(nelem, MED_SIZE);
     swap_rand_helper(nelem, LARGE_SIZE);
 }
+
+// MAP RAND ////////////////////////////////////////////////////////////////////
+void map_rand_helper(size_t max_sz)
+{
+    std::vector<int> vec;
+    std::vector<int> mapped;
+
+    vec = std::vector<int>(max_sz);
+    for (int& e : vec)
+    {
+        e = rand();
+    }
+    begin = clock();
+    mapped = std::vector<int>(vec.size());
+    std::transform(vec.begin(), vec.end(), mapped.begin(),
+        [](int e) { return e * 2; });
+    end = clock();
+    print_results(VECTOR, max_sz, begin, end);
+}
+
+void map_rand(void)
+{
+    puts("MAPPING A VECTOR INTO A NEW VECTOR");
+    map_rand_helper(MED_SIZE);
+    map_rand_helper(LARGE_SIZE);
+}
+
+// SORT RAND ///////////////////////////////////////////////////////////////////
+void sort_rand_helper(size_t max_sz)
+{
+    std::vector<int> vec;
+
+    vec = std::vector<int>(max_sz);
+    for (int& e : vec)
+    {
+        e = rand();
+    }
+    begin = clock();
+    std::sort(vec.begin(), vec.end());
+    end = clock();
+    print_results(VECTOR, max_sz, begin, end);
+}
+
+void sort_rand(void)
+{
+    puts("SORT A VECTOR OF RANDOM INTEGERS");
+    sort_rand_helper(SMALL_SIZE);
+    sort_rand_helper(MED_SIZE);
+    sort_rand_helper(LARGE_SIZE);
+}
+
+// RADIX SORT RAND /////////////////////////////////////////////////////////////
+void radix_sort_rand_helper(size_t max_sz)
+{
+    std::vector<uint32_t> vec;
+
+    vec = std::vector<uint32_t>(max_sz);
+    for (uint32_t& e : vec)
+    {
+        e = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+    }
+    begin = clock();
+    std::sort(vec.begin(), vec.end());
+    end = clock();
+    print_results(VECTOR, max_sz, begin, end);
+}
+
+void radix_sort_rand(void)
+{
+    puts("RADIX SORT A VECTOR OF RANDOM 32-BIT INTEGERS");
+    radix_sort_rand_helper(MED_SIZE);
+    radix_sort_rand_helper(LARGE_SIZE);
+}
+
+// PERCENTILES RAND ////////////////////////////////////////////////////////////
+void percentiles_rand_helper(size_t max_sz)
+{
+    std::vector<int> vec;
+    double qs[] = {0.5, 0.99, 0.999};
+    long sum = 0;
+
+    vec = std::vector<int>(max_sz);
+    for (int& e : vec)
+    {
+        e = rand();
+    }
+    begin = clock();
+    for (double q : qs)
+    {
+        size_t rank = (size_t)(q * max_sz);
+        auto nth = vec.begin() + (rank > 0 ? rank - 1 : 0);
+        std::nth_element(vec.begin(), nth, vec.end());
+        sum += *nth;
+    }
+    end = clock();
+    print_results(VECTOR, max_sz, begin, end);
+    if (sum == 0)
+        puts("all percentiles zero");
+}
+
+void percentiles_rand(void)
+{
+    puts("P50, P99, AND P999 OF A VECTOR OF RANDOM INTEGERS");
+    percentiles_rand_helper(MED_SIZE);
+    percentiles_rand_helper(LARGE_SIZE);
+}
+
+// PARALLEL SORT SCALING ///////////////////////////////////////////////////////
+void parallel_sort_scaling(void)
+{
+    std::vector<int> vec;
+
+    puts("SORT A VECTOR OF RANDOM INTEGERS (WALL CLOCK, SINGLE THREAD)");
+    vec = std::vector<int>(LARGE_SIZE);
+    for (int& e : vec)
+    {
+        e = rand();
+    }
+    double wbegin = wall_msec();
+    std::sort(vec.begin(), vec.end());
+    double wend = wall_msec();
+    print_results_wall(VECTOR, LARGE_SIZE, wbegin, wend);
+}
+
+// SEARCH RAND /////////////////////////////////////////////////////////////////
+void search_rand_helper(size_t max_sz)
+{
+    std::vector<int> vec;
+    std::vector<int> keys;
+
+    vec = std::vector<int>(max_sz);
+    for (int& e : vec)
+    {
+        e = rand();
+    }
+    std::sort(vec.begin(), vec.end());
+    keys = std::vector<int>(NUM_LOOKUPS);
+    for (int& k : keys)
+    {
+        k = vec[rand() % max_sz];
+    }
+
+    size_t found = 0;
+    begin = clock();
+    for (int k : keys)
+    {
+        found += std::lower_bound(vec.begin(), vec.end(), k) - vec.begin();
+    }
+    end = clock();
+    print_results(VECTOR, max_sz, begin, end);
+    if (found == 0)
+        puts("no keys found");
+}
+
+void search_rand(void)
+{
+    puts("SEARCH A SORTED VECTOR FOR 1000000 RANDOM KEYS");
+    search_rand_helper(MED_SIZE);
+    search_rand_helper(LARGE_SIZE);
+}
+
+// MERGE BATCH RAND ////////////////////////////////////////////////////////////
+void merge_batch_rand_helper(size_t max_sz)
+{
+    std::vector<int> vec;
+    std::vector<int> batch;
+
+    vec = std::vector<int>(max_sz);
+    for (int& e : vec)
+    {
+        e = rand();
+    }
+    std::sort(vec.begin(), vec.end());
+    batch = std::vector<int>(max_sz / 100);
+    for (int& e : batch)
+    {
+        e = rand();
+    }
+    begin = clock();
+    std::sort(batch.begin(), batch.end());
+    vec.insert(vec.end(), batch.begin(), batch.end());
+    std::inplace_merge(vec.begin(), vec.end() - batch.size(), vec.end());
+    end = clock();
+    print_results(VECTOR, batch.size(), begin, end);
+}
+
+void merge_batch_rand(void)
+{
+    puts("INSERT A BATCH OF RANDOM KEYS INTO A SORTED VECTOR");
+    merge_batch_rand_helper(MED_SIZE);
+    merge_batch_rand_helper(LARGE_SIZE);
+}
+
+// K-WAY MERGE RAND ////////////////////////////////////////////////////////////
+void kway_merge_rand_helper(size_t narrays, size_t array_sz)
+{
+    std::vector<std::vector<int>> vecs(narrays);
+    for (std::vector<int>& vec : vecs)
+    {
+        vec = std::vector<int>(array_sz);
+        for (int& e : vec)
+        {
+            e = rand();
+        }
+        std::sort(vec.begin(), vec.end());
+    }
+
+    // Heap of (value, source) pairs, smallest value on top.
+    typedef std::pair<int, size_t> entry;
+    begin = clock();
+    std::vector<int> merged;
+    merged.reserve(narrays * array_sz);
+    std::vector<size_t> pos(narrays, 0);
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> heap;
+    for (size_t a = 0; a < narrays; ++a)
+    {
+        heap.push(entry(vecs[a][0], a));
+    }
+    while (!heap.empty())
+    {
+        entry top = heap.top();
+        heap.pop();
+        merged.push_back(top.first);
+        if (++pos[top.second] < array_sz)
+        {
+            heap.push(entry(vecs[top.second][pos[top.second]], top.second));
+        }
+    }
+    end = clock();
+    print_results(VECTOR, narrays * array_sz, begin, end);
+}
+
+void kway_merge_rand(void)
+{
+    puts("MERGE 256 SORTED VECTORS OF RANDOM INTEGERS");
+    kway_merge_rand_helper(256, MED_SIZE / 256);
+    kway_merge_rand_helper(256, LARGE_SIZE / 256);
+}
+
+// SET INTERSECT RAND //////////////////////////////////////////////////////////
+// Strictly increasing random sequence, like a posting list.
+std::vector<uint32_t> random_set_u32(size_t nelem, uint32_t max_gap)
+{
+    std::vector<uint32_t> set(nelem);
+    uint32_t x = 0;
+    for (uint32_t& e : set)
+    {
+        x += 1 + (uint32_t)rand() % max_gap;
+        e = x;
+    }
+    return set;
+}
+
+void set_intersect_rand_helper(size_t na, size_t nb)
+{
+    std::vector<uint32_t> a = random_set_u32(na, 4);
+    std::vector<uint32_t> b = random_set_u32(nb, (uint32_t)(4 * na / nb));
+
+    begin = clock();
+    std::vector<uint32_t> out;
+    out.reserve(std::min(na, nb));
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+        std::back_inserter(out));
+    out.shrink_to_fit();
+    end = clock();
+    print_results(VECTOR, na + nb, begin, end);
+}
+
+void set_intersect_rand(void)
+{
+    puts("INTERSECT SORTED SETS OF RANDOM INTEGERS");
+    set_intersect_rand_helper(MED_SIZE, MED_SIZE);
+    set_intersect_rand_helper(LARGE_SIZE, LARGE_SIZE);
+    puts("  (second set 1000 times smaller)");
+    set_intersect_rand_helper(LARGE_SIZE, LARGE_SIZE / 1000);
+}
+
+// HEAP RAND ///////////////////////////////////////////////////////////////////
+// Pushes random keys onto a heap, then pops them all.
+void heap_rand_helper(size_t max_sz)
+{
+    srand(1);
+    begin = clock();
+    std::priority_queue<int> heap;
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        heap.push(rand());
+    }
+    while (!heap.empty())
+    {
+        heap.pop();
+    }
+    end = clock();
+    print_results(VECTOR, max_sz, begin, end);
+}
+
+void heap_rand(void)
+{
+    puts("PUSH AND POP RANDOM INTEGERS ON A HEAP");
+    heap_rand_helper(MED_SIZE);
+    heap_rand_helper(LARGE_SIZE / 10);
+}
+
+// DMAP RAND ///////////////////////////////////////////////////////////////////
+// Inserts random keys into a hash map, finds each of them, then erases them.
+void dmap_rand_helper(size_t max_sz)
+{
+    std::vector<int> keys(max_sz);
+    for (int& key : keys)
+    {
+        key = rand();
+    }
+    size_t found = 0;
+
+    std::unordered_map<int, int> map;
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        map[keys[i]] = (int)i;
+    }
+    end = clock();
+    print_results(UMAP_INSERT, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        found += map.find(keys[i]) != map.end();
+    }
+    end = clock();
+    print_results(UMAP_FIND, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        map.erase(keys[i]);
+    }
+    end = clock();
+    print_results(UMAP_ERASE, max_sz, begin, end);
+
+    if (found != max_sz)
+        puts("keys missing");
+}
+
+void dmap_rand(void)
+{
+    puts("INSERT, FIND, AND ERASE RANDOM INTEGER KEYS IN A HASH MAP");
+    dmap_rand_helper(MED_SIZE);
+    dmap_rand_helper(LARGE_SIZE / 10);
+}
+
+// DSET RAND ///////////////////////////////////////////////////////////////////
+// Inserts random IDs into a hash set, then looks up as many random IDs, about
+// half of which are in the set.
+void dset_rand_helper(size_t max_sz)
+{
+    std::vector<uint32_t> ids(max_sz);
+    std::vector<uint32_t> queries(max_sz);
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        ids[i] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+        queries[i] = i % 2 == 0 ? ids[(size_t)rand() % (i + 1)]
+            : (uint32_t)rand() << 16 ^ (uint32_t)rand();
+    }
+    size_t found = 0;
+
+    std::unordered_set<uint32_t> set;
+    begin = clock();
+    for (uint32_t id : ids)
+    {
+        set.insert(id);
+    }
+    end = clock();
+    print_results(USET_INSERT, max_sz, begin, end);
+
+    begin = clock();
+    for (uint32_t query : queries)
+    {
+        found += set.count(query);
+    }
+    end = clock();
+    print_results(USET_FIND, max_sz, begin, end);
+
+    if (found == 0)
+        puts("no ids found");
+}
+
+void dset_rand(void)
+{
+    puts("INSERT AND LOOK UP RANDOM IDS IN A HASH SET");
+    dset_rand_helper(MED_SIZE);
+    dset_rand_helper(LARGE_SIZE / 10);
+}
+
+// DBITS RAND //////////////////////////////////////////////////////////////////
+// Combines and counts two random bitmaps NUM_FINDS times.
+void dbits_rand_helper(size_t max_sz)
+{
+    std::vector<bool> a(max_sz);
+    std::vector<bool> b(max_sz);
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        a[i] = rand() % 2;
+        b[i] = rand() % 2;
+    }
+    size_t total = 0;
+
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        for (size_t i = 0; i < max_sz; ++i)
+        {
+            a[i] = a[i] != b[i];
+        }
+    }
+    end = clock();
+    print_results(VBOOL_XOR, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        total += std::count(a.begin(), a.end(), true);
+    }
+    end = clock();
+    print_results(VBOOL_COUNT, max_sz, begin, end);
+
+    if (total == 0)
+        puts("no bits set");
+}
+
+void dbits_rand(void)
+{
+    puts("COMBINE, COUNT, RANK AND SELECT RANDOM BITMAPS");
+    dbits_rand_helper(MED_SIZE);
+    dbits_rand_helper(LARGE_SIZE / 10);
+}
+
+// DSOA RAND ///////////////////////////////////////////////////////////////////
+// Sums one field of random 64-byte records NUM_FINDS times.
+void dsoa_rand_helper(size_t max_sz)
+{
+    std::vector<perf_record> aos(max_sz);
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        aos[i].id = (int)i;
+        aos[i].mass = rand() / (double)RAND_MAX;
+    }
+    double sum = 0;
+
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        for (const perf_record& record : aos)
+        {
+            sum += record.mass;
+        }
+    }
+    end = clock();
+    print_results(VECTOR_AOS_SUM, max_sz, begin, end);
+
+    if (sum == 0)
+        puts("zero sum");
+}
+
+void dsoa_rand(void)
+{
+    puts("SUM ONE FIELD OF RANDOM RECORDS");
+    dsoa_rand_helper(MED_SIZE);
+    dsoa_rand_helper(LARGE_SIZE / 100);
+}
+
+// DSMAP RAND //////////////////////////////////////////////////////////////////
+// Inserts random IDs into a tree map, then looks up as many random IDs, about
+// half of which are in the map.
+void dsmap_rand_helper(size_t max_sz)
+{
+    std::vector<uint32_t> ids(max_sz);
+    std::vector<uint32_t> queries(max_sz);
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        ids[i] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+        queries[i] = i % 2 == 0 ? ids[(size_t)rand() % (i + 1)]
+            : (uint32_t)rand() << 16 ^ (uint32_t)rand();
+    }
+    size_t found = 0;
+
+    std::map<uint32_t, uint32_t> map;
+    begin = clock();
+    for (uint32_t id : ids)
+    {
+        map[id] = id;
+    }
+    end = clock();
+    print_results(MAP_INSERT, max_sz, begin, end);
+
+    begin = clock();
+    for (uint32_t query : queries)
+    {
+        found += map.count(query);
+    }
+    end = clock();
+    print_results(MAP_FIND, max_sz, begin, end);
+
+    if (found == 0)
+        puts("no ids found");
+}
+
+void dsmap_rand(void)
+{
+    puts("BUILD AND LOOK UP RANDOM IDS IN A SORTED MAP");
+    dsmap_rand_helper(MED_SIZE);
+    dsmap_rand_helper(LARGE_SIZE / 100);
+}
+
+// DSLOTMAP RAND ///////////////////////////////////////////////////////////////
+// Inserts values into a hash map keyed by sequential IDs, then looks them up
+// and erases them in random order.
+void dslotmap_rand_helper(size_t max_sz)
+{
+    std::vector<uint32_t> order(max_sz);
+    std::iota(order.begin(), order.end(), 0);
+    for (size_t i = max_sz - 1; i > 0; --i)
+    {
+        std::swap(order[i], order[(size_t)rand() % (i + 1)]);
+    }
+    size_t sum = 0;
+
+    std::unordered_map<uint32_t, uint32_t> map;
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        map.emplace((uint32_t)i, (uint32_t)i);
+    }
+    end = clock();
+    print_results(UMAP_INSERT, max_sz, begin, end);
+
+    begin = clock();
+    for (uint32_t id : order)
+    {
+        sum += map.find(id)->second;
+    }
+    end = clock();
+    print_results(UMAP_FIND, max_sz, begin, end);
+
+    begin = clock();
+    for (uint32_t id : order)
+    {
+        map.erase(id);
+    }
+    end = clock();
+    print_results(UMAP_ERASE, max_sz, begin, end);
+
+    if (sum != max_sz*(max_sz - 1)/2)
+        puts("sums differ");
+}
+
+void dslotmap_rand(void)
+{
+    puts("INSERT, LOOK UP AND ERASE VALUES IN RANDOM ORDER IN A SLOT MAP");
+    dslotmap_rand_helper(MED_SIZE);
+    dslotmap_rand_helper(LARGE_SIZE / 10);
+}
+
+// DJAGGED RAND ////////////////////////////////////////////////////////////////
+// Builds adjacency lists of random length as a vector of vectors, then sums
+// every element of every row NUM_FINDS times.
+void djagged_rand_helper(size_t max_sz)
+{
+    size_t nrows = max_sz / 8;
+    std::vector<size_t> lengths(nrows);
+    for (size_t i = 0; i < nrows; ++i)
+    {
+        lengths[i] = (size_t)rand() % 16;
+    }
+    long long sum = 0;
+
+    begin = clock();
+    std::vector<std::vector<int>> nested(nrows);
+    for (size_t i = 0; i < nrows; ++i)
+    {
+        for (size_t j = 0; j < lengths[i]; ++j)
+        {
+            nested[i].push_back((int)j);
+        }
+    }
+    end = clock();
+    print_results(VVEC_BUILD, nrows, begin, end);
+
+    begin = clock();
+    for (size_t k = 0; k < NUM_FINDS; ++k)
+    {
+        for (const std::vector<int>& row : nested)
+        {
+            for (int value : row)
+            {
+                sum += value;
+            }
+        }
+    }
+    end = clock();
+    print_results(VVEC_SUM, nrows, begin, end);
+
+    if (sum < 0)
+        puts("sum overflowed");
+}
+
+void djagged_rand(void)
+{
+    puts("BUILD AND SUM ROWS OF RANDOM LENGTH IN A JAGGED ARRAY");
+    djagged_rand_helper(MED_SIZE);
+    djagged_rand_helper(LARGE_SIZE / 10);
+}
+
+// DPACKED RAND ////////////////////////////////////////////////////////////////
+// Pushes random 12-bit values into a vector of uint32_t and reads them back.
+void dpacked_rand_helper(size_t max_sz)
+{
+    uint64_t sum = 0;
+    std::vector<uint32_t> vec;
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        vec.push_back((uint32_t)rand() % 4096);
+    }
+    end = clock();
+    print_results(VECTOR_PUSH_U32, max_sz, begin, end);
+
+    begin = clock();
+    for (size_t i = 0; i < max_sz; ++i)
+    {
+        sum += vec[i];
+    }
+    end = clock();
+    print_results(VECTOR_SUM_U32, max_sz, begin, end);
+
+    if (sum > max_sz*4096)
+        puts("sum out of range");
+}
+
+void dpacked_rand(void)
+{
+    puts("PUSH, GET AND UNPACK RANDOM 12-BIT VALUES IN A PACKED ARRAY");
+    dpacked_rand_helper(MED_SIZE);
+    dpacked_rand_helper(LARGE_SIZE);
+}
+
+// FIND RAND ///////////////////////////////////////////////////////////////////
+void find_rand_helper(size_t max_sz)
+{
+    std::vector<int> vec;
+    std::vector<int> keys;
+
+    keys = std::vector<int>(NUM_FINDS);
+    for (int& k : keys)
+    {
+        k = rand();
+    }
+    vec = std::vector<int>(max_sz);
+    for (int& e : vec)
+    {
+        e = rand();
+    }
+    size_t found = 0;
+    begin = clock();
+    for (int k : keys)
+    {
+        found += std::find(vec.begin(), vec.end(), k) - vec.begin();
+    }
+    end = clock();
+    print_results(VECTOR, max_sz, begin, end);
+    if (found == 0)
+        puts("no keys found");
+}
+
+void find_rand(void)
+{
+    puts("LINEAR SEARCH A VECTOR FOR 100 RANDOM VALUES");
+    find_rand_helper(MED_SIZE);
+    find_rand_helper(LARGE_SIZE);
+}
+
+// REDUCE RAND /////////////////////////////////////////////////////////////////
+void reduce_rand(void)
+{
+    std::vector<int> vec;
+
+    puts("SUM AND ARGMAX A VECTOR OF RANDOM INTEGERS (WALL CLOCK)");
+    vec = std::vector<int>(LARGE_SIZE);
+    for (int& e : vec)
+    {
+        e = rand();
+    }
+    double wbegin = wall_msec();
+    int64_t sum = std::accumulate(vec.begin(), vec.end(), int64_t{0});
+    long argmax = std::max_element(vec.begin(), vec.end()) - vec.begin();
+    double wend = wall_msec();
+    print_results_wall(VECTOR, LARGE_SIZE, wbegin, wend);
+    if (sum == 0 && argmax == 0)
+        puts("empty reduction");
+}
+
+// SCAN RAND ///////////////////////////////////////////////////////////////////
+void scan_rand(void)
+{
+    std::vector<int> vec;
+
+    puts("PREFIX SUM A VECTOR OF RANDOM INTEGERS (WALL CLOCK)");
+    vec = std::vector<int>(LARGE_SIZE);
+    for (int& e : vec)
+    {
+        e = rand() % 16;
+    }
+    double wbegin = wall_msec();
+    std::partial_sum(vec.begin(), vec.end(), vec.begin());
+    double wend = wall_msec();
+    print_results_wall(VECTOR, LARGE_SIZE, wbegin, wend);
+}
+
+// PARALLEL FOR SCALING ////////////////////////////////////////////////////////
+void parallel_for_scaling(void)
+{
+    std::vector<unsigned> vec;
+
+    puts("APPLY A SKEWED CPU-BOUND TRANSFORM TO A VECTOR (WALL CLOCK)");
+    vec = std::vector<unsigned>(MED_SIZE);
+    for (unsigned& e : vec)
+    {
+        e = rand();
+    }
+    double wbegin = wall_msec();
+    for (size_t index = 0; index < vec.size(); ++index)
+    {
+        unsigned x = vec[index] | 1;
+        for (size_t i = 0; i < index * 2000 / vec.size(); ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+        }
+        vec[index] = x;
+    }
+    double wend = wall_msec();
+    print_results_wall(VECTOR, MED_SIZE, wbegin, wend);
+}
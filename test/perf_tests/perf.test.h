@@ -1,5 +1,8 @@
 #pragma once
 
+#ifndef _POSIX_C_SOURCE
+#   define _POSIX_C_SOURCE 200809L // clock_gettime
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,14 +11,91 @@
 #define CARR             "built-in array"
 #define DARR             "darray"
 #define DARR_FE          "darray (foreach)"
+#define DARR_SORT        "darray (da_sort)"
+#define DARR_SORT_T      "darray (typed)"
+#define CARR_QSORT       "built-in (qsort)"
+#define DARR_RADIX       "darray (radix)"
+#define DARR_BOUND       "darray (bound)"
+#define DARR_BATCH       "darray (batch)"
+#define DARR_EYTZINGER   "darray (eytz)"
+#define DARR_BTREE       "darray (btree)"
+#define DARR_FIND        "darray (da_find)"
+#define DARR_REDUCE      "darray (reduce)"
+#define DARR_MAP         "darray (da_map)"
+#define DARR_SCAN        "darray (scan)"
+#define DARR_SELECT      "darray (select)"
+#define DARR_INSERT_S    "darray (insert)"
+#define DARR_MERGE_B     "darray (merge)"
+#define DARR_KWAY        "darray (k-way)"
+#define DARR_SET         "darray (set)"
+#define DARR_SET_T       "darray (set u32)"
+#define DARR_HEAP2       "darray (2-heap)"
+#define DARR_HEAP4       "darray (4-heap)"
+#define DMAP_INSERT      "dmap (insert)"
+#define DMAP_FIND        "dmap (find)"
+#define DMAP_ERASE       "dmap (erase)"
+#define DSET_INSERT      "dset (insert)"
+#define DSET_INSERT_B    "dset (bulk ins)"
+#define DSET_FIND        "dset (find)"
+#define DSET_FIND_B      "dset (bulk find)"
+#define DBITS_XOR        "dbits (xor)"
+#define DBITS_POPCOUNT   "dbits (popcount)"
+#define DBITS_RANK       "dbits (rank)"
+#define DBITS_RANK_I     "dbits (rank idx)"
+#define DBITS_SELECT     "dbits (select)"
+#define DBITS_SELECT_I   "dbits (sel idx)"
+#define DARR_AOS_SUM     "darray (AoS sum)"
+#define DSOA_SUM         "dsoa (col sum)"
+#define DSOA_PUSH        "dsoa (push)"
+#define DSOA_FROM_AOS    "dsoa (from AoS)"
+#define DSOA_TO_AOS      "dsoa (to AoS)"
+#define DSMAP_BUILD      "dsmap (bulk)"
+#define DSMAP_FIND       "dsmap (find)"
+#define DSMAP_FIND_CMP   "dsmap (find cmp)"
+#define SLOTMAP_INSERT   "slotmap (insert)"
+#define SLOTMAP_GET      "slotmap (get)"
+#define SLOTMAP_ERASE    "slotmap (erase)"
+#define DARR_NESTED_BLD  "nested (build)"
+#define DARR_NESTED_SUM  "nested (sum)"
+#define DJAGGED_BUILD    "djagged (build)"
+#define DJAGGED_SUM      "djagged (sum)"
+#define DPACKED_PUSH     "dpacked (push)"
+#define DPACKED_GET      "dpacked (get)"
+#define DPACKED_UNPACK   "dpacked (unpack)"
+#define CARR_BSEARCH     "built-in bsearch"
 #define VECTOR           "std::vector"
 #define VECTOR_RF        "std::vector (range-for)"
+#define UMAP_INSERT      "unordered_map (insert)"
+#define UMAP_FIND        "unordered_map (find)"
+#define UMAP_ERASE       "unordered_map (erase)"
+#define USET_INSERT      "unordered_set (insert)"
+#define USET_FIND        "unordered_set (find)"
+#define VBOOL_XOR        "vector<bool> (xor)"
+#define VBOOL_COUNT      "vector<bool> (count)"
+#define VECTOR_AOS_SUM   "std::vector (AoS sum)"
+#define VVEC_BUILD       "vector<vector> (build)"
+#define VVEC_SUM         "vector<vector> (sum)"
+#define VECTOR_PUSH_U32  "std::vector (push u32)"
+#define VECTOR_SUM_U32   "std::vector (sum u32)"
+#define MAP_INSERT       "std::map (insert)"
+#define MAP_FIND         "std::map (find)"
 #define RESULTS_MAY_VARY "*results may vary significantly from run to run"
 #define HR40             "========================================"
 #define SMALL_SIZE 100
+#define NUM_LOOKUPS 1000000
+#define NUM_FINDS   100
 #define MED_SIZE   100000
 #define LARGE_SIZE 100000000
 
+// 64-byte record of which the struct-of-arrays benchmarks sum a single field.
+struct perf_record
+{
+    int id;
+    float pos[3];
+    double mass;
+    char name[40];
+};
+
 #ifdef __cplusplus
 #   define MAX_WIDTH_TYPE_STR VECTOR_RF
 #else
@@ -41,6 +121,26 @@ void print_results(const char* type, size_t nelements, clock_t begin,
         clock_to_msec(end-begin));
 }
 
+// clock() reports CPU time summed across threads, so multi-threaded
+// benchmarks are timed against a monotonic wall clock instead.
+double wall_msec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000.0 + ts.tv_nsec/1000000.0;
+}
+
+void print_results_wall(const char* type, size_t nelements, double begin,
+    double end)
+{
+    printf("%*s%-*s : %10zu elements | %5ld msec\n",
+        INDENT_SPACES,
+        "", /* for indent %*s */
+        WIDTH_OF_MAX_WIDTH_TYPE_STR,
+        type, nelements,
+        (long)(end-begin));
+}
+
 void fill_pre_sized(void);
 void fill_push_back(void);
 void insert_front(void);
@@ -48,6 +148,28 @@ void insert_rand(void);
 void remove_front(void);
 void remove_rand(void);
 void swap_rand(void);
+void map_rand(void);
+void sort_rand(void);
+void radix_sort_rand(void);
+void percentiles_rand(void);
+void parallel_sort_scaling(void);
+void search_rand(void);
+void merge_batch_rand(void);
+void kway_merge_rand(void);
+void set_intersect_rand(void);
+void heap_rand(void);
+void dmap_rand(void);
+void dset_rand(void);
+void dbits_rand(void);
+void dsoa_rand(void);
+void dsmap_rand(void);
+void dslotmap_rand(void);
+void djagged_rand(void);
+void dpacked_rand(void);
+void find_rand(void);
+void reduce_rand(void);
+void scan_rand(void);
+void parallel_for_scaling(void);
 
 int main(void)
 {
@@ -61,7 +183,29 @@ int main(void)
     insert_rand();    putchar('\n');
     remove_front();   putchar('\n');
     remove_rand();    putchar('\n');
-    swap_rand();
+    swap_rand();      putchar('\n');
+    map_rand();       putchar('\n');
+    sort_rand();      putchar('\n');
+    radix_sort_rand(); putchar('\n');
+    percentiles_rand(); putchar('\n');
+    parallel_sort_scaling(); putchar('\n');
+    search_rand();    putchar('\n');
+    merge_batch_rand(); putchar('\n');
+    kway_merge_rand(); putchar('\n');
+    set_intersect_rand(); putchar('\n');
+    heap_rand(); putchar('\n');
+    dmap_rand(); putchar('\n');
+    dset_rand(); putchar('\n');
+    dbits_rand(); putchar('\n');
+    dsoa_rand(); putchar('\n');
+    dsmap_rand(); putchar('\n');
+    dslotmap_rand(); putchar('\n');
+    djagged_rand(); putchar('\n');
+    dpacked_rand(); putchar('\n');
+    find_rand();      putchar('\n');
+    reduce_rand();    putchar('\n');
+    scan_rand();      putchar('\n');
+    parallel_for_scaling();
     puts(HR40 HR40);
     return EXIT_SUCCESS;
 }